@@ -0,0 +1,358 @@
+/**
+ * @file BENCH.c
+ * @brief On-target self-benchmark implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-10-17
+ * @version 1.1
+ */
+
+#include "BENCH.h"
+#include "CRC.h"
+#include "DWT.h"
+#include "I2C.h"
+#include "MAX30101.h"
+#include "PCA9548.h"
+#include "POOL.h"
+#include "SCHED.h"
+#include "STREAM.h"
+#include "TIMER.h"
+#include "stm32f303x8.h"
+#include <math.h>
+#include <stdio.h>
+
+typedef void (*BENCH_Kernel)(uint8_t n);
+
+static const BENCH_Config *bench_config;
+static BENCH_Output bench_output;
+static uint32_t bench_overhead;             /**< Cycles of an empty case */
+static uint8_t bench_cases;
+static char bench_line[96];
+
+static MAX30101_Sample bench_fifo[MAX30101_FIFO_DEPTH]; /**< Landing buffer of the burst cases */
+static PIPE_Block bench_block;
+static STAGE_BiquadState bench_biquad;
+static STAGE_DCBlockerState bench_dcblock;
+
+/** Hampel cases: skip-list state of the longest window, or the Red and IR rings of the reference */
+static union {
+    uint8_t skip[STAGE_HAMPEL_STATE_BYTES(STAGE_HAMPEL_MAX_WINDOW)];
+    float32_t ring[2][STAGE_HAMPEL_MAX_WINDOW];
+} bench_hampel __attribute__((aligned(8))) PIPE_CCM;
+static float32_t bench_hampel_sorted[STAGE_HAMPEL_MAX_WINDOW]; /**< Sort buffer of the reference (also used by the check) */
+static STAGE_HampelConfig bench_hampel_config = { 0, BENCH_HAMPEL_THRESHOLD, BENCH_HAMPEL_MIN_DEV };
+static uint32_t bench_seed;
+static NIRS_KalmanState bench_kalman;
+static NIRS_TsiFit bench_tsi;
+static uint8_t bench_slot;
+
+static void BENCH_Empty(uint8_t n) {
+}
+
+static void BENCH_Select(uint8_t n) {
+    PCA9548_SelectChannel(bench_config->sensor);
+}
+
+static void BENCH_Status(uint8_t n) {
+    (void)MAX30101_ReadFIFOStatus(NULL);
+}
+
+static void BENCH_Burst(uint8_t n) {
+    MAX30101_ReadFIFOBurst(bench_fifo, n);
+}
+
+static void BENCH_Unpack(uint8_t n) {
+    bench_block.count = n;
+    STAGE_Unpack(NULL, &bench_block, NULL);
+}
+
+static void BENCH_Biquad(uint8_t n) {
+    bench_block.count = n;
+    STAGE_Biquad(&bench_biquad, &bench_block, bench_config->biquad);
+}
+
+static void BENCH_DCBlock(uint8_t n) {
+    bench_block.count = n;
+    STAGE_DCBlocker(&bench_dcblock, &bench_block, bench_config->dcblock);
+}
+
+static void BENCH_Kalman(uint8_t n) {
+    for (uint8_t i = 0; i < n; i++) {
+        const float32_t od[NIRS_WAVELENGTHS] = { 1.0e-3f * bench_block.current[i].red / 4096.0f,
+                                                  1.0e-3f * bench_block.current[i].ir / 4096.0f };
+        NIRS_KalmanUpdate(bench_config->kalman, &bench_kalman, od, &bench_block.hb[i]);
+    }
+}
+
+/** Mean currents (nA) at 15, 20, … 50 mm of a 70 % saturated tissue (Tools/nirs_tsi.py, Farrell model) */
+static const MAX30101_CurrentSample bench_tsi_current[STREAM_MAX_SENSORS] = {
+    { 3000.0f, 3000.0f }, { 432.69f, 583.52f }, { 69.17f, 124.06f }, { 11.88f, 28.09f },
+    { 2.14f, 6.67f }, { 0.41f, 1.64f }, { 0.078f, 0.42f }, { 0.016f, 0.11f },
+};
+
+/**
+ * @brief Close of one TSI interval over n detectors 5 mm apart: fit and solve (no frame)
+ */
+static void BENCH_Tsi(uint8_t n) {
+    NIRS_TsiResult result;
+    NIRS_TsiReset(&bench_tsi);
+    for (uint8_t k = 0; k < n; k++) {
+        NIRS_TsiAdd(&bench_tsi, 15.0f + 5.0f * k, &bench_tsi_current[k]);
+    }
+    (void)NIRS_TsiSolve(&bench_tsi, &result);
+}
+
+/**
+ * @brief Synthetic current for the Hampel cases: DC level, 0–51 nA uniform noise and a
+ *        +500 nA spike on about one sample in 16
+ */
+static float32_t BENCH_NextSample(void) {
+    bench_seed = bench_seed * 1664525U + 1013904223U;
+    float32_t x = 20000.0f + (float32_t)(bench_seed >> 22) * 0.05f;
+    return ((bench_seed >> 8) & 0xFU) ? x : x + 500.0f;
+}
+
+static void BENCH_Hampel(uint8_t n) {
+    bench_block.count = 1;
+    bench_block.current[0].red = BENCH_NextSample();
+    bench_block.current[0].ir = BENCH_NextSample();
+    STAGE_Hampel(bench_hampel.skip, &bench_block, &bench_hampel_config);
+}
+
+static void BENCH_Sort(float32_t *v, uint8_t n) {
+    for (uint8_t i = 1; i < n; i++) {
+        float32_t x = v[i];
+        uint8_t j = i;
+        for (; j > 0 && v[j - 1] > x; j--) {
+            v[j] = v[j - 1];
+        }
+        v[j] = x;
+    }
+}
+
+/**
+ * @brief Reference Hampel test: median and MAD from insertion-sorted copies of the window
+ */
+static float32_t BENCH_HampelRef(const float32_t *window, uint8_t n, float32_t x) {
+    float32_t *sorted = bench_hampel_sorted;
+    for (uint8_t i = 0; i < n; i++) {
+        sorted[i] = window[i];
+    }
+    BENCH_Sort(sorted, n);
+    float32_t median = sorted[n / 2];
+    float32_t dev = fabsf(x - median);
+    if (!(dev > bench_hampel_config.min_dev)) {
+        return x;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        sorted[i] = fabsf(window[i] - median);
+    }
+    BENCH_Sort(sorted, n);
+    return (dev > bench_hampel_config.threshold * 1.4826f * sorted[n / 2]) ? median : x;
+}
+
+static void BENCH_HampelSort(uint8_t n) {
+    float32_t *out[2] = { &bench_block.current[0].red, &bench_block.current[0].ir };
+    for (uint8_t c = 0; c < 2; c++) {
+        float32_t x = BENCH_NextSample();
+        bench_hampel.ring[c][bench_slot] = x;
+        *out[c] = BENCH_HampelRef(bench_hampel.ring[c], n, x);
+    }
+    bench_slot = (uint8_t)(bench_slot + 1U == n ? 0U : bench_slot + 1U);
+}
+
+/**
+ * @brief Compare STAGE_Hampel() with BENCH_HampelRef() on every sample of the signal
+ * @details The reference sorts the window held by the skip lists themselves (the Red and
+ *          IR values, in ring order, follow the STAGE_HampelState header), so both tests
+ *          see the same samples. Reported as #BENCHCHECK.
+ * @param n - Window
+ * @return Tested values (Red and IR) where the outputs differ
+ */
+static uint16_t BENCH_HampelCheck(uint8_t n) {
+    const STAGE_HampelState *st = (const STAGE_HampelState *)bench_hampel.skip;
+    uint16_t mismatches = 0;
+    bench_seed = 1;
+    STAGE_HampelInit(bench_hampel.skip, 0, &bench_hampel_config);
+    for (uint16_t k = 0; k < BENCH_HAMPEL_CHECK_SAMPLES; k++) {
+        float32_t x[2] = { BENCH_NextSample(), BENCH_NextSample() };
+        bench_block.count = 1;
+        bench_block.current[0].red = x[0];
+        bench_block.current[0].ir = x[1];
+        STAGE_Hampel(bench_hampel.skip, &bench_block, &bench_hampel_config);
+        if (st->fill < n) {
+            continue;   // window not full yet: the sample passes untested
+        }
+        float32_t y[2] = { bench_block.current[0].red, bench_block.current[0].ir };
+        for (uint8_t c = 0; c < 2; c++) {
+            const float32_t *window = (const float32_t *)((const uint8_t *)(st + 1) + c * STAGE_HAMPEL_CHANNEL_BYTES(n));
+            if (BENCH_HampelRef(window, n, x[c]) != y[c]) {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+static void BENCH_Csv(uint8_t n) {
+    char line[48];
+    for (uint8_t i = 0; i < n; i++) {
+        snprintf(line, sizeof(line), "%.4f,%.4f\r\n", bench_block.filtered[i].red, bench_block.filtered[i].ir);
+    }
+}
+
+static void BENCH_Crc(uint8_t n) {
+    (void)CRC_Ccitt16(CRC_CCITT_INIT, &bench_block.frame->data[2], n);
+}
+
+static void BENCH_CrcSoft(uint8_t n) {
+    (void)CRC_Ccitt16Soft(CRC_CCITT_INIT, &bench_block.frame->data[2], n);
+}
+
+/**
+ * @brief Time one kernel over BENCH_RUNS runs and report it
+ * @param name - Kernel name in the report
+ * @param kernel - Function under test
+ * @param n - Samples (bytes) per run
+ * @return Minimum cycles per run
+ */
+static uint32_t BENCH_Case(const char *name, BENCH_Kernel kernel, uint8_t n) {
+    uint32_t min = UINT32_MAX, max = 0;
+    uint64_t sum = 0;
+    for (uint8_t r = 0; r < BENCH_RUNS; r++) {
+        uint32_t t0 = DWT_GetCycles();
+        kernel(n);
+        uint32_t cycles = DWT_GetCycles() - t0;
+        cycles = (cycles > bench_overhead) ? cycles - bench_overhead : 0;
+        if (cycles < min) min = cycles;
+        if (cycles > max) max = cycles;
+        sum += cycles;
+    }
+    if (bench_output) {
+        snprintf(bench_line, sizeof(bench_line), "#BENCH,%s,%u,%u,%lu,%lu,%lu\r\n",
+                 name, n, BENCH_RUNS,
+                 (unsigned long)min,
+                 (unsigned long)(sum / BENCH_RUNS),
+                 (unsigned long)max);
+        bench_output(bench_line);
+        bench_cases++;
+    }
+    return min;
+}
+
+/**
+ * @brief Run the whole suite and report every case
+ * @details Order: build/clock information, I2C driver cases (the sensor FIFO is
+ *          emptied afterwards), then the processing kernels on the samples read by the
+ *          32-sample burst, copied into a pool frame as the scheduler would leave them.
+ *          Filter states are initialised and marked warm so every run is a steady-state
+ *          block.
+ * @param config - [in] Filter configurations and sensor channel
+ * @param output - Line output function
+ * @return 1 on success, 0 if no pool frame was free for the pipeline cases
+ */
+uint8_t BENCH_Run(const BENCH_Config *config, BENCH_Output output) {
+    static const uint8_t bursts[] = { 1, 8, MAX30101_FIFO_DEPTH };
+    static const uint8_t blocks[] = { 1, SCHED_HANDOFF_SAMPLES, PIPE_BLOCK_SAMPLES };
+    static const uint8_t tsi_sensors[] = { 2, 4, STREAM_MAX_SENSORS };
+    static const uint8_t hampel_windows[] = { 5, 15, 31, STAGE_HAMPEL_MAX_WINDOW };
+    static const uint8_t crc_bytes[] = {
+        STREAM_HEADER_BYTES - 2 + 13,                                       // FILTERED
+        STREAM_HEADER_BYTES - 2 + STREAM_RAW_PAYLOAD(SCHED_HANDOFF_SAMPLES),  // RAW, handoff size
+        STREAM_HEADER_BYTES - 2 + STREAM_RAW_PAYLOAD(STREAM_RAW_CAPACITY),    // RAW, full frame
+    };
+    uint32_t t_start = TIMER_GetMicros();
+    bench_config = config;
+    bench_cases = 0;
+
+    bench_output = NULL;
+    bench_overhead = 0;
+    bench_overhead = BENCH_Case("empty", BENCH_Empty, 0);
+    bench_output = output;
+
+    snprintf(bench_line, sizeof(bench_line), "#BENCHINFO,%s,%s,%lu,%lu,%u,%lu,%u\r\n",
+             __DATE__, __TIME__,
+             (unsigned long)SystemCoreClock,
+             (unsigned long)(FLASH->ACR & FLASH_ACR_LATENCY),
+             (FLASH->ACR & FLASH_ACR_PRFTBS) ? 1U : 0U,
+             (unsigned long)I2C1_BUS_HZ,
+             BENCH_RUNS);
+    output(bench_line);
+
+    BENCH_Case("select", BENCH_Select, 1);
+    PCA9548_SelectChannel(config->sensor);
+    BENCH_Case("status", BENCH_Status, 3);
+    for (uint8_t i = 0; i < sizeof(bursts); i++) {
+        BENCH_Case("burst", BENCH_Burst, bursts[i]);
+    }
+    MAX30101_ResetFIFO();
+
+    POOL_Frame *frame = POOL_Alloc();
+    if (frame == NULL) {
+        output("#BENCHERR,no pool frame\r\n");
+        return 0;
+    }
+    uint8_t *words = &frame->data[STREAM_RAW_SAMPLES_OFFSET];
+    for (uint32_t i = 0; i < PIPE_BLOCK_SAMPLES * MAX30101_SAMPLE_BYTES; i++) {
+        words[i] = ((const uint8_t *)bench_fifo)[i];
+    }
+    bench_block = (PIPE_Block){ .frame = frame, .period_us = MAX30101_GetSamplePeriodUs() };
+    BENCH_Unpack(PIPE_BLOCK_SAMPLES);
+
+    for (uint8_t i = 0; i < sizeof(blocks); i++) {
+        BENCH_Case("unpack", BENCH_Unpack, blocks[i]);
+    }
+    if (config->biquad) {
+        STAGE_BiquadInit(&bench_biquad, config->sensor, config->biquad);
+        bench_biquad.warm = 1;
+        for (uint8_t i = 0; i < sizeof(blocks); i++) {
+            BENCH_Case("biquad", BENCH_Biquad, blocks[i]);
+        }
+    }
+    if (config->dcblock) {
+        bench_dcblock = (STAGE_DCBlockerState){ .warm = 1 };
+        for (uint8_t i = 0; i < sizeof(blocks); i++) {
+            BENCH_Case("dcblock", BENCH_DCBlock, blocks[i]);
+        }
+    }
+    NIRS_KalmanStart(config->kalman, &bench_kalman);
+    for (uint8_t i = 0; i < sizeof(blocks); i++) {
+        BENCH_Case("kalman", BENCH_Kalman, blocks[i]);
+    }
+    for (uint8_t i = 0; i < sizeof(tsi_sensors); i++) {
+        BENCH_Case("tsi", BENCH_Tsi, tsi_sensors[i]);
+    }
+    for (uint8_t i = 0; i < sizeof(hampel_windows); i++) {
+        uint8_t w = hampel_windows[i];
+        bench_hampel_config.window = w;
+        bench_seed = 1;
+        STAGE_HampelInit(bench_hampel.skip, 0, &bench_hampel_config);
+        for (uint8_t k = 0; k < w; k++) {
+            BENCH_Hampel(w);    // fill the window
+        }
+        BENCH_Case("hampel", BENCH_Hampel, w);
+        snprintf(bench_line, sizeof(bench_line), "#BENCHCHECK,hampel,%u,%u,%u\r\n",
+                 w, 2U * (BENCH_HAMPEL_CHECK_SAMPLES - w + 1U), BENCH_HampelCheck(w));
+        output(bench_line);
+    }
+    for (uint8_t i = 0; i < sizeof(hampel_windows); i++) {
+        uint8_t w = hampel_windows[i];
+        bench_seed = 1;
+        bench_slot = 0;
+        for (uint8_t k = 0; k < w; k++) {
+            BENCH_HampelSort(w);
+        }
+        BENCH_Case("hampelsort", BENCH_HampelSort, w);
+    }
+    BENCH_Case("csv", BENCH_Csv, 1);
+    BENCH_Case("csv", BENCH_Csv, SCHED_HANDOFF_SAMPLES);
+    for (uint8_t i = 0; i < sizeof(crc_bytes); i++) {
+        BENCH_Case("crc16", BENCH_Crc, crc_bytes[i]);
+        BENCH_Case("crc16sw", BENCH_CrcSoft, crc_bytes[i]);
+    }
+    POOL_Free(frame);
+
+    snprintf(bench_line, sizeof(bench_line), "#BENCHEND,%u,%lu\r\n",
+             bench_cases, (unsigned long)((TIMER_GetMicros() - t_start) / 1000U));
+    output(bench_line);
+    return 1;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file BENCH.h
+ * @brief On-target self-benchmark of the acquisition drivers and processing kernels
+ * @details Runs a fixed suite on the board itself, so the numbers include flash wait
+ *          states, prefetch, bus contention and the real I2C timing that a host
+ *          benchmark cannot see. Every case is timed with DWT over BENCH_RUNS runs; the
+ *          cost of an empty case is measured first and subtracted.
+ *
+ *  | Kernel | n | Code under test |
+ *  |--------|---|-----------------|
+ *  | select | 1 | PCA9548_SelectChannel() |
+ *  | status | 3 | MAX30101_ReadFIFOStatus() (pointer read) |
+ *  | burst | 1, 8, 32 | MAX30101_ReadFIFOBurst() |
+ *  | unpack | 1, 8, 18 | STAGE_Unpack() |
+ *  | biquad | 1, 8, 18 | STAGE_Biquad() (Chebyshev II cascade) |
+ *  | dcblock | 1, 8, 18 | STAGE_DCBlocker() |
+ *  | kalman | 1, 8, 18 | NIRS_KalmanUpdate() (ΔOD given: without the two log10f() of every ΔHb) |
+ *  | tsi | 2, 4, 8 | NIRS_TsiAdd() per sensor + NIRS_TsiSolve(): close of one STAGE_TSI interval |
+ *  | hampel | 5, 15, 31, 63 | STAGE_Hampel(), one Red + IR sample per run (skip list) |
+ *  | hampelsort | 5, 15, 31, 63 | same test from insertion-sorted copies of the window (the reference) |
+ *  | csv | 1, 8 | CSV line formatter of STAGE_EncodeCsv() (snprintf, no UART) |
+ *  | crc16 | 21, 62, 122 | frame encoder CRC (CRC unit): FILTERED, 8-sample and 18-sample RAW frames |
+ *  | crc16sw | 21, 62, 122 | same frames, software nibble table (CRC_Ccitt16Soft()) |
+ *
+ *  n is samples (bytes for crc16/crc16sw, window for the Hampel cases, sensors for tsi). The Hampel cases run on
+ *  a synthetic noisy current with spikes, after the window has been filled; their
+ *  state lives in CCM SRAM like the pipeline arena. After each hampel case, STAGE_Hampel() is
+ *  checked against the reference on BENCH_HAMPEL_CHECK_SAMPLES samples and the values whose
+ *  outputs differ are reported (#BENCHCHECK, 0 expected). The I2C cases use the sensor on PCA9548 channel
+ *  BENCH_Config.sensor, whose FIFO is emptied afterwards (MAX30101_ResetFIFO()).
+ *
+ * ### Report
+ *  ```
+ *  #BENCHINFO,<build_date>,<build_time>,<core_hz>,<flash_wait_states>,<prefetch>,<i2c_hz>,<runs>
+ *  #BENCH,<kernel>,<n>,<runs>,<min_cycles>,<mean_cycles>,<max_cycles>
+ *  #BENCHCHECK,hampel,<window>,<tested>,<mismatches>
+ *  #BENCHEND,<cases>,<elapsed_ms>
+ *  ```
+ *  The lines go through the caller's output function (STATUS frames or CSV lines).
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-10-17
+ * @version 1.1
+ * @note Blocking. Acquisition must be stopped (SCHED_Stop()) or not started; interrupts
+ *       stay enabled, so max_cycles includes higher-priority handlers while min_cycles
+ *       does not.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include "STAGES.h"
+
+#define BENCH_RUNS          32      /**< Timed runs per case */
+#define BENCH_HAMPEL_THRESHOLD  3.0f    /**< Hampel cases: limit in scaled MADs */
+#define BENCH_HAMPEL_MIN_DEV    0.1f    /**< Hampel cases: deviation always kept (nA) */
+#define BENCH_HAMPEL_CHECK_SAMPLES  512U    /**< Red + IR samples of each Hampel check */
+
+/**
+ * @struct BENCH_Config
+ * @brief Inputs of the suite
+ */
+typedef struct {
+    const STAGE_BiquadConfig *biquad;       /**< Cascade for the biquad cases */
+    const STAGE_DCBlockerConfig *dcblock;   /**< Pole for the dcblock cases */
+    const NIRS_KalmanModel *kalman;         /**< Model for the kalman cases */
+    uint8_t sensor;                         /**< PCA9548 channel of the I2C cases */
+} BENCH_Config;
+
+/**
+ * @brief Report output function (one null-terminated line per call)
+ */
+typedef void (*BENCH_Output)(const char *line);
+
+/**
+ * @brief Run the whole suite and report every case
+ * @param config - [in] Filter configurations and sensor channel
+ * @param output - Line output function
+ * @return 1 on success, 0 if no pool frame was free for the pipeline cases
+ */
+uint8_t BENCH_Run(const BENCH_Config *config, BENCH_Output output);
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,142 @@
+/**
+ * @file BOOT.c
+ * @brief Boot timeline and fast start implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-08-18
+ * @version 1.1
+ */
+
+#include "BOOT.h"
+#include "DWT.h"
+#include "I2C.h"
+#include "MAX30101.h"
+#include "PCA9548.h"
+#include <stdio.h>
+
+static uint32_t boot_cycles[BOOT_MARKS];        /**< DWT value at each mark */
+static uint16_t boot_marked;                    /**< Bit per recorded mark */
+
+/** Sensor configuration chain (I2C1 interrupt) */
+static struct {
+    MAX30101_RegWrite seq[MAX30101_INIT_WRITES];
+    uint8_t num_sensors;
+    uint8_t sensor;             /**< Sensor being configured */
+    uint8_t step;               /**< Next transfer: 0 = channel select, n = seq[n − 1] */
+    uint8_t fail;               /**< Bit per sensor that did not acknowledge */
+    volatile uint8_t busy;
+} boot_chain;
+
+/**
+ * @brief Record the end of a boot phase
+ * @param mark - BOOT_* mark
+ * @return 1 if this call recorded the mark, 0 if it was already set
+ */
+uint8_t BOOT_Mark(uint8_t mark) {
+    if (boot_marked & (1U << mark)) {
+        return 0;
+    }
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq(); // BOOT_SENSORS is marked by the I2C1 interrupt in fast start
+    boot_cycles[mark] = DWT_GetCycles();
+    boot_marked |= (uint16_t)(1U << mark);
+    __set_PRIMASK(primask);
+    return 1;
+}
+
+/**
+ * @brief Completion callback of one chain transfer: start the next one
+ * @details A NACK skips the rest of that sensor. The last completion records
+ *          BOOT_SENSORS from interrupt context.
+ */
+static void BOOT_SensorStep(uint8_t ok) {
+    if (!ok) {
+        boot_chain.fail |= (uint8_t)(1U << boot_chain.sensor);
+        boot_chain.step = MAX30101_INIT_WRITES + 1U;
+    }
+    if (boot_chain.step > MAX30101_INIT_WRITES) {
+        boot_chain.sensor++;
+        boot_chain.step = 0;
+    }
+    if (boot_chain.sensor >= boot_chain.num_sensors) {
+        BOOT_Mark(BOOT_SENSORS);
+        boot_chain.busy = 0;
+        return;
+    }
+    if (boot_chain.step == 0) {
+        boot_chain.step = 1;
+        I2C1_WriteAsync(PCA9548_ADDR, (uint8_t)(1U << boot_chain.sensor), BOOT_SensorStep);
+    } else {
+        const MAX30101_RegWrite *w = &boot_chain.seq[boot_chain.step - 1U];
+        boot_chain.step++;
+        I2C1_WriteRegAsync(SENSOR_ADDR, w->reg, w->value, BOOT_SensorStep);
+    }
+}
+
+/**
+ * @brief Start the asynchronous configuration of every sensor
+ * @details num_sensors × (1 select + MAX30101_INIT_WRITES register writes), one
+ *          transfer per I2C1 completion interrupt.
+ * @param num_sensors - Sensors on PCA9548 channels 0..num_sensors-1
+ * @param red_ma - Red LED current (mA)
+ * @param ir_ma - IR LED current (mA)
+ * @param odr_hz - Sample rate (Hz)
+ * @param hold - 1 = MODE_CONFIG written with SHDN (synchronised release later)
+ * @return 1 if started, 0 if the rate is not supported
+ */
+uint8_t BOOT_StartSensors(uint8_t num_sensors, float32_t red_ma, float32_t ir_ma, uint16_t odr_hz, uint8_t hold) {
+    if (!MAX30101_PrepareNIRSLite(red_ma, ir_ma, odr_hz, boot_chain.seq)) {
+        return 0;
+    }
+    if (hold) {
+        boot_chain.seq[MAX30101_INIT_WRITES - 1U].value |= MAX30101_MODE_SHDN; // MODE_CONFIG is last
+    }
+    boot_chain.num_sensors = num_sensors;
+    boot_chain.sensor = 0;
+    boot_chain.step = 0;
+    boot_chain.fail = 0;
+    boot_chain.busy = 1;
+    BOOT_SensorStep(1);
+    return 1;
+}
+
+/**
+ * @brief Wait for the sensor configuration chain to complete
+ * @return Bit k set if sensor k did not acknowledge
+ */
+uint8_t BOOT_WaitSensors(void) {
+    while (boot_chain.busy) {
+    }
+    return boot_chain.fail;
+}
+
+/**
+ * @brief Format the boot timeline as a report line
+ * @details The clock phase runs mostly at the HSI frequency (PLL lock wait), so its
+ *          cycles are converted at BOOT_HSI_HZ and the later ones at SystemCoreClock.
+ *          Marks not reached are reported as 0.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param fast_start - 1 if the fast start was used
+ * @return Number of characters written (excluding terminator)
+ */
+int BOOT_FormatReport(char *buffer, uint32_t size, uint8_t fast_start) {
+    uint32_t us[BOOT_MARKS];
+    uint32_t clock = boot_cycles[BOOT_CLOCK];
+    uint32_t clock_us = clock / (BOOT_HSI_HZ / 1000000U);
+    for (uint8_t m = 0; m < BOOT_MARKS; m++) {
+        if (!(boot_marked & (1U << m))) {
+            us[m] = 0;
+        } else if (m == BOOT_CLOCK) {
+            us[m] = clock_us;
+        } else {
+            us[m] = clock_us + DWT_CyclesToUs(boot_cycles[m] - clock);
+        }
+    }
+    return snprintf(buffer, size, "#BOOT,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+                    fast_start, boot_chain.fail,
+                    (unsigned long)us[BOOT_CLOCK], (unsigned long)us[BOOT_CONFIG],
+                    (unsigned long)us[BOOT_BUS], (unsigned long)us[BOOT_SENSORS],
+                    (unsigned long)us[BOOT_LINK], (unsigned long)us[BOOT_FILTERS],
+                    (unsigned long)us[BOOT_READY], (unsigned long)us[BOOT_FIRST_SAMPLE],
+                    (unsigned long)us[BOOT_FIRST_OUTPUT]);
+}
@@ -0,0 +1,103 @@
+/**
+ * @file BOOT.h
+ * @brief Boot timeline and fast start
+ * @details Time-stamps the boot sequence with the DWT cycle counter, from main() to the
+ *          first sample leaving the processing chain, and reports it once as a "#BOOT"
+ *          line so power-cycled rigs can see where the start-up time goes.
+ *
+ * ### Marks
+ *  Each mark is the end of a boot phase, in µs since DWT_Init() at the top of main():
+ *
+ *  | Mark | Phase ending |
+ *  |------|--------------|
+ *  | BOOT_CLOCK | clk_config(): PLL lock and switch (counted at the 8 MHz HSI) |
+ *  | BOOT_CONFIG | TIM2 timebase, CONFIG_Load() |
+ *  | BOOT_BUS | LED, I2C1, PCA9548 |
+ *  | BOOT_SENSORS | register writes of every sensor (completion of the chain in fast start) |
+ *  | BOOT_LINK | UART, frame pool, streams, commands, markers |
+ *  | BOOT_FILTERS | DesignFilters(), DesignHbModel(), PIPE_Init() |
+ *  | BOOT_READY | deadlines, scheduler, profile; SCHED_Start() |
+ *  | BOOT_FIRST_SAMPLE | first RAW frame taken by the main loop |
+ *  | BOOT_FIRST_OUTPUT | that frame through the pipeline (queued for the UART) |
+ *
+ *  Report: `#BOOT,<fast_start>,<sensor_fail_mask>,<clock_us>,<config_us>,<bus_us>,
+ *  <sensors_us>,<link_us>,<filters_us>,<ready_us>,<first_sample_us>,<first_output_us>\r\n`.
+ *  The reset handler (SystemInit, RAM initialisation) runs before main() and is not
+ *  included.
+ *
+ * ### Fast Start
+ *  BOOT_StartSensors() sends the sensor configuration as a chain of asynchronous I2C1
+ *  transfers (channel select, then MAX30101_PrepareNIRSLite() with the mode written
+ *  last) driven by the I2C1 interrupt. The main loop meanwhile configures the UART,
+ *  streams and commands and designs the filters, and only waits in BOOT_WaitSensors()
+ *  before the scheduler starts. Sensors that do not acknowledge are reported in
+ *  sensor_fail_mask instead of hanging the blocking driver. The caller also starts the
+ *  filters at the steady state of the first sample (STAGE_WARMUP_STEADY) and hands the
+ *  first frame of every sensor off at once (SCHED_HandoffFirst()).
+ *  With hold = 1 the mode is written with SHDN, so the sensors wait for the
+ *  synchronised release of SCHED_SyncStart() instead of starting one by one.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-08-18
+ * @version 1.1
+ * @note Requires DWT_Init() before clk_config(); fast start requires I2C1_DMA_Config().
+ */
+
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include <stdint.h>
+#include "arm_math_types.h"
+
+#define BOOT_HSI_HZ         8000000U    /**< Core clock until clk_config() switches to the PLL */
+
+/** @name Marks
+ * @{ */
+#define BOOT_CLOCK          0
+#define BOOT_CONFIG         1
+#define BOOT_BUS            2
+#define BOOT_SENSORS        3
+#define BOOT_LINK           4
+#define BOOT_FILTERS        5
+#define BOOT_READY          6
+#define BOOT_FIRST_SAMPLE   7
+#define BOOT_FIRST_OUTPUT   8
+#define BOOT_MARKS          9
+/** @} */
+
+/**
+ * @brief Record the end of a boot phase
+ * @details Only the first call per mark counts; later calls cost one test.
+ * @param mark - BOOT_* mark
+ * @return 1 if this call recorded the mark, 0 if it was already set
+ */
+uint8_t BOOT_Mark(uint8_t mark);
+
+/**
+ * @brief Start the asynchronous configuration of every sensor (fast start)
+ * @param num_sensors - Sensors on PCA9548 channels 0..num_sensors-1
+ * @param red_ma - Red LED current (mA)
+ * @param ir_ma - IR LED current (mA)
+ * @param odr_hz - Sample rate (50, 100, 200 or 400 Hz)
+ * @param hold - 1 = leave every sensor in shutdown for SCHED_SyncStart()
+ * @return 1 if started, 0 if the rate is not supported (nothing sent)
+ * @note Leaves I2C1 to the chain until BOOT_WaitSensors() returns.
+ */
+uint8_t BOOT_StartSensors(uint8_t num_sensors, float32_t red_ma, float32_t ir_ma, uint16_t odr_hz, uint8_t hold);
+
+/**
+ * @brief Wait for the sensor configuration chain to complete
+ * @return Bit k set if sensor k did not acknowledge (its remaining writes skipped)
+ */
+uint8_t BOOT_WaitSensors(void);
+
+/**
+ * @brief Format the boot timeline as a report line
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param fast_start - 1 if the fast start was used
+ * @return Number of characters written (excluding terminator)
+ */
+int BOOT_FormatReport(char *buffer, uint32_t size, uint8_t fast_start);
+
+#endif /* BOOT_H_ */
@@ -0,0 +1,175 @@
+/**
+ * @file CMD.c
+ * @brief Host → device command receiver implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-16
+ * @version 1.0
+ */
+
+#include "CMD.h"
+#include "STREAM.h"
+#include "CRC.h"
+#include "stm32f303x8.h"
+#include <string.h>
+
+/**
+ * @enum CMD_State
+ * @brief Receive state machine
+ */
+typedef enum {
+    CMD_WAIT_SYNC0,
+    CMD_WAIT_SYNC1,
+    CMD_HEADER,
+    CMD_PAYLOAD,
+    CMD_CRC
+} CMD_State;
+
+static CMD_State cmd_state = CMD_WAIT_SYNC0;
+static uint8_t cmd_header[8];       /**< id, seq, length (2), host time (4) */
+static uint16_t cmd_count;          /**< Bytes received in the current state */
+static uint16_t cmd_crc;            /**< Running CRC over header and payload */
+static uint16_t cmd_rx_crc;         /**< CRC received in the trailer */
+static uint32_t cmd_char_us;        /**< One character time (µs) */
+static CMD_Frame cmd_current;       /**< Frame under reception */
+static volatile uint32_t cmd_errors;
+
+static CMD_Frame cmd_queue[CMD_QUEUE_SIZE];
+static volatile uint8_t cmd_head;   /**< Written by ISR only */
+static volatile uint8_t cmd_tail;   /**< Written by main loop only */
+
+static struct {
+    uint8_t id;
+    CMD_Handler handler;
+} cmd_handlers[CMD_MAX_HANDLERS];
+static uint8_t cmd_num_handlers;
+
+/**
+ * @brief Reset the parser and enable the USART2 receive interrupt
+ * @param baud_rate - UART baud rate
+ * @return void
+ */
+void CMD_Init(uint32_t baud_rate) {
+    cmd_state = CMD_WAIT_SYNC0;
+    cmd_head = cmd_tail = 0;
+    cmd_errors = 0;
+    cmd_char_us = (10U * 1000000U + baud_rate - 1U) / baud_rate; // 8N1 = 10 bit times, rounded up
+    NVIC_SetPriority(USART2_IRQn, CMD_IRQ_PRIORITY);
+    NVIC_EnableIRQ(USART2_IRQn);
+}
+
+/**
+ * @brief Register the handler of one command ID
+ * @param id - Command identifier
+ * @param handler - Function called from CMD_Poll()
+ * @return 1 on success, 0 if the table is full
+ */
+uint8_t CMD_Register(uint8_t id, CMD_Handler handler) {
+    if (cmd_num_handlers >= CMD_MAX_HANDLERS) {
+        return 0;
+    }
+    cmd_handlers[cmd_num_handlers].id = id;
+    cmd_handlers[cmd_num_handlers].handler = handler;
+    cmd_num_handlers++;
+    return 1;
+}
+
+/**
+ * @brief Feed one received byte to the parser (USART2 ISR context)
+ * @details The CRC is updated byte by byte so a frame is validated as soon as its last
+ *          byte arrives. Valid frames are copied into the command queue; if the queue is
+ *          full the frame is counted as an error and discarded.
+ * @param byte - Received byte
+ * @param now_us - TIM2 time at which the byte was read
+ * @return void
+ */
+void CMD_RxByte(uint8_t byte, uint32_t now_us) {
+    switch (cmd_state) {
+        case CMD_WAIT_SYNC0:
+            if (byte == STREAM_SYNC0) {
+                cmd_current.rx_time_us = now_us - cmd_char_us;
+                cmd_state = CMD_WAIT_SYNC1;
+            }
+            break;
+        case CMD_WAIT_SYNC1:
+            if (byte == STREAM_SYNC1) {
+                cmd_count = 0;
+                cmd_crc = CRC_CCITT_INIT;
+                cmd_state = CMD_HEADER;
+            } else if (byte == STREAM_SYNC0) {
+                // Repeated first sync byte: the frame starts at this byte
+                cmd_current.rx_time_us = now_us - cmd_char_us;
+            } else {
+                cmd_state = CMD_WAIT_SYNC0;
+            }
+            break;
+        case CMD_HEADER:
+            cmd_header[cmd_count++] = byte;
+            cmd_crc = CRC_Ccitt16Soft(cmd_crc, &byte, 1);
+            if (cmd_count == sizeof(cmd_header)) {
+                cmd_current.id = cmd_header[0];
+                cmd_current.seq = cmd_header[1];
+                uint16_t length = (uint16_t)(cmd_header[2] | (cmd_header[3] << 8));
+                cmd_current.host_time = (uint32_t)cmd_header[4] | ((uint32_t)cmd_header[5] << 8) |
+                                        ((uint32_t)cmd_header[6] << 16) | ((uint32_t)cmd_header[7] << 24);
+                if (length > CMD_MAX_PAYLOAD) {
+                    cmd_errors++;
+                    cmd_state = CMD_WAIT_SYNC0;
+                    break;
+                }
+                cmd_current.length = (uint8_t)length;
+                cmd_count = 0;
+                cmd_state = length ? CMD_PAYLOAD : CMD_CRC;
+            }
+            break;
+        case CMD_PAYLOAD:
+            cmd_current.payload[cmd_count++] = byte;
+            cmd_crc = CRC_Ccitt16Soft(cmd_crc, &byte, 1);
+            if (cmd_count == cmd_current.length) {
+                cmd_count = 0;
+                cmd_state = CMD_CRC;
+            }
+            break;
+        case CMD_CRC:
+            if (cmd_count == 0) {
+                cmd_rx_crc = byte;
+                cmd_count = 1;
+                break;
+            }
+            cmd_rx_crc |= (uint16_t)(byte << 8);
+            cmd_state = CMD_WAIT_SYNC0;
+            uint8_t next = (cmd_head + 1) & (CMD_QUEUE_SIZE - 1);
+            if (cmd_rx_crc != cmd_crc || next == cmd_tail) {
+                cmd_errors++;
+                break;
+            }
+            cmd_queue[cmd_head] = cmd_current;
+            cmd_head = next;
+            break;
+    }
+}
+
+/**
+ * @brief Dispatch queued commands to their handlers (main-loop context)
+ * @details Unknown command IDs are discarded silently.
+ * @return void
+ */
+void CMD_Poll(void) {
+    while (cmd_tail != cmd_head) {
+        const CMD_Frame *frame = &cmd_queue[cmd_tail];
+        for (uint8_t i = 0; i < cmd_num_handlers; i++) {
+            if (cmd_handlers[i].id == frame->id) {
+                cmd_handlers[i].handler(frame);
+                break;
+            }
+        }
+        cmd_tail = (cmd_tail + 1) & (CMD_QUEUE_SIZE - 1);
+    }
+}
+
+/**
+ * @brief Number of frames rejected by the parser
+ * @return Error count
+ */
+uint32_t CMD_GetErrorCount(void) {
+    return cmd_errors;
+}
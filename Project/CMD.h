@@ -0,0 +1,107 @@
+/**
+ * @file CMD.h
+ * @brief Host → device command receiver on USART2 RX
+ * @details Parses host frames byte by byte in the USART2 receive interrupt and hands
+ *          complete, CRC-checked frames to the main loop, where registered handlers run.
+ *          Host frames use the same layout as device frames (STREAM.h):
+ *
+ *  ```
+ *  A5 5A | command id u8 | seq u8 | length u16 | host time u32 | payload | CRC-16 u16
+ *  ```
+ *
+ * ### Receive Timestamps
+ *  The TIM2 time of the first sync byte is latched in the ISR and corrected by one
+ *  character time (the RXNE flag rises after the stop bit), so rx_time_us is the device
+ *  time at which the frame started on the wire.
+ *
+ * ### Command IDs
+ *  | ID | Command | Handler |
+ *  |----|---------|---------|
+ *  | 0x80 | PING (clock synchronisation) | SYNC_HandlePing |
+ *  | 0x81 | BENCH (run the self-benchmark, no payload) | main.c HandleBench |
+ *  | 0x82 | PROFILE (payload: profile ID u8, see PROFILE.h) | main.c HandleProfile |
+ *  | 0x83 | CONFIG (payload: operation u8 [, key u8 + value u32 ...], see CONFIG.h) | main.c HandleConfig |
+ *  | 0x84 | SUMMARY (payload: window ms u16 [, full rate u8], see STREAM.h) | main.c HandleSummary |
+ *  | 0x85 | DEADBAND (payload: threshold f32 nA, max silence ms u16, see STAGES.h) | main.c HandleDeadband |
+ *  | 0x86 | TRACE (payload: op u8, 0 = dump now, 1 = dump at the next fault, see TRACE.h) | TRACE_HandleCommand |
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-16
+ * @version 1.0
+ * @note USART2 RX runs at a higher NVIC priority than SysTick so that bytes are not
+ *       lost while the acquisition ISR blocks on I2C.
+ */
+
+#ifndef CMD_H_
+#define CMD_H_
+
+#include <stdint.h>
+
+#define CMD_MAX_PAYLOAD     32      /**< Largest accepted command payload (bytes) */
+#define CMD_QUEUE_SIZE      4       /**< ISR → main command queue depth (power of two) */
+#define CMD_MAX_HANDLERS    8       /**< Registered command handlers */
+#define CMD_IRQ_PRIORITY    1       /**< USART2 NVIC priority (SysTick runs at 15) */
+
+#define CMD_PING            0x80    /**< Clock synchronisation ping */
+#define CMD_BENCH           0x81    /**< Run the on-target benchmark (BENCH.h) */
+#define CMD_PROFILE         0x82    /**< Select the operating profile (PROFILE.h) */
+#define CMD_CONFIG          0x83    /**< Read or store the persistent configuration (CONFIG.h) */
+#define CMD_SUMMARY         0x84    /**< Set the summary window and the full-rate streams (STAGE_SUMMARY) */
+#define CMD_DEADBAND        0x85    /**< Set the change-driven output threshold (STAGE_DEADBAND) */
+#define CMD_TRACE           0x86    /**< Dump the event trace ring (TRACE.h) */
+
+/**
+ * @struct CMD_Frame
+ * @brief One received host command
+ */
+typedef struct {
+    uint8_t id;                         /**< Command identifier */
+    uint8_t seq;                        /**< Host sequence number */
+    uint8_t length;                     /**< Payload length */
+    uint32_t host_time;                 /**< Host time field (low 32 bits, host-defined) */
+    uint32_t rx_time_us;                /**< Device time of the first sync byte (TIM2) */
+    uint8_t payload[CMD_MAX_PAYLOAD];   /**< Payload bytes */
+} CMD_Frame;
+
+/**
+ * @brief Command handler prototype (runs in main-loop context)
+ */
+typedef void (*CMD_Handler)(const CMD_Frame *frame);
+
+/**
+ * @brief Reset the parser and enable the USART2 receive interrupt
+ * @param baud_rate - UART baud rate (for the one-character timestamp correction)
+ * @return void
+ * @note Requires UART_Config() and TIMER_Init().
+ */
+void CMD_Init(uint32_t baud_rate);
+
+/**
+ * @brief Register the handler of one command ID
+ * @param id - Command identifier
+ * @param handler - Function called from CMD_Poll()
+ * @return 1 on success, 0 if the table is full
+ */
+uint8_t CMD_Register(uint8_t id, CMD_Handler handler);
+
+/**
+ * @brief Feed one received byte to the parser (USART2 ISR context)
+ * @param byte - Received byte
+ * @param now_us - TIM2 time at which the byte was read
+ * @return void
+ */
+void CMD_RxByte(uint8_t byte, uint32_t now_us);
+
+/**
+ * @brief Dispatch queued commands to their handlers (main-loop context)
+ * @return void
+ */
+void CMD_Poll(void);
+
+/**
+ * @brief Number of frames rejected by the parser (bad CRC or oversize)
+ * @return Error count
+ */
+uint32_t CMD_GetErrorCount(void);
+
+#endif /* CMD_H_ */
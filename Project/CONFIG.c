@@ -0,0 +1,385 @@
+/**
+ * @file CONFIG.c
+ * @brief Persistent device configuration implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-08-11
+ * @version 1.0
+ */
+
+#include "CONFIG.h"
+#include "DWT.h"
+#include "PROFILE.h"
+#include "STAGES.h"
+#include "CRC.h"
+#include "stm32f303x8.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CONFIG_CRC_OFFSET   (CONFIG_RECORD_SIZE - 2U)
+#define CONFIG_PARAM_OFFSET 8U
+
+static CONFIG_Params config_stored;     /**< Newest stored parameters (or the defaults) */
+static uint32_t config_seq;             /**< seq of the newest record, 0 if none */
+static uint8_t config_page;             /**< Page holding the newest record */
+static uint8_t config_next;             /**< First erased slot of that page (CONFIG_SLOTS if full) */
+static uint8_t config_spare_erased;     /**< The other page is erased (a save may switch to it) */
+static uint8_t config_status;
+static uint32_t config_load_cycles;
+
+static inline const uint8_t *CONFIG_Slot(uint8_t page, uint8_t slot) {
+    return (const uint8_t *)(CONFIG_FLASH_BASE + page * CONFIG_PAGE_SIZE + slot * CONFIG_RECORD_SIZE);
+}
+
+static inline uint8_t CONFIG_SlotErased(uint8_t page, uint8_t slot) {
+    return *(const volatile uint32_t *)CONFIG_Slot(page, slot) == 0xFFFFFFFFUL;
+}
+
+static inline uint32_t CONFIG_Get32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void CONFIG_Put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t CONFIG_FloatBits(float32_t f) {
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+static inline float32_t CONFIG_BitsFloat(uint32_t v) {
+    float32_t f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+/**
+ * @brief Serialize parameters into the parameter bytes of a record
+ */
+static void CONFIG_Encode(const CONFIG_Params *params, uint8_t *p) {
+    CONFIG_Put32(&p[0], params->baud_rate);
+    CONFIG_Put32(&p[4], CONFIG_FloatBits(params->filter_cutoff_hz));
+    CONFIG_Put32(&p[8], CONFIG_FloatBits(params->led_red_ma));
+    CONFIG_Put32(&p[12], CONFIG_FloatBits(params->led_ir_ma));
+    p[16] = (uint8_t)params->odr_hz;
+    p[17] = (uint8_t)(params->odr_hz >> 8);
+    p[18] = params->num_sensors;
+    p[19] = params->profile;
+    p[20] = params->filter_order;
+    p[21] = params->filter_stop_db;
+}
+
+/**
+ * @brief Deserialize the first length parameter bytes over params
+ * @details Parameters beyond length keep their previous (default) values.
+ */
+static void CONFIG_Decode(const uint8_t *p, uint8_t length, CONFIG_Params *params) {
+    uint8_t b[CONFIG_PARAM_BYTES];
+    uint8_t n = (length < CONFIG_PARAM_BYTES) ? length : (uint8_t)CONFIG_PARAM_BYTES;
+    CONFIG_Encode(params, b);
+    memcpy(b, p, n);
+    params->baud_rate = CONFIG_Get32(&b[0]);
+    params->filter_cutoff_hz = CONFIG_BitsFloat(CONFIG_Get32(&b[4]));
+    params->led_red_ma = CONFIG_BitsFloat(CONFIG_Get32(&b[8]));
+    params->led_ir_ma = CONFIG_BitsFloat(CONFIG_Get32(&b[12]));
+    params->odr_hz = (uint16_t)(b[16] | (b[17] << 8));
+    params->num_sensors = b[18];
+    params->profile = b[19];
+    params->filter_order = b[20];
+    params->filter_stop_db = b[21];
+}
+
+/**
+ * @brief Record CRC (bytes 0 to CONFIG_CRC_OFFSET − 1)
+ */
+static inline uint16_t CONFIG_Crc(const uint8_t *record) {
+    return CRC_Ccitt16(CRC_CCITT_INIT, record, CONFIG_CRC_OFFSET);
+}
+
+/**
+ * @brief Check magic and CRC of a programmed slot
+ */
+static uint8_t CONFIG_RecordValid(const uint8_t *record) {
+    uint16_t magic = (uint16_t)(record[0] | (record[1] << 8));
+    uint16_t crc = (uint16_t)(record[CONFIG_CRC_OFFSET] | (record[CONFIG_CRC_OFFSET + 1] << 8));
+    return magic == CONFIG_MAGIC && record[2] >= 1 && crc == CONFIG_Crc(record);
+}
+
+/**
+ * @brief First erased slot of a page (binary search)
+ * @details Slots are programmed in order, so the programmed ones form a prefix; an
+ *          interrupted record has its magic programmed and counts as used.
+ * @return Slot index, CONFIG_SLOTS if the page is full
+ */
+static uint8_t CONFIG_FindNext(uint8_t page) {
+    uint8_t lo = 0;
+    uint8_t hi = CONFIG_SLOTS;
+    while (lo < hi) {
+        uint8_t mid = (uint8_t)((lo + hi) / 2U);
+        if (CONFIG_SlotErased(page, mid)) {
+            hi = mid;
+        } else {
+            lo = (uint8_t)(mid + 1U);
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Unlock the flash controller for programming or erasing
+ */
+static void CONFIG_Unlock(void) {
+    if (FLASH->CR & FLASH_CR_LOCK) {
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
+    }
+}
+
+/**
+ * @brief Wait for the current operation and clear its status flags
+ * @return 1 if it ended without a programming or write-protection error
+ */
+static uint8_t CONFIG_Wait(void) {
+    while (FLASH->SR & FLASH_SR_BSY) {
+    }
+    uint32_t sr = FLASH->SR & (FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR);
+    FLASH->SR = sr;     // write 1 to clear
+    return (sr & (FLASH_SR_PGERR | FLASH_SR_WRPERR)) == 0U;
+}
+
+/**
+ * @brief Erase one configuration page
+ */
+static uint8_t CONFIG_ErasePage(uint8_t page) {
+    FLASH->CR |= FLASH_CR_PER;
+    FLASH->AR = CONFIG_FLASH_BASE + page * CONFIG_PAGE_SIZE;
+    FLASH->CR |= FLASH_CR_STRT;
+    uint8_t ok = CONFIG_Wait();
+    FLASH->CR &= ~FLASH_CR_PER;
+    return ok;
+}
+
+/**
+ * @brief Check that every word of a configuration page reads erased
+ */
+static uint8_t CONFIG_PageErased(uint8_t page) {
+    const volatile uint32_t *w = (const volatile uint32_t *)CONFIG_Slot(page, 0);
+    for (uint32_t i = 0; i < CONFIG_PAGE_SIZE / 4U; i++) {
+        if (w[i] != 0xFFFFFFFFUL) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Program one record, CRC half-word last
+ */
+static uint8_t CONFIG_Program(uint8_t page, uint8_t slot, const uint8_t *record) {
+    volatile uint16_t *dst = (volatile uint16_t *)CONFIG_Slot(page, slot);
+    uint8_t ok = 1;
+    FLASH->CR |= FLASH_CR_PG;
+    for (uint32_t i = 0; i < CONFIG_RECORD_SIZE / 2U && ok; i++) {
+        dst[i] = (uint16_t)(record[2U * i] | (record[2U * i + 1U] << 8));
+        ok = CONFIG_Wait();
+    }
+    FLASH->CR &= ~FLASH_CR_PG;
+    return ok && memcmp((const void *)dst, record, CONFIG_RECORD_SIZE) == 0;
+}
+
+/**
+ * @brief Load the newest valid stored configuration
+ * @details For each page: first erased slot by binary search, then back to the last
+ *          record with a valid CRC; the higher seq of the two pages wins. The record is
+ *          decoded over the defaults and must pass CONFIG_Validate(). The other page is
+ *          then erased if it is not already (20–40 ms, once per CONFIG_SLOTS saves), so
+ *          later saves never erase while acquisition runs.
+ * @param defaults - [in] Compiled-in parameters (used when nothing valid is stored)
+ * @param params - [out] Parameters to boot with
+ * @return CONFIG_OK, CONFIG_EMPTY or CONFIG_INVALID
+ */
+uint8_t CONFIG_Load(const CONFIG_Params *defaults, CONFIG_Params *params) {
+    uint32_t t0 = DWT_GetCycles();
+    const uint8_t *newest = NULL;
+    uint8_t next[CONFIG_PAGES];
+
+    config_seq = 0;
+    config_page = 0;
+    for (uint8_t page = 0; page < CONFIG_PAGES; page++) {
+        next[page] = CONFIG_FindNext(page);
+        for (uint8_t slot = next[page]; slot-- > 0;) {
+            const uint8_t *record = CONFIG_Slot(page, slot);
+            if (CONFIG_RecordValid(record)) {
+                uint32_t seq = CONFIG_Get32(&record[4]);
+                if (newest == NULL || (int32_t)(seq - config_seq) > 0) {
+                    newest = record;
+                    config_seq = seq;
+                    config_page = page;
+                }
+                break;
+            }
+        }
+    }
+    config_next = next[config_page];
+
+    // Erase the other page now, while no sensor, UART or SysTick runs, so a save never erases
+    uint8_t spare = (uint8_t)(config_page ^ 1U);
+    config_spare_erased = CONFIG_PageErased(spare);
+    if (!config_spare_erased) {
+        CONFIG_Unlock();
+        config_spare_erased = CONFIG_ErasePage(spare) && CONFIG_PageErased(spare);
+        FLASH->CR |= FLASH_CR_LOCK;
+    }
+
+    config_stored = *defaults;
+    config_status = CONFIG_EMPTY;
+    if (newest != NULL) {
+        CONFIG_Params stored = *defaults;
+        CONFIG_Decode(&newest[CONFIG_PARAM_OFFSET], newest[3], &stored);
+        if (CONFIG_Validate(&stored)) {
+            config_stored = stored;
+            config_status = CONFIG_OK;
+        } else {
+            config_status = CONFIG_INVALID;
+        }
+    }
+    *params = config_stored;
+    config_load_cycles = DWT_GetCycles() - t0;
+    return config_status;
+}
+
+/**
+ * @brief Check a parameter set against the ranges the firmware supports
+ * @details Sensors 1–CONFIG_MAX_SENSORS, ODR 50/100/200/400 Hz, LED currents
+ *          0–CONFIG_MAX_LED_MA, baud 9600–4 Mbit/s, a known profile, filter order
+ *          1–2·STAGE_BIQUAD_MAX_SECTIONS, cut-off below ODR/8 (DC blocker α > 0) and a
+ *          stopband of 20–120 dB.
+ * @param params - [in] Parameters
+ * @return 1 if valid, 0 otherwise
+ */
+uint8_t CONFIG_Validate(const CONFIG_Params *params) {
+    uint16_t odr = params->odr_hz;
+    return params->num_sensors >= 1 && params->num_sensors <= CONFIG_MAX_SENSORS
+        && (odr == 50 || odr == 100 || odr == 200 || odr == 400)
+        && params->led_red_ma >= 0.0f && params->led_red_ma <= CONFIG_MAX_LED_MA
+        && params->led_ir_ma >= 0.0f && params->led_ir_ma <= CONFIG_MAX_LED_MA
+        && params->baud_rate >= 9600U && params->baud_rate <= 4000000U
+        && params->profile < PROFILE_COUNT
+        && params->filter_order >= 1 && params->filter_order <= 2 * STAGE_BIQUAD_MAX_SECTIONS
+        && params->filter_cutoff_hz > 0.0f && params->filter_cutoff_hz < (float32_t)odr / 8.0f
+        && params->filter_stop_db >= 20 && params->filter_stop_db <= 120;
+}
+
+/**
+ * @brief Change one parameter by key
+ * @param params - [in,out] Parameters
+ * @param key - CONFIG_KEY_* identifier
+ * @param value - New value (IEEE-754 bits for float parameters)
+ * @details Changed means the stored bytes differ (float parameters compare as bits),
+ *          so a value that truncates to the current one is CONFIG_FIELD_SAME.
+ * @return CONFIG_FIELD_UNKNOWN, CONFIG_FIELD_SAME or CONFIG_FIELD_CHANGED
+ */
+uint8_t CONFIG_SetField(CONFIG_Params *params, uint8_t key, uint32_t value) {
+    uint8_t before[CONFIG_PARAM_BYTES], after[CONFIG_PARAM_BYTES];
+    CONFIG_Encode(params, before);
+    switch (key) {
+        case CONFIG_KEY_SENSORS:      params->num_sensors = (uint8_t)value; break;
+        case CONFIG_KEY_ODR_HZ:       params->odr_hz = (uint16_t)value; break;
+        case CONFIG_KEY_LED_RED_MA:   params->led_red_ma = CONFIG_BitsFloat(value); break;
+        case CONFIG_KEY_LED_IR_MA:    params->led_ir_ma = CONFIG_BitsFloat(value); break;
+        case CONFIG_KEY_BAUD_RATE:    params->baud_rate = value; break;
+        case CONFIG_KEY_PROFILE:      params->profile = (uint8_t)value; break;
+        case CONFIG_KEY_FILTER_ORDER: params->filter_order = (uint8_t)value; break;
+        case CONFIG_KEY_CUTOFF_HZ:    params->filter_cutoff_hz = CONFIG_BitsFloat(value); break;
+        case CONFIG_KEY_STOP_DB:      params->filter_stop_db = (uint8_t)value; break;
+        default:                      return CONFIG_FIELD_UNKNOWN;
+    }
+    CONFIG_Encode(params, after);
+    return memcmp(before, after, sizeof(before)) ? CONFIG_FIELD_CHANGED : CONFIG_FIELD_SAME;
+}
+
+/**
+ * @brief Append a parameter set as the newest record
+ * @details Goes to the next erased slot of the page holding the newest record; when that
+ *          page is full, the record becomes slot 0 of the other page, erased at boot by
+ *          CONFIG_Load(). If that page has been used since the boot, nothing is written.
+ *          The record is read back after programming.
+ * @param params - [in] Parameters (must pass CONFIG_Validate())
+ * @return CONFIG_OK, CONFIG_INVALID, CONFIG_ERASE_PENDING or CONFIG_FLASH_ERROR
+ */
+uint8_t CONFIG_Save(const CONFIG_Params *params) {
+    uint8_t record[CONFIG_RECORD_SIZE];
+    if (!CONFIG_Validate(params)) {
+        config_status = CONFIG_INVALID;
+        return config_status;
+    }
+    uint32_t seq = config_seq + 1U;
+    memset(record, 0, sizeof(record));
+    record[0] = (uint8_t)CONFIG_MAGIC;
+    record[1] = (uint8_t)(CONFIG_MAGIC >> 8);
+    record[2] = CONFIG_VERSION;
+    record[3] = CONFIG_PARAM_BYTES;
+    CONFIG_Put32(&record[4], seq);
+    CONFIG_Encode(params, &record[CONFIG_PARAM_OFFSET]);
+    uint16_t crc = CONFIG_Crc(record);
+    record[CONFIG_CRC_OFFSET] = (uint8_t)crc;
+    record[CONFIG_CRC_OFFSET + 1U] = (uint8_t)(crc >> 8);
+
+    uint8_t page = config_page;
+    uint8_t slot = config_next;
+    if (slot >= CONFIG_SLOTS) {
+        if (!config_spare_erased) {
+            config_status = CONFIG_ERASE_PENDING;   // erasing now would stall acquisition
+            return config_status;
+        }
+        page = (uint8_t)(page ^ 1U);
+        slot = 0;
+        config_spare_erased = 0;    // the full page is erased at the next boot
+    }
+    CONFIG_Unlock();
+    uint8_t ok = CONFIG_Program(page, slot, record);
+    FLASH->CR |= FLASH_CR_LOCK;
+
+    if (!ok) {
+        // The slot is spoilt either way; the next save moves past it
+        config_page = page;
+        config_next = (uint8_t)(slot + 1U);
+        config_status = CONFIG_FLASH_ERROR;
+        return config_status;
+    }
+    config_stored = *params;
+    config_seq = seq;
+    config_page = page;
+    config_next = (uint8_t)(slot + 1U);
+    config_status = CONFIG_OK;
+    return config_status;
+}
+
+/**
+ * @brief Stored configuration (what the next boot will use)
+ * @return Pointer to the newest stored parameters, or the defaults if none
+ */
+const CONFIG_Params *CONFIG_GetStored(void) {
+    return &config_stored;
+}
+
+/**
+ * @brief Format the stored configuration as a report line
+ * @details Format: `#CONFIG,<status>,<seq>,<load_cycles>,<sensors>,<odr_hz>,<led_red_ma>,
+ *          <led_ir_ma>,<baud>,<profile>,<filter_order>,<cutoff_hz>,<stop_db>\r\n`.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int CONFIG_FormatReport(char *buffer, uint32_t size) {
+    const CONFIG_Params *p = &config_stored;
+    return snprintf(buffer, size, "#CONFIG,%u,%lu,%lu,%u,%u,%.1f,%.1f,%lu,%u,%u,%.4f,%u\r\n",
+                    config_status, (unsigned long)config_seq, (unsigned long)config_load_cycles,
+                    p->num_sensors, p->odr_hz, (double)p->led_red_ma, (double)p->led_ir_ma,
+                    (unsigned long)p->baud_rate, p->profile, p->filter_order,
+                    (double)p->filter_cutoff_hz, p->filter_stop_db);
+}
@@ -0,0 +1,193 @@
+/**
+ * @file CONFIG.h
+ * @brief Persistent device configuration in a reserved flash area
+ * @details Keeps the operational parameters (sensor count, ODR, LED currents, filter,
+ *          baud rate, boot profile) in the last two 2 KB flash pages, so a device boots
+ *          straight into the streaming configuration it was given over the command link
+ *          instead of the compiled-in defaults.
+ *
+ * ### Record
+ *  Fixed 32-byte records, appended one after the other (64 per page):
+ *
+ *  | Offset | Field | Notes |
+ *  |--------|-------|-------|
+ *  | 0 | magic u16 | CONFIG_MAGIC |
+ *  | 2 | version u8 | layout version (CONFIG_VERSION) |
+ *  | 3 | length u8 | parameter bytes in use (CONFIG_PARAM_BYTES) |
+ *  | 4 | seq u32 | incremented by every save |
+ *  | 8 | parameters | little-endian, see below, unused bytes 0 |
+ *  | 30 | CRC-16 u16 | CCITT-FALSE over bytes 0–29, programmed last |
+ *
+ *  | Offset | Parameter |
+ *  |--------|-----------|
+ *  | 8 | baud_rate u32 |
+ *  | 12 | filter_cutoff_hz f32 |
+ *  | 16 | led_red_ma f32 |
+ *  | 20 | led_ir_ma f32 |
+ *  | 24 | odr_hz u16 |
+ *  | 26 | num_sensors u8 |
+ *  | 27 | profile u8 |
+ *  | 28 | filter_order u8 |
+ *  | 29 | filter_stop_db u8 |
+ *
+ *  A later layout only appends parameters: a record with a shorter length fills the
+ *  leading parameters and leaves the rest at their defaults, a longer one is read as far
+ *  as this version knows.
+ *
+ * ### Wear Levelling
+ *  Saves append to the page holding the newest record; when it is full the record goes
+ *  to the first slot of the other page. That page is erased at boot (CONFIG_Load()),
+ *  never by a save, so each page is erased once per 64 saves. The newest valid record
+ *  always survives a reset during a save or an erase: an interrupted record fails its
+ *  CRC and the previous one is used.
+ *
+ * ### Load
+ *  Records are programmed in slot order, so the first erased slot of each page is found
+ *  by binary search (6 reads). From there the loader steps back to the last record with
+ *  a valid CRC and keeps the higher seq of the two pages; a few microseconds at boot
+ *  (the cycles are reported). A record that fails CONFIG_Validate() is ignored. If the
+ *  other page is not erased it is erased here, before the sensors, the UART and SysTick
+ *  start: 20–40 ms more on the first boot after a page has filled.
+ *
+ * ### Save Timing
+ *  A save only programs its record: 16 half-words of about 50 µs each (~0.8 ms). Flash
+ *  programming stalls instruction fetches, interrupts included, but only for one
+ *  half-word at a time; pending interrupts run between half-words, so a SysTick slot or
+ *  an I2C/DMA handler starts at most ~50 µs late and acquisition continues unchanged.
+ *  The 20–40 ms page erase runs only at boot. When the page in use fills up again
+ *  before the next boot, the save is refused with CONFIG_ERASE_PENDING (nothing
+ *  written): reset (CONFIG_OP_RESET) and repeat it. Bytes arriving on USART2 during a
+ *  save may overrun, so the host waits for the "#CONFIG" answer before its next command.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-08-11
+ * @version 1.0
+ * @note The linker region __ROM0_SIZE (RTE regions_STM32F303K8Tx.h) ends before
+ *       CONFIG_FLASH_BASE, so the program can never be placed in the configuration pages.
+ *       New parameters take effect after a reset (CMD_CONFIG op CONFIG_OP_RESET).
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stdint.h>
+#include "arm_math_types.h"
+
+#define CONFIG_FLASH_BASE   0x0800F000UL    /**< First of the two configuration pages */
+#define CONFIG_PAGE_SIZE    2048U           /**< STM32F303K8 flash page */
+#define CONFIG_PAGES        2
+#define CONFIG_RECORD_SIZE  32U
+#define CONFIG_SLOTS        (CONFIG_PAGE_SIZE / CONFIG_RECORD_SIZE)
+#define CONFIG_MAGIC        0xC0F1U
+#define CONFIG_VERSION      1
+#define CONFIG_PARAM_BYTES  22U             /**< Parameter bytes of CONFIG_VERSION */
+
+#define CONFIG_MAX_SENSORS  8               /**< PCA9548 downstream channels */
+#define CONFIG_MAX_LED_MA   51.0f           /**< MAX30101 LED pulse amplitude limit */
+
+/** @name Load and save status
+ * @{ */
+#define CONFIG_OK           0       /**< Newest stored record loaded */
+#define CONFIG_EMPTY        1       /**< Nothing stored, defaults in use */
+#define CONFIG_INVALID      2       /**< Stored record rejected by CONFIG_Validate(), defaults in use */
+#define CONFIG_FLASH_ERROR  3       /**< Last save failed to program or verify */
+#define CONFIG_ERASE_PENDING 4      /**< Save refused: no erased page until the next boot (reset first) */
+/** @} */
+
+/** @name CMD_CONFIG operations (first payload byte)
+ * @{ */
+#define CONFIG_OP_READ      0       /**< Report the stored configuration */
+#define CONFIG_OP_SET       1       /**< Change fields: (key u8, value u32) pairs, then save if any differs */
+#define CONFIG_OP_DEFAULTS  2       /**< Save the compiled-in defaults */
+#define CONFIG_OP_RESET     3       /**< Report, then reset into the stored configuration */
+/** @} */
+
+/** @name CONFIG_SetField() results
+ * @{ */
+#define CONFIG_FIELD_UNKNOWN    0   /**< Unknown key, params unchanged */
+#define CONFIG_FIELD_SAME       1   /**< Known key, value already stored */
+#define CONFIG_FIELD_CHANGED    2   /**< Known key, value changed */
+/** @} */
+
+/** @name CONFIG_OP_SET keys (float parameters as IEEE-754 bits)
+ * @{ */
+#define CONFIG_KEY_SENSORS      0
+#define CONFIG_KEY_ODR_HZ       1
+#define CONFIG_KEY_LED_RED_MA   2
+#define CONFIG_KEY_LED_IR_MA    3
+#define CONFIG_KEY_BAUD_RATE    4
+#define CONFIG_KEY_PROFILE      5
+#define CONFIG_KEY_FILTER_ORDER 6
+#define CONFIG_KEY_CUTOFF_HZ    7
+#define CONFIG_KEY_STOP_DB      8
+/** @} */
+
+/**
+ * @struct CONFIG_Params
+ * @brief Operational parameters applied at boot
+ */
+typedef struct {
+    uint32_t baud_rate;         /**< USART2 baud rate */
+    float32_t filter_cutoff_hz; /**< High-pass edge (FILTER_CUTOFF_HZ) */
+    float32_t led_red_ma;       /**< Red LED current (mA) */
+    float32_t led_ir_ma;        /**< IR LED current (mA) */
+    uint16_t odr_hz;            /**< Sensor ODR: 50, 100, 200 or 400 */
+    uint8_t num_sensors;        /**< Active sensors (1–CONFIG_MAX_SENSORS) */
+    uint8_t profile;            /**< Boot operating profile (PROFILE.h) */
+    uint8_t filter_order;       /**< Chebyshev II high-pass order */
+    uint8_t filter_stop_db;     /**< Chebyshev II stopband attenuation (dB) */
+} CONFIG_Params;
+
+/**
+ * @brief Load the newest valid stored configuration
+ * @param defaults - [in] Compiled-in parameters (used when nothing valid is stored)
+ * @param params - [out] Parameters to boot with
+ * @return CONFIG_OK, CONFIG_EMPTY or CONFIG_INVALID
+ * @note Call before the sensors and the UART are initialised; needs DWT_Init() for the
+ *       load time.
+ */
+uint8_t CONFIG_Load(const CONFIG_Params *defaults, CONFIG_Params *params);
+
+/**
+ * @brief Check a parameter set against the ranges the firmware supports
+ * @param params - [in] Parameters
+ * @return 1 if valid, 0 otherwise
+ */
+uint8_t CONFIG_Validate(const CONFIG_Params *params);
+
+/**
+ * @brief Change one parameter by key
+ * @param params - [in,out] Parameters
+ * @param key - CONFIG_KEY_* identifier
+ * @param value - New value (IEEE-754 bits for float parameters)
+ * @return CONFIG_FIELD_UNKNOWN, CONFIG_FIELD_SAME or CONFIG_FIELD_CHANGED
+ */
+uint8_t CONFIG_SetField(CONFIG_Params *params, uint8_t key, uint32_t value);
+
+/**
+ * @brief Append a parameter set as the newest record
+ * @param params - [in] Parameters (must pass CONFIG_Validate())
+ * @return CONFIG_OK, CONFIG_INVALID or CONFIG_ERASE_PENDING (nothing written), or
+ *         CONFIG_FLASH_ERROR
+ * @note Main-loop context only; stalls the CPU for each programmed half-word (see Save Timing).
+ */
+uint8_t CONFIG_Save(const CONFIG_Params *params);
+
+/**
+ * @brief Stored configuration (what the next boot will use)
+ * @return Pointer to the newest stored parameters, or the defaults if none
+ */
+const CONFIG_Params *CONFIG_GetStored(void);
+
+/**
+ * @brief Format the stored configuration as a report line
+ * @details Format: `#CONFIG,<status>,<seq>,<load_cycles>,<sensors>,<odr_hz>,<led_red_ma>,
+ *          <led_ir_ma>,<baud>,<profile>,<filter_order>,<cutoff_hz>,<stop_db>\r\n`.
+ *          status is the result of the last load or save, seq 0 means no stored record.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int CONFIG_FormatReport(char *buffer, uint32_t size);
+
+#endif /* CONFIG_H_ */
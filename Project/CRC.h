@@ -0,0 +1,67 @@
+/**
+ * @file CRC.h
+ * @brief CRC-16/CCITT-FALSE on the STM32F3 CRC unit with a software fallback
+ * @details One CRC for every checked byte stream of the firmware: output frames
+ *          (STREAM.h), host commands (CMD.h) and the stored configuration (CONFIG.h).
+ *          Polynomial 0x1021, initial value 0xFFFF, no reflection, no final XOR; check
+ *          value 0x29B1 over "123456789".
+ *
+ * ### Hardware Unit
+ *  The F3 CRC unit is set to a 16-bit polynomial (CR.POLYSIZE = 01, POL = 0x1021). It
+ *  consumes DR writes MSB first, so four data bytes go in as one byte-reversed word
+ *  (REV), the tail byte by byte; INIT carries a running CRC into the next call. A
+ *  122-byte RAW frame is 30 word writes and 2 byte writes instead of 244 table look-ups.
+ *  CRC_Init() checks the unit against the software result; CRC_Ccitt16() falls back to
+ *  software if the check fails, before CRC_Init() and with CRC_HW 0 (host builds).
+ *
+ * ### Context
+ *  The unit holds the state of one computation, so CRC_Ccitt16() belongs to the main
+ *  loop only (frame encoder, configuration store, benchmark). Interrupt code (the
+ *  command parser in the USART2 ISR, which adds one byte at a time) uses
+ *  CRC_Ccitt16Soft().
+ *
+ * ### Benchmark
+ *  BENCH reports both paths on frame-sized inputs: crc16 (CRC_Ccitt16()) and crc16sw.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-10-17
+ * @version 1.0
+ */
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <stdint.h>
+
+#ifndef CRC_HW
+#define CRC_HW              1       /**< 1 = use the CRC unit, 0 = software only (host builds) */
+#endif
+#define CRC_CCITT_POLY      0x1021U /**< CRC-16/CCITT polynomial */
+#define CRC_CCITT_INIT      0xFFFFU /**< Initial value */
+#define CRC_CCITT_CHECK     0x29B1U /**< CRC of "123456789" */
+
+/**
+ * @brief Enable and configure the CRC unit, then check it against software
+ * @return 1 if the unit is in use, 0 if CRC_Ccitt16() runs in software
+ */
+uint8_t CRC_Init(void);
+
+/**
+ * @brief Continue a CRC-16/CCITT-FALSE computation on the CRC unit (main loop only)
+ * @param crc - Running CRC (start with CRC_CCITT_INIT)
+ * @param data - Bytes to checksum
+ * @param length - Number of bytes
+ * @return Updated CRC (no final XOR needed)
+ */
+uint16_t CRC_Ccitt16(uint16_t crc, const uint8_t *data, uint16_t length);
+
+/**
+ * @brief Continue a CRC-16/CCITT-FALSE computation in software (any context)
+ * @param crc - Running CRC (start with CRC_CCITT_INIT)
+ * @param data - Bytes to checksum
+ * @param length - Number of bytes
+ * @return Updated CRC (no final XOR needed)
+ */
+uint16_t CRC_Ccitt16Soft(uint16_t crc, const uint8_t *data, uint16_t length);
+
+#endif /* CRC_H_ */
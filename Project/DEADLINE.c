@@ -0,0 +1,235 @@
+/**
+ * @file DEADLINE.c
+ * @brief Real-time deadline monitor implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-07-14
+ * @version 1.0
+ */
+
+#include "DEADLINE.h"
+#include "TIMER.h"
+#include "stm32f303x8.h"
+#include <stdio.h>
+
+volatile uint8_t deadline_stage[DEADLINE_TASKS];
+
+/**
+ * @struct DEADLINE_Task
+ * @brief Per-task monitor state
+ */
+typedef struct {
+    uint32_t deadline_us;       /**< Allowed duration */
+    uint32_t start;             /**< TIM2 time of the current run */
+    volatile uint8_t running;   /**< Between Begin and End */
+    volatile uint8_t missed;    /**< Compare fired during the current run */
+    uint32_t runs;              /**< Completed runs */
+    volatile uint32_t misses;   /**< Runs that passed their deadline */
+    uint32_t max_us;            /**< Longest run */
+    volatile uint16_t stage_misses[DEADLINE_MAX_STAGES]; /**< Misses per active stage */
+} DEADLINE_Task;
+
+static DEADLINE_Task deadline_task[DEADLINE_TASKS];
+static volatile uint8_t deadline_progress;  /**< Bit per task: completed since last watchdog reload */
+static uint8_t deadline_wdg_enabled;
+static uint8_t deadline_wdg_reset;          /**< Last reset came from the IWDG */
+
+/** TIM2 compare channel of each task */
+static volatile uint32_t *const deadline_ccr[DEADLINE_TASKS] = { &TIM2->CCR3, &TIM2->CCR4 };
+static const uint32_t deadline_ie[DEADLINE_TASKS] = { TIM_DIER_CC3IE, TIM_DIER_CC4IE };
+static const uint32_t deadline_if[DEADLINE_TASKS] = { TIM_SR_CC3IF, TIM_SR_CC4IF };
+
+/**
+ * @brief Set or clear the compare interrupt enable of a task
+ * @details DIER is shared by both tasks, which run at different priorities; the
+ *          read-modify-write is done with interrupts masked so neither loses the other's bit.
+ */
+static void DEADLINE_Arm(uint8_t task, uint8_t on) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (on) {
+        TIM2->DIER |= deadline_ie[task];
+    } else {
+        TIM2->DIER &= ~deadline_ie[task];
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Set the deadlines and enable the TIM2 compare interrupt
+ * @details CH3/CH4 stay in frozen output-compare mode (CCMR2 = 0, outputs disabled):
+ *          only the compare flags are used. Also latches and clears the reset cause.
+ * @param acq_us - Deadline of one acquisition slot (µs)
+ * @param batch_us - Deadline of one consumer pass (µs)
+ * @return void
+ */
+void DEADLINE_Init(uint32_t acq_us, uint32_t batch_us) {
+    for (uint8_t t = 0; t < DEADLINE_TASKS; t++) {
+        deadline_task[t] = (DEADLINE_Task){0};
+        deadline_stage[t] = 0;
+    }
+    deadline_task[DEADLINE_ACQ].deadline_us = acq_us;
+    deadline_task[DEADLINE_BATCH].deadline_us = batch_us;
+
+    deadline_wdg_reset = (RCC->CSR & RCC_CSR_IWDGRSTF) ? 1 : 0;
+    RCC->CSR |= RCC_CSR_RMVF;
+
+    TIM2->CCMR2 &= ~(TIM_CCMR2_CC3S | TIM_CCMR2_OC3M | TIM_CCMR2_CC4S | TIM_CCMR2_OC4M);
+    TIM2->DIER &= ~(TIM_DIER_CC3IE | TIM_DIER_CC4IE);
+    TIM2->SR = ~(TIM_SR_CC3IF | TIM_SR_CC4IF);
+    NVIC_SetPriority(TIM2_IRQn, DEADLINE_IRQ_PRIORITY);
+    NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+/**
+ * @brief Change both deadlines (e.g. after SCHED_Configure()) and restart the statistics
+ * @details A run in progress keeps its start time and is checked against the new
+ *          deadline at DEADLINE_End(); its armed compare is left as it is.
+ * @param acq_us - Deadline of one acquisition slot (µs)
+ * @param batch_us - Deadline of one consumer pass (µs)
+ * @return void
+ */
+void DEADLINE_SetDeadlines(uint32_t acq_us, uint32_t batch_us) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t t = 0; t < DEADLINE_TASKS; t++) {
+        DEADLINE_Task *task = &deadline_task[t];
+        *task = (DEADLINE_Task){ .start = task->start, .running = task->running, .missed = task->missed };
+    }
+    deadline_task[DEADLINE_ACQ].deadline_us = acq_us;
+    deadline_task[DEADLINE_BATCH].deadline_us = batch_us;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Start timing one run of a task and arm its deadline
+ * @details A run that begins while the previous one is still open (overrun) restarts
+ *          the measurement; the open run has already been counted as missed by the
+ *          compare interrupt.
+ * @param task - DEADLINE_ACQ or DEADLINE_BATCH
+ * @return void
+ */
+void DEADLINE_Begin(uint8_t task) {
+    DEADLINE_Task *t = &deadline_task[task];
+    uint32_t now = TIMER_GetMicros();
+    t->start = now;
+    t->missed = 0;
+    t->running = 1;
+    deadline_stage[task] = 0;
+    TRACE_Event(TRACE_TASK, task);
+    *deadline_ccr[task] = now + t->deadline_us;
+    TIM2->SR = ~deadline_if[task];
+    DEADLINE_Arm(task, 1);
+}
+
+/**
+ * @brief End the run of a task: disarm, record duration and margin
+ * @param task - DEADLINE_ACQ or DEADLINE_BATCH
+ * @return void
+ */
+void DEADLINE_End(uint8_t task) {
+    DEADLINE_Task *t = &deadline_task[task];
+    DEADLINE_Arm(task, 0);
+    uint32_t elapsed = TIMER_GetMicros() - t->start;
+    // Catches a deadline passed with the TIM2 interrupt masked by a higher-priority ISR
+    if (!t->missed && elapsed > t->deadline_us) {
+        t->missed = 1;
+        t->misses++;
+        t->stage_misses[deadline_stage[task]]++;
+        TRACE_Event(TRACE_DEADLINE_MISS, ((uint32_t)task << 8) | deadline_stage[task]);
+        TRACE_Trigger();
+    }
+    t->running = 0;
+    TRACE_Event(TRACE_TASK | TRACE_END, task);
+    t->runs++;
+    if (elapsed > t->max_us) t->max_us = elapsed;
+    deadline_progress |= (uint8_t)(1U << task);
+}
+
+/**
+ * @brief TIM2 interrupt body
+ * @details For every armed channel whose compare flag is set, the task is past its
+ *          deadline: count the miss against the active stage and disarm the channel.
+ * @return void
+ */
+void DEADLINE_TimerIrq(void) {
+    uint32_t sr = TIM2->SR;
+    for (uint8_t task = 0; task < DEADLINE_TASKS; task++) {
+        DEADLINE_Task *t = &deadline_task[task];
+        if ((sr & deadline_if[task]) && (TIM2->DIER & deadline_ie[task])) {
+            TIM2->SR = ~deadline_if[task];
+            TIM2->DIER &= ~deadline_ie[task];
+            if (t->running && !t->missed) {
+                t->missed = 1;
+                t->misses++;
+                t->stage_misses[deadline_stage[task]]++;
+                TRACE_Event(TRACE_DEADLINE_MISS, ((uint32_t)task << 8) | deadline_stage[task]);
+                TRACE_Trigger();
+            }
+        }
+    }
+}
+
+/**
+ * @brief Start the independent watchdog
+ * @details LSI ≈ 40 kHz, prescaler /32 → 1.25 kHz; reload = timeout × 1.25 (max 4095).
+ *          The IWDG is frozen while the core is halted by the debugger.
+ * @param timeout_ms - Reset timeout (1–3276 ms)
+ * @return void
+ */
+void DEADLINE_EnableWatchdog(uint32_t timeout_ms) {
+    uint32_t reload = timeout_ms * 5U / 4U;
+    if (reload < 1) reload = 1;
+    if (reload > 0xFFF) reload = 0xFFF;
+    DBGMCU->APB1FZ |= DBGMCU_APB1_FZ_DBG_IWDG_STOP;
+    IWDG->KR = 0xCCCC;      // Start (also starts the LSI)
+    IWDG->KR = 0x5555;      // Unlock PR/RLR
+    IWDG->PR = 3;           // /32
+    IWDG->RLR = reload;
+    while (IWDG->SR) {
+    }
+    IWDG->KR = 0xAAAA;
+    deadline_progress = 0;
+    deadline_wdg_enabled = 1;
+}
+
+/**
+ * @brief Reload the watchdog if both tasks made progress
+ * @return void
+ */
+void DEADLINE_Service(void) {
+    if (deadline_wdg_enabled && deadline_progress == (1U << DEADLINE_TASKS) - 1U) {
+        deadline_progress = 0;
+        IWDG->KR = 0xAAAA;
+    }
+}
+
+/**
+ * @brief Format the statistics of one task as a report line
+ * @details Format: `#DEADLINE,<task>,<runs>,<misses>,<deadline_us>,<worst_margin_us>,
+ *          <max_us>,<wdg_reset>[,<stage>:<misses>...]\r\n`; only stages with misses
+ *          are listed.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param task - DEADLINE_ACQ or DEADLINE_BATCH
+ * @return Number of characters written (excluding terminator)
+ */
+int DEADLINE_FormatReport(char *buffer, uint32_t size, uint8_t task) {
+    const DEADLINE_Task *t = &deadline_task[task];
+    int n = snprintf(buffer, size, "#DEADLINE,%u,%lu,%lu,%lu,%ld,%lu,%u",
+                     task,
+                     (unsigned long)t->runs,
+                     (unsigned long)t->misses,
+                     (unsigned long)t->deadline_us,
+                     (long)((int32_t)t->deadline_us - (int32_t)t->max_us),
+                     (unsigned long)t->max_us,
+                     deadline_wdg_reset);
+    for (uint8_t s = 0; s < DEADLINE_MAX_STAGES && n > 0 && (uint32_t)n < size; s++) {
+        if (t->stage_misses[s]) {
+            n += snprintf(&buffer[n], size - (uint32_t)n, ",%u:%u", s, (unsigned)t->stage_misses[s]);
+        }
+    }
+    if (n > 0 && (uint32_t)n < size) {
+        n += snprintf(&buffer[n], size - (uint32_t)n, "\r\n");
+    }
+    return n;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file DEADLINE.h
+ * @brief Real-time deadline monitor with overrun attribution
+ * @details Watches two recurring tasks against fixed deadlines:
+ *          - **DEADLINE_ACQ**: one acquisition slot, from the SysTick entry to the end
+ *            of the FIFO drain (the end of the I2C/DMA chain in DMA mode). Deadline: the
+ *            slot length, i.e. the next slot must not find the previous one running.
+ *          - **DEADLINE_BATCH**: one main-loop consumer pass, from data_ready to the last
+ *            frame run through the pipeline and the reports sent. Deadline: one
+ *            acquisition period, i.e. the main loop keeps up with the sensors.
+ *
+ * ### Attribution
+ *  Code marks what it is doing with DEADLINE_SetStage() (one store, plus a trace record
+ *  when TRACE_RECORDS is set). At DEADLINE_Begin()
+ *  a TIM2 compare channel (CH3 for ACQ, CH4 for BATCH) is armed at start + deadline; if
+ *  the task is still running when it fires, the TIM2 interrupt (DEADLINE_IRQ_PRIORITY,
+ *  above SysTick and the I2C1 chain) counts the miss against the stage that was active
+ *  at that instant — even while the task itself is stuck in a blocking transfer.
+ *
+ *  | Task | Stages |
+ *  |------|--------|
+ *  | ACQ | 0 slot, 1 select, 2 status, 3 burst, 4 commit |
+ *  | BATCH | 0 pop, 1 report, 2 + n = pipeline stage n |
+ *
+ * ### Margins
+ *  DEADLINE_End() records the duration; the worst-case margin (deadline − longest
+ *  duration, negative after a miss) is kept per task.
+ *
+ * ### Watchdog (optional)
+ *  DEADLINE_EnableWatchdog() starts the IWDG (LSI ≈ 40 kHz). DEADLINE_Service() in the
+ *  main loop reloads it only if an acquisition slot and a consumer pass both completed
+ *  since the previous reload, so a hung ISR or a stalled main loop resets the MCU
+ *  instead of freezing it. A watchdog reset is reported after the restart.
+ *
+ *  Report: `#DEADLINE,<task>,<runs>,<misses>,<deadline_us>,<worst_margin_us>,<max_us>,
+ *  <wdg_reset>[,<stage>:<misses>...]\r\n` (task 0 = ACQ, 1 = BATCH)
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-07-14
+ * @version 1.0
+ * @note Requires TIMER_Init(). TIM2 CH3/CH4 are used in output-compare (frozen) mode;
+ *       CH1 stays with MARKER input capture.
+ */
+
+#ifndef DEADLINE_H_
+#define DEADLINE_H_
+
+#include <stdint.h>
+#include "TRACE.h"
+
+#define DEADLINE_IRQ_PRIORITY   1       /**< TIM2 priority: above I2C1 (3) and SysTick (15) */
+#define DEADLINE_MAX_STAGES     16      /**< Stage codes per task */
+
+/** @name Tasks
+ * @{ */
+#define DEADLINE_ACQ            0       /**< Acquisition slot (SysTick / I2C1 chain) */
+#define DEADLINE_BATCH          1       /**< Main-loop consumer pass */
+#define DEADLINE_TASKS          2
+/** @} */
+
+/** @name Stage codes
+ * @{ */
+#define DEADLINE_STAGE_SLOT     0       /**< ACQ: slot bookkeeping */
+#define DEADLINE_STAGE_SELECT   1       /**< ACQ: PCA9548 channel select */
+#define DEADLINE_STAGE_STATUS   2       /**< ACQ: FIFO pointer read */
+#define DEADLINE_STAGE_BURST    3       /**< ACQ: FIFO burst read */
+#define DEADLINE_STAGE_COMMIT   4       /**< ACQ: frame accounting / handoff */
+#define DEADLINE_STAGE_POP      0       /**< BATCH: taking frames from the scheduler */
+#define DEADLINE_STAGE_REPORT   1       /**< BATCH: statistics reports */
+#define DEADLINE_STAGE_PIPE     2       /**< BATCH: pipeline stage n is DEADLINE_STAGE_PIPE + n */
+/** @} */
+
+extern volatile uint8_t deadline_stage[DEADLINE_TASKS]; /**< Active stage per task */
+
+/**
+ * @brief Set the deadlines and enable the TIM2 compare interrupt
+ * @param acq_us - Deadline of one acquisition slot (µs)
+ * @param batch_us - Deadline of one consumer pass (µs)
+ * @return void
+ */
+void DEADLINE_Init(uint32_t acq_us, uint32_t batch_us);
+
+/**
+ * @brief Change both deadlines and restart the statistics (after SCHED_Configure())
+ * @param acq_us - Deadline of one acquisition slot (µs)
+ * @param batch_us - Deadline of one consumer pass (µs)
+ * @return void
+ */
+void DEADLINE_SetDeadlines(uint32_t acq_us, uint32_t batch_us);
+
+/**
+ * @brief Start timing one run of a task and arm its deadline
+ * @param task - DEADLINE_ACQ or DEADLINE_BATCH
+ * @return void
+ */
+void DEADLINE_Begin(uint8_t task);
+
+/**
+ * @brief End the run of a task: disarm, record duration and margin
+ * @param task - DEADLINE_ACQ or DEADLINE_BATCH
+ * @return void
+ */
+void DEADLINE_End(uint8_t task);
+
+/**
+ * @brief Mark the stage a task is in (for miss attribution)
+ * @param task - DEADLINE_ACQ or DEADLINE_BATCH
+ * @param stage - Stage code (< DEADLINE_MAX_STAGES)
+ * @return void
+ */
+static inline void DEADLINE_SetStage(uint8_t task, uint8_t stage) {
+    deadline_stage[task] = stage;
+    TRACE_Event(TRACE_STAGE, ((uint32_t)task << 8) | stage);
+}
+
+/**
+ * @brief TIM2 interrupt body: count misses of tasks still running at their deadline
+ * @return void
+ * @note Called from TIM2_IRQHandler().
+ */
+void DEADLINE_TimerIrq(void);
+
+/**
+ * @brief Start the independent watchdog
+ * @param timeout_ms - Reset timeout (1–3276 ms)
+ * @return void
+ * @warning The IWDG cannot be stopped once started.
+ */
+void DEADLINE_EnableWatchdog(uint32_t timeout_ms);
+
+/**
+ * @brief Reload the watchdog if both tasks made progress (main loop)
+ * @return void
+ */
+void DEADLINE_Service(void);
+
+/**
+ * @brief Format the statistics of one task as a report line
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param task - DEADLINE_ACQ or DEADLINE_BATCH
+ * @return Number of characters written (excluding terminator)
+ */
+int DEADLINE_FormatReport(char *buffer, uint32_t size, uint8_t task);
+
+#endif /* DEADLINE_H_ */
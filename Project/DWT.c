@@ -0,0 +1,24 @@
+/**
+ * @file DWT.c
+ * @brief Cortex-M4 DWT cycle counter implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-02
+ * @version 1.0
+ */
+
+#include "DWT.h"
+
+/**
+ * @brief Enable the trace block and start the cycle counter
+ * @details The DWT unit is gated by CoreDebug DEMCR.TRCENA; once enabled, CYCCNT
+ *          increments on every core clock and keeps running during interrupts.
+ * @return void
+ * @note Safe to call more than once; the counter restarts from 0.
+ */
+void DWT_Init(void) {
+    // Enable trace and debug blocks (required for DWT access)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    // Reset and start the cycle counter
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file DWT.h
+ * @brief Cortex-M4 DWT cycle counter for execution-time measurement
+ * @details Thin wrapper around the Data Watchpoint and Trace unit cycle counter (CYCCNT).
+ *
+ * ### Characteristics
+ *  - **Resolution**: 1 CPU cycle (15.625 ns at 64 MHz)
+ *  - **Width**: 32-bit, wraps every ~67 s at 64 MHz
+ *  - **Cost**: one load per timestamp; unsigned subtraction handles a single wrap
+ *
+ * ### Usage
+ *  ```c
+ *  DWT_Init();
+ *  uint32_t t0 = DWT_GetCycles();
+ *  do_work();
+ *  uint32_t us = DWT_CyclesToUs(DWT_GetCycles() - t0);
+ *  ```
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-02
+ * @version 1.0
+ * @note DWT_Init() runs before clk_config() so the boot timeline (BOOT.h) includes the
+ *       clock set-up; DWT_CyclesToUs() converts at the current SystemCoreClock.
+ */
+
+#ifndef DWT_H_
+#define DWT_H_
+
+#include <stdint.h>
+#include "stm32f303x8.h"
+
+/**
+ * @brief Enable the trace block and start the cycle counter
+ * @details Sets DEMCR.TRCENA, clears CYCCNT and sets DWT_CTRL.CYCCNTENA.
+ * @return void
+ */
+void DWT_Init(void);
+
+/**
+ * @brief Read the free-running cycle counter
+ * @return Current CYCCNT value
+ */
+static inline uint32_t DWT_GetCycles(void) {
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief Convert a cycle count to microseconds
+ * @param cycles - Elapsed CPU cycles
+ * @return Elapsed time in µs (truncated)
+ */
+static inline uint32_t DWT_CyclesToUs(uint32_t cycles) {
+    return cycles / (SystemCoreClock / 1000000U);
+}
+
+#endif /* DWT_H_ */
@@ -9,6 +9,7 @@
 
 #include "I2C.h"
 #include "stm32f303x8.h"
+#include "TRACE.h"
 
 /**
  * @brief Initialize I2C1 peripheral and GPIO pins for 400 kHz master-mode operation
@@ -274,3 +275,153 @@ void I2C1_Read(uint8_t slave, uint8_t addr, uint8_t *data, uint8_t size){
     // Clear STOPF flag
     I2C1->ICR = I2C_ICR_STOPCF;
 }
+
+/** Asynchronous transfer in flight (one at a time) */
+static struct {
+    uint8_t slave;
+    uint8_t tx[2];           /**< Bytes of the write phase (register address, data) */
+    uint8_t tx_len;
+    uint8_t tx_pos;
+    uint8_t size;
+    uint8_t read;            /**< 1 = register read, 0 = write */
+    uint8_t *data;
+    I2C1_Callback done;
+} i2c1_async;
+
+/**
+ * @brief Enable asynchronous transfers (DMA1 Channel 3 + I2C1 interrupts)
+ * @details Configuration sequence:
+ *          1. SYSCFG_CFGR3.I2C1_RX_DMA_RMP = 01: I2C1_RX request on DMA1 Channel 3
+ *          2. Channel 3: peripheral → memory, memory increment, source I2C1->RXDR
+ *          3. I2C1 event and error interrupts enabled at I2C1_IRQ_PRIORITY
+ * @return void
+ */
+void I2C1_DMA_Config(void) {
+    RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    SYSCFG->CFGR3 = (SYSCFG->CFGR3 & ~SYSCFG_CFGR3_I2C1_RX_DMA_RMP) | SYSCFG_CFGR3_I2C1_RX_DMA_RMP_0;
+    DMA1_Channel3->CCR = 0;
+    DMA1_Channel3->CPAR = (uint32_t)&I2C1->RXDR;
+    DMA1_Channel3->CCR = DMA_CCR_MINC;
+    NVIC_SetPriority(I2C1_EV_IRQn, I2C1_IRQ_PRIORITY);
+    NVIC_SetPriority(I2C1_ER_IRQn, I2C1_IRQ_PRIORITY);
+    NVIC_EnableIRQ(I2C1_EV_IRQn);
+    NVIC_EnableIRQ(I2C1_ER_IRQn);
+}
+
+/**
+ * @brief Start a 1-byte write without waiting
+ * @details TXIS delivers the byte, STOPF (AUTOEND) completes the transfer.
+ * @param slave - Slave address (pre-shifted)
+ * @param data - Byte to write
+ * @param done - Completion callback
+ * @return void
+ */
+void I2C1_WriteAsync(uint8_t slave, uint8_t data, I2C1_Callback done) {
+    i2c1_async.slave = slave;
+    i2c1_async.tx[0] = data;
+    i2c1_async.tx_len = 1;
+    i2c1_async.tx_pos = 0;
+    i2c1_async.read = 0;
+    i2c1_async.done = done;
+    I2C1->ICR = I2C_ICR_STOPCF | I2C_ICR_NACKCF;
+    I2C1->CR1 |= I2C_CR1_TXIE | I2C_CR1_STOPIE | I2C_CR1_NACKIE | I2C_CR1_ERRIE;
+    I2C1->CR2 = I2C_CR2_AUTOEND | (1U << 16) | slave | I2C_CR2_START;
+}
+
+/**
+ * @brief Start a register write without waiting
+ * @details TXIS delivers the register address, then the data byte; STOPF (AUTOEND)
+ *          completes the transfer.
+ * @param slave - Slave address (pre-shifted)
+ * @param addr - Register address
+ * @param data - Data byte
+ * @param done - Completion callback
+ * @return void
+ */
+void I2C1_WriteRegAsync(uint8_t slave, uint8_t addr, uint8_t data, I2C1_Callback done) {
+    i2c1_async.slave = slave;
+    i2c1_async.tx[0] = addr;
+    i2c1_async.tx[1] = data;
+    i2c1_async.tx_len = 2;
+    i2c1_async.tx_pos = 0;
+    i2c1_async.read = 0;
+    i2c1_async.done = done;
+    I2C1->ICR = I2C_ICR_STOPCF | I2C_ICR_NACKCF;
+    I2C1->CR1 |= I2C_CR1_TXIE | I2C_CR1_STOPIE | I2C_CR1_NACKIE | I2C_CR1_ERRIE;
+    I2C1->CR2 = I2C_CR2_AUTOEND | (2U << 16) | slave | I2C_CR2_START;
+}
+
+/**
+ * @brief Start a DMA register read without waiting
+ * @details Phase 1 (write, no AUTOEND): TXIS sends the register address, TC starts
+ *          phase 2: DMA armed, repeated START with RD_WRN and AUTOEND. STOPF completes.
+ * @param slave - Slave address (pre-shifted)
+ * @param addr - Register address
+ * @param data - [out] Destination
+ * @param size - Number of bytes (1–255)
+ * @param done - Completion callback
+ * @return void
+ */
+void I2C1_ReadAsync(uint8_t slave, uint8_t addr, uint8_t *data, uint8_t size, I2C1_Callback done) {
+    i2c1_async.slave = slave;
+    i2c1_async.tx[0] = addr;
+    i2c1_async.tx_len = 1;
+    i2c1_async.tx_pos = 0;
+    i2c1_async.data = data;
+    i2c1_async.size = size;
+    i2c1_async.read = 1;
+    i2c1_async.done = done;
+    I2C1->ICR = I2C_ICR_STOPCF | I2C_ICR_NACKCF;
+    I2C1->CR1 |= I2C_CR1_TXIE | I2C_CR1_TCIE | I2C_CR1_STOPIE | I2C_CR1_NACKIE | I2C_CR1_ERRIE;
+    I2C1->CR2 = (1U << 16) | slave | I2C_CR2_START;
+}
+
+/**
+ * @brief I2C1 event/error interrupt body
+ * @details - TXIS: write the next byte of the write phase, mask TXIS after the last
+ *          - TC (end of the address phase of a read): arm DMA1 Channel 3, issue the
+ *            repeated START for the read phase
+ *          - NACKF/BERR/ARLO: abort; the peripheral generates STOP (AUTOEND) or is
+ *            stopped explicitly, and the callback reports failure
+ *          - STOPF: disarm DMA, mask interrupts, run the callback
+ * @return void
+ */
+void I2C1_EventHandler(void) {
+    static uint8_t failed;
+    uint32_t isr = I2C1->ISR;
+
+    if (isr & (I2C_ISR_NACKF | I2C_ISR_BERR | I2C_ISR_ARLO)) {
+        I2C1->ICR = I2C_ICR_NACKCF | I2C_ICR_BERRCF | I2C_ICR_ARLOCF;
+        failed = 1;
+        if (!(I2C1->CR2 & I2C_CR2_AUTOEND)) {
+            I2C1->CR2 |= I2C_CR2_STOP;
+        }
+    }
+    if ((isr & I2C_ISR_TXIS) && (I2C1->CR1 & I2C_CR1_TXIE)) {
+        I2C1->TXDR = i2c1_async.tx[i2c1_async.tx_pos++];
+        if (i2c1_async.tx_pos >= i2c1_async.tx_len) {
+            I2C1->CR1 &= ~I2C_CR1_TXIE;
+        }
+    }
+    if ((isr & I2C_ISR_TC) && i2c1_async.read) {
+        I2C1->CR1 &= ~I2C_CR1_TCIE;
+        DMA1_Channel3->CCR &= ~DMA_CCR_EN;
+        DMA1_Channel3->CMAR = (uint32_t)i2c1_async.data;
+        DMA1_Channel3->CNDTR = i2c1_async.size;
+        DMA1_Channel3->CCR |= DMA_CCR_EN;
+        I2C1->CR1 |= I2C_CR1_RXDMAEN;
+        I2C1->CR2 = I2C_CR2_AUTOEND | I2C_CR2_RD_WRN | ((uint32_t)i2c1_async.size << 16) | i2c1_async.slave | I2C_CR2_START;
+    }
+    if (isr & I2C_ISR_STOPF) {
+        I2C1->ICR = I2C_ICR_STOPCF;
+        I2C1->CR1 &= ~(I2C_CR1_TXIE | I2C_CR1_TCIE | I2C_CR1_STOPIE | I2C_CR1_NACKIE | I2C_CR1_ERRIE | I2C_CR1_RXDMAEN);
+        DMA1_Channel3->CCR &= ~DMA_CCR_EN;
+        uint8_t ok = !failed;
+        failed = 0;
+        TRACE_Event(TRACE_I2C_DONE, ok);
+        if (i2c1_async.done) {
+            i2c1_async.done(ok);
+        }
+    }
+}
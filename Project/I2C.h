@@ -19,8 +19,12 @@
  * ### Driver Characteristics
  *  - **Write latency**: ~30-50 µs per byte (2 bytes minimum per transaction)
  *  - **Read latency**: ~100 µs overhead + ~30 µs/byte (repeated START; e.g. 6 bytes ≈ 280 µs)
- *  - **Blocking**: Yes (waits for bus/flags; no interrupts or DMA)
- *  - **Thread-safe**: No (not safe for concurrent I2C accesses)
+ *  - **Blocking**: I2C1_Write/WriteByte/Read wait for bus/flags
+ *  - **Asynchronous**: I2C1_WriteAsync/ReadAsync are driven by the I2C1 event interrupt;
+ *    read data lands by DMA (I2C1_RX remapped to DMA1 Channel 3) and a callback runs
+ *    in interrupt context after STOP
+ *  - **Thread-safe**: No (not safe for concurrent I2C accesses; do not mix blocking and
+ *    asynchronous transfers while one is in flight)
  *
  * ### Supported Transactions
  *  1. **Write**: Master writes register address + 1 data byte (MAX30101 registers)
@@ -30,8 +34,7 @@
  * @date 2026-03-26
  * @version 2.0
  * @note For STM32F303K8 only. TIMINGR value 0x00C50F26 is specific to APB1 = 32 MHz
- * @todo Add error handling (NAK detection, bus timeout)
- * @todo Implement DMA for high-speed FIFO reads
+ * @todo Add error handling for the blocking functions (NAK detection, bus timeout)
  */
 
 #ifndef I2C_H_
@@ -39,6 +42,29 @@
 
 #include <stdint.h>
 
+/** @name I2C1 bus timing model
+ *  @brief Wire-time estimates used to budget bus occupancy (400 kHz Fast-mode)
+ *  @details Each byte on the wire costs 9 SCL periods (8 data bits + ACK). START,
+ *           repeated START and STOP are folded into one extra byte time per phase.
+ *           These figures exclude the software polling overhead of the blocking
+ *           driver and are therefore a lower bound for the time spent in I2C1_Read().
+ *  @{
+ */
+#define I2C1_BUS_HZ             400000U                         /**< SCL frequency (Hz) */
+#define I2C1_BIT_NS             (1000000000U / I2C1_BUS_HZ)     /**< SCL period (ns) = 2500 ns */
+#define I2C1_BYTE_NS            (9U * I2C1_BIT_NS)              /**< One byte + ACK on the wire (ns) = 22.5 µs */
+#define I2C1_WRITE_COST_NS(n)   ((2U + (n)) * I2C1_BYTE_NS)     /**< START + address + n bytes + STOP */
+#define I2C1_READ_COST_NS(n)    ((4U + (n)) * I2C1_BYTE_NS)     /**< address(W) + register + RESTART/address(R) + n bytes + STOP */
+/** @} */
+
+#define I2C1_IRQ_PRIORITY       3   /**< I2C1 event/error interrupt priority (asynchronous transfers) */
+
+/**
+ * @brief Completion callback of an asynchronous transfer (interrupt context)
+ * @param ok - 1 if the transfer completed, 0 on NACK or bus error
+ */
+typedef void (*I2C1_Callback)(uint8_t ok);
+
 /**
  * @brief Initialize I2C1 peripheral and GPIO pins
  * @details One-time configuration of I2C1 for master-mode 400 kHz operation.
@@ -86,4 +112,52 @@ void I2C1_WriteByte(uint8_t slave, uint8_t data);
  */
 void I2C1_Read(uint8_t slave, uint8_t addr, uint8_t *data, uint8_t size);
 
+/**
+ * @brief Enable asynchronous transfers: DMA1 Channel 3 for I2C1_RX and the I2C1 interrupts
+ * @details Remaps I2C1_RX from DMA1 Channel 7 (used by USART2_TX) to Channel 3 through
+ *          SYSCFG_CFGR3 and enables the I2C1 event and error interrupts in the NVIC.
+ * @return void
+ * @note Call after I2C1_Config().
+ */
+void I2C1_DMA_Config(void);
+
+/**
+ * @brief Start a 1-byte write (e.g. PCA9548 control byte) without waiting
+ * @param slave - Slave address (pre-shifted, as for I2C1_WriteByte())
+ * @param data - Byte to write
+ * @param done - Called from the I2C1 interrupt after STOP
+ * @return void
+ */
+void I2C1_WriteAsync(uint8_t slave, uint8_t data, I2C1_Callback done);
+
+/**
+ * @brief Start a register write (e.g. sensor configuration) without waiting
+ * @param slave - Slave address (pre-shifted, as for I2C1_Write())
+ * @param addr - Register address
+ * @param data - Data byte
+ * @param done - Called from the I2C1 interrupt after STOP
+ * @return void
+ */
+void I2C1_WriteRegAsync(uint8_t slave, uint8_t addr, uint8_t data, I2C1_Callback done);
+
+/**
+ * @brief Start a register read whose data is transferred by DMA, without waiting
+ * @details Register address write, repeated START, DMA read of size bytes, STOP.
+ *          CPU involvement: three short interrupts (TXIS, TC, STOPF) per transfer.
+ * @param slave - Slave address (pre-shifted)
+ * @param addr - Register address
+ * @param data - [out] Destination; must stay valid until the callback
+ * @param size - Number of bytes (1–255)
+ * @param done - Called from the I2C1 interrupt after STOP
+ * @return void
+ */
+void I2C1_ReadAsync(uint8_t slave, uint8_t addr, uint8_t *data, uint8_t size, I2C1_Callback done);
+
+/**
+ * @brief I2C1 event/error interrupt body (asynchronous transfer state machine)
+ * @return void
+ * @note Called from I2C1_EV_IRQHandler() and I2C1_ER_IRQHandler().
+ */
+void I2C1_EventHandler(void);
+
 #endif /* I2C_H_ */    
\ No newline at end of file
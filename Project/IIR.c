@@ -0,0 +1,349 @@
+/**
+ * @file IIR.c
+ * @brief Run-time IIR filter design implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-08-04
+ * @version 1.0
+ */
+
+#include "IIR.h"
+#include <math.h>
+#include <stddef.h>
+
+#define IIR_PI          3.14159265358979323846
+#define IIR_REAL_TOL    1e-9    /**< |Im| below which a digital pole/zero counts as real */
+
+/**
+ * @struct IIR_Complex
+ * @brief Double-precision complex number (poles and zeros during the design)
+ */
+typedef struct {
+    double re;
+    double im;
+} IIR_Complex;
+
+/**
+ * @struct IIR_Group
+ * @brief One section's worth of poles or zeros: a conjugate pair (index of the upper
+ *        member twice), two real roots or a single real root
+ */
+typedef struct {
+    uint8_t idx[2];             /**< Indices into the root array */
+    uint8_t n;                  /**< Roots in the section: 1 or 2 */
+    uint8_t used;
+} IIR_Group;
+
+static inline IIR_Complex IIR_C(double re, double im) {
+    return (IIR_Complex){ re, im };
+}
+
+static inline IIR_Complex IIR_Add(IIR_Complex a, IIR_Complex b) {
+    return IIR_C(a.re + b.re, a.im + b.im);
+}
+
+static inline IIR_Complex IIR_Sub(IIR_Complex a, IIR_Complex b) {
+    return IIR_C(a.re - b.re, a.im - b.im);
+}
+
+static inline IIR_Complex IIR_Mul(IIR_Complex a, IIR_Complex b) {
+    return IIR_C(a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re);
+}
+
+static inline IIR_Complex IIR_Div(IIR_Complex a, IIR_Complex b) {
+    double d = b.re * b.re + b.im * b.im;
+    return IIR_C((a.re * b.re + a.im * b.im) / d, (a.im * b.re - a.re * b.im) / d);
+}
+
+static inline IIR_Complex IIR_Scale(IIR_Complex a, double k) {
+    return IIR_C(a.re * k, a.im * k);
+}
+
+static inline double IIR_Abs(IIR_Complex a) {
+    return sqrt(a.re * a.re + a.im * a.im);
+}
+
+/**
+ * @brief Principal square root
+ */
+static IIR_Complex IIR_Sqrt(IIR_Complex a) {
+    double m = IIR_Abs(a);
+    double re = sqrt(0.5 * (m + a.re));
+    double im = sqrt(0.5 * (m - a.re));
+    return IIR_C(re, (a.im < 0.0) ? -im : im);
+}
+
+/**
+ * @brief Analog low-pass prototype with its edge at 1 rad/s
+ * @details Butterworth: poles on the unit circle, no zeros. Chebyshev II: reciprocals of
+ *          the Chebyshev I poles for ε = 1/√(10^(stop_db/10) − 1), zeros at j/cos θk
+ *          (none for the middle angle of an odd order).
+ * @return Number of zeros (poles = order)
+ */
+static uint8_t IIR_Prototype(const IIR_Spec *spec, IIR_Complex *poles, IIR_Complex *zeros) {
+    uint8_t n = spec->order;
+    uint8_t nz = 0;
+    double sh = 1.0, ch = 1.0;
+    if (spec->family == IIR_CHEBYSHEV2) {
+        double mu = asinh(sqrt(pow(10.0, 0.1 * spec->stop_db) - 1.0)) / n;
+        sh = sinh(mu);
+        ch = cosh(mu);
+    }
+    for (uint8_t k = 0; k < n; k++) {
+        double theta = IIR_PI * (2 * k + 1) / (2.0 * n);
+        IIR_Complex p = IIR_C(-sh * sin(theta), ch * cos(theta));
+        if (spec->family == IIR_CHEBYSHEV2) {
+            p = IIR_Div(IIR_C(1.0, 0.0), p);
+            if (2 * k + 1 != n) {
+                zeros[nz++] = IIR_C(0.0, 1.0 / cos(theta));
+            }
+        }
+        poles[k] = p;
+    }
+    return nz;
+}
+
+/**
+ * @brief Map prototype roots to prewarped LP/HP/BP analog roots, in place
+ * @details LP: s → s/Ω; HP: s → Ω/s; BP: s → (s² + Ω0²) / (B·s), each root becoming
+ *          the two roots of s² − B·r·s + Ω0² = 0.
+ * @return Number of roots after the transformation
+ */
+static uint8_t IIR_Transform(const IIR_Spec *spec, double w1, double w2, IIR_Complex *roots, uint8_t n) {
+    if (spec->response == IIR_LOWPASS) {
+        for (uint8_t i = 0; i < n; i++) {
+            roots[i] = IIR_Scale(roots[i], w1);
+        }
+        return n;
+    }
+    if (spec->response == IIR_HIGHPASS) {
+        for (uint8_t i = 0; i < n; i++) {
+            roots[i] = IIR_Div(IIR_C(w1, 0.0), roots[i]);
+        }
+        return n;
+    }
+    double bw = w2 - w1;
+    double w0sq = w1 * w2;
+    for (uint8_t i = n; i-- > 0; ) {
+        IIR_Complex h = IIR_Scale(roots[i], 0.5 * bw);
+        IIR_Complex d = IIR_Sqrt(IIR_Sub(IIR_Mul(h, h), IIR_C(w0sq, 0.0)));
+        roots[2 * i] = IIR_Add(h, d);
+        roots[2 * i + 1] = IIR_Sub(h, d);
+    }
+    return 2 * n;
+}
+
+/**
+ * @brief Bilinear transform z = (2·fs + s) / (2·fs − s), in place
+ */
+static void IIR_Bilinear(IIR_Complex *roots, uint8_t n, double k) {
+    for (uint8_t i = 0; i < n; i++) {
+        roots[i] = IIR_Div(IIR_C(k + roots[i].re, roots[i].im), IIR_C(k - roots[i].re, -roots[i].im));
+    }
+}
+
+/**
+ * @brief Split digital roots into section groups
+ * @details Conjugate pairs form one group each. Real roots are sorted and paired
+ *          outside-in, so a band-pass gets one zero at z = 1 and one at z = −1 per
+ *          section; an odd one out stays single.
+ * @return Number of groups
+ */
+static uint8_t IIR_GroupRoots(const IIR_Complex *roots, uint8_t n, IIR_Group *groups) {
+    uint8_t real[IIR_MAX_ORDER];
+    uint8_t nr = 0, ng = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        if (fabs(roots[i].im) <= IIR_REAL_TOL) {
+            uint8_t j = nr++;
+            for (; j > 0 && roots[real[j - 1]].re > roots[i].re; j--) {
+                real[j] = real[j - 1];
+            }
+            real[j] = i;
+        } else if (roots[i].im > 0.0) {
+            groups[ng++] = (IIR_Group){ { i, i }, 2, 0 };
+        }
+    }
+    uint8_t lo = 0, hi = nr;
+    while (hi - lo >= 2) {
+        groups[ng++] = (IIR_Group){ { real[lo++], real[--hi] }, 2, 0 };
+    }
+    if (hi > lo) {
+        groups[ng++] = (IIR_Group){ { real[lo], real[lo] }, 1, 0 };
+    }
+    return ng;
+}
+
+/**
+ * @brief Numerator or denominator of a group: 1 + c[1]·z⁻¹ + c[2]·z⁻²
+ * @details Conjugate pair r, r*: c[1] = −2·Re r, c[2] = |r|²; real pair: −(r1 + r2),
+ *          r1·r2; single root: −r, 0.
+ */
+static void IIR_GroupPoly(const IIR_Complex *roots, const IIR_Group *g, double *c) {
+    const IIR_Complex *r0 = &roots[g->idx[0]];
+    const IIR_Complex *r1 = &roots[g->idx[1]];
+    c[0] = 1.0;
+    if (g->n == 1) {
+        c[1] = -r0->re;
+        c[2] = 0.0;
+    } else if (g->idx[0] == g->idx[1]) {
+        c[1] = -2.0 * r0->re;
+        c[2] = r0->re * r0->re + r0->im * r0->im;
+    } else {
+        c[1] = -(r0->re + r1->re);
+        c[2] = r0->re * r1->re;
+    }
+}
+
+/**
+ * @brief Largest root magnitude of a group (distance of its poles to z = 0)
+ */
+static double IIR_GroupRadius(const IIR_Complex *roots, const IIR_Group *g) {
+    double a = IIR_Abs(roots[g->idx[0]]);
+    double b = IIR_Abs(roots[g->idx[1]]);
+    return (a > b) ? a : b;
+}
+
+/**
+ * @brief Gain of one section at z = e^{jω}
+ */
+static double IIR_SectionGain(const double *b, const double *a, double omega) {
+    IIR_Complex q = IIR_C(cos(omega), -sin(omega));       // z⁻¹
+    IIR_Complex q2 = IIR_Mul(q, q);
+    IIR_Complex num = IIR_Add(IIR_C(b[0], 0.0), IIR_Add(IIR_Scale(q, b[1]), IIR_Scale(q2, b[2])));
+    IIR_Complex den = IIR_Add(IIR_C(1.0, 0.0), IIR_Add(IIR_Scale(q, a[1]), IIR_Scale(q2, a[2])));
+    return IIR_Abs(num) / IIR_Abs(den);
+}
+
+/**
+ * @brief Number of biquad sections a specification needs
+ * @param spec - [in] Filter specification
+ * @return ⌈order/2⌉ for LP/HP, order for BP
+ */
+uint8_t IIR_Sections(const IIR_Spec *spec) {
+    return (spec->response == IIR_BANDPASS) ? spec->order : (uint8_t)((spec->order + 1U) / 2U);
+}
+
+/**
+ * @brief Design a biquad cascade for a sample rate
+ * @details See the method in IIR.h. Zeros at s = ∞ (LP, BP) map to z = −1 and the
+ *          zeros the HP/BP transformation places at s = 0 map to z = 1, so numerator
+ *          and denominator always have the same degree. A design whose poles leave the
+ *          unit circle once the coefficients are rounded to float32_t is rejected (edges
+ *          far below fs/1000 with steep responses).
+ * @param spec - [in] Filter specification
+ * @param fs_hz - Sample rate (Hz)
+ * @param coeffs - [out] 5 coefficients per section, CMSIS-DSP df2T layout
+ * @param max_sections - Capacity of coeffs in sections
+ * @return Sections written, 0 if the specification is invalid for fs_hz, does not fit or
+ *         is unstable in single precision
+ */
+uint8_t IIR_Design(const IIR_Spec *spec, float32_t fs_hz, float32_t *coeffs, uint8_t max_sections) {
+    IIR_Complex poles[IIR_MAX_ORDER];
+    IIR_Complex zeros[IIR_MAX_ORDER];
+    IIR_Group pole_groups[IIR_MAX_ORDER];
+    IIR_Group zero_groups[IIR_MAX_ORDER];
+    uint8_t n = spec->order;
+    uint8_t bandpass = (spec->response == IIR_BANDPASS);
+    double fs = fs_hz;
+
+    if (n == 0 || n > (bandpass ? IIR_MAX_ORDER / 2 : IIR_MAX_ORDER) || spec->response > IIR_BANDPASS
+        || spec->family > IIR_CHEBYSHEV2 || IIR_Sections(spec) > max_sections
+        || !(spec->f1_hz > 0.0f && spec->f1_hz < 0.5f * fs_hz)
+        || (bandpass && !(spec->f2_hz > spec->f1_hz && spec->f2_hz < 0.5f * fs_hz))
+        || (spec->family == IIR_CHEBYSHEV2 && !(spec->stop_db > 0.0f))) {
+        return 0;
+    }
+
+    // 1. Prototype
+    uint8_t nz = IIR_Prototype(spec, poles, zeros);
+    uint8_t missing = n - nz;                                   // Prototype zeros at s = ∞
+
+    // 2. Prewarped frequency transformation
+    double w1 = 2.0 * fs * tan(IIR_PI * spec->f1_hz / fs);
+    double w2 = bandpass ? 2.0 * fs * tan(IIR_PI * spec->f2_hz / fs) : w1;
+    uint8_t np = IIR_Transform(spec, w1, w2, poles, n);
+    nz = IIR_Transform(spec, w1, w2, zeros, nz);
+    if (spec->response != IIR_LOWPASS) {
+        for (uint8_t i = 0; i < missing; i++) {
+            zeros[nz++] = IIR_C(0.0, 0.0);                     // s → 1/s, s → (s² + Ω0²)/(B·s)
+        }
+    }
+
+    // 3. Bilinear transform; the rest of the zeros at s = ∞ land on z = −1
+    IIR_Bilinear(poles, np, 2.0 * fs);
+    IIR_Bilinear(zeros, nz, 2.0 * fs);
+    while (nz < np) {
+        zeros[nz++] = IIR_C(-1.0, 0.0);
+    }
+
+    // 4. Pair: poles closest to the unit circle first, each with the nearest zeros
+    uint8_t sections = IIR_GroupRoots(poles, np, pole_groups);
+    if (sections != IIR_Sections(spec) || IIR_GroupRoots(zeros, nz, zero_groups) != sections) {
+        return 0;
+    }
+    double omega = (spec->response == IIR_LOWPASS) ? 0.0
+                 : (spec->response == IIR_HIGHPASS) ? IIR_PI
+                 : 2.0 * atan(sqrt(w1 * w2) / (2.0 * fs));
+    for (uint8_t s = 0; s < sections; s++) {
+        IIR_Group *pg = NULL;
+        double radius = 0.0;
+        for (uint8_t i = 0; i < sections; i++) {
+            double r = IIR_GroupRadius(poles, &pole_groups[i]);
+            if (!pole_groups[i].used && (pg == NULL || r > radius)) {
+                pg = &pole_groups[i];
+                radius = r;
+            }
+        }
+        IIR_Group *zg = NULL;
+        double best = 0.0;
+        for (uint8_t i = 0; i < sections; i++) {
+            IIR_Group *g = &zero_groups[i];
+            if (g->used || g->n != pg->n) {
+                continue;
+            }
+            for (uint8_t j = 0; j < g->n; j++) {
+                double d = IIR_Abs(IIR_Sub(zeros[g->idx[j]], poles[pg->idx[0]]));
+                if (zg == NULL || d < best) {
+                    zg = g;
+                    best = d;
+                }
+            }
+        }
+        if (zg == NULL) {
+            return 0;
+        }
+        pg->used = 1;
+        zg->used = 1;
+
+        // 5. Unity gain at ω, feedback negated for CMSIS-DSP
+        double b[3], a[3];
+        IIR_GroupPoly(zeros, zg, b);
+        IIR_GroupPoly(poles, pg, a);
+        double g = 1.0 / IIR_SectionGain(b, a, omega);
+        float32_t *c = &coeffs[5 * s];
+        c[0] = (float32_t)(g * b[0]);
+        c[1] = (float32_t)(g * b[1]);
+        c[2] = (float32_t)(g * b[2]);
+        c[3] = (float32_t)(-a[1]);
+        c[4] = (float32_t)(-a[2]);
+
+        // Rounded poles must stay inside the unit circle (stability triangle)
+        double a1 = -(double)c[3], a2 = -(double)c[4];
+        if (!(fabs(a2) < 1.0 && fabs(a1) < 1.0 + a2)) {
+            return 0;
+        }
+    }
+    return sections;
+}
+
+/**
+ * @brief Pole of the first-order DC blocker for a cut-off frequency
+ * @details |H(e^{jω})|² = 2(1 − cos ω) / (1 − 2α·cos ω + α²) = 1/2 at ωc = 2π·fc/fs
+ *          gives α = c − √((1 − c)(3 − c)), c = cos ωc (α ≈ 1 − ωc for fc ≪ fs).
+ * @param fc_hz - −3 dB frequency (Hz)
+ * @param fs_hz - Sample rate (Hz)
+ * @return α
+ */
+float32_t IIR_DCBlockerAlpha(float32_t fc_hz, float32_t fs_hz) {
+    double c = cos(2.0 * IIR_PI * (double)fc_hz / (double)fs_hz);
+    return (float32_t)(c - sqrt((1.0 - c) * (3.0 - c)));
+}
@@ -0,0 +1,101 @@
+/**
+ * @file IIR.h
+ * @brief Run-time design of IIR filters for the sample rate in use
+ * @details Turns a filter specification (family, response, order, edges) and the
+ *          sample rate into CMSIS-DSP biquad coefficients, so the conditioning stages
+ *          follow the configured ODR instead of a table designed offline for 50 Hz.
+ *
+ *  | Family | Edge f1 (LP/HP) | Passband | Stopband |
+ *  |--------|-----------------|----------|----------|
+ *  | IIR_BUTTERWORTH | −3 dB | maximally flat | monotonic |
+ *  | IIR_CHEBYSHEV2 | stopband edge (−stop_db) | maximally flat | equiripple at −stop_db |
+ *
+ *  Band-pass filters take the edges f1 < f2 (−3 dB for Butterworth, stopband edges for
+ *  Chebyshev II) and double the order.
+ *
+ * ### Method
+ *  1. Analog low-pass prototype (poles and zeros, edge at 1 rad/s)
+ *  2. Frequency transformation to LP/HP/BP with the edges prewarped,
+ *     Ω = 2·fs·tan(π·f/fs), so they land exactly on f after step 3
+ *  3. Bilinear transform z = (2·fs + s) / (2·fs − s); zeros at infinity go to z = −1
+ *  4. Pole pairs, taken from the one closest to the unit circle, each get the nearest
+ *     remaining zero pair; a real pole left over becomes a first-order section
+ *  5. Every section is scaled to unity gain in the passband (DC, Nyquist or the centre
+ *     frequency), which also keeps the internal levels of the cascade bounded
+ *
+ *  Sections are emitted in step-4 order as [b0, b1, b2, a1, a2] with the feedback
+ *  coefficients negated (arm_biquad_cascade_df2T_f32). The design runs in double
+ *  precision (software floating point on the Cortex-M4, once per rate change) and only
+ *  the result is rounded to float: at 0.04 Hz and 50 Hz the poles sit within 0.03 of
+ *  z = 1, where a single-precision design would lose the response.
+ *
+ *  The DC blocker H(z) = (1 − z⁻¹) / (1 − α·z⁻¹) gets α from its exact −3 dB point.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-08-04
+ * @version 1.0
+ * @note Tools/nirs_iir.py builds IIR.c on the host and checks it against reference
+ *       designs and the filter specifications.
+ */
+
+#ifndef IIR_H_
+#define IIR_H_
+
+#include <stdint.h>
+#include "arm_math_types.h"
+
+/** @name Families
+ * @{ */
+#define IIR_BUTTERWORTH     0
+#define IIR_CHEBYSHEV2      1
+/** @} */
+
+/** @name Responses
+ * @{ */
+#define IIR_LOWPASS         0
+#define IIR_HIGHPASS        1
+#define IIR_BANDPASS        2
+/** @} */
+
+#define IIR_MAX_ORDER       8   /**< Largest prototype order (band-pass: 4, i.e. 8 poles) */
+
+/**
+ * @struct IIR_Spec
+ * @brief Filter specification, independent of the sample rate
+ */
+typedef struct {
+    uint8_t family;         /**< IIR_BUTTERWORTH or IIR_CHEBYSHEV2 */
+    uint8_t response;       /**< IIR_LOWPASS, IIR_HIGHPASS or IIR_BANDPASS */
+    uint8_t order;          /**< Prototype order (1–IIR_MAX_ORDER, band-pass 1–IIR_MAX_ORDER/2) */
+    float32_t f1_hz;        /**< LP/HP edge, BP lower edge (Hz) */
+    float32_t f2_hz;        /**< BP upper edge (Hz), unused otherwise */
+    float32_t stop_db;      /**< Chebyshev II stopband attenuation (dB), unused otherwise */
+} IIR_Spec;
+
+/**
+ * @brief Number of biquad sections a specification needs
+ * @param spec - [in] Filter specification
+ * @return ⌈order/2⌉ for LP/HP, order for BP
+ */
+uint8_t IIR_Sections(const IIR_Spec *spec);
+
+/**
+ * @brief Design a biquad cascade for a sample rate
+ * @param spec - [in] Filter specification
+ * @param fs_hz - Sample rate (Hz)
+ * @param coeffs - [out] 5 coefficients per section, CMSIS-DSP df2T layout
+ * @param max_sections - Capacity of coeffs in sections
+ * @return Sections written, 0 if the specification is invalid for fs_hz, does not fit or
+ *         is unstable with float32_t coefficients (coeffs then undefined)
+ */
+uint8_t IIR_Design(const IIR_Spec *spec, float32_t fs_hz, float32_t *coeffs, uint8_t max_sections);
+
+/**
+ * @brief Pole of the first-order DC blocker for a cut-off frequency
+ * @param fc_hz - −3 dB frequency (Hz), 0 < fc_hz < fs_hz / 8 (α > 0)
+ * @param fs_hz - Sample rate (Hz)
+ * @return α
+ */
+float32_t IIR_DCBlockerAlpha(float32_t fc_hz, float32_t fs_hz);
+
+#endif /* IIR_H_ */
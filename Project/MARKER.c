@@ -0,0 +1,180 @@
+/**
+ * @file MARKER.c
+ * @brief Hardware-timestamped external event marker implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-23
+ * @version 1.0
+ */
+
+#include "MARKER.h"
+#include "MAX30101.h"
+#include "TIMER.h"
+#include "stm32f303x8.h"
+#include <stdio.h>
+
+static MARKER_Event marker_queue[MARKER_QUEUE_SIZE];
+static volatile uint8_t marker_head;     /**< Written by ISR only */
+static volatile uint8_t marker_tail;     /**< Written by main loop only */
+
+static uint32_t marker_seq;              /**< Accepted edges (ISR) */
+static uint32_t marker_last_time;        /**< Last accepted edge time (ISR) */
+static volatile uint32_t marker_dropped; /**< Queue-full drops (ISR) */
+static volatile uint16_t marker_isr_min = UINT16_MAX;
+static volatile uint16_t marker_isr_max;
+
+static uint32_t marker_out_count;        /**< Events output (main loop) */
+static uint32_t marker_out_min = UINT32_MAX;
+static uint32_t marker_out_max;
+static uint32_t marker_out_sum;
+
+/**
+ * @brief Configure PA0 as TIM2_CH1 capture input and enable the EXTI0 interrupt
+ * @details Configuration sequence:
+ *          1. PA0 alternate function AF1 (TIM2_CH1) with pull-down
+ *          2. TIM2 channel 1 input capture on TI1, rising edge, filter N = 8 at f_CK_INT
+ *             (125 ns glitch rejection)
+ *          3. EXTI0 mapped to PA0 (SYSCFG), rising edge, unmasked; the GPIO input stage
+ *             stays active in alternate-function mode, so both paths see the same edge
+ *          4. EXTI0 NVIC priority MARKER_IRQ_PRIORITY, enabled
+ * @return void
+ */
+void MARKER_Init(void) {
+    RCC->AHBENR |= RCC_AHBENR_GPIOAEN;
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+
+    // PA0: alternate function 1 (TIM2_CH1), pull-down
+    GPIOA->MODER &= ~(0x3U << 0);
+    GPIOA->MODER |= (0x2U << 0);
+    GPIOA->AFR[0] &= ~(0xFU << 0);
+    GPIOA->AFR[0] |= (0x1U << 0);
+    GPIOA->PUPDR &= ~(0x3U << 0);
+    GPIOA->PUPDR |= (0x2U << 0);
+
+    // TIM2 CH1: input capture from TI1, IC1F = 0011 (f_CK_INT, N = 8), rising edge
+    TIM2->CCER &= ~TIM_CCER_CC1E;
+    TIM2->CCMR1 &= ~(TIM_CCMR1_CC1S | TIM_CCMR1_IC1F);
+    TIM2->CCMR1 |= TIM_CCMR1_CC1S_0 | TIM_CCMR1_IC1F_0 | TIM_CCMR1_IC1F_1;
+    TIM2->CCER &= ~(TIM_CCER_CC1P | TIM_CCER_CC1NP);
+    TIM2->CCER |= TIM_CCER_CC1E;
+    TIM2->SR = ~(TIM_SR_CC1IF | TIM_SR_CC1OF);
+
+    // EXTI0 ← PA0, rising edge
+    SYSCFG->EXTICR[0] &= ~SYSCFG_EXTICR1_EXTI0;
+    SYSCFG->EXTICR[0] |= SYSCFG_EXTICR1_EXTI0_PA;
+    EXTI->RTSR |= EXTI_RTSR_TR0;
+    EXTI->FTSR &= ~EXTI_FTSR_TR0;
+    EXTI->PR = EXTI_PR_PR0;
+    EXTI->IMR |= EXTI_IMR_MR0;
+
+    marker_head = marker_tail = 0;
+    NVIC_SetPriority(EXTI0_IRQn, MARKER_IRQ_PRIORITY);
+    NVIC_EnableIRQ(EXTI0_IRQn);
+}
+
+/**
+ * @brief EXTI0 interrupt body
+ * @details The edge time comes from CCR1 (latched by hardware); reading CCR1 clears
+ *          CC1IF. If a bounce re-triggered the capture before the ISR ran, CCR1 holds
+ *          the later edge (at most one ISR latency after the first). Without a pending
+ *          capture (should not happen) the ISR entry time is used instead.
+ * @return void
+ */
+void MARKER_Capture(void) {
+    uint32_t now = TIMER_GetMicros();
+    EXTI->PR = EXTI_PR_PR0;
+    uint32_t edge = (TIM2->SR & TIM_SR_CC1IF) ? TIM2->CCR1 : now;
+    TIM2->SR = ~TIM_SR_CC1OF;
+
+    if (marker_seq && (edge - marker_last_time) < MARKER_DEBOUNCE_US) {
+        return;
+    }
+    marker_last_time = edge;
+
+    uint16_t latency = (uint16_t)(now - edge);
+    if (latency < marker_isr_min) marker_isr_min = latency;
+    if (latency > marker_isr_max) marker_isr_max = latency;
+
+    uint8_t next = (uint8_t)((marker_head + 1U) & (MARKER_QUEUE_SIZE - 1U));
+    marker_seq++;
+    if (next == marker_tail) {
+        marker_dropped++;
+        return;
+    }
+    marker_queue[marker_head].seq = marker_seq;
+    marker_queue[marker_head].time = edge;
+    marker_queue[marker_head].isr_latency = latency;
+    marker_head = next;
+}
+
+/**
+ * @brief Take the oldest pending event
+ * @param event - [out] Event
+ * @return 1 if an event was returned, 0 if the queue is empty
+ */
+uint8_t MARKER_Pop(MARKER_Event *event) {
+    uint8_t tail = marker_tail;
+    if (tail == marker_head) {
+        return 0;
+    }
+    *event = marker_queue[tail];
+    marker_tail = (uint8_t)((tail + 1U) & (MARKER_QUEUE_SIZE - 1U));
+    return 1;
+}
+
+/**
+ * @brief Record the end-to-end latency of one output event
+ * @param event - [in] Event
+ * @param now - TIM2 time after the output was handed to the UART
+ * @return void
+ */
+void MARKER_NoteOutput(const MARKER_Event *event, uint32_t now) {
+    uint32_t latency = now - event->time;
+    if (latency < marker_out_min) marker_out_min = latency;
+    if (latency > marker_out_max) marker_out_max = latency;
+    marker_out_sum += latency;
+    marker_out_count++;
+}
+
+/**
+ * @brief Index of the sample nearest to a time, from a reference sample
+ * @details k = round((time − ref_time) / T), index = ref_index + k (clamped at 0),
+ *          offset = time − (ref_time + k·T), saturated to int16.
+ * @param time - Event time (TIM2 µs)
+ * @param ref_index - Reference sample index
+ * @param ref_time - Reference sample time (TIM2 µs)
+ * @param offset_us - [out] time − nearest sample time (µs)
+ * @return Nearest sample index
+ */
+uint32_t MARKER_NearestSample(uint32_t time, uint32_t ref_index, uint32_t ref_time, int16_t *offset_us) {
+    const int32_t period = (int32_t)MAX30101_GetSamplePeriodUs();
+    int32_t dt = (int32_t)(time - ref_time);
+    int32_t k = (dt >= 0) ? (dt + period / 2) / period : -((period / 2 - dt) / period);
+    if (k < 0 && (uint32_t)(-k) > ref_index) {
+        k = -(int32_t)ref_index;
+    }
+    int32_t offset = dt - k * period;
+    if (offset > INT16_MAX) offset = INT16_MAX;
+    if (offset < INT16_MIN) offset = INT16_MIN;
+    *offset_us = (int16_t)offset;
+    return ref_index + (uint32_t)k;
+}
+
+/**
+ * @brief Format the marker latency statistics as a report line
+ * @details Format: `#MARKER,<events>,<dropped>,<isr_min_us>,<isr_max_us>,<out_min_us>,<out_mean_us>,<out_max_us>\r\n`
+ *          (zeros until the first event has been output)
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int MARKER_FormatReport(char *buffer, uint32_t size) {
+    uint8_t any = (marker_out_count != 0);
+    return snprintf(buffer, size, "#MARKER,%lu,%lu,%u,%u,%lu,%lu,%lu\r\n",
+                    (unsigned long)marker_seq,
+                    (unsigned long)marker_dropped,
+                    (unsigned)(any ? marker_isr_min : 0U),
+                    (unsigned)marker_isr_max,
+                    (unsigned long)(any ? marker_out_min : 0U),
+                    (unsigned long)(any ? marker_out_sum / marker_out_count : 0U),
+                    (unsigned long)marker_out_max);
+}
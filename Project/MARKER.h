@@ -0,0 +1,103 @@
+/**
+ * @file MARKER.h
+ * @brief Hardware-timestamped external event marker input
+ * @details Rising edges on PA0 (Nucleo A0) mark external events such as foot strikes or
+ *          stimulus onsets. The edge time is latched by TIM2 input capture (channel 1)
+ *          in hardware, so the timestamp does not depend on interrupt latency; the EXTI0
+ *          interrupt only collects the captured value and queues the event.
+ *
+ * ### Signal Path
+ *  ```
+ *  PA0 ──┬── TIM2_CH1 (AF1) input capture → CCR1  (edge time, 1 µs)
+ *        └── EXTI0 rising edge → MARKER_Capture() → lock-free queue → main loop
+ *  ```
+ *
+ * ### Queue
+ *  - Single producer (EXTI0 ISR), single consumer (main loop), MARKER_QUEUE_SIZE entries
+ *  - Events arriving while the queue is full are counted as dropped
+ *  - Edges closer than MARKER_DEBOUNCE_US to the previous accepted edge are ignored
+ *
+ * ### Latency Statistics
+ *  - ISR latency: TIM2 count at ISR entry − captured edge time
+ *  - Output latency: time the EVENT frame has been queued for UART DMA (or the CSV line
+ *    has been sent) − captured edge time, i.e. delay through the main loop including
+ *    frames being encoded ahead of it
+ *  - Report: `#MARKER,<events>,<dropped>,<isr_min_us>,<isr_max_us>,<out_min_us>,<out_mean_us>,<out_max_us>\r\n`
+ *    (jitter = max − min)
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-23
+ * @version 1.0
+ * @note Requires TIMER_Init() before MARKER_Init(). The input has a pull-down; drive it
+ *       with a 3.3 V logic signal or a switch to 3.3 V.
+ */
+
+#ifndef MARKER_H_
+#define MARKER_H_
+
+#include <stdint.h>
+
+#define MARKER_QUEUE_SIZE       16      /**< Pending events (power of two) */
+#define MARKER_DEBOUNCE_US      2000    /**< Minimum spacing between accepted edges (µs) */
+#define MARKER_IRQ_PRIORITY     0       /**< EXTI0 priority: above USART2 RX and SysTick */
+
+/**
+ * @struct MARKER_Event
+ * @brief One captured marker edge
+ */
+typedef struct {
+    uint32_t seq;            /**< Marker sequence number (counts accepted edges) */
+    uint32_t time;           /**< Captured edge time (TIM2 µs) */
+    uint16_t isr_latency;    /**< ISR entry − edge time (µs) */
+} MARKER_Event;
+
+/**
+ * @brief Configure PA0 as TIM2_CH1 capture input and enable the EXTI0 interrupt
+ * @return void
+ */
+void MARKER_Init(void);
+
+/**
+ * @brief EXTI0 interrupt body: read the captured edge time and queue the event
+ * @return void
+ * @note Called from EXTI0_IRQHandler().
+ */
+void MARKER_Capture(void);
+
+/**
+ * @brief Take the oldest pending event (main loop)
+ * @param event - [out] Event
+ * @return 1 if an event was returned, 0 if the queue is empty
+ */
+uint8_t MARKER_Pop(MARKER_Event *event);
+
+/**
+ * @brief Record that an event has been output, for the end-to-end latency statistics
+ * @param event - [in] Event taken with MARKER_Pop()
+ * @param now - TIM2 time after the event was handed to the UART
+ * @return void
+ */
+void MARKER_NoteOutput(const MARKER_Event *event, uint32_t now);
+
+/**
+ * @brief Index of the sample nearest to a time, from a reference sample
+ * @details Extrapolates by whole sample periods from the reference (usually the last
+ *          sample taken from the scheduler queue), so the result is valid for edges
+ *          before or after the reference.
+ * @param time - Event time (TIM2 µs)
+ * @param ref_index - Reference sample index
+ * @param ref_time - Reference sample time (TIM2 µs)
+ * @param offset_us - [out] time − nearest sample time (µs)
+ * @return Nearest sample index
+ */
+uint32_t MARKER_NearestSample(uint32_t time, uint32_t ref_index, uint32_t ref_time, int16_t *offset_us);
+
+/**
+ * @brief Format the marker latency statistics as a report line
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int MARKER_FormatReport(char *buffer, uint32_t size);
+
+#endif /* MARKER_H_ */
@@ -13,6 +13,8 @@
 #include "arm_math_types.h"
 #include <stdint.h>
 
+static uint32_t max30101_period_us = MAX30101_SAMPLE_PERIOD_US; /**< Set by MAX30101_RateCode() */
+
 /**
  * @brief Initialize MAX30101 in SpO2 mode (dual-LED: Red + IR)
  * @details Configures sensor for blood oxygen (SpO2) measurement with low power consumption.
@@ -93,6 +95,134 @@ uint8_t MAX30101_GetNumAvailableSamples(void) {
     return num_samples;
 }
 
+/**
+ * @brief Read the FIFO pointer registers with a single I2C transaction
+ * @details WR_PTR (0x04), OVF_COUNTER (0x05) and RD_PTR (0x06) are contiguous, so the
+ *          register auto-increment returns all three in one 3-byte read. This replaces
+ *          the two separate pointer reads of MAX30101_GetNumAvailableSamples() and also
+ *          exposes the overflow counter.
+ * @param status - [out] Optional pointer register snapshot (may be NULL)
+ * @return uint8_t Number of unread samples (0 to 32)
+ *         - Returns 32 when OVF_COUNTER is non-zero (FIFO full, oldest samples overwritten)
+ * @note Cost: one I2C1_READ_COST_NS(3) transaction (~160 µs on the wire)
+ * @see MAX30101_ReadFIFOBurst
+ */
+uint8_t MAX30101_ReadFIFOStatus(MAX30101_FIFOStatus *status) {
+    uint8_t regs[3];
+
+    I2C1_Read(SENSOR_ADDR, FIFO_WRITPTR, regs, 3);
+    return MAX30101_ParseFIFOStatus(regs, status);
+}
+
+/**
+ * @brief Decode a FIFO pointer register snapshot
+ * @param regs - [in] WR_PTR, OVF_COUNTER, RD_PTR
+ * @param status - [out] Optional pointer register snapshot (may be NULL)
+ * @return uint8_t Number of unread samples (0 to 32)
+ */
+uint8_t MAX30101_ParseFIFOStatus(const uint8_t regs[3], MAX30101_FIFOStatus *status) {
+    uint8_t write_ptr = regs[0] & 0x1F;
+    uint8_t read_ptr  = regs[2] & 0x1F;
+
+    if (status) {
+        status->write_ptr = write_ptr;
+        status->ovf_counter = regs[1] & 0x1F;
+        status->read_ptr = read_ptr;
+    }
+    // A full FIFO has equal pointers; the overflow counter disambiguates it from empty
+    if (regs[1] & 0x1F) {
+        return MAX30101_FIFO_DEPTH;
+    }
+    return (uint8_t)((write_ptr - read_ptr) & 0x1F);
+}
+
+/**
+ * @brief SPO2_CONFIG sample-rate code of an ODR; records its sample period
+ * @param odr_hz - [in] Sample rate (Hz)
+ * @param sr - [out] SR = 000 (50 Hz), 001 (100 Hz), 010 (200 Hz) or 011 (400 Hz)
+ * @return 1 if supported, 0 otherwise (period unchanged)
+ */
+static uint8_t MAX30101_RateCode(uint16_t odr_hz, uint8_t *sr) {
+    switch (odr_hz) {
+        case 50:  *sr = 0; break;
+        case 100: *sr = 1; break;
+        case 200: *sr = 2; break;
+        case 400: *sr = 3; break;
+        default:  return 0;
+    }
+    max30101_period_us = 1000000U / odr_hz;
+    return 1;
+}
+
+/**
+ * @brief Set the output data rate of the selected sensor
+ * @details SPO2_CONFIG = 0x23 | (SR << 2): 4096 nA range and 411 µs / 18-bit are kept,
+ *          SR = 000 (50 Hz), 001 (100 Hz), 010 (200 Hz) or 011 (400 Hz). Faster rates
+ *          require shorter pulse widths (lower resolution) and are not offered.
+ * @param odr_hz - [in] Sample rate (Hz)
+ * @return 1 if applied, 0 if not supported
+ */
+uint8_t MAX30101_SetSampleRate(uint16_t odr_hz) {
+    uint8_t sr;
+    if (!MAX30101_RateCode(odr_hz, &sr)) {
+        return 0;
+    }
+    I2C1_Write(SENSOR_ADDR, SPO2_CONFIG, (uint8_t)(0x23 | (sr << 2)));
+    return 1;
+}
+
+/**
+ * @brief Register sequence of the NIRS Lite configuration at a given ODR
+ * @details FIFO_CONFIG 0x10, SPO2_CONFIG 0x23 | (SR << 2), LED1/LED2 = mA / 0.2,
+ *          FIFO_WR_PTR, OVF_COUNTER and FIFO_RD_PTR cleared, MODE_CONFIG 0x03 (SpO2) last.
+ * @param ledPower_red - Red LED current (mA)
+ * @param ledPower_ir - IR LED current (mA)
+ * @param odr_hz - Sample rate (Hz)
+ * @param seq - [out] MAX30101_INIT_WRITES register writes
+ * @return Number of writes, 0 if the rate is not supported
+ */
+uint8_t MAX30101_PrepareNIRSLite(float32_t ledPower_red, float32_t ledPower_ir, uint16_t odr_hz, MAX30101_RegWrite *seq) {
+    uint8_t sr;
+    if (!MAX30101_RateCode(odr_hz, &sr)) {
+        return 0;
+    }
+    seq[0] = (MAX30101_RegWrite){ FIFO_CONFIG, 0x10 };
+    seq[1] = (MAX30101_RegWrite){ SPO2_CONFIG, (uint8_t)(0x23 | (sr << 2)) };
+    seq[2] = (MAX30101_RegWrite){ LED1_PAMPLI, (uint8_t)(ledPower_red / 0.2f) };
+    seq[3] = (MAX30101_RegWrite){ LED2_PAMPLI, (uint8_t)(ledPower_ir / 0.2f) };
+    seq[4] = (MAX30101_RegWrite){ FIFO_WRITPTR, 0x0 };
+    seq[5] = (MAX30101_RegWrite){ OVRF_COUNTER, 0x0 };
+    seq[6] = (MAX30101_RegWrite){ FIFO_READPTR, 0x0 };
+    seq[7] = (MAX30101_RegWrite){ MODE_CONFIG, 0x03 };
+    return MAX30101_INIT_WRITES;
+}
+
+/**
+ * @brief Nominal time between FIFO samples at the configured rate
+ * @return Sample period (µs)
+ */
+uint32_t MAX30101_GetSamplePeriodUs(void) {
+    return max30101_period_us;
+}
+
+/**
+ * @brief Burst-read samples from the MAX30101 FIFO
+ * @details Reads num_samples × 6 bytes from FIFO_DATAREG in one repeated-START transaction.
+ *          The sensor does not auto-increment the register address on FIFO_DATAREG but does
+ *          advance FIFO_RD_PTR after every complete sample, so consecutive bytes walk the FIFO.
+ *          The MAX30101_Sample layout matches the FIFO byte order, so the buffer can be
+ *          unpacked in place with MAX30101_ConvertSampleToUint32().
+ *
+ * @param samples - [out] Buffer for raw samples (capacity ≥ num_samples)
+ * @param num_samples - [in] Number of samples to read (1 to 32)
+ * @return void
+ * @note Cost: one I2C1_READ_COST_NS(6 × num_samples) transaction
+ * @see MAX30101_ReadFIFOStatus, MAX30101_ConvertSampleToUint32
+ */
+void MAX30101_ReadFIFOBurst(MAX30101_Sample *samples, uint8_t num_samples) {
+    I2C1_Read(SENSOR_ADDR, FIFO_DATAREG, (uint8_t *)samples, (uint8_t)(num_samples * MAX30101_SAMPLE_BYTES));
+}
+
 /**
  * @brief Update the FIFO read pointer
  * @details Advances the read pointer by a specified number of samples, wrapping around at 32.
@@ -109,6 +239,76 @@ void MAX30101_UpdateReadPointer(uint8_t num_samples) {
     I2C1_Write(SENSOR_ADDR, FIFO_READPTR, read_ptr);
 }
 
+/**
+ * @brief Empty the FIFO of the selected sensor
+ * @details Clears FIFO_WR_PTR, OVF_COUNTER and FIFO_RD_PTR (datasheet: recommended
+ *          before a new acquisition), discarding every unread sample.
+ * @return void
+ */
+void MAX30101_ResetFIFO(void) {
+    I2C1_Write(SENSOR_ADDR, FIFO_WRITPTR, 0x0);
+    I2C1_Write(SENSOR_ADDR, OVRF_COUNTER, 0x0);
+    I2C1_Write(SENSOR_ADDR, FIFO_READPTR, 0x0);
+}
+
+/**
+ * @brief Stop or restart the conversions of the selected sensor(s)
+ * @details MODE_CONFIG = 0x03 (SpO2), | SHDN to stop. Registers and FIFO contents are
+ *          kept in shutdown, so the sensor can be fully configured before it starts.
+ * @param shutdown - 1 = shutdown, 0 = SpO2 conversions running
+ * @return void
+ */
+void MAX30101_SetShutdown(uint8_t shutdown) {
+    I2C1_Write(SENSOR_ADDR, MODE_CONFIG, (uint8_t)(0x03 | (shutdown ? MAX30101_MODE_SHDN : 0)));
+}
+
+/**
+ * @brief Enable or disable the PPG_RDY interrupt of the selected sensor
+ * @details INTR_STATUS1 is read afterwards so a flag raised before the call does not
+ *          hold INT low.
+ * @param enable - 1 = assert INT on every new sample, 0 = INT unused
+ * @return void
+ */
+void MAX30101_SetDataReadyInterrupt(uint8_t enable) {
+    uint8_t status;
+    I2C1_Write(SENSOR_ADDR, INTR_ENABLE1, enable ? MAX30101_INT_PPG_RDY : 0x00);
+    I2C1_Read(SENSOR_ADDR, INTR_STATUS1, &status, 1);
+}
+
+/**
+ * @brief Set the proximity-mode pilot current and wake-up threshold of the selected sensor
+ * @param pilot_ma - IR LED current in proximity mode (mA)
+ * @param threshold_na - IR current that ends proximity mode (nA)
+ * @return void
+ */
+void MAX30101_SetProximity(float32_t pilot_ma, float32_t threshold_na) {
+    float32_t thresh = threshold_na / MAX30101_PROX_LSB_NA;
+    I2C1_Write(SENSOR_ADDR, PILOT_PA, (uint8_t)(pilot_ma / 0.2f));
+    I2C1_Write(SENSOR_ADDR, PROX_INT_THRESH, (thresh > 255.0f) ? 0xFF : (uint8_t)thresh);
+}
+
+/**
+ * @brief Register sequence that enters (PROX_INT_EN, mode restart) or leaves
+ *        (PROX_INT_EN off, FIFO cleared) proximity mode
+ * @param enter - 1 = enter, 0 = leave
+ * @param data_ready - 1 to keep PPG_RDY enabled
+ * @param seq - [out] Register writes
+ * @return Number of writes
+ */
+uint8_t MAX30101_PrepareProximity(uint8_t enter, uint8_t data_ready, MAX30101_RegWrite *seq) {
+    uint8_t ppg = data_ready ? MAX30101_INT_PPG_RDY : 0x00;
+    if (enter) {
+        seq[0] = (MAX30101_RegWrite){ INTR_ENABLE1, (uint8_t)(ppg | MAX30101_INT_PROX) };
+        seq[1] = (MAX30101_RegWrite){ MODE_CONFIG, 0x03 };
+        return 2;
+    }
+    seq[0] = (MAX30101_RegWrite){ INTR_ENABLE1, ppg };
+    seq[1] = (MAX30101_RegWrite){ FIFO_WRITPTR, 0x0 };
+    seq[2] = (MAX30101_RegWrite){ OVRF_COUNTER, 0x0 };
+    seq[3] = (MAX30101_RegWrite){ FIFO_READPTR, 0x0 };
+    return MAX30101_PROX_WRITES;
+}
+
 /**
  * @brief Convert raw NIRS sample bytes to 32-bit ADC counts
  * @details Combines 3-byte groups (MSB, LSB, unused) into 32-bit values per channe from 18-bit ADC output.
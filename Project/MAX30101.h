@@ -36,19 +36,32 @@
 #define     LED2_PAMPLI			0x0D
 #define     LED3_PAMPLI			0x0E
 #define     LED4_PAMPLI			0x0F
+#define     PILOT_PA			0x10
 #define     MLED_CONFG1			0x11
 #define     MLED_CONFG2			0x12
 #define     DIE_TEMPINT			0x1F
 #define     DIE_TEMPFRC			0x20
 #define     DIE_TEMPCFG			0x21
+#define     PROX_INT_THRESH		0x30
 
 #define     BUFFERBLOCKSIZE     0x8
+#define     MAX30101_FIFO_DEPTH     32      /**< FIFO capacity in samples */
+#define     MAX30101_SAMPLE_BYTES   6       /**< Bytes per FIFO sample in SpO2 mode (Red + IR, 3 bytes each) */
+#define     MAX30101_ODR_HZ         50      /**< Output data rate set by MAX30101_InitNIRSLite() (SPO2_CONFIG SR = 000) */
+#define     MAX30101_ODR_MAX_HZ     400     /**< Highest ODR in SpO2 mode at 411 µs pulse width (18-bit) */
+#define     MAX30101_SAMPLE_PERIOD_US   (1000000U / MAX30101_ODR_HZ) /**< Nominal time between FIFO samples at the default ODR (µs) */
 #define     MAX30101_ADC_VREF   3.3f        /**< ADC reference voltage in volts */
 #define     MAX30101_ADC_BITS   18          /**< ADC resolution in bits */
 #define     MAX30101_ADC_MAX    ((1 << MAX30101_ADC_BITS) - 1)  /**< Max ADC count (262143 for 18-bit) */
 #define     MAX30101_CURRENT_LSB_PA  15.625f  /**< LSB size in picoamps (pA): 4096 nA / 2^18 */
 #define     MAX30101_CURRENT_LSB_NA  (MAX30101_CURRENT_LSB_PA / 1000.0f)  /**< LSB size in nanoamps (nA) */
 #define     MAX30101_CURRENT_FULLSCALE  4096.0f  /**< Full scale current range in nanoamps (nA) */
+#define     MAX30101_MODE_SHDN      0x80    /**< MODE_CONFIG: shutdown (conversions stopped, registers kept) */
+#define     MAX30101_INT_PPG_RDY    0x40    /**< INTR_ENABLE1/INTR_STATUS1: new FIFO sample ready */
+#define     MAX30101_INIT_WRITES    8       /**< Register writes of MAX30101_PrepareNIRSLite() */
+#define     MAX30101_INT_PROX       0x10    /**< INTR_ENABLE1/INTR_STATUS1: IR level above PROX_INT_THRESH in proximity mode */
+#define     MAX30101_PROX_LSB_NA    16.0f   /**< PROX_INT_THRESH step: the 8 MSBs of the 18-bit IR count (4096 nA / 256) */
+#define     MAX30101_PROX_WRITES    4       /**< Largest register sequence of MAX30101_PrepareProximity() */
 
 /**
  * @struct MAX30101_Sample
@@ -84,6 +97,26 @@ typedef struct {
     float32_t ir;        /**< IR current (0–4096 nA) */
 } MAX30101_CurrentSample;
 
+/**
+ * @struct MAX30101_FIFOStatus
+ * @brief Snapshot of the FIFO pointer registers (0x04–0x06)
+ * @details Filled by MAX30101_ReadFIFOStatus() with a single 3-byte I2C read.
+ */
+typedef struct {
+    uint8_t write_ptr;   /**< FIFO_WR_PTR (5-bit) */
+    uint8_t ovf_counter; /**< OVF_COUNTER: samples lost since last read (saturates at 31) */
+    uint8_t read_ptr;    /**< FIFO_RD_PTR (5-bit) */
+} MAX30101_FIFOStatus;
+
+/**
+ * @struct MAX30101_RegWrite
+ * @brief One register write of a configuration sequence
+ */
+typedef struct {
+    uint8_t reg;         /**< Register address */
+    uint8_t value;       /**< Value written */
+} MAX30101_RegWrite;
+
 /**
  * @brief Initialize MAX30101 for NIRS muscle oxygenation (dual-LED: Red + IR)
  * @details Configures sensor for blood oxygen measurement with low power consumption.
@@ -103,11 +136,124 @@ void MAX30101_InitNIRSLite(float32_t ledPower_red, float32_t ledPower_ir);
  */
 uint8_t MAX30101_GetNumAvailableSamples(void);
 
+/**
+ * @brief Read WR_PTR, OVF_COUNTER and RD_PTR in one transaction
+ * @param status - [out] Optional pointer register snapshot (may be NULL)
+ * @return Number of unread samples (0-32); 32 when the overflow counter is non-zero
+ */
+uint8_t MAX30101_ReadFIFOStatus(MAX30101_FIFOStatus *status);
+
+/**
+ * @brief Decode a WR_PTR/OVF_COUNTER/RD_PTR register snapshot
+ * @details Shared by MAX30101_ReadFIFOStatus() and asynchronous (DMA) status reads.
+ * @param regs - [in] Registers 0x04–0x06 as read in one transaction
+ * @param status - [out] Optional pointer register snapshot (may be NULL)
+ * @return Number of unread samples (0-32); 32 when the overflow counter is non-zero
+ */
+uint8_t MAX30101_ParseFIFOStatus(const uint8_t regs[3], MAX30101_FIFOStatus *status);
+
+/**
+ * @brief Set the output data rate of the selected sensor (SpO2 mode, 411 µs, 18-bit)
+ * @details Supported rates at 411 µs pulse width with two LEDs: 50, 100, 200, 400 Hz.
+ *          The rate is shared by every sensor: MAX30101_GetSamplePeriodUs() returns the
+ *          period of the last successful call.
+ * @param odr_hz - [in] Sample rate (Hz)
+ * @return 1 if applied, 0 if the rate is not supported (configuration unchanged)
+ * @note Call after MAX30101_InitNIRSLite() on every sensor, before acquisition starts.
+ */
+uint8_t MAX30101_SetSampleRate(uint16_t odr_hz);
+
+/**
+ * @brief Register sequence of the NIRS Lite configuration at a given ODR, for
+ *        asynchronous transfer (boot fast start)
+ * @details Same settings as MAX30101_InitNIRSLite() + MAX30101_SetSampleRate(), ordered
+ *          so that conversions start last: FIFO, SpO2 (rate), LED currents, FIFO pointer
+ *          reset, then MODE_CONFIG. The first sample in the FIFO is therefore already taken
+ *          at the final rate and LED currents. The rate becomes the one returned by
+ *          MAX30101_GetSamplePeriodUs(); no I2C transfer is made.
+ * @param ledPower_red - Red LED current (mA)
+ * @param ledPower_ir - IR LED current (mA)
+ * @param odr_hz - Sample rate: 50, 100, 200 or 400 Hz
+ * @param seq - [out] MAX30101_INIT_WRITES register writes
+ * @return Number of writes, 0 if the rate is not supported
+ */
+uint8_t MAX30101_PrepareNIRSLite(float32_t ledPower_red, float32_t ledPower_ir, uint16_t odr_hz, MAX30101_RegWrite *seq);
+
+/**
+ * @brief Nominal time between FIFO samples at the configured rate
+ * @return Sample period (µs); MAX30101_SAMPLE_PERIOD_US until MAX30101_SetSampleRate() is used
+ */
+uint32_t MAX30101_GetSamplePeriodUs(void);
+
+/**
+ * @brief Burst-read consecutive samples from FIFO_DATAREG
+ * @details The read pointer advances in hardware with every sample read, so no
+ *          MAX30101_UpdateReadPointer() call is needed afterwards.
+ * @param samples - [out] Buffer for raw samples (capacity ≥ num_samples)
+ * @param num_samples - [in] Number of samples to read (1-32)
+ */
+void MAX30101_ReadFIFOBurst(MAX30101_Sample *samples, uint8_t num_samples);
+
 /**
  * @brief Update FIFO read pointer
  * @param num_samples Number of samples to advance read pointer
  */
 void MAX30101_UpdateReadPointer(uint8_t num_samples);
+
+/**
+ * @brief Empty the FIFO of the selected sensor (WR_PTR, OVF_COUNTER, RD_PTR = 0)
+ * @return void
+ */
+void MAX30101_ResetFIFO(void);
+
+/**
+ * @brief Stop or restart the conversions of the selected sensor(s)
+ * @details Writes MODE_CONFIG = SpO2 with or without SHDN. Leaving shutdown starts
+ *          the sample clock at the STOP condition of the write, so one write through
+ *          PCA9548_SelectMask() starts several sensors in phase.
+ * @param shutdown - 1 = shutdown, 0 = SpO2 conversions running
+ * @return void
+ */
+void MAX30101_SetShutdown(uint8_t shutdown);
+
+/**
+ * @brief Enable or disable the PPG_RDY interrupt of the selected sensor
+ * @details With PPG_RDY enabled the open-drain INT pin goes low when a new sample
+ *          enters the FIFO and is released by the next FIFO_DATAREG read (or a read of
+ *          INTR_STATUS1), so every drain re-arms it.
+ * @param enable - 1 = assert INT on every new sample, 0 = INT unused
+ * @return void
+ */
+void MAX30101_SetDataReadyInterrupt(uint8_t enable);
+
+/**
+ * @brief Set the proximity-mode pilot current and wake-up threshold of the selected sensor
+ * @details Proximity mode drives only the IR LED, at pilot_ma, until the IR count exceeds
+ *          PROX_INT_THRESH; the sensor then raises PROX_INT and starts the configured
+ *          SpO2 conversions on its own. The threshold is rounded down to a multiple of
+ *          MAX30101_PROX_LSB_NA (the register holds the 8 MSBs of the count).
+ * @param pilot_ma - IR LED current in proximity mode (mA, 0.2 mA steps)
+ * @param threshold_na - IR current at pilot_ma that ends proximity mode (nA, up to 4080)
+ * @return void
+ * @note Takes effect the next time proximity mode is entered (MAX30101_PrepareProximity()).
+ */
+void MAX30101_SetProximity(float32_t pilot_ma, float32_t threshold_na);
+
+/**
+ * @brief Register sequence that enters or leaves proximity mode, for blocking or
+ *        asynchronous transfer
+ * @details Enter: PROX_INT_EN on and MODE_CONFIG rewritten (SpO2), which restarts the
+ *          sensor in proximity mode. Leave (after PROX_INT): PROX_INT_EN off and the FIFO
+ *          pointers cleared, so the first sample read is one taken after the wake-up.
+ *          PPG_RDY is kept as given, the interrupt enable register being written whole.
+ *          No I2C transfer is made.
+ * @param enter - 1 = enter proximity mode, 0 = leave it
+ * @param data_ready - 1 if PPG_RDY is in use (MAX30101_SetDataReadyInterrupt())
+ * @param seq - [out] Up to MAX30101_PROX_WRITES register writes
+ * @return Number of writes
+ */
+uint8_t MAX30101_PrepareProximity(uint8_t enter, uint8_t data_ready, MAX30101_RegWrite *seq);
+
 /**
  * @brief Convert raw NIRS sample bytes to 32-bit ADC counts
  * @param sample_in Pointer to MAX30101_Sample with raw byte data
@@ -146,7 +292,7 @@ void MAX30101_ReadSingleCurrentData(MAX30101_CurrentSample *sample);
  * @param x  Current input sample (raw current in nA)
  * @param w  Pointer to the filter state variable (updated in place)
  * @return Filtered output sample with DC removed
- * @note ALPHA = 0.95 corresponds to a cutoff frequency of approximately 0.4 Hz at a sampling rate of 50 Hz, while ALPHA = 0.995 corresponds to a cutoff frequency of approximately 0.04 Hz at a sampling rate of 50 Hz.
+ * @note ALPHA = 0.95 corresponds to a cutoff frequency of approximately 0.4 Hz at a sampling rate of 50 Hz, while ALPHA = 0.995 corresponds to a cutoff frequency of approximately 0.04 Hz at a sampling rate of 50 Hz; IIR_DCBlockerAlpha() computes it for any cut-off and rate.
  */
 static inline float32_t MAX30101_FirstOrderDC_Blocker(float32_t x, float32_t *w, float32_t alpha)
 {
@@ -0,0 +1,230 @@
+/**
+ * @file NIRS.h
+ * @brief Modified Beer-Lambert conversion of Red/IR currents to hemoglobin changes
+ * @details Converts each calibrated Red (660 nm) / IR (880 nm) sample into relative
+ *          concentration changes of oxygenated (ΔHbO2) and deoxygenated (ΔHHb) hemoglobin.
+ *
+ * ### Model
+ *  ```
+ *  ΔOD(λ) = −log10( I(λ) / I0(λ) )
+ *  ΔOD(λ) = d · DPF · ( ε_HbO2(λ) · ΔHbO2 + ε_HHb(λ) · ΔHHb )
+ *  ```
+ *  The 2×2 system is inverted once in NIRS_Init(); each sample then costs two log10f()
+ *  and a 2×2 matrix-vector product.
+ *
+ * ### Kalman Estimator
+ *  The per-sample inversion passes the full optical noise into ΔHb. NIRS_KalmanUpdate()
+ *  instead estimates x = [ΔHbO2; ΔHHb] (µM) as a random walk observed through the ΔOD
+ *  of every wavelength slot:
+ *  ```
+ *  x[n] = x[n−1] + w,   w ~ N(0, q·I),   q = q_rate² · T
+ *  ΔOD[n] = H · x[n] + v,   v ~ N(0, R),  H = d · DPF · ε · 10⁻⁶,  R = diag(σ_OD²)
+ *  ```
+ *  F, H, Q and R are constant, so NIRS_KalmanDesign() precomputes the information one
+ *  sample adds, G = Hᵀ R⁻¹ H (2×2), and Hᵀ R⁻¹ (2 × NIRS_WAVELENGTHS). The update is
+ *  then the information form, hand-unrolled on the symmetric 2×2 covariance:
+ *  ```
+ *  P⁻ = P + q·I,   Y = (P⁻)⁻¹,   P = (Y + G)⁻¹,   x = P · (Y·x + Hᵀ R⁻¹ · ΔOD)
+ *  ```
+ *  Two divisions and about 40 multiply-adds per sample, independent of the number of
+ *  wavelengths except for Hᵀ R⁻¹ · ΔOD. The estimate starts at 0 with the covariance of
+ *  one inverted sample, G⁻¹, when the baseline is latched. q_rate sets the trade-off:
+ *  the steady-state gain, and with it the noise reduction and the lag, follows from
+ *  q / (H⁻¹ R H⁻ᵀ) (see Tools/nirs_kalman.py).
+ *
+ * ### Tissue Saturation Index
+ *  ΔHb needs no absolute calibration but says nothing about the absolute oxygenation.
+ *  With detectors at several source–detector distances ρ, spatially resolved
+ *  spectroscopy (SRS) gets it from the slope of the attenuation A = −log10(I) over ρ,
+ *  where the unknown source intensity and coupling cancel:
+ *  ```
+ *  k·µa(λ) = ( ln10 · ∂A/∂ρ(λ) − 2/ρ̄ )² / ( 3 · (1 − h·λ) )
+ *  [k·HbO2; k·HHb] = ε⁻¹ · [k·µa(660); k·µa(880)]
+ *  TSI = k·HbO2 / (k·HbO2 + k·HHb)   (%)
+ *  ```
+ *  (diffusion approximation for a semi-infinite medium, µs' ∝ 1 − h·λ with
+ *  h = NIRS_SRS_SCATTER_SLOPE, ρ̄ the mean distance). The unknown scale k cancels in the
+ *  ratio. NIRS_TsiAdd() folds one (ρ, mean current) point per detector into the sums
+ *  of a least-squares line per wavelength, so the fit takes constant memory whatever
+ *  the number of detectors; NIRS_TsiSolve() turns the slopes into the TSI. The
+ *  detectors must see the same source intensity and have equal gains: any per-detector
+ *  offset in A shows up directly as a slope error.
+ *
+ * ### Constants
+ *  | Symbol | Value | Notes |
+ *  |--------|-------|-------|
+ *  | ε_HbO2(660), ε_HHb(660) | 319.6, 3226.56 cm⁻¹/M | Prahl tabulation |
+ *  | ε_HbO2(880), ε_HHb(880) | 1154.0, 726.44 cm⁻¹/M | Prahl tabulation |
+ *  | d | NIRS_SD_DISTANCE_CM | Source–detector distance |
+ *  | DPF | NIRS_DPF | Differential pathlength factor (skeletal muscle) |
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-09
+ * @version 1.0
+ * @note The baseline intensity I0 is latched from the first sample of each sensor.
+ */
+
+#ifndef NIRS_H_
+#define NIRS_H_
+
+#include <stdint.h>
+#include "arm_math_types.h"
+#include "MAX30101.h"
+
+#define NIRS_MAX_SENSORS        8       /**< One baseline per PCA9548 channel */
+#define NIRS_WAVELENGTHS        2       /**< Wavelength slots in use: Red, IR (NIRS Lite mode) */
+#define NIRS_SD_DISTANCE_CM     0.3f    /**< Source–detector distance of the MAX30101 package (cm) */
+#define NIRS_DPF                4.0f    /**< Differential pathlength factor for skeletal muscle */
+
+#define NIRS_RED_NM             660.0f  /**< Red LED wavelength (nm) */
+#define NIRS_IR_NM              880.0f  /**< IR LED wavelength (nm) */
+#define NIRS_SRS_SCATTER_SLOPE  6.3e-4f /**< h: µs' ∝ 1 − h·λ (nm⁻¹, Suzuki et al. 1999) */
+
+#define NIRS_EPS_HBO2_RED       319.6f  /**< ε HbO2 at 660 nm (cm⁻¹/M) */
+#define NIRS_EPS_HHB_RED        3226.56f/**< ε HHb at 660 nm (cm⁻¹/M) */
+#define NIRS_EPS_HBO2_IR        1154.0f /**< ε HbO2 at 880 nm (cm⁻¹/M) */
+#define NIRS_EPS_HHB_IR         726.44f /**< ε HHb at 880 nm (cm⁻¹/M) */
+
+/**
+ * @struct NIRS_HbSample
+ * @brief Hemoglobin concentration changes relative to the baseline
+ */
+typedef struct {
+    float32_t hbo2;      /**< ΔHbO2 (µM) */
+    float32_t hhb;       /**< ΔHHb (µM) */
+} NIRS_HbSample;
+
+/**
+ * @struct NIRS_KalmanModel
+ * @brief Constant matrices of the Kalman estimator (NIRS_KalmanDesign())
+ */
+typedef struct {
+    float32_t q;                            /**< Random-walk variance per sample (µM²) */
+    float32_t g[3];                         /**< Hᵀ R⁻¹ H (µM⁻²): [0][0], [0][1], [1][1] */
+    float32_t p0[3];                        /**< G⁻¹, covariance of one inverted sample (µM²) */
+    float32_t h_r[2][NIRS_WAVELENGTHS];     /**< Hᵀ R⁻¹ (µM⁻¹ per unit OD) */
+} NIRS_KalmanModel;
+
+/**
+ * @struct NIRS_KalmanState
+ * @brief Estimate and covariance of one sensor
+ */
+typedef struct {
+    float32_t x[2];             /**< ΔHbO2, ΔHHb (µM) */
+    float32_t p[3];             /**< Covariance (µM²): [0][0], [0][1], [1][1] */
+} NIRS_KalmanState;
+
+/**
+ * @struct NIRS_TsiFit
+ * @brief Running sums of the attenuation-over-distance regression (NIRS_TsiAdd())
+ * @details Sums are taken relative to the first point added, which keeps the float32
+ *          cancellation in the slope small.
+ */
+typedef struct {
+    uint8_t n;                              /**< Points added */
+    float32_t x0;                           /**< Distance of the first point (mm) */
+    float32_t y0[NIRS_WAVELENGTHS];         /**< log10 I of the first point */
+    float32_t sx;                           /**< Σ (ρ − x0) */
+    float32_t sxx;                          /**< Σ (ρ − x0)² */
+    float32_t sy[NIRS_WAVELENGTHS];         /**< Σ (log10 I − y0) */
+    float32_t sxy[NIRS_WAVELENGTHS];        /**< Σ (ρ − x0)·(log10 I − y0) */
+} NIRS_TsiFit;
+
+/**
+ * @struct NIRS_TsiResult
+ * @brief Spatially resolved estimate (NIRS_TsiSolve())
+ */
+typedef struct {
+    float32_t tsi;                          /**< Tissue saturation index (%) */
+    float32_t slope[NIRS_WAVELENGTHS];      /**< ∂A/∂ρ per wavelength slot (OD/mm) */
+    float32_t distance_mm;                  /**< Mean distance ρ̄ of the fit (mm) */
+} NIRS_TsiResult;
+
+/**
+ * @brief Precompute the inverse extinction matrix and clear all baselines
+ * @return void
+ */
+void NIRS_Init(void);
+
+/**
+ * @brief Forget the baseline of one sensor (next sample becomes I0)
+ * @param sensor - Sensor index (0–7)
+ * @return void
+ */
+void NIRS_ResetBaseline(uint8_t sensor);
+
+/**
+ * @brief Convert one Red/IR current sample to ΔHbO2/ΔHHb
+ * @param sensor - Sensor index (0–7)
+ * @param current - [in] Unfiltered photodiode currents (nA, DC included)
+ * @param hb - [out] Concentration changes (µM)
+ * @return 1 if hb is valid, 0 when the sample was latched as baseline or is out of range
+ */
+uint8_t NIRS_ComputeDeltaHb(uint8_t sensor, const MAX30101_CurrentSample *current, NIRS_HbSample *hb);
+
+/**
+ * @brief Optical density changes of one Red/IR current sample
+ * @param sensor - Sensor index (0–7)
+ * @param current - [in] Unfiltered photodiode currents (nA, DC included)
+ * @param od - [out] ΔOD per wavelength slot (Red, IR)
+ * @return 1 if od is valid, 0 when the sample was latched as baseline or is out of range
+ */
+uint8_t NIRS_ComputeDeltaOD(uint8_t sensor, const MAX30101_CurrentSample *current, float32_t od[NIRS_WAVELENGTHS]);
+
+/**
+ * @brief Precompute the constant matrices of the Kalman estimator
+ * @param model - [out] Model
+ * @param q_rate - Random-walk rate of ΔHbO2 and ΔHHb (µM/√s)
+ * @param od_noise - [in] ΔOD noise per sample of each wavelength slot (1 σ, > 0)
+ * @param period_s - Sample period (s)
+ * @return void
+ * @note Call after NIRS_Init() and again when the sample rate changes.
+ */
+void NIRS_KalmanDesign(NIRS_KalmanModel *model, float32_t q_rate, const float32_t od_noise[NIRS_WAVELENGTHS], float32_t period_s);
+
+/**
+ * @brief Start an estimate at the baseline (x = 0, P = G⁻¹)
+ * @param model - [in] Model
+ * @param state - [out] Estimator state
+ * @return void
+ */
+void NIRS_KalmanStart(const NIRS_KalmanModel *model, NIRS_KalmanState *state);
+
+/**
+ * @brief One predict/update step with the ΔOD of a new sample
+ * @param model - [in] Model
+ * @param state - [in,out] Estimator state
+ * @param od - [in] ΔOD per wavelength slot (NIRS_ComputeDeltaOD())
+ * @param hb - [out] Updated estimate (µM)
+ * @return void
+ */
+void NIRS_KalmanUpdate(const NIRS_KalmanModel *model, NIRS_KalmanState *state, const float32_t od[NIRS_WAVELENGTHS], NIRS_HbSample *hb);
+
+/**
+ * @brief Start an empty attenuation-over-distance fit
+ * @param fit - [out] Regression sums
+ * @return void
+ */
+void NIRS_TsiReset(NIRS_TsiFit *fit);
+
+/**
+ * @brief Add one detector to the fit
+ * @param fit - [in,out] Regression sums
+ * @param distance_mm - Source–detector distance of the detector (mm)
+ * @param current - [in] Its mean Red/IR current over the fit interval (nA)
+ * @return 1 if added, 0 if a current is not positive (point ignored)
+ * @timing 2 log10f() + ~10 multiply-adds
+ */
+uint8_t NIRS_TsiAdd(NIRS_TsiFit *fit, float32_t distance_mm, const MAX30101_CurrentSample *current);
+
+/**
+ * @brief Tissue saturation index from the attenuation slopes of the fit
+ * @param fit - [in] Regression sums
+ * @param result - [out] TSI, slopes and mean distance (slopes and distance are set
+ *                 whenever two distances differ, the TSI only when valid)
+ * @return 1 if the TSI is valid; 0 with fewer than two distinct distances, a slope
+ *         below the diffusion limit (2 / (ln10 · ρ̄)) or a negative concentration
+ */
+uint8_t NIRS_TsiSolve(const NIRS_TsiFit *fit, NIRS_TsiResult *result);
+
+#endif /* NIRS_H_ */
@@ -7,7 +7,7 @@
  *          a NACK on the second byte.
  * @author Julio Fajardo
  * @date 2026-05-11
- * @version 1.1
+ * @version 1.2
  */
 
 #include "PCA9548.h"
@@ -22,3 +22,8 @@ void PCA9548_SelectChannel(uint8_t channel) {
     /* Convert channel number (0-7) to bitmask and send as control byte */
     I2C1_WriteByte(PCA9548_ADDR, (uint8_t)(1U << channel));
 }
+
+void PCA9548_SelectMask(uint8_t mask) {
+    /* The control byte is the channel bitmask itself */
+    I2C1_WriteByte(PCA9548_ADDR, mask);
+}
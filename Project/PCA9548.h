@@ -20,9 +20,15 @@
  *  MAX30101_Read(...);
  *  ```
  *
+ * ### Broadcast
+ *  PCA9548_SelectMask() enables several channels at once. A write then reaches every
+ *  device behind them in the same bus cycle (identical devices acknowledge together on
+ *  the wired-AND bus), which starts several sensors at the same instant. Reads must not
+ *  be made in that state: the devices would drive SDA against each other.
+ *
  * @author Julio Fajardo
  * @date 2026-05-11
- * @version 1.1
+ * @version 1.2
  * @note Requires I2C1_Config() to be called before use.
  */
 
@@ -55,4 +61,12 @@ void PCA9548_Init(void);
  */
 void PCA9548_SelectChannel(uint8_t channel);
 
+/**
+ * @brief Activate any set of downstream channels at once (broadcast writes)
+ * @param mask - Bit per channel to enable (0x00 disables all)
+ * @return void
+ * @note Blocking. Only writes may follow while more than one channel is enabled.
+ */
+void PCA9548_SelectMask(uint8_t mask);
+
 #endif /* PCA9548_H_ */
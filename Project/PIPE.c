@@ -0,0 +1,155 @@
+/**
+ * @file PIPE.c
+ * @brief Statically configured block-processing pipeline implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-07-07
+ * @version 1.0
+ */
+
+#include "PIPE.h"
+#include "DWT.h"
+#include "DEADLINE.h"
+#include "MAX30101.h"
+#include <stdio.h>
+
+static const PIPE_Stage *pipe_stages;
+static uint8_t pipe_num_stages;
+static uint8_t pipe_num_sensors;
+static PIPE_ProfileHook pipe_hook;
+
+static uint8_t pipe_arena[PIPE_ARENA_BYTES] __attribute__((aligned(8))) PIPE_CCM;
+static void *pipe_state[PIPE_MAX_STAGES][STREAM_MAX_SENSORS]; /**< Per-stage, per-sensor state in the arena */
+static PIPE_StageStats pipe_stats[PIPE_MAX_STAGES];
+static PIPE_Block pipe_block;
+
+/**
+ * @brief Install a stage table and initialise every stage for every sensor
+ * @details State blocks are carved out of the arena in table order, sensor by sensor,
+ *          each rounded up to 8 bytes so float and pointer members stay aligned.
+ * @param stages - [in] Stage table
+ * @param num_stages - Entries in the table
+ * @param num_sensors - Sensors whose state is allocated
+ * @return 1 on success, 0 if the table is too long or the state does not fit
+ */
+uint8_t PIPE_Init(const PIPE_Stage *stages, uint8_t num_stages, uint8_t num_sensors) {
+    if (num_stages > PIPE_MAX_STAGES || num_sensors > STREAM_MAX_SENSORS) {
+        return 0;
+    }
+    uint32_t used = 0;
+    for (uint8_t s = 0; s < num_stages; s++) {
+        uint32_t bytes = (stages[s].state_bytes + 7U) & ~7U;
+        for (uint8_t k = 0; k < num_sensors; k++) {
+            if (bytes == 0) {
+                pipe_state[s][k] = NULL;
+                continue;
+            }
+            if (used + bytes > PIPE_ARENA_BYTES) {
+                return 0;
+            }
+            pipe_state[s][k] = &pipe_arena[used];
+            used += bytes;
+        }
+    }
+    for (uint32_t i = 0; i < used; i++) {
+        pipe_arena[i] = 0;
+    }
+    pipe_stages = stages;
+    pipe_num_stages = num_stages;
+    pipe_num_sensors = num_sensors;
+    for (uint8_t s = 0; s < num_stages; s++) {
+        pipe_stats[s] = (PIPE_StageStats){0};
+        if (stages[s].init) {
+            for (uint8_t k = 0; k < num_sensors; k++) {
+                stages[s].init(pipe_state[s][k], k, stages[s].config);
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Run one RAW frame through every stage
+ * @details Fills the block header from the frame, then calls each stage's process()
+ *          with the state of the frame's sensor and times it with DWT.
+ * @param frame - Frame from SCHED_PopFrame()
+ * @return void
+ */
+void PIPE_Run(POOL_Frame *frame) {
+    PIPE_Block *block = &pipe_block;
+    uint8_t k = frame->sensor;
+    if (k >= pipe_num_sensors) {
+        POOL_Free(frame);
+        return;
+    }
+    block->frame = frame;
+    block->sensor = k;
+    block->count = frame->count;
+    block->filtered_from = 0;
+    block->first_index = frame->first_index;
+    block->first_time = frame->first_time;
+    block->period_us = MAX30101_GetSamplePeriodUs();
+    block->hb_valid = 0;
+
+    for (uint8_t s = 0; s < pipe_num_stages; s++) {
+        const PIPE_Stage *stage = &pipe_stages[s];
+        DEADLINE_SetStage(DEADLINE_BATCH, DEADLINE_STAGE_PIPE + s);
+        uint32_t t0 = DWT_GetCycles();
+        stage->process(pipe_state[s][k], block, stage->config);
+        uint32_t cycles = DWT_GetCycles() - t0;
+
+        PIPE_StageStats *st = &pipe_stats[s];
+        st->blocks++;
+        st->samples += block->count;
+        st->cycles += cycles;
+        if (cycles > st->max_cycles) st->max_cycles = cycles;
+        if (stage->budget_cycles && cycles > (uint32_t)stage->budget_cycles * block->count) {
+            st->over_budget++;
+        }
+        if (pipe_hook) {
+            pipe_hook(s, cycles, block->count);
+        }
+    }
+    if (block->frame) {
+        POOL_Free(block->frame);
+        block->frame = NULL;
+    }
+}
+
+/**
+ * @brief Install a profiling hook (NULL to remove)
+ * @param hook - Function called after every stage call
+ * @return void
+ */
+void PIPE_SetProfileHook(PIPE_ProfileHook hook) {
+    pipe_hook = hook;
+}
+
+/**
+ * @brief Number of stages installed by PIPE_Init()
+ * @return Stage count
+ */
+uint8_t PIPE_GetNumStages(void) {
+    return pipe_num_stages;
+}
+
+/**
+ * @brief Format the profiling totals of one stage as a report line
+ * @details Format: `#PIPE,<stage>,<name>,<blocks>,<samples>,<cycles_per_sample>,
+ *          <max_block_cycles>,<budget_per_sample>,<over_budget>\r\n`
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param stage - Stage position in the table
+ * @return Number of characters written (excluding terminator)
+ */
+int PIPE_FormatReport(char *buffer, uint32_t size, uint8_t stage) {
+    const PIPE_StageStats *st = &pipe_stats[stage];
+    return snprintf(buffer, size, "#PIPE,%u,%s,%lu,%lu,%lu,%lu,%u,%lu\r\n",
+                    stage,
+                    pipe_stages[stage].name,
+                    (unsigned long)st->blocks,
+                    (unsigned long)st->samples,
+                    (unsigned long)(st->samples ? st->cycles / st->samples : 0U),
+                    (unsigned long)st->max_cycles,
+                    (unsigned)pipe_stages[stage].budget_cycles,
+                    (unsigned long)st->over_budget);
+}
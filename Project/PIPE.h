@@ -0,0 +1,155 @@
+/**
+ * @file PIPE.h
+ * @brief Statically configured block-processing pipeline for the main loop
+ * @details Every RAW frame taken from the scheduler runs through a table of stages
+ *          fixed at build time. A stage sees the whole frame as one block of consecutive
+ *          samples of one sensor, so per-call overhead is paid once per block:
+ *
+ *  ```
+ *  SCHED_PopFrame ─▶ acquire ─▶ condition ─▶ feature ─▶ encode ─▶ transmit
+ *                    (unpack)   (high-pass)  (ΔHb)     (frames)   (RAW out / free)
+ *  ```
+ *
+ * ### Stage Descriptor
+ *  - `init(state, sensor, config)`: called once per sensor by PIPE_Init()
+ *  - `process(state, block, config)`: called once per block with the state of the
+ *    block's sensor
+ *  - `state_bytes`: per-sensor state, carved out of one static arena (PIPE_ARENA_BYTES)
+ *    by PIPE_Init(); no heap. The arena lives in the 4 KB CCM SRAM (PIPE_CCM), which
+ *    only the CPU reaches: stage state must not be a DMA source or target
+ *  - `budget_cycles`: allowed CPU cycles per sample; blocks above count × budget are
+ *    counted as over budget
+ *
+ * ### Configuration
+ *  The table is an ordinary const array (see main.c); adding, removing or reordering
+ *  stages does not touch the acquisition ISR or the scheduler. Stages communicate
+ *  only through PIPE_Block.
+ *
+ * ### Profiling
+ *  Each stage call is timed with the DWT cycle counter. The totals are reported as
+ *  `#PIPE,<stage>,<name>,<blocks>,<samples>,<cycles_per_sample>,<max_block_cycles>,
+ *  <budget_per_sample>,<over_budget>\r\n`; an optional hook (PIPE_SetProfileHook)
+ *  sees every measurement as it is taken.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-07-07
+ * @version 1.0
+ * @note Requires DWT_Init() before PIPE_Init().
+ */
+
+#ifndef PIPE_H_
+#define PIPE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "MAX30101.h"
+#include "NIRS.h"
+#include "POOL.h"
+#include "STREAM.h"
+
+#define PIPE_MAX_STAGES     10      /**< Stages per pipeline */
+#define PIPE_ARENA_BYTES    3072    /**< Per-sensor stage state, all stages and sensors (8 × biquad + summary + deadband + 7-sample Hampel) */
+#define PIPE_CCM            __attribute__((section(".bss.ccm"))) /**< Zero-initialised variable in CCM SRAM (RW_RAM1, CPU only) */
+#define PIPE_BLOCK_SAMPLES  STREAM_RAW_CAPACITY /**< Largest block (samples of one RAW frame) */
+
+/**
+ * @struct PIPE_Block
+ * @brief Samples of one RAW frame as they move through the stages
+ */
+typedef struct {
+    POOL_Frame *frame;          /**< Source RAW frame (owned by the pipeline until a stage releases it) */
+    uint8_t sensor;             /**< Originating sensor */
+    uint8_t count;              /**< Samples in the block */
+    uint8_t filtered_from;      /**< First sample whose filtered value is valid */
+    uint32_t first_index;       /**< Sample index of sample 0 */
+    uint32_t first_time;        /**< Acquisition time of sample 0 (TIM2 µs) */
+    uint32_t period_us;         /**< Time between samples (µs) */
+    uint32_t hb_valid;          /**< Bit i set when hb[i] is valid */
+    MAX30101_CurrentSample current[PIPE_BLOCK_SAMPLES];  /**< Unfiltered currents (nA) */
+    MAX30101_CurrentSample filtered[PIPE_BLOCK_SAMPLES]; /**< DC-removed currents (nA) */
+    NIRS_HbSample hb[PIPE_BLOCK_SAMPLES];                /**< ΔHbO2/ΔHHb (µM) */
+} PIPE_Block;
+
+/**
+ * @struct PIPE_Stage
+ * @brief Stage descriptor (one row of the pipeline table)
+ */
+typedef struct {
+    const char *name;                                   /**< Short name for reports */
+    void (*init)(void *state, uint8_t sensor, const void *config);       /**< Optional per-sensor init */
+    void (*process)(void *state, PIPE_Block *block, const void *config); /**< Block processing */
+    const void *config;                                 /**< Stage parameters (may be NULL) */
+    uint16_t state_bytes;                               /**< Per-sensor state size (0 = stateless) */
+    uint16_t budget_cycles;                             /**< CPU cycles allowed per sample */
+} PIPE_Stage;
+
+/**
+ * @struct PIPE_StageStats
+ * @brief Profiling totals of one stage
+ */
+typedef struct {
+    uint32_t blocks;            /**< Blocks processed */
+    uint32_t samples;           /**< Samples processed */
+    uint64_t cycles;            /**< CPU cycles, all blocks */
+    uint32_t max_cycles;        /**< Longest single block (cycles) */
+    uint32_t over_budget;       /**< Blocks above count × budget_cycles */
+} PIPE_StageStats;
+
+/**
+ * @brief Profiling hook, called after every stage call
+ * @param stage - Stage position in the table
+ * @param cycles - CPU cycles of the call
+ * @param samples - Samples in the block
+ */
+typedef void (*PIPE_ProfileHook)(uint8_t stage, uint32_t cycles, uint8_t samples);
+
+/**
+ * @brief Install a stage table and initialise every stage for every sensor
+ * @param stages - [in] Stage table (must stay valid; usually a static const array)
+ * @param num_stages - Entries in the table (1–PIPE_MAX_STAGES)
+ * @param num_sensors - Sensors whose state is allocated (1–8)
+ * @return 1 on success, 0 if the table is too long or the state does not fit the arena
+ */
+uint8_t PIPE_Init(const PIPE_Stage *stages, uint8_t num_stages, uint8_t num_sensors);
+
+/**
+ * @brief Run one RAW frame through every stage
+ * @details Ownership of the frame passes to the pipeline; the transmit stage releases
+ *          it (STREAM_SendRaw() or POOL_Free()). If no stage did, it is freed here.
+ * @param frame - Frame from SCHED_PopFrame()
+ * @return void
+ */
+void PIPE_Run(POOL_Frame *frame);
+
+/**
+ * @brief Mark the block's frame as released by a stage
+ * @param block - [in,out] Block whose frame has been handed on or freed
+ * @return void
+ */
+static inline void PIPE_ReleaseFrame(PIPE_Block *block) {
+    block->frame = NULL;
+}
+
+/**
+ * @brief Install a profiling hook (NULL to remove)
+ * @param hook - Function called after every stage call
+ * @return void
+ */
+void PIPE_SetProfileHook(PIPE_ProfileHook hook);
+
+/**
+ * @brief Number of stages installed by PIPE_Init()
+ * @return Stage count
+ */
+uint8_t PIPE_GetNumStages(void);
+
+/**
+ * @brief Format the profiling totals of one stage as a report line
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param stage - Stage position in the table
+ * @return Number of characters written (excluding terminator)
+ */
+int PIPE_FormatReport(char *buffer, uint32_t size, uint8_t stage);
+
+#endif /* PIPE_H_ */
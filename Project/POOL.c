@@ -0,0 +1,98 @@
+/**
+ * @file POOL.c
+ * @brief Fixed-block frame pool implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-30
+ * @version 1.0
+ */
+
+#include "POOL.h"
+#include "stm32f303x8.h"
+#include <stdio.h>
+
+static POOL_Frame pool_arena[POOL_BLOCKS];
+static volatile uint32_t pool_free_mask;    /**< Bit (31 − i) set = block i free */
+static volatile uint32_t pool_in_use;
+static volatile uint32_t pool_high_water;
+static volatile uint32_t pool_failures;
+
+/**
+ * @brief Atomically add delta to a counter and return the new value
+ */
+static inline uint32_t POOL_AtomicAdd(volatile uint32_t *value, int32_t delta) {
+    uint32_t v;
+    do {
+        v = __LDREXW(value) + (uint32_t)delta;
+    } while (__STREXW(v, value));
+    return v;
+}
+
+/**
+ * @brief Mark every block free and clear the statistics
+ * @return void
+ */
+void POOL_Init(void) {
+    pool_free_mask = (POOL_BLOCKS == 32) ? 0xFFFFFFFFU : ~(0xFFFFFFFFU >> POOL_BLOCKS);
+    pool_in_use = 0;
+    pool_high_water = 0;
+    pool_failures = 0;
+}
+
+/**
+ * @brief Take a free frame
+ * @details CLZ of the free mask is the lowest-numbered free block; the exclusive store
+ *          only succeeds if no other context touched the mask in between.
+ * @return Frame, or NULL if the pool is exhausted
+ */
+POOL_Frame *POOL_Alloc(void) {
+    uint32_t mask, block;
+    do {
+        mask = __LDREXW(&pool_free_mask);
+        if (mask == 0) {
+            __CLREX();
+            POOL_AtomicAdd(&pool_failures, 1);
+            return NULL;
+        }
+        block = __CLZ(mask);
+    } while (__STREXW(mask & ~(0x80000000U >> block), &pool_free_mask));
+
+    uint32_t in_use = POOL_AtomicAdd(&pool_in_use, 1);
+    uint32_t high;
+    do {
+        high = __LDREXW(&pool_high_water);
+        if (in_use <= high) {
+            __CLREX();
+            break;
+        }
+    } while (__STREXW(in_use, &pool_high_water));
+    return &pool_arena[block];
+}
+
+/**
+ * @brief Return a frame to the pool
+ * @param frame - Frame obtained from POOL_Alloc()
+ * @return void
+ */
+void POOL_Free(POOL_Frame *frame) {
+    uint32_t block = (uint32_t)(frame - pool_arena);
+    uint32_t mask;
+    do {
+        mask = __LDREXW(&pool_free_mask);
+    } while (__STREXW(mask | (0x80000000U >> block), &pool_free_mask));
+    POOL_AtomicAdd(&pool_in_use, -1);
+}
+
+/**
+ * @brief Format the pool occupancy as a report line
+ * @details Format: `#POOL,<blocks>,<in_use>,<high_water>,<alloc_failures>\r\n`
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int POOL_FormatReport(char *buffer, uint32_t size) {
+    return snprintf(buffer, size, "#POOL,%u,%lu,%lu,%lu\r\n",
+                    (unsigned)POOL_BLOCKS,
+                    (unsigned long)pool_in_use,
+                    (unsigned long)pool_high_water,
+                    (unsigned long)pool_failures);
+}
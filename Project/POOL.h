@@ -0,0 +1,76 @@
+/**
+ * @file POOL.h
+ * @brief Fixed-block frame pool for zero-copy handoff between ISR, main loop and DMA
+ * @details POOL_BLOCKS frames of POOL_FRAME_BYTES live in one static arena. A frame is
+ *          allocated once, filled where it lies and passed on by pointer:
+ *
+ *  ```
+ *  SysTick ISR          main loop                      DMA1 Ch7 ISR
+ *  POOL_Alloc ─▶ I2C burst into payload ─▶ filter/encode from it ─▶ header + CRC ─▶ UART DMA ─▶ POOL_Free
+ *  ```
+ *
+ * ### Allocator
+ *  - Free blocks are the set bits of one 32-bit mask
+ *  - Alloc: CLZ picks a free bit, LDREX/STREX clears it; free: LDREX/STREX sets it
+ *  - O(1), lock-free and safe from any context (a preempted exclusive store fails and
+ *    retries), no ABA problem because there are no links to corrupt
+ *
+ * ### Frame Layout
+ *  `data` holds the complete wire frame (STREAM.h): header, payload, CRC. Producers
+ *  write the payload at STREAM_HEADER_BYTES; STREAM fills in header and CRC in place.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-30
+ * @version 1.0
+ * @note Report: `#POOL,<blocks>,<in_use>,<high_water>,<alloc_failures>\r\n`
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdint.h>
+
+#define POOL_BLOCKS         24      /**< Frames in the arena (≤ 32, one mask bit each) */
+#define POOL_FRAME_BYTES    128     /**< Wire bytes per frame (header + payload + CRC) */
+
+/**
+ * @struct POOL_Frame
+ * @brief One pool block: routing metadata plus the wire frame
+ */
+typedef struct {
+    uint32_t first_index;           /**< Sample index of the first sample (RAW) */
+    uint32_t first_time;            /**< Acquisition time of the first sample (TIM2 µs, RAW) */
+    uint16_t length;                /**< Wire bytes to transmit (set by STREAM) */
+    uint8_t sensor;                 /**< Originating sensor (RAW) */
+    uint8_t count;                  /**< Samples in the payload (RAW) */
+    uint8_t data[POOL_FRAME_BYTES]; /**< Wire frame */
+} POOL_Frame;
+
+/**
+ * @brief Mark every block free and clear the statistics
+ * @return void
+ */
+void POOL_Init(void);
+
+/**
+ * @brief Take a free frame (any context)
+ * @return Frame, or NULL if the pool is exhausted
+ */
+POOL_Frame *POOL_Alloc(void);
+
+/**
+ * @brief Return a frame to the pool (any context)
+ * @param frame - Frame obtained from POOL_Alloc()
+ * @return void
+ */
+void POOL_Free(POOL_Frame *frame);
+
+/**
+ * @brief Format the pool occupancy as a report line
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int POOL_FormatReport(char *buffer, uint32_t size);
+
+#endif /* POOL_H_ */
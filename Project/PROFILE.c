@@ -0,0 +1,236 @@
+/**
+ * @file PROFILE.c
+ * @brief Operating profiles and end-to-end latency statistics implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-07-28
+ * @version 1.0
+ */
+
+#include "PROFILE.h"
+#include "DEADLINE.h"
+#include "MAX30101.h"
+#include "SCHED.h"
+#include "STREAM.h"
+#include "stm32f303x8.h"
+#include <stdio.h>
+
+#define PROFILE_HIST_SUB    (1U << PROFILE_HIST_SUB_BITS)
+
+/**
+ * @struct PROFILE_Latency
+ * @brief Latency histogram of one path (written by the DMA1 Ch7 ISR)
+ */
+typedef struct {
+    uint16_t bins[PROFILE_HIST_BINS]; /**< Samples per bin (saturating) */
+    uint32_t count;                   /**< Samples since the last report */
+    uint32_t min_us;
+    uint32_t max_us;
+} PROFILE_Latency;
+
+static const PROFILE_Config profile_table[PROFILE_COUNT] = {
+    { "standard",   0,                  SCHED_HANDOFF_SAMPLES, STREAM_FILTERED_DECIMATION, STREAM_HB_DECIMATION, 0 },
+    { "latency",    1,                  1,                     1,                          1,                    1 },
+    { "throughput", PROFILE_DEEP_BATCH, STREAM_RAW_CAPACITY,   PROFILE_SUMMARY_DECIMATION, PROFILE_SUMMARY_DECIMATION, 0 },
+};
+
+static uint32_t profile_default_period_us;
+static uint8_t profile_int_wired;
+static uint8_t profile_active;
+static uint8_t profile_data_ready;          /**< Data-ready mode in effect */
+static PROFILE_Latency profile_latency[PROFILE_PATHS];
+
+/**
+ * @brief Histogram bin of a latency
+ * @details Values below 2·PROFILE_HIST_SUB µs have one bin each; above, every octave
+ *          [2^e, 2^(e+1)) is split into PROFILE_HIST_SUB equal bins.
+ */
+static inline uint32_t PROFILE_Bin(uint32_t us) {
+    if (us < PROFILE_HIST_SUB) {
+        return us;
+    }
+    uint32_t e = 31U - __CLZ(us);
+    uint32_t bin = ((e - PROFILE_HIST_SUB_BITS + 1U) << PROFILE_HIST_SUB_BITS)
+                 + ((us >> (e - PROFILE_HIST_SUB_BITS)) & (PROFILE_HIST_SUB - 1U));
+    return (bin < PROFILE_HIST_BINS) ? bin : PROFILE_HIST_BINS - 1U;
+}
+
+/**
+ * @brief Largest latency that falls into a bin (µs)
+ */
+static uint32_t PROFILE_BinUpper(uint32_t bin) {
+    if (bin < PROFILE_HIST_SUB) {
+        return bin;
+    }
+    uint32_t shift = (bin >> PROFILE_HIST_SUB_BITS) - 1U;
+    uint32_t lower = (PROFILE_HIST_SUB + (bin & (PROFILE_HIST_SUB - 1U))) << shift;
+    return lower + (1U << shift) - 1U;
+}
+
+static void PROFILE_Add(PROFILE_Latency *lat, uint32_t us) {
+    uint16_t *bin = &lat->bins[PROFILE_Bin(us)];
+    if (*bin < UINT16_MAX) {
+        (*bin)++;
+    }
+    if (us < lat->min_us) lat->min_us = us;
+    if (us > lat->max_us) lat->max_us = us;
+    lat->count++;
+}
+
+static void PROFILE_Clear(PROFILE_Latency *lat) {
+    *lat = (PROFILE_Latency){ .min_us = UINT32_MAX };
+}
+
+/**
+ * @brief Transfer-complete hook (DMA1 Ch7 ISR): latency of every sample in the frame
+ * @details Sample times estimated after `now` (clock phase of the estimate) count as 0.
+ */
+static void PROFILE_TxDone(const POOL_Frame *frame, uint32_t now) {
+    const uint8_t *f = frame->data;
+    if (f[2] == STREAM_RAW) {
+        uint32_t period = MAX30101_GetSamplePeriodUs();
+        uint32_t t = frame->first_time;
+        for (uint8_t i = 0; i < frame->count; i++, t += period) {
+            int32_t us = (int32_t)(now - t);
+            PROFILE_Add(&profile_latency[PROFILE_PATH_RAW], (us > 0) ? (uint32_t)us : 0U);
+        }
+    } else if (f[2] == STREAM_FILTERED) {
+        uint32_t t = (uint32_t)f[6] | ((uint32_t)f[7] << 8) | ((uint32_t)f[8] << 16) | ((uint32_t)f[9] << 24);
+        int32_t us = (int32_t)(now - t);
+        PROFILE_Add(&profile_latency[PROFILE_PATH_FILTERED], (us > 0) ? (uint32_t)us : 0U);
+    }
+}
+
+/**
+ * @brief Record the build defaults and install the transmit-completion hook
+ * @param default_period_us - Acquisition period of the standard profile
+ * @param int_wired - 1 if the INT pin of sensor 0 is wired to PA1
+ * @return void
+ */
+void PROFILE_Init(uint32_t default_period_us, uint8_t int_wired) {
+    profile_default_period_us = default_period_us;
+    profile_int_wired = int_wired;
+    profile_active = PROFILE_STANDARD;
+    profile_data_ready = 0;
+    for (uint8_t p = 0; p < PROFILE_PATHS; p++) {
+        PROFILE_Clear(&profile_latency[p]);
+    }
+    STREAM_SetTxHook(PROFILE_TxDone);
+}
+
+/**
+ * @brief Configure scheduler, deadlines and streams for a profile
+ * @details Drain period = drain_samples × sample period (the standard profile keeps
+ *          the SCHED_Init() period). Data-ready mode is used only when the profile asks
+ *          for it, the INT pin is wired and a single sensor is configured. Deadlines
+ *          follow the new slot length and period (the floor of the period with
+ *          adaptive polling, where the drain period is only the start value); the
+ *          latency statistics restart.
+ * @param id - Profile ID
+ * @return 1 if applied, 0 if the ID is unknown
+ */
+uint8_t PROFILE_Apply(uint8_t id) {
+    if (id >= PROFILE_COUNT) {
+        return 0;
+    }
+    const PROFILE_Config *cfg = &profile_table[id];
+    uint32_t period_us = cfg->drain_samples ? cfg->drain_samples * MAX30101_GetSamplePeriodUs() : profile_default_period_us;
+
+    if (profile_int_wired) {
+        profile_data_ready = SCHED_EnableDataReady(cfg->data_ready) && cfg->data_ready;
+    }
+    SCHED_Configure(period_us, cfg->handoff_samples);
+    period_us = SCHED_GetShortestPeriodUs(); // Adaptive polling may shorten the period down to its floor
+    DEADLINE_SetDeadlines(period_us / SCHED_GetNumSensors(), period_us);
+    STREAM_SetDecimation(cfg->filtered_decimation, cfg->hb_decimation);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t p = 0; p < PROFILE_PATHS; p++) {
+        PROFILE_Clear(&profile_latency[p]);
+    }
+    __set_PRIMASK(primask);
+    profile_active = id;
+    return 1;
+}
+
+/**
+ * @brief Switch profile at run time
+ * @param id - Profile ID
+ * @return 1 if applied, 0 if the ID is unknown
+ */
+uint8_t PROFILE_Select(uint8_t id) {
+    if (id >= PROFILE_COUNT) {
+        return 0;
+    }
+    SCHED_Stop();
+    PROFILE_Apply(id);
+    SCHED_Resume();
+    return 1;
+}
+
+/**
+ * @brief Active profile
+ * @return Profile ID
+ */
+uint8_t PROFILE_GetActive(void) {
+    return profile_active;
+}
+
+/**
+ * @brief Format the active profile as a report line
+ * @details Format: `#PROFILE,<id>,<name>,<period_us>,<handoff>,<filtered_decimation>,
+ *          <hb_decimation>,<data_ready>\r\n`; period_us is the applied drain period.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int PROFILE_FormatInfo(char *buffer, uint32_t size) {
+    const PROFILE_Config *cfg = &profile_table[profile_active];
+    return snprintf(buffer, size, "#PROFILE,%u,%s,%lu,%u,%u,%u,%u\r\n",
+                    profile_active, cfg->name,
+                    (unsigned long)SCHED_GetPeriodUs(),
+                    cfg->handoff_samples, cfg->filtered_decimation, cfg->hb_decimation,
+                    profile_data_ready);
+}
+
+/**
+ * @brief Format and restart the latency statistics of one path
+ * @details Format: `#LATENCY,<profile>,<stream>,<samples>,<min_us>,<p50_us>,<p90_us>,
+ *          <p99_us>,<max_us>\r\n`. The p-th percentile is the upper edge of the first
+ *          bin whose cumulative count reaches ⌈p · samples / 100⌉ (capped at max_us).
+ *          The DMA1 Ch7 interrupt, the only writer, is held off while the histogram is
+ *          read and cleared.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param path - PROFILE_PATH_RAW or PROFILE_PATH_FILTERED
+ * @return Number of characters written (excluding terminator)
+ */
+int PROFILE_FormatReport(char *buffer, uint32_t size, uint8_t path) {
+    static const uint8_t pct[3] = { 50, 90, 99 };
+    PROFILE_Latency *lat = &profile_latency[path];
+    uint32_t p[3] = { 0, 0, 0 };
+
+    NVIC_DisableIRQ(DMA1_Channel7_IRQn);
+    uint32_t count = lat->count;
+    uint32_t min_us = count ? lat->min_us : 0U;
+    uint32_t max_us = lat->max_us;
+    uint32_t cumulative = 0;
+    uint8_t next = 0;
+    for (uint32_t b = 0; b < PROFILE_HIST_BINS && next < 3 && count; b++) {
+        cumulative += lat->bins[b];
+        while (next < 3 && cumulative * 100U >= pct[next] * count) {
+            uint32_t upper = PROFILE_BinUpper(b);
+            p[next++] = (upper < max_us) ? upper : max_us;
+        }
+    }
+    PROFILE_Clear(lat);
+    NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+
+    return snprintf(buffer, size, "#LATENCY,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+                    profile_active,
+                    (path == PROFILE_PATH_RAW) ? (unsigned)STREAM_RAW : (unsigned)STREAM_FILTERED,
+                    (unsigned long)count,
+                    (unsigned long)min_us,
+                    (unsigned long)p[0], (unsigned long)p[1], (unsigned long)p[2],
+                    (unsigned long)max_us);
+}
@@ -0,0 +1,139 @@
+/**
+ * @file PROFILE.h
+ * @brief Named operating profiles (latency vs throughput) with end-to-end latency statistics
+ * @details A profile sets, in one step, how often each sensor is drained, how many
+ *          samples a RAW frame collects before it is handed to the main loop and how
+ *          far the FILTERED/HB streams are decimated:
+ *
+ *  | ID | Profile | Drain | RAW frame | FILTERED / HB | Slot trigger |
+ *  |----|---------|-------|-----------|---------------|--------------|
+ *  | 0 | standard | build rate (ACQ_PERIOD_HZ) | SCHED_HANDOFF_SAMPLES | STREAM defaults | SysTick |
+ *  | 1 | latency | every sample | 1 sample | every sample | PPG_RDY on PA1 if wired, else SysTick at the ODR |
+ *  | 2 | throughput | every PROFILE_DEEP_BATCH samples | STREAM_RAW_CAPACITY | PROFILE_SUMMARY_DECIMATION | SysTick |
+ *
+ *  - **latency**: the sample leaves as soon as the sensor has it. With the INT pin of a
+ *    single sensor wired to PA1 (SCHED_EnableDataReady), PPG_RDY starts the drain
+ *    within an interrupt latency of the sample (the MAX30101 almost-full threshold
+ *    cannot go below 17 samples, so the per-sample flag stands in for "FIFO
+ *    threshold 1"). Otherwise the sensors are polled once per sample period. Every
+ *    sample becomes its own RAW frame, which the pipeline hands to the UART DMA queue
+ *    straight away.
+ *  - **throughput**: few I2C transactions and frame headers per sample. Each drain
+ *    reads half the FIFO in one burst (a late slot still cannot overflow), frames carry
+ *    the full 18 samples and the summary streams leave link capacity for RAW. The
+ *    drain period is limited by the 24-bit SysTick (262 ms, i.e. 13 samples at 50 Hz).
+ *
+ * ### Latency Measurement
+ *  Every frame whose UART DMA transfer completes (STREAM_SetTxHook) is compared with
+ *  the acquisition time of the samples it carries:
+ *  - RAW: one value per sample, completion − (first_time + i × sample period)
+ *  - FILTERED: completion − time of the newest sample of the block
+ *
+ *  Values go into a log-linear histogram (8 bins per octave, ≤ 12.5 % bin width, up to
+ *  2.1 s); percentiles are reported as the upper edge of their bin. The sample time
+ *  is the scheduler's estimate: when polled, the newest sample of a drain is dated at
+ *  the drain, so the wait in the FIFO before it (0 … one sample period) is not
+ *  included. In data-ready mode the drain follows the sample, so nothing is left out.
+ *  DMA completion is when the last byte has moved to USART2, up to two character
+ *  times before it has left the pin.
+ *
+ * ### Reports
+ *  ```
+ *  #PROFILE,<id>,<name>,<period_us>,<handoff>,<filtered_decimation>,<hb_decimation>,<data_ready>
+ *  #LATENCY,<profile>,<stream>,<samples>,<min_us>,<p50_us>,<p90_us>,<p99_us>,<max_us>
+ *  ```
+ *  "#PROFILE" answers every selection; "#LATENCY" (stream 1 = RAW, 2 = FILTERED) covers
+ *  the interval since the previous report and restarts the histogram.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-07-28
+ * @version 1.0
+ * @note Requires SCHED_Init(), STREAM_Init() and DEADLINE_Init() before PROFILE_Init().
+ *       Latency statistics need the framed output (UART DMA).
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+#define PROFILE_STANDARD            0   /**< Build configuration */
+#define PROFILE_LATENCY             1   /**< Minimum sample-to-wire latency */
+#define PROFILE_THROUGHPUT          2   /**< Maximum sensors × ODR per bus, CPU and link */
+#define PROFILE_COUNT               3
+
+#define PROFILE_DEEP_BATCH          16  /**< Throughput: samples per drain (half the FIFO) */
+#define PROFILE_SUMMARY_DECIMATION  25  /**< Throughput: FILTERED/HB samples per frame (2 Hz at 50 Hz) */
+
+#define PROFILE_HIST_SUB_BITS       3   /**< Histogram: 2^3 bins per octave */
+#define PROFILE_HIST_BINS           152 /**< Histogram: exact below 16 µs; 2^21 µs and above land in the top bin */
+
+/** @name Latency paths (report stream column = STREAM_Id)
+ * @{ */
+#define PROFILE_PATH_RAW            0
+#define PROFILE_PATH_FILTERED       1
+#define PROFILE_PATHS               2
+/** @} */
+
+/**
+ * @struct PROFILE_Config
+ * @brief Parameters of one operating profile
+ */
+typedef struct {
+    const char *name;               /**< Report name */
+    uint8_t drain_samples;          /**< Samples per drain and sensor (0 = SCHED_Init() period) */
+    uint8_t handoff_samples;        /**< Samples per RAW frame before handoff */
+    uint8_t filtered_decimation;    /**< FILTERED samples per frame */
+    uint8_t hb_decimation;          /**< HB samples per frame */
+    uint8_t data_ready;             /**< 1 = drain on PPG_RDY when the INT pin is wired */
+} PROFILE_Config;
+
+/**
+ * @brief Record the build defaults and install the transmit-completion hook
+ * @param default_period_us - Acquisition period of the standard profile (SCHED_GetPeriodUs())
+ * @param int_wired - 1 if the INT pin of sensor 0 is wired to PA1
+ * @return void
+ */
+void PROFILE_Init(uint32_t default_period_us, uint8_t int_wired);
+
+/**
+ * @brief Configure scheduler, deadlines and streams for a profile (acquisition stopped)
+ * @param id - Profile ID (PROFILE_STANDARD … PROFILE_THROUGHPUT)
+ * @return 1 if applied, 0 if the ID is unknown
+ * @note Before SCHED_Start(); at run time use PROFILE_Select().
+ */
+uint8_t PROFILE_Apply(uint8_t id);
+
+/**
+ * @brief Switch profile at run time: stop acquisition, apply, resume
+ * @param id - Profile ID
+ * @return 1 if applied, 0 if the ID is unknown (nothing changed)
+ * @note Main-loop context. The FIFOs are emptied on resume; the samples missed meanwhile
+ *       appear as overflows and an index gap (SCHED_Resume()).
+ */
+uint8_t PROFILE_Select(uint8_t id);
+
+/**
+ * @brief Active profile
+ * @return Profile ID
+ */
+uint8_t PROFILE_GetActive(void);
+
+/**
+ * @brief Format the active profile as a report line ("#PROFILE,…")
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int PROFILE_FormatInfo(char *buffer, uint32_t size);
+
+/**
+ * @brief Format and restart the latency statistics of one path ("#LATENCY,…")
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param path - PROFILE_PATH_RAW or PROFILE_PATH_FILTERED
+ * @return Number of characters written (excluding terminator)
+ */
+int PROFILE_FormatReport(char *buffer, uint32_t size, uint8_t path);
+
+#endif /* PROFILE_H_ */
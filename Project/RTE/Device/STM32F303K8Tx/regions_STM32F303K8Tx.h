@@ -17,7 +17,8 @@
 #define __ROM0_BASE 0x08000000
 //   <o> Region size [bytes] <0x0-0xFFFFFFFF:8>
 //   <i> Defines size of memory region. Default: 0x00010000
-#define __ROM0_SIZE 0x00010000
+//   <i> The last two 2 KB pages (0x0800F000-0x0800FFFF) hold the persistent configuration (CONFIG.h)
+#define __ROM0_SIZE 0x0000F000
 // </h>
 
 // <h> __ROM1 (unused)
@@ -61,13 +62,14 @@
 #define __RAM0_SIZE 0x00003000
 // </h>
 
-// <h> __RAM1 (unused)
+// <h> __RAM1 (is rwx memory: CCM SRAM)
 //   <o> Base address <0x0-0xFFFFFFFF:8>
 //   <i> Defines base address of memory region.
-#define __RAM1_BASE 0x0
+//   <i> Core-coupled SRAM: CPU only (no DMA), holds the .bss.ccm sections (pipeline stage state, PIPE.h)
+#define __RAM1_BASE 0x10000000
 //   <o> Region size [bytes] <0x0-0xFFFFFFFF:8>
 //   <i> Defines size of memory region.
-#define __RAM1_SIZE 0x0
+#define __RAM1_SIZE 0x00001000
 // </h>
 
 // <h> __RAM2 (unused)
@@ -92,9 +94,11 @@
 
 // <h> Stack / Heap Configuration
 //   <o0> Stack Size (in Bytes) <0x0-0xFFFFFFFF:8>
+//   <i> Must equal Stack_Size in startup_stm32f303x8.s (its STACK area fills this region)
 //   <o1> Heap Size (in Bytes) <0x0-0xFFFFFFFF:8>
-#define __STACK_SIZE 0x00000200
-#define __HEAP_SIZE 0x00000C00
+//   <i> No heap: all buffers are static (frame pool, pipeline arena)
+#define __STACK_SIZE 0x00000400
+#define __HEAP_SIZE 0x00000000
 // </h>
 
 
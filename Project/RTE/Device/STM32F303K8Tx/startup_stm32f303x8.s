@@ -26,6 +26,8 @@
 
 ; Amount of memory (in bytes) allocated for Stack
 ; Tailor this value to your application needs
+; Keep Stack_Size = __STACK_SIZE and Heap_Size = __HEAP_SIZE (regions_STM32F303K8Tx.h):
+; the scatter file places the STACK area in that region instead of RW_RAM0
 ; <h> Stack Configuration
 ;   <o> Stack Size (in Bytes) <0x0-0xFFFFFFFF:8>
 ; </h>
@@ -41,7 +43,7 @@ __initial_sp
 ;   <o>  Heap Size (in Bytes) <0x0-0xFFFFFFFF:8>
 ; </h>
 
-Heap_Size       EQU     0x00000200
+Heap_Size       EQU     0x00000000
 
                 AREA    HEAP, NOINIT, READWRITE, ALIGN=3
 __heap_base
@@ -0,0 +1,1474 @@
+/**
+ * @file SCHED.c
+ * @brief Phase-staggered multi-sensor acquisition scheduler implementation
+ * @details One SysTick interrupt per slot; slot k drains the MAX30101 on PCA9548 channel k.
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-02
+ * @version 1.6
+ */
+
+#include "SCHED.h"
+#include "MAX30101.h"
+#include "PCA9548.h"
+#include "I2C.h"
+#include "DWT.h"
+#include "TIMER.h"
+#include "STREAM.h"
+#include "DEADLINE.h"
+#include "TRACE.h"
+#include "stm32f303x8.h"
+#include <stdint.h>
+#include <stdio.h>
+
+static uint8_t sched_num_sensors = 1;       /**< Sensors (slots) per period */
+static uint32_t sched_slot_cycles;          /**< SysTick reload: period / num_sensors in CPU cycles */
+static uint32_t sched_period_us;            /**< Acquisition period per sensor (µs) */
+static uint32_t sched_budget_ns;            /**< Bus budget per slot (ns) */
+static uint8_t sched_max_batch;             /**< Samples per slot that fit the bus budget */
+static uint8_t sched_handoff = SCHED_HANDOFF_SAMPLES; /**< Samples per RAW frame before handoff */
+static uint8_t sched_slot = 0;              /**< Slot that runs on the next SysTick */
+static uint32_t sched_periods = 0;          /**< Acquisition periods since the last report */
+static uint32_t sched_report_us;            /**< Report interval (SCHED_REPORT_PERIODS at the SCHED_Init() rate) */
+static uint32_t sched_report_periods = SCHED_REPORT_PERIODS;
+static uint8_t sched_data_ready;            /**< Slots triggered by the sensor INT line (SysTick = backstop) */
+static volatile uint8_t sched_report_due = 0;
+static uint8_t sched_resumed;               /**< Bit per sensor: next drain follows SCHED_Resume() */
+static uint8_t sched_first;                 /**< Bit per sensor: hand off the next frame at once (SCHED_HandoffFirst()) */
+
+static SCHED_SensorStats sched_stats[SCHED_MAX_SENSORS];
+static uint32_t sched_index[SCHED_MAX_SENSORS];          /**< Next sample index per sensor */
+static POOL_Frame *sched_open[SCHED_MAX_SENSORS];        /**< RAW frame being filled per sensor */
+
+/** Asynchronous slot state (SCHED_EnableDMA) */
+static struct {
+    uint8_t enabled;
+    volatile uint8_t busy;   /**< Chain in flight (set by SysTick, cleared by I2C1 ISR) */
+    uint8_t sensor;          /**< Sensor of the chain in flight */
+    uint8_t batch;           /**< Samples requested by the burst */
+    uint8_t lent;            /**< Slot lent by a parked sensor */
+    uint8_t status[3];       /**< WR_PTR/OVF/RD_PTR landing buffer */
+    uint32_t status_ns;      /**< Estimated bus time of the status read (0 = predicted slot) */
+    uint32_t status_start;   /**< DWT time the status read was started */
+    uint32_t cpu_cycles;     /**< CPU time of the chain so far */
+} sched_dma;
+
+/** Presence gating state (SCHED_EnablePresence); the masks are written in slot context only */
+static struct {
+    uint8_t enabled;
+    volatile uint8_t present;   /**< Bit per sensor being drained */
+    uint8_t parking;            /**< Bit per present sensor to park at its next slot */
+    uint8_t low;                /**< Bit per sensor whose IR is below min_counts since low_since */
+    uint8_t backlog;            /**< Bit per sensor whose last drain was cut by the bus budget */
+    uint8_t lend_next;          /**< First sensor considered for the next lent slot */
+    volatile uint8_t admitted;  /**< Bit per re-admitted sensor not yet taken by the main loop */
+    uint32_t min_counts;        /**< min_na in ADC counts */
+    uint32_t hold_us;
+    uint32_t poll_us;
+    uint32_t poll_periods;      /**< poll_us in acquisition periods (SCHED_Configure()) */
+    uint32_t wait[SCHED_MAX_SENSORS];       /**< Own slots of a parked sensor until its next poll */
+    uint32_t low_since[SCHED_MAX_SENSORS];  /**< TIM2 µs of the first low sample */
+    uint32_t drain_us[SCHED_MAX_SENSORS];   /**< TIM2 µs of the last drain */
+} sched_presence;
+
+/** Proximity transfers of one slot: park, or poll followed by re-admission */
+static struct {
+    MAX30101_RegWrite seq[MAX30101_PROX_WRITES];
+    uint8_t count;              /**< Writes in seq */
+    uint8_t step;               /**< Next write (asynchronous chain) */
+    uint8_t action;             /**< SCHED_CTL_* */
+    uint8_t status;             /**< INTR_STATUS1 landing buffer */
+} sched_ctl;
+
+#define SCHED_CTL_PARK      1   /**< Enter proximity mode */
+#define SCHED_CTL_POLL      2   /**< Read INTR_STATUS1 */
+#define SCHED_CTL_ADMIT     3   /**< PROX_INT seen: leave proximity mode */
+#define SCHED_CTL_IDLE      0xFFU /**< Parked, no poll due and no slot to lend */
+
+/** Predictive drain state (SCHED_EnablePrediction); per-sensor fields are slot context only */
+static struct {
+    uint8_t verify_every;       /**< Longest run of predicted slots (0 = prediction off) */
+    uint8_t valid;              /**< Bit per sensor whose fill model is seeded */
+    uint8_t learned;            /**< Bit per sensor whose rate has been measured */
+    uint32_t period_us;         /**< Sample period the rates were set for */
+    uint32_t rate[SCHED_MAX_SENSORS];        /**< Sample rate (samples per µs, Q32) */
+    uint32_t fill[SCHED_MAX_SENSORS];        /**< Lower bound of the unread samples at model_us (Q16) */
+    uint32_t width[SCHED_MAX_SENSORS];       /**< Upper − lower bound (Q16) */
+    uint32_t model_us[SCHED_MAX_SENSORS];    /**< TIM2 µs of the last model update */
+    uint32_t anchor_us[SCHED_MAX_SENSORS];   /**< TIM2 µs of the rate anchor */
+    uint32_t anchor_read[SCHED_MAX_SENSORS]; /**< Samples read since the anchor */
+    uint8_t anchor_fill[SCHED_MAX_SENSORS];  /**< Unread samples at the anchor */
+    uint8_t gap[SCHED_MAX_SENSORS];          /**< Predicted slots allowed between verifications */
+    uint8_t countdown[SCHED_MAX_SENSORS];    /**< Predicted slots left before the next verification */
+} sched_predict;
+
+/** Adaptive polling state (SCHED_EnableAdaptive); retuned in slot context */
+static struct {
+    uint8_t enabled;
+    uint8_t target;             /**< Fill to find at each drain (samples) */
+    uint8_t peak;               /**< Highest fill seen at a drain in the current period */
+    uint8_t overflowed;         /**< Overflow seen in the current period */
+    uint32_t floor_us;          /**< Shortest period */
+    uint32_t ceiling_us;        /**< Longest period (latency ceiling) */
+    uint32_t fill_q8;           /**< Smoothed peak fill (Q8) */
+    volatile uint32_t slot_us;  /**< TIM2 CH2 compare step */
+    uint32_t min_us;            /**< Shortest period since the last report */
+    uint32_t max_us;            /**< Longest period since the last report */
+    uint32_t drains;            /**< Drains of all sensors at the last report */
+    uint32_t samples;           /**< Samples of all sensors at the last report */
+    uint32_t overflows;         /**< Overflows of all sensors at the last report */
+} sched_adapt;
+
+/** Inter-sensor phase tracking (SCHED_SyncStart); slot context */
+static struct {
+    uint8_t enabled;
+    uint8_t valid;                              /**< Bit per sensor with a bracket */
+    uint8_t anchored;                           /**< Bit per sensor with a rate anchor */
+    uint32_t nominal_q16;                       /**< Nominal sample period (µs, Q16) */
+    uint32_t period_q16[SCHED_MAX_SENSORS];     /**< Learned sample period (µs, Q16) */
+    uint32_t ref_index[SCHED_MAX_SENSORS];      /**< Sample the bracket refers to (newest seen) */
+    uint32_t ref_us[SCHED_MAX_SENSORS];         /**< Earliest arrival time of that sample (TIM2 µs) */
+    uint32_t width_us[SCHED_MAX_SENSORS];       /**< Bracket width: latest arrival − earliest */
+    uint32_t anchor_index[SCHED_MAX_SENSORS];   /**< Rate anchor: sample index ... */
+    uint32_t anchor_us[SCHED_MAX_SENSORS];      /**< ... and its arrival (bracket midpoint) */
+    uint32_t slips[SCHED_MAX_SENSORS];          /**< Brackets restarted from a status read */
+} sched_phase;
+
+#define SCHED_PHASE_SLACK_SHIFT 12      /**< Phase bracket widens by advance >> 12 (244 ppm) for rate uncertainty */
+#define SCHED_PREDICT_READ      0xFFU   /**< SCHED_Predict(): read the FIFO status */
+#define SCHED_PREDICT_SPAN_US   (1UL << 30) /**< Rate anchor restarted after this long (~18 min, TIM2 wraps at 71 min) */
+
+#if SCHED_QUEUE_SIZE < POOL_BLOCKS
+#error "SCHED_QUEUE_SIZE must hold every pool frame"
+#endif
+
+/* Single-producer (ISR) / single-consumer (main) queue of completed frames */
+static POOL_Frame *sched_queue[SCHED_QUEUE_SIZE];
+static volatile uint16_t sched_head = 0;    /**< Written by ISR only */
+static volatile uint16_t sched_tail = 0;    /**< Written by main loop only */
+
+/**
+ * @brief Configure the slot table and derive the per-slot bus budget
+ * @details The slot length is 1 / (period_hz × num_sensors). The budget is
+ *          SCHED_BUS_BUDGET_PCT % of it; the fixed per-slot cost (channel select and
+ *          FIFO status read) is subtracted and the remainder is divided by the wire
+ *          time of one 6-byte sample to obtain the maximum burst size.
+ *
+ * @param num_sensors - Number of sensors on PCA9548 CH0..CH(num_sensors-1) (1–8)
+ * @param period_hz - Per-sensor acquisition rate (Hz)
+ * @return void
+ *
+ * @example
+ *   // 4 sensors at 50 Hz: 5 ms slots, 3 ms bus budget, up to 19 samples per slot
+ *   SCHED_Init(4, 50);
+ */
+void SCHED_Init(uint8_t num_sensors, uint32_t period_hz) {
+    if (num_sensors < 1) num_sensors = 1;
+    if (num_sensors > SCHED_MAX_SENSORS) num_sensors = SCHED_MAX_SENSORS;
+    sched_num_sensors = num_sensors;
+    sched_report_us = SCHED_REPORT_PERIODS * (1000000U / period_hz);
+    SCHED_Configure(1000000U / period_hz, SCHED_HANDOFF_SAMPLES);
+
+    for (uint8_t i = 0; i < SCHED_MAX_SENSORS; i++) {
+        sched_stats[i] = (SCHED_SensorStats){0};
+        sched_stats[i].interval_min_cycles = UINT32_MAX;
+        sched_index[i] = 0;
+        sched_open[i] = NULL;
+    }
+    sched_presence.present = (uint8_t)((1U << num_sensors) - 1U);
+    sched_slot = 0;
+    sched_periods = 0;
+}
+
+/**
+ * @brief Adaptive polling is in charge of the slot timing
+ * @return 1 if enabled and not in data-ready mode
+ */
+static inline uint8_t SCHED_Adaptive(void) {
+    return sched_adapt.enabled && !sched_data_ready;
+}
+
+/**
+ * @brief Apply a slot length: period, bus budget, burst limit and period-based counts
+ * @param slot_cycles - Slot length (CPU cycles)
+ */
+static void SCHED_SetSlot(uint32_t slot_cycles) {
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    sched_slot_cycles = slot_cycles;
+    sched_period_us = slot_cycles / cycles_per_us * sched_num_sensors;
+    sched_budget_ns = (uint32_t)((uint64_t)slot_cycles * 1000U / cycles_per_us) / 100U * SCHED_BUS_BUDGET_PCT;
+
+    uint32_t fixed_ns = I2C1_WRITE_COST_NS(1) + I2C1_READ_COST_NS(3);
+    uint32_t batch = 0;
+    if (sched_budget_ns > fixed_ns + I2C1_READ_COST_NS(MAX30101_SAMPLE_BYTES)) {
+        batch = (sched_budget_ns - fixed_ns - I2C1_READ_COST_NS(0)) / (MAX30101_SAMPLE_BYTES * I2C1_BYTE_NS);
+    }
+    // Always drain at least one sample per slot so a sensor can never starve
+    if (batch < 1) batch = 1;
+    if (batch > MAX30101_FIFO_DEPTH) batch = MAX30101_FIFO_DEPTH;
+    sched_max_batch = (uint8_t)batch;
+
+    sched_report_periods = sched_report_us / sched_period_us;
+    if (sched_report_periods < 1) sched_report_periods = 1;
+    sched_presence.poll_periods = sched_presence.poll_us / sched_period_us;
+    if (sched_presence.poll_periods < 1) sched_presence.poll_periods = 1;
+}
+
+/**
+ * @brief Change the acquisition period and the RAW frame handoff size
+ * @details Re-derives the bus budget and burst limit for the new slot length and keeps
+ *          the report interval constant in time. The slot is limited to the 24-bit
+ *          SysTick range (262 ms at 64 MHz). With adaptive polling the period is the
+ *          start value, clamped to its floor and ceiling instead.
+ * @param period_us - Acquisition period per sensor (µs)
+ * @param handoff - Samples per RAW frame before it is handed to the main loop
+ *                  (1–STREAM_RAW_CAPACITY)
+ * @return Applied period (µs)
+ */
+uint32_t SCHED_Configure(uint32_t period_us, uint8_t handoff) {
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    if (SCHED_Adaptive()) {
+        // Start value of the adaptive period; TIM2 has no 24-bit limit
+        if (period_us < sched_adapt.floor_us) period_us = sched_adapt.floor_us;
+        if (period_us > sched_adapt.ceiling_us) period_us = sched_adapt.ceiling_us;
+    }
+    uint32_t slot_cycles = (uint32_t)((uint64_t)period_us * cycles_per_us / sched_num_sensors);
+    if (!SCHED_Adaptive() && slot_cycles > SysTick_LOAD_RELOAD_Msk + 1U) slot_cycles = SysTick_LOAD_RELOAD_Msk + 1U;
+    SCHED_SetSlot(slot_cycles);
+    sched_adapt.slot_us = sched_period_us / sched_num_sensors;
+
+    if (handoff < 1) handoff = 1;
+    if (handoff > STREAM_RAW_CAPACITY) handoff = STREAM_RAW_CAPACITY;
+    sched_handoff = handoff;
+    return sched_period_us;
+}
+
+/**
+ * @brief Acquisition period per sensor set by SCHED_Init() or SCHED_Configure()
+ * @return Period (µs)
+ */
+uint32_t SCHED_GetPeriodUs(void) {
+    return sched_period_us;
+}
+
+/**
+ * @brief Shortest period the slots may run at
+ * @return Adaptive floor (µs), or the configured period
+ */
+uint32_t SCHED_GetShortestPeriodUs(void) {
+    return SCHED_Adaptive() ? sched_adapt.floor_us : sched_period_us;
+}
+
+/**
+ * @brief Arm adaptive polling
+ * @details TIM2 CH2 runs in frozen output-compare mode (no pin, only the flag and its
+ *          interrupt, which shares TIM2_IRQn with the deadline monitor).
+ * @param cfg - [in] Target fill, floor and ceiling of the period
+ * @return void
+ */
+void SCHED_EnableAdaptive(const SCHED_AdaptiveConfig *cfg) {
+    sched_adapt.target = cfg->target_fill;
+    if (sched_adapt.target < 1) sched_adapt.target = 1;
+    if (sched_adapt.target > SCHED_ADAPT_MAX_FILL) sched_adapt.target = SCHED_ADAPT_MAX_FILL;
+    sched_adapt.floor_us = cfg->floor_us;
+    sched_adapt.ceiling_us = (cfg->ceiling_us > cfg->floor_us) ? cfg->ceiling_us : cfg->floor_us;
+    sched_adapt.fill_q8 = (uint32_t)sched_adapt.target << 8;
+    sched_adapt.peak = 0;
+    sched_adapt.overflowed = 0;
+    sched_adapt.enabled = 1;
+    SCHED_Configure(sched_period_us, sched_handoff);
+    sched_adapt.min_us = sched_adapt.max_us = sched_period_us;
+    TIM2->CCMR1 &= ~(TIM_CCMR1_CC2S | TIM_CCMR1_OC2M);
+    TIM2->CCER &= ~TIM_CCER_CC2E;
+}
+
+/**
+ * @brief Enable or disable the TIM2 CH2 compare interrupt
+ * @details DIER is shared with the deadline channels; masked read-modify-write.
+ * @param on - 1 = armed
+ */
+static void SCHED_ArmCompare(uint8_t on) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (on) {
+        TIM2->CCR2 = TIMER_GetMicros() + sched_adapt.slot_us;
+        TIM2->SR = ~TIM_SR_CC2IF;
+        TIM2->DIER |= TIM_DIER_CC2IE;
+    } else {
+        TIM2->DIER &= ~TIM_DIER_CC2IE;
+        TIM2->SR = ~TIM_SR_CC2IF;
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief TIM2 interrupt body (adaptive polling): pend the slot and schedule the next one
+ * @details The compare advances by the slot step from its own previous value, so
+ *          interrupt latency does not accumulate; a compare already in the past (the
+ *          step shrank or the interrupt was held off) restarts from now.
+ * @return void
+ */
+void SCHED_TimerIrq(void) {
+    if ((TIM2->SR & TIM_SR_CC2IF) && (TIM2->DIER & TIM_DIER_CC2IE)) {
+        TIM2->SR = ~TIM_SR_CC2IF;
+        uint32_t next = TIM2->CCR2 + sched_adapt.slot_us;
+        uint32_t now = TIMER_GetMicros();
+        if ((int32_t)(next - now) <= 0) {
+            next = now + sched_adapt.slot_us;
+        }
+        TIM2->CCR2 = next;
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    }
+}
+
+/**
+ * @brief Release every sensor at the same instant and track their phases
+ * @details All channels of the PCA9548 are enabled together; the FIFO pointers of
+ *          every sensor are then cleared and MODE_CONFIG leaves shutdown with one
+ *          broadcast write each, so sample 0 of all sensors is converted in the same
+ *          period. Phase tracking restarts from the nominal period.
+ * @return void
+ */
+void SCHED_SyncStart(void) {
+    PCA9548_SelectMask((uint8_t)((1U << sched_num_sensors) - 1U));
+    MAX30101_ResetFIFO();
+    MAX30101_SetShutdown(0);
+    PCA9548_SelectMask(0x00); // No read may reach more than one sensor
+    sched_phase.nominal_q16 = MAX30101_GetSamplePeriodUs() << 16;
+    for (uint8_t k = 0; k < sched_num_sensors; k++) {
+        sched_index[k] = 0;
+        sched_phase.period_q16[k] = sched_phase.nominal_q16;
+        sched_phase.slips[k] = 0;
+    }
+    sched_phase.valid = 0;
+    sched_phase.anchored = 0;
+    sched_phase.enabled = 1;
+}
+
+/**
+ * @brief Hand the first frame of every sensor off after its first drain
+ * @return void
+ */
+void SCHED_HandoffFirst(void) {
+    sched_first = (uint8_t)((1U << sched_num_sensors) - 1U);
+}
+
+/**
+ * @brief Arm presence gating
+ * @details The pilot current and PROX_INT_THRESH are written to every sensor now; they
+ *          are only used once a sensor is parked (MAX30101_PrepareProximity()).
+ * @param cfg - [in] Gating parameters
+ * @return void
+ */
+void SCHED_EnablePresence(const SCHED_PresenceConfig *cfg) {
+    for (uint8_t k = 0; k < sched_num_sensors; k++) {
+        PCA9548_SelectChannel(k);
+        MAX30101_SetProximity(cfg->pilot_ma, cfg->prox_na);
+    }
+    sched_presence.min_counts = (uint32_t)(cfg->min_na / MAX30101_CURRENT_LSB_NA);
+    sched_presence.hold_us = cfg->hold_ms * 1000U;
+    sched_presence.poll_us = cfg->poll_ms * 1000U;
+    sched_presence.poll_periods = sched_presence.poll_us / sched_period_us;
+    if (sched_presence.poll_periods < 1) sched_presence.poll_periods = 1;
+    sched_presence.present = (uint8_t)((1U << sched_num_sensors) - 1U);
+    sched_presence.parking = 0;
+    sched_presence.low = 0;
+    sched_presence.backlog = 0;
+    sched_presence.admitted = 0;
+    sched_presence.enabled = 1;
+}
+
+/**
+ * @brief Arm the predictive drain
+ * @details Every sensor starts unseeded: its first slots read the status until the
+ *          rate has been learned.
+ * @param verify_every - Longest run of predicted slots between two status reads (0 = off)
+ * @return void
+ */
+void SCHED_EnablePrediction(uint8_t verify_every) {
+    sched_predict.verify_every = verify_every;
+    sched_predict.valid = 0;
+    sched_predict.learned = 0;
+}
+
+/**
+ * @brief Sensors currently drained
+ * @return Bit per present sensor
+ */
+uint8_t SCHED_GetPresent(void) {
+    return sched_presence.present;
+}
+
+/**
+ * @brief Take the sensors re-admitted since the last call
+ * @return Bit per re-admitted sensor
+ */
+uint8_t SCHED_TakeAdmitted(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint8_t admitted = sched_presence.admitted;
+    sched_presence.admitted = 0;
+    __set_PRIMASK(primask);
+    return admitted;
+}
+
+/**
+ * @brief Start SysTick at the slot rate
+ * @details In data-ready mode SysTick runs at twice the slot length and is restarted
+ *          by every slot, so it only fires when an INT edge has been missed. With
+ *          adaptive polling the SysTick counter stays off and TIM2 CH2 pends the slots.
+ * @return void
+ */
+void SCHED_Start(void) {
+    uint32_t reload = sched_slot_cycles;
+    if (SCHED_Adaptive()) {
+        // SysTick only as the slot exception (priority set, counter off); TIM2 CH2 pends it
+        SysTick_Config(SysTick_LOAD_RELOAD_Msk);
+        SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+        SCHED_ArmCompare(1);
+        return;
+    }
+    if (sched_data_ready) {
+        reload = (reload > (SysTick_LOAD_RELOAD_Msk + 1U) / 2U) ? SysTick_LOAD_RELOAD_Msk + 1U : 2U * reload;
+        EXTI->PR = EXTI_PR_PR1;
+        NVIC_ClearPendingIRQ(EXTI1_IRQn);
+        NVIC_EnableIRQ(EXTI1_IRQn);
+    }
+    SysTick_Config(reload);
+}
+
+/**
+ * @brief Trigger slots from the sensor INT line instead of the SysTick period
+ * @details Enables PPG_RDY on the sensor and a falling-edge interrupt on PA1
+ *          (EXTI1, pull-up; the INT output is open-drain, active low). Each edge pends
+ *          SysTick, so the slot runs in its usual context right after the sample
+ *          enters the FIFO. Only one sensor can own the line.
+ * @param enable - 1 = INT-triggered slots, 0 = periodic slots
+ * @return 1 if applied, 0 if more than one sensor is configured
+ * @note Main-loop context while stopped (before SCHED_Start() or between SCHED_Stop()
+ *       and SCHED_Resume()).
+ */
+uint8_t SCHED_EnableDataReady(uint8_t enable) {
+    if (enable && sched_num_sensors != 1) {
+        return 0;
+    }
+    if (enable) {
+        RCC->AHBENR |= RCC_AHBENR_GPIOAEN;
+        RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+        // PA1: input, pull-up
+        GPIOA->MODER &= ~(0x3U << 2);
+        GPIOA->PUPDR &= ~(0x3U << 2);
+        GPIOA->PUPDR |= (0x1U << 2);
+        // EXTI1 ← PA1, falling edge
+        SYSCFG->EXTICR[0] &= ~SYSCFG_EXTICR1_EXTI1;
+        SYSCFG->EXTICR[0] |= SYSCFG_EXTICR1_EXTI1_PA;
+        EXTI->FTSR |= EXTI_FTSR_TR1;
+        EXTI->RTSR &= ~EXTI_RTSR_TR1;
+        EXTI->PR = EXTI_PR_PR1;
+        EXTI->IMR |= EXTI_IMR_MR1;
+        NVIC_SetPriority(EXTI1_IRQn, SCHED_DRDY_IRQ_PRIORITY);
+    } else {
+        EXTI->IMR &= ~EXTI_IMR_MR1;
+    }
+    PCA9548_SelectChannel(0);
+    MAX30101_SetDataReadyInterrupt(enable);
+    if (!(sched_presence.present & 1U)) {
+        // Parked: keep waiting for PROX_INT
+        I2C1_Write(SENSOR_ADDR, INTR_ENABLE1, (uint8_t)((enable ? MAX30101_INT_PPG_RDY : 0x00) | MAX30101_INT_PROX));
+    }
+    sched_data_ready = enable;
+    return 1;
+}
+
+/**
+ * @brief EXTI1 interrupt body: run the slot now
+ * @return void
+ */
+void SCHED_DataReadyIrq(void) {
+    EXTI->PR = EXTI_PR_PR1;
+    SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+}
+
+/**
+ * @brief Hand the open frame of a sensor to the main loop
+ * @param sensor - Sensor index
+ */
+static void SCHED_Handoff(uint8_t sensor) {
+    uint16_t head = sched_head;
+    sched_queue[head] = sched_open[sensor];
+    sched_head = (head + 1) & (SCHED_QUEUE_SIZE - 1); // Publish after the entry is written
+    sched_open[sensor] = NULL;
+    TRACE_Event(TRACE_HANDOFF, sensor);
+}
+
+/**
+ * @brief Stop the slots (main-loop context)
+ * @details Disables SysTick, waits for an asynchronous chain still on the bus and hands
+ *          the open frames to the main loop. The I2C bus is free for blocking use until
+ *          SCHED_Resume().
+ * @return void
+ */
+void SCHED_Stop(void) {
+    NVIC_DisableIRQ(EXTI1_IRQn); // An INT edge would pend SysTick even with the counter off
+    SCHED_ArmCompare(0);
+    SysTick->CTRL &= ~(SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk);
+    SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+    while (sched_dma.busy) {
+    }
+    for (uint8_t k = 0; k < sched_num_sensors; k++) {
+        if (sched_open[k]) {
+            SCHED_Handoff(k);
+        }
+    }
+}
+
+/**
+ * @brief Restart the slots after SCHED_Stop()
+ * @details The FIFOs may have been read or overflowed while stopped, so each one is
+ *          emptied. The samples acquired since the last drain of a sensor are counted as
+ *          overflows and skipped in its index sequence, which keeps indices on the time
+ *          axis (±1 sample) across the pause. Parked sensors are left in proximity mode;
+ *          their re-admission accounts for the whole absence.
+ * @return void
+ */
+void SCHED_Resume(void) {
+    uint32_t period_cycles = MAX30101_GetSamplePeriodUs() * (SystemCoreClock / 1000000U);
+    for (uint8_t k = 0; k < sched_num_sensors; k++) {
+        if (!(sched_presence.present & (1U << k))) {
+            continue;
+        }
+        PCA9548_SelectChannel(k);
+        MAX30101_ResetFIFO();
+        SCHED_SensorStats *st = &sched_stats[k];
+        if (st->drains) {
+            uint32_t lost = (DWT_GetCycles() - st->last_drain_cycles) / period_cycles;
+            st->overflows += lost;
+            sched_index[k] += lost;
+        }
+        sched_resumed |= (uint8_t)(1U << k);
+    }
+    sched_slot = 0;
+    SCHED_Start();
+}
+
+/**
+ * @brief Advance the fill bracket of a sensor to now
+ * @details Both bounds move by elapsed time × rate; the bracket widens by 1/256 of
+ *          the advance on each side, the rate uncertainty after SCHED_PREDICT_LEARN
+ *          samples.
+ * @param sensor - Sensor index
+ * @return TIM2 time of the update (µs)
+ */
+static uint32_t SCHED_PredictAdvance(uint8_t sensor) {
+    uint32_t now = TIMER_GetMicros();
+    uint32_t elapsed = now - sched_predict.model_us[sensor];
+    uint32_t advance = (uint32_t)(((uint64_t)elapsed * sched_predict.rate[sensor]) >> 16);
+    sched_predict.fill[sensor] += advance - (advance >> 8);
+    sched_predict.width[sensor] += 2U * (advance >> 8);
+    sched_predict.model_us[sensor] = now;
+    return now;
+}
+
+/**
+ * @brief Decide between a predicted slot and a status read
+ * @details A seeded model of a sensor not just resumed or re-admitted predicts until
+ *          its countdown runs out or the FIFO may be near full (overflow unseen).
+ * @param sensor - Sensor index
+ * @return Samples to burst without a status read, or SCHED_PREDICT_READ
+ */
+static uint8_t SCHED_Predict(uint8_t sensor) {
+    uint8_t bit = (uint8_t)(1U << sensor);
+    if (!sched_predict.verify_every || sched_data_ready) {
+        return SCHED_PREDICT_READ;
+    }
+    if (sched_resumed & bit) {
+        sched_predict.valid &= (uint8_t)~bit; // FIFO emptied meanwhile
+    }
+    if (!(sched_predict.valid & bit) || sched_predict.countdown[sensor] == 0) {
+        return SCHED_PREDICT_READ;
+    }
+    SCHED_PredictAdvance(sensor);
+    uint32_t fill = sched_predict.fill[sensor];
+    if (fill + sched_predict.width[sensor] >= (uint32_t)(MAX30101_FIFO_DEPTH - 1) << 16) {
+        return SCHED_PREDICT_READ;
+    }
+    sched_predict.countdown[sensor]--;
+    sched_stats[sensor].predicted++;
+    return (fill > SCHED_PREDICT_MARGIN) ? (uint8_t)((fill - SCHED_PREDICT_MARGIN) >> 16) : 0;
+}
+
+/**
+ * @brief Check the fill bracket against a status read and narrow it
+ * @details The true fill lies in [available, available + 1) samples. A bracket that
+ *          still overlaps it agrees and is intersected with it, so the phase of the
+ *          sample arrivals is pinned down over successive reads; a lower bound past
+ *          it is "ahead" (a predicted burst may have read past WR_PTR: "unsafe"), an
+ *          upper bound below it "behind", and the bracket restarts from the read. The
+ *          rate is re-measured as samples produced (read since the anchor + unread now
+ *          − unread at the anchor) over the time since the anchor. Agreement with a
+ *          learned rate doubles the run of predicted slots, anything else restarts it.
+ *          An overflow, an unseeded model or a changed ODR seeds the bracket and the
+ *          anchor from this read.
+ * @param sensor - Sensor index
+ * @param available - Unread samples reported by the status read
+ * @param ovf - OVF_COUNTER of the status read
+ * @param cycles - Measured duration of the status read (CPU cycles)
+ */
+static void SCHED_Verify(uint8_t sensor, uint8_t available, uint8_t ovf, uint32_t cycles) {
+    SCHED_SensorStats *st = &sched_stats[sensor];
+    uint8_t bit = (uint8_t)(1U << sensor);
+    if (!sched_predict.verify_every) {
+        return;
+    }
+    st->status_cycles = st->status_cycles ? (3U * st->status_cycles + cycles) / 4U : cycles;
+    uint32_t now = SCHED_PredictAdvance(sensor);
+    uint32_t low = (uint32_t)available << 16;
+    uint32_t high = low + 0x10000U;
+    uint8_t agree = 0;
+
+    if (sched_predict.period_us != MAX30101_GetSamplePeriodUs()) {
+        sched_predict.period_us = MAX30101_GetSamplePeriodUs();
+        sched_predict.learned = 0;
+        sched_predict.valid = 0;
+    }
+    if (!(sched_predict.learned & bit)) {
+        sched_predict.rate[sensor] = (uint32_t)((1ULL << 32) / sched_predict.period_us);
+    }
+    uint32_t lo = sched_predict.fill[sensor];
+    uint32_t hi = lo + sched_predict.width[sensor];
+    if (ovf || !(sched_predict.valid & bit)) {
+        sched_predict.valid |= bit;
+        sched_predict.anchor_us[sensor] = now;
+        sched_predict.anchor_read[sensor] = 0;
+        sched_predict.anchor_fill[sensor] = available;
+        lo = low;
+        hi = high;
+    } else {
+        st->verified++;
+        if (lo >= high) {
+            st->ahead++;
+            if (lo - SCHED_PREDICT_MARGIN >= high) {
+                st->unsafe++;
+            }
+            lo = low;
+            hi = high;
+        } else if (hi <= low) {
+            st->behind++;
+            lo = low;
+            hi = high;
+        } else {
+            agree = 1;
+            if (lo < low) lo = low;
+            if (hi > high) hi = high;
+        }
+        uint32_t span_us = now - sched_predict.anchor_us[sensor];
+        int32_t produced = (int32_t)(sched_predict.anchor_read[sensor] + available) - sched_predict.anchor_fill[sensor];
+        if (produced >= SCHED_PREDICT_LEARN && span_us) {
+            sched_predict.rate[sensor] = (uint32_t)(((uint64_t)produced << 32) / span_us);
+            sched_predict.learned |= bit;
+        }
+        if (span_us >= SCHED_PREDICT_SPAN_US) {
+            sched_predict.anchor_us[sensor] = now;
+            sched_predict.anchor_read[sensor] = 0;
+            sched_predict.anchor_fill[sensor] = available;
+        }
+    }
+    sched_predict.fill[sensor] = lo;
+    sched_predict.width[sensor] = hi - lo;
+
+    uint8_t gap = 0;
+    if (agree && (sched_predict.learned & bit)) {
+        gap = sched_predict.gap[sensor];
+        gap = (gap == 0) ? 1U : (gap >= sched_predict.verify_every / 2U) ? sched_predict.verify_every : (uint8_t)(2U * gap);
+    }
+    sched_predict.gap[sensor] = gap;
+    sched_predict.countdown[sensor] = gap;
+}
+
+/**
+ * @brief Narrow the arrival time of the newest sample from a status read
+ * @details The status read found `arrived` samples in total: the newest had landed
+ *          by the end of the read, the next one not before its start. The previous
+ *          bracket, advanced by the learned period (and widened by 1/256 of the
+ *          advance), is intersected with that; a disjoint bracket restarts from the read.
+ *          The period is re-measured from bracket midpoints once SCHED_PREDICT_LEARN
+ *          samples separate them from the anchor.
+ * @param sensor - Sensor index
+ * @param available - Unread samples of the status read
+ * @param ovf - OVF_COUNTER of the status read
+ * @param cycles - Duration of the status read (DWT cycles)
+ */
+static void SCHED_TrackPhase(uint8_t sensor, uint8_t available, uint8_t ovf, uint32_t cycles) {
+    uint8_t bit = (uint8_t)(1U << sensor);
+    uint32_t arrived = sched_index[sensor] + ovf + available;
+    if (!sched_phase.enabled || arrived == 0) {
+        return;
+    }
+    uint32_t newest = arrived - 1U;
+    uint32_t period_q16 = sched_phase.period_q16[sensor];
+    uint32_t t_end = TIMER_GetMicros();
+    uint32_t t_start = t_end - DWT_CyclesToUs(cycles) - 1U;
+    uint32_t lo = t_start - (period_q16 >> 16) + 1U; // Sample newest + 1 had not landed at t_start
+    uint32_t hi = t_end;                              // Sample newest had landed at t_end
+    if (sched_phase.valid & bit) {
+        uint32_t steps = newest - sched_phase.ref_index[sensor];
+        if (steps < 0x10000U) {
+            uint32_t advance = (uint32_t)(((uint64_t)steps * period_q16) >> 16);
+            uint32_t p_lo = sched_phase.ref_us[sensor] + advance;
+            uint32_t p_hi = p_lo + sched_phase.width_us[sensor] + (advance >> SCHED_PHASE_SLACK_SHIFT) + 1U;
+            uint32_t n_lo = ((int32_t)(p_lo - lo) > 0) ? p_lo : lo;
+            uint32_t n_hi = ((int32_t)(p_hi - hi) < 0) ? p_hi : hi;
+            if ((int32_t)(n_hi - n_lo) >= 0) {
+                lo = n_lo;
+                hi = n_hi;
+            } else {
+                sched_phase.slips[sensor]++;
+            }
+        } else {
+            sched_phase.anchored &= (uint8_t)~bit; // Index went backwards or far ahead
+        }
+    }
+    sched_phase.ref_index[sensor] = newest;
+    sched_phase.ref_us[sensor] = lo;
+    sched_phase.width_us[sensor] = hi - lo;
+    sched_phase.valid |= bit;
+
+    uint32_t mid = lo + (hi - lo) / 2U;
+    uint32_t span_samples = newest - sched_phase.anchor_index[sensor];
+    uint32_t span_us = mid - sched_phase.anchor_us[sensor];
+    if (!(sched_phase.anchored & bit) || span_us >= SCHED_PREDICT_SPAN_US) {
+        sched_phase.anchor_index[sensor] = newest;
+        sched_phase.anchor_us[sensor] = mid;
+        sched_phase.anchored |= bit;
+    } else if (span_samples >= SCHED_PREDICT_LEARN) {
+        sched_phase.period_q16[sensor] = (uint32_t)(((uint64_t)span_us << 16) / span_samples);
+    }
+}
+
+/**
+ * @brief Arrival time of a sample from the tracked phase
+ * @param sensor - Sensor index with a valid bracket
+ * @param index - Sample index
+ * @return Estimated arrival (TIM2 µs, bracket midpoint)
+ */
+static uint32_t SCHED_PhaseTime(uint8_t sensor, uint32_t index) {
+    int32_t steps = (int32_t)(index - sched_phase.ref_index[sensor]);
+    int64_t offset = (int64_t)steps * (int64_t)sched_phase.period_q16[sensor] / 65536;
+    return sched_phase.ref_us[sensor] + sched_phase.width_us[sensor] / 2U + (uint32_t)(int32_t)offset;
+}
+
+/**
+ * @brief Process a FIFO status snapshot and reserve room for the burst
+ * @details Accounts for overflow (index gap, open frame closed), drain-interval spread
+ *          and the bus budget, then opens a frame if needed.
+ * @param sensor - Sensor index
+ * @param available - Unread samples reported by the status read (or predicted)
+ * @param ovf - OVF_COUNTER of the status read (0 when predicted)
+ * @param lent - 1 in a slot lent by a parked sensor (left out of the interval spread)
+ * @param dst - [out] Burst destination inside the open frame
+ * @return Samples to burst-read (0 = nothing to read)
+ */
+static uint8_t SCHED_Plan(uint8_t sensor, uint8_t available, uint8_t ovf, uint8_t lent, uint8_t **dst) {
+    SCHED_SensorStats *st = &sched_stats[sensor];
+    if (ovf) {
+        st->overflows += ovf;
+        sched_index[sensor] += ovf; // Lost samples leave a gap in the index sequence
+        TRACE_Event(TRACE_FIFO_OVF, ((uint32_t)sensor << 8) | ovf);
+        TRACE_Trigger();
+        if (sched_open[sensor]) {
+            SCHED_Handoff(sensor); // Frames only hold consecutive samples
+        }
+    }
+
+    // Drain-interval spread of this sensor = sample-age jitter at read-out
+    uint32_t t_drain = DWT_GetCycles();
+    uint32_t t_drain_us = TIMER_GetMicros();
+    if (lent) {
+        st->borrowed++;
+    } else {
+        if (st->drains && !(sched_resumed & (1U << sensor))) {
+            uint32_t interval = t_drain - st->last_drain_cycles;
+            if (interval < st->interval_min_cycles) st->interval_min_cycles = interval;
+            if (interval > st->interval_max_cycles) st->interval_max_cycles = interval;
+        }
+        st->last_drain_cycles = t_drain;
+        sched_resumed &= (uint8_t)~(1U << sensor);
+    }
+    st->drains++;
+    sched_presence.drain_us[sensor] = t_drain_us;
+
+    if (available > sched_adapt.peak) sched_adapt.peak = available;
+    if (ovf) sched_adapt.overflowed = 1;
+
+    uint8_t batch = available;
+    sched_presence.backlog &= (uint8_t)~(1U << sensor);
+    if (batch > sched_max_batch) {
+        batch = sched_max_batch;
+        sched_presence.backlog |= (uint8_t)(1U << sensor);
+    }
+    POOL_Frame *frame = sched_open[sensor];
+    if (batch && frame == NULL) {
+        frame = POOL_Alloc();
+        if (frame == NULL) {
+            st->starved++;
+            st->deferrals++;
+            return 0;
+        }
+        frame->sensor = sensor;
+        frame->count = 0;
+        frame->first_index = sched_index[sensor];
+        frame->first_time = (sched_phase.valid & (1U << sensor))
+                          ? SCHED_PhaseTime(sensor, sched_index[sensor])
+                          : t_drain_us - (uint32_t)(available - 1U) * MAX30101_GetSamplePeriodUs();
+        sched_open[sensor] = frame;
+    }
+    if (batch) {
+        uint8_t room = STREAM_RAW_CAPACITY - frame->count;
+        if (batch > room) {
+            batch = room;
+        }
+        *dst = &frame->data[STREAM_RAW_SAMPLES_OFFSET + frame->count * MAX30101_SAMPLE_BYTES];
+    }
+    if (batch < available) {
+        st->deferrals++;    // once per slot: the backlog itself is drained by the next slots
+    }
+    return batch;
+}
+
+/**
+ * @brief DC-level presence detector, run on the newest sample of every drain
+ * @details Requests parking once the IR count has stayed below min_counts for hold_us.
+ * @param sensor - Sensor index
+ * @param newest - [in] FIFO bytes of the newest sample read
+ */
+static void SCHED_CheckPresence(uint8_t sensor, const uint8_t *newest) {
+    uint8_t bit = (uint8_t)(1U << sensor);
+    uint32_t ir = ((uint32_t)(newest[3] & 0x3U) << 16) | ((uint32_t)newest[4] << 8) | newest[5];
+    uint32_t now = TIMER_GetMicros();
+    if (ir >= sched_presence.min_counts) {
+        sched_presence.low &= (uint8_t)~bit;
+    } else if (!(sched_presence.low & bit)) {
+        sched_presence.low |= bit;
+        sched_presence.low_since[sensor] = now;
+    } else if (now - sched_presence.low_since[sensor] >= sched_presence.hold_us) {
+        sched_presence.parking |= bit;
+    }
+}
+
+/**
+ * @brief Choose the proximity action of a slot and, for a parked owner, its borrower
+ * @details A sensor due for parking is parked; a parked sensor is polled every
+ *          poll_periods of its own slots, and otherwise its slot goes to the next
+ *          present sensor with a budget backlog (round robin), or stays idle.
+ * @param sensor - [in/out] Slot owner; the borrower when a slot is lent
+ * @return 0 to drain *sensor, SCHED_CTL_PARK, SCHED_CTL_POLL or SCHED_CTL_IDLE
+ */
+static uint8_t SCHED_PresenceAction(uint8_t *sensor) {
+    uint8_t k = *sensor;
+    uint8_t bit = (uint8_t)(1U << k);
+    if (sched_presence.present & bit) {
+        return (sched_presence.parking & bit) ? SCHED_CTL_PARK : 0;
+    }
+    if (--sched_presence.wait[k] == 0) {
+        sched_presence.wait[k] = sched_presence.poll_periods;
+        return SCHED_CTL_POLL;
+    }
+    uint8_t lendable = sched_presence.backlog & sched_presence.present & (uint8_t)~sched_presence.parking;
+    for (uint8_t i = 0; lendable && i < sched_num_sensors; i++) {
+        uint8_t j = (uint8_t)((sched_presence.lend_next + i) % sched_num_sensors);
+        if (lendable & (1U << j)) {
+            sched_presence.lend_next = (uint8_t)((j + 1U) % sched_num_sensors);
+            *sensor = j;
+            return 0;
+        }
+    }
+    return SCHED_CTL_IDLE;
+}
+
+/**
+ * @brief Bookkeeping after the proximity transfers of a slot
+ * @param sensor - Sensor index
+ * @param action - SCHED_CTL_PARK (now in proximity mode) or SCHED_CTL_ADMIT (FIFO cleared)
+ */
+static void SCHED_PresenceDone(uint8_t sensor, uint8_t action) {
+    SCHED_SensorStats *st = &sched_stats[sensor];
+    uint8_t bit = (uint8_t)(1U << sensor);
+    if (action == SCHED_CTL_PARK) {
+        sched_presence.present &= (uint8_t)~bit;
+        sched_presence.parking &= (uint8_t)~bit;
+        sched_presence.low &= (uint8_t)~bit;
+        sched_presence.backlog &= (uint8_t)~bit;
+        sched_presence.wait[sensor] = sched_presence.poll_periods;
+        st->parks++;
+    } else if (action == SCHED_CTL_ADMIT) {
+        // Samples the sensor would have taken since its last drain leave an index gap
+        uint32_t skipped = (TIMER_GetMicros() - sched_presence.drain_us[sensor]) / MAX30101_GetSamplePeriodUs();
+        st->skipped += skipped;
+        sched_index[sensor] += skipped;
+        sched_resumed |= bit;
+        sched_presence.present |= bit;
+        sched_presence.admitted |= bit;
+        st->admits++;
+    }
+}
+
+/**
+ * @brief Proximity transfers of a slot on the blocking driver
+ * @param sensor - Sensor index
+ * @param action - SCHED_CTL_PARK or SCHED_CTL_POLL
+ * @return Estimated bus occupancy (ns)
+ */
+static uint32_t SCHED_ControlBlocking(uint8_t sensor, uint8_t action) {
+    uint32_t bus_ns = I2C1_WRITE_COST_NS(1);
+    DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_SELECT);
+    PCA9548_SelectChannel(sensor);
+    if (action == SCHED_CTL_POLL) {
+        uint8_t status;
+        DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_STATUS);
+        I2C1_Read(SENSOR_ADDR, INTR_STATUS1, &status, 1);
+        sched_stats[sensor].polls++;
+        bus_ns += I2C1_READ_COST_NS(1);
+        if (!(status & MAX30101_INT_PROX)) {
+            return bus_ns;
+        }
+        action = SCHED_CTL_ADMIT;
+    }
+    DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_COMMIT);
+    uint8_t count = MAX30101_PrepareProximity(action == SCHED_CTL_PARK, sched_data_ready, sched_ctl.seq);
+    for (uint8_t i = 0; i < count; i++) {
+        I2C1_Write(SENSOR_ADDR, sched_ctl.seq[i].reg, sched_ctl.seq[i].value);
+    }
+    SCHED_PresenceDone(sensor, action);
+    return bus_ns + count * I2C1_WRITE_COST_NS(2);
+}
+
+/**
+ * @brief Account a completed burst and hand the frame off when it is full enough
+ * @param sensor - Sensor index
+ * @param batch - Samples read into the open frame
+ * @param bus_ns - Estimated bus occupancy of the whole slot
+ */
+static void SCHED_Commit(uint8_t sensor, uint8_t batch, uint32_t bus_ns) {
+    SCHED_SensorStats *st = &sched_stats[sensor];
+    if (batch) {
+        POOL_Frame *frame = sched_open[sensor];
+        if (sched_presence.enabled) {
+            const uint8_t *newest = &frame->data[STREAM_RAW_SAMPLES_OFFSET + (frame->count + batch - 1U) * MAX30101_SAMPLE_BYTES];
+            SCHED_CheckPresence(sensor, newest);
+        }
+        frame->count += batch;
+        sched_index[sensor] += batch;
+        st->samples += batch;
+        if (sched_predict.valid & (1U << sensor)) {
+            sched_predict.fill[sensor] -= (uint32_t)batch << 16;
+            sched_predict.anchor_read[sensor] += batch;
+        }
+        if (frame->count >= sched_handoff || (sched_first & (1U << sensor))) {
+            sched_first &= (uint8_t)~(1U << sensor);
+            SCHED_Handoff(sensor);
+        }
+    }
+    if (bus_ns > st->bus_max_ns) st->bus_max_ns = bus_ns;
+}
+
+/**
+ * @brief Retune the adaptive period from the fill seen in the period that just ended
+ * @details The peak fill of the period is smoothed (1/2) and the period scaled by
+ *          2·target / (fill + target): halfway to the period that would find the
+ *          target, which keeps the ±1 sample quantisation of the fill from ringing.
+ *          An overflow halves the period at once. The result is clamped to the floor
+ *          and the latency ceiling, and the budget follows the new slot length.
+ */
+static void SCHED_Retune(void) {
+    uint32_t period = sched_period_us;
+    int32_t delta = (int32_t)((uint32_t)sched_adapt.peak << 8) - (int32_t)sched_adapt.fill_q8;
+    sched_adapt.fill_q8 = (uint32_t)((int32_t)sched_adapt.fill_q8 + delta / 2);
+    if (sched_adapt.overflowed) {
+        period /= 2U;
+    } else {
+        uint32_t target_q8 = (uint32_t)sched_adapt.target << 8;
+        period = (uint32_t)((uint64_t)period * 2U * target_q8 / (sched_adapt.fill_q8 + target_q8));
+    }
+    sched_adapt.peak = 0;
+    sched_adapt.overflowed = 0;
+    if (period < sched_adapt.floor_us) period = sched_adapt.floor_us;
+    if (period > sched_adapt.ceiling_us) period = sched_adapt.ceiling_us;
+    if (period != sched_period_us) {
+        SCHED_SetSlot((uint32_t)((uint64_t)period * (SystemCoreClock / 1000000U) / sched_num_sensors));
+        sched_adapt.slot_us = sched_period_us / sched_num_sensors;
+    }
+    if (sched_period_us < sched_adapt.min_us) sched_adapt.min_us = sched_period_us;
+    if (sched_period_us > sched_adapt.max_us) sched_adapt.max_us = sched_period_us;
+}
+
+/**
+ * @brief Advance to the next slot
+ * @return 1 when the slot closed an acquisition period, 0 otherwise
+ */
+static uint8_t SCHED_NextSlot(void) {
+    if (++sched_slot >= sched_num_sensors) {
+        sched_slot = 0;
+        if (SCHED_Adaptive()) {
+            SCHED_Retune();
+        }
+        if (++sched_periods >= sched_report_periods) {
+            sched_periods = 0;
+            sched_report_due = 1;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* Asynchronous (DMA) slot: select → status → burst, each step started from the
+   completion callback of the previous one in the I2C1 interrupt */
+static void SCHED_DmaSelected(uint8_t ok);
+static void SCHED_DmaStatus(uint8_t ok);
+static void SCHED_DmaBurst(uint8_t ok);
+
+/**
+ * @brief End the asynchronous chain of the current sensor
+ * @param cycles_at_entry - DWT time at entry of the calling callback
+ */
+static void SCHED_DmaFinish(uint32_t cycles_at_entry) {
+    SCHED_SensorStats *st = &sched_stats[sched_dma.sensor];
+    uint32_t cycles = sched_dma.cpu_cycles + (DWT_GetCycles() - cycles_at_entry);
+    if (cycles > st->isr_max_cycles) st->isr_max_cycles = cycles;
+    sched_dma.busy = 0;
+    DEADLINE_End(DEADLINE_ACQ);
+}
+
+/**
+ * @brief Plan the burst of the chain in flight and start it, or end the chain
+ * @param available - Unread samples (status read or prediction)
+ * @param ovf - OVF_COUNTER of the status read (0 when predicted)
+ * @param t0 - DWT time at entry of the calling callback
+ */
+static void SCHED_DmaStartBurst(uint8_t available, uint8_t ovf, uint32_t t0) {
+    uint8_t *dst = NULL;
+    sched_dma.batch = SCHED_Plan(sched_dma.sensor, available, ovf, sched_dma.lent, &dst);
+    if (sched_dma.batch == 0) {
+        SCHED_Commit(sched_dma.sensor, 0, I2C1_WRITE_COST_NS(1) + sched_dma.status_ns);
+        SCHED_DmaFinish(t0);
+        return;
+    }
+    DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_BURST);
+    I2C1_ReadAsync(SENSOR_ADDR, FIFO_DATAREG, dst, (uint8_t)(sched_dma.batch * MAX30101_SAMPLE_BYTES), SCHED_DmaBurst);
+    sched_dma.cpu_cycles += DWT_GetCycles() - t0;
+}
+
+static void SCHED_DmaSelected(uint8_t ok) {
+    uint32_t t0 = DWT_GetCycles();
+    if (!ok) {
+        SCHED_DmaFinish(t0);
+        return;
+    }
+    uint8_t predicted = SCHED_Predict(sched_dma.sensor);
+    if (predicted != SCHED_PREDICT_READ) {
+        sched_dma.status_ns = 0;
+        SCHED_DmaStartBurst(predicted, 0, t0);
+        return;
+    }
+    DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_STATUS);
+    sched_dma.status_ns = I2C1_READ_COST_NS(3);
+    sched_dma.status_start = DWT_GetCycles();
+    I2C1_ReadAsync(SENSOR_ADDR, FIFO_WRITPTR, sched_dma.status, 3, SCHED_DmaStatus);
+    sched_dma.cpu_cycles += DWT_GetCycles() - t0;
+}
+
+static void SCHED_DmaStatus(uint8_t ok) {
+    uint32_t t0 = DWT_GetCycles();
+    MAX30101_FIFOStatus fifo;
+    if (!ok) {
+        SCHED_DmaFinish(t0);
+        return;
+    }
+    uint8_t available = MAX30101_ParseFIFOStatus(sched_dma.status, &fifo);
+    SCHED_Verify(sched_dma.sensor, available, fifo.ovf_counter, t0 - sched_dma.status_start);
+    SCHED_TrackPhase(sched_dma.sensor, available, fifo.ovf_counter, DWT_GetCycles() - sched_dma.status_start);
+    SCHED_DmaStartBurst(available, fifo.ovf_counter, t0);
+}
+
+static void SCHED_DmaBurst(uint8_t ok) {
+    uint32_t t0 = DWT_GetCycles();
+    uint8_t batch = ok ? sched_dma.batch : 0;
+    if (!ok) {
+        sched_predict.valid &= (uint8_t)~(1U << sched_dma.sensor); // Read pointer unknown
+    }
+    DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_COMMIT);
+    SCHED_Commit(sched_dma.sensor, batch,
+                 I2C1_WRITE_COST_NS(1) + sched_dma.status_ns + I2C1_READ_COST_NS(sched_dma.batch * MAX30101_SAMPLE_BYTES));
+    SCHED_DmaFinish(t0);
+}
+
+/**
+ * @brief Asynchronous proximity transfers: select, [INTR_STATUS1 read], register writes,
+ *        one per I2C1 completion; a NACK ends the chain and the action is retried later
+ */
+static void SCHED_DmaControl(uint8_t ok) {
+    uint32_t t0 = DWT_GetCycles();
+    uint8_t sensor = sched_dma.sensor;
+    if (!ok) {
+        SCHED_DmaFinish(t0);
+        return;
+    }
+    if (sched_ctl.action == SCHED_CTL_POLL) {
+        if (sched_ctl.step == 0) {
+            sched_ctl.step = 1;
+            DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_STATUS);
+            I2C1_ReadAsync(SENSOR_ADDR, INTR_STATUS1, &sched_ctl.status, 1, SCHED_DmaControl);
+            sched_dma.cpu_cycles += DWT_GetCycles() - t0;
+            return;
+        }
+        sched_stats[sensor].polls++;
+        if (!(sched_ctl.status & MAX30101_INT_PROX)) {
+            SCHED_DmaFinish(t0);
+            return;
+        }
+        sched_ctl.action = SCHED_CTL_ADMIT;
+        sched_ctl.count = MAX30101_PrepareProximity(0, sched_data_ready, sched_ctl.seq);
+        sched_ctl.step = 0;
+    }
+    if (sched_ctl.step < sched_ctl.count) {
+        const MAX30101_RegWrite *w = &sched_ctl.seq[sched_ctl.step++];
+        DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_COMMIT);
+        I2C1_WriteRegAsync(SENSOR_ADDR, w->reg, w->value, SCHED_DmaControl);
+        sched_dma.cpu_cycles += DWT_GetCycles() - t0;
+        return;
+    }
+    SCHED_PresenceDone(sensor, sched_ctl.action);
+    SCHED_DmaFinish(t0);
+}
+
+/**
+ * @brief Execute one acquisition slot (SysTick context)
+ * @details Sequence for the sensor that owns the slot:
+ *          1. Select its PCA9548 channel
+ *          2. Read WR_PTR/OVF/RD_PTR in one transaction; on overflow close the open frame
+ *             (predictive drain: most slots take the count from the fill model instead)
+ *          3. Burst-read min(available, budgeted batch, frame room) samples directly into
+ *             the sensor's open frame (allocated from the pool if needed)
+ *          4. Hand the frame to the main loop once it holds the handoff size
+ *             (SCHED_HANDOFF_SAMPLES unless changed with SCHED_Configure())
+ *          5. Update worst-case ISR length, drain-interval spread and bus occupancy
+ *
+ *          After SCHED_EnableDMA() the slot only starts step 1; steps 2–4 run in the
+ *          I2C1 interrupt as each transfer completes and the bytes move by DMA. A slot
+ *          whose predecessor is still on the bus is skipped (counted as "overrun").
+ *
+ *          With presence gating a slot may instead park its sensor, poll it for PROX_INT
+ *          (re-admitting it when set), drain a present sensor with a backlog, or do
+ *          nothing (SCHED_PresenceAction()).
+ *
+ * @return 1 when the slot closed an acquisition period, 0 otherwise
+ * @note ISR context; the frame queue is lock-free (ISR writes head, main writes tail).
+ */
+uint8_t SCHED_RunSlot(void) {
+    uint32_t t_start = DWT_GetCycles();
+    uint8_t sensor = sched_slot;
+    uint8_t action = 0;
+    if (sched_data_ready) {
+        SysTick->VAL = 0; // Restart the backstop period
+    }
+    if (sched_presence.enabled) {
+        action = SCHED_PresenceAction(&sensor);
+        if (action == SCHED_CTL_IDLE) {
+            return SCHED_NextSlot();
+        }
+        if (action == SCHED_CTL_PARK && sched_open[sensor]) {
+            SCHED_Handoff(sensor);
+        }
+    }
+    SCHED_SensorStats *st = &sched_stats[sensor];
+    uint8_t lent = (sensor != sched_slot);
+
+    if (sched_dma.enabled) {
+        if (sched_dma.busy) {
+            st->overruns++;
+            if (action == SCHED_CTL_POLL) {
+                sched_presence.wait[sensor] = 1; // Poll at the next own slot instead
+            }
+        } else {
+            sched_dma.busy = 1;
+            sched_dma.sensor = sensor;
+            sched_dma.lent = lent;
+            DEADLINE_Begin(DEADLINE_ACQ);
+            DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_SELECT);
+            if (action) {
+                sched_ctl.action = action;
+                sched_ctl.step = 0;
+                sched_ctl.count = (action == SCHED_CTL_PARK)
+                                ? MAX30101_PrepareProximity(1, sched_data_ready, sched_ctl.seq) : 0;
+                I2C1_WriteAsync(PCA9548_ADDR, (uint8_t)(1U << sensor), SCHED_DmaControl);
+            } else {
+                I2C1_WriteAsync(PCA9548_ADDR, (uint8_t)(1U << sensor), SCHED_DmaSelected);
+            }
+            sched_dma.cpu_cycles = DWT_GetCycles() - t_start;
+        }
+        return SCHED_NextSlot();
+    }
+
+    DEADLINE_Begin(DEADLINE_ACQ);
+    if (action) {
+        uint32_t bus_ns = SCHED_ControlBlocking(sensor, action);
+        if (bus_ns > st->bus_max_ns) st->bus_max_ns = bus_ns;
+    } else {
+        MAX30101_FIFOStatus fifo = {0};
+        uint8_t *dst = NULL;
+        uint32_t bus_ns = I2C1_WRITE_COST_NS(1);
+        DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_SELECT);
+        PCA9548_SelectChannel(sensor);
+        uint8_t available = SCHED_Predict(sensor);
+        if (available == SCHED_PREDICT_READ) {
+            DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_STATUS);
+            uint32_t t_status = DWT_GetCycles();
+            available = MAX30101_ReadFIFOStatus(&fifo);
+            uint32_t status_cycles = DWT_GetCycles() - t_status;
+            SCHED_Verify(sensor, available, fifo.ovf_counter, status_cycles);
+            SCHED_TrackPhase(sensor, available, fifo.ovf_counter, status_cycles);
+            bus_ns += I2C1_READ_COST_NS(3);
+        }
+        uint8_t batch = SCHED_Plan(sensor, available, fifo.ovf_counter, lent, &dst);
+        if (batch) {
+            DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_BURST);
+            MAX30101_ReadFIFOBurst((MAX30101_Sample *)dst, batch);
+            bus_ns += I2C1_READ_COST_NS(batch * MAX30101_SAMPLE_BYTES);
+        }
+        DEADLINE_SetStage(DEADLINE_ACQ, DEADLINE_STAGE_COMMIT);
+        SCHED_Commit(sensor, batch, bus_ns);
+    }
+
+    uint8_t period_end = SCHED_NextSlot();
+    DEADLINE_End(DEADLINE_ACQ);
+    uint32_t cycles = DWT_GetCycles() - t_start;
+    if (cycles > st->isr_max_cycles) st->isr_max_cycles = cycles;
+    return period_end;
+}
+
+/**
+ * @brief Move the FIFO reads to the asynchronous I2C/DMA chain
+ * @return void
+ */
+void SCHED_EnableDMA(void) {
+    sched_dma.busy = 0;
+    sched_dma.enabled = 1;
+}
+
+/**
+ * @brief Totals over all sensors since SCHED_Init()
+ * @param samples - [out] Samples read from the FIFOs
+ * @param overruns - [out] Slots skipped because the previous DMA chain was still running
+ * @return void
+ */
+void SCHED_GetTotals(uint32_t *samples, uint32_t *overruns) {
+    uint32_t s = 0, o = 0;
+    for (uint8_t i = 0; i < sched_num_sensors; i++) {
+        s += sched_stats[i].samples;
+        o += sched_stats[i].overruns;
+    }
+    *samples = s;
+    *overruns = o;
+}
+
+/**
+ * @brief Take the oldest completed RAW frame (main-loop side)
+ * @return Frame (ownership passes to the caller), or NULL if none is ready
+ */
+POOL_Frame *SCHED_PopFrame(void) {
+    uint16_t tail = sched_tail;
+    if (tail == sched_head) {
+        return NULL;
+    }
+    POOL_Frame *frame = sched_queue[tail];
+    sched_tail = (tail + 1) & (SCHED_QUEUE_SIZE - 1);
+    return frame;
+}
+
+/**
+ * @brief Check and clear the statistics-report request
+ * @return 1 if a report is due, 0 otherwise
+ */
+uint8_t SCHED_ReportDue(void) {
+    if (sched_report_due) {
+        sched_report_due = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Format one sensor's statistics as a CSV report line
+ * @details The statistics are copied with interrupts masked so the line is consistent
+ *          with a single point in time.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param sensor - Sensor index
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatReport(char *buffer, uint32_t size, uint8_t sensor) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    SCHED_SensorStats st = sched_stats[sensor];
+    __set_PRIMASK(primask);
+
+    uint32_t jitter = (st.drains > 2) ? st.interval_max_cycles - st.interval_min_cycles : 0;
+    return snprintf(buffer, size, "#SCHED,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+                    sensor,
+                    (unsigned long)st.drains,
+                    (unsigned long)st.samples,
+                    (unsigned long)st.deferrals,
+                    (unsigned long)st.overflows,
+                    (unsigned long)st.starved,
+                    (unsigned long)DWT_CyclesToUs(st.isr_max_cycles),
+                    (unsigned long)DWT_CyclesToUs(jitter),
+                    (unsigned long)(st.bus_max_ns / 1000U),
+                    (unsigned long)(sched_budget_ns / 1000U));
+}
+
+/**
+ * @brief Number of sensors configured with SCHED_Init()
+ * @return Sensor count
+ */
+uint8_t SCHED_GetNumSensors(void) {
+    return sched_num_sensors;
+}
+
+/**
+ * @brief Format the presence state of one sensor as a CSV report line
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param sensor - Sensor index
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatPresenceReport(char *buffer, uint32_t size, uint8_t sensor) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    SCHED_SensorStats st = sched_stats[sensor];
+    uint8_t present = (sched_presence.present >> sensor) & 1U;
+    __set_PRIMASK(primask);
+
+    return snprintf(buffer, size, "#PRESENCE,%u,%u,%lu,%lu,%lu,%lu,%lu\r\n",
+                    sensor, present,
+                    (unsigned long)st.parks,
+                    (unsigned long)st.admits,
+                    (unsigned long)st.polls,
+                    (unsigned long)st.skipped,
+                    (unsigned long)st.borrowed);
+}
+
+/**
+ * @brief Format the predictive-drain state of one sensor as a CSV report line
+ * @details Drift is the learned rate against the nominal ODR (0 until learned); the
+ *          saved bus time is the predicted slots × the measured status read time.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param sensor - Sensor index
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatPredictReport(char *buffer, uint32_t size, uint8_t sensor) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    SCHED_SensorStats st = sched_stats[sensor];
+    uint32_t rate = sched_predict.rate[sensor];
+    uint8_t learned = (sched_predict.learned >> sensor) & 1U;
+    __set_PRIMASK(primask);
+
+    int32_t drift_ppm = 0;
+    if (learned && sched_predict.period_us) {
+        uint32_t nominal = (uint32_t)((1ULL << 32) / sched_predict.period_us);
+        drift_ppm = (int32_t)(((int64_t)rate - (int64_t)nominal) * 1000000 / (int64_t)nominal);
+    }
+    uint32_t status_us = DWT_CyclesToUs(st.status_cycles);
+    return snprintf(buffer, size, "#PREDICT,%u,%lu,%lu,%lu,%lu,%lu,%ld,%lu,%lu\r\n",
+                    sensor,
+                    (unsigned long)st.predicted,
+                    (unsigned long)st.verified,
+                    (unsigned long)st.ahead,
+                    (unsigned long)st.behind,
+                    (unsigned long)st.unsafe,
+                    (long)drift_ppm,
+                    (unsigned long)status_us,
+                    (unsigned long)((uint64_t)st.predicted * st.status_cycles / (SystemCoreClock / 1000000U)));
+}
+
+/**
+ * @brief Format the adaptive polling state as a CSV report line
+ * @details Batch and overflow figures cover all sensors since the previous call.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatAdaptiveReport(char *buffer, uint32_t size) {
+    uint32_t drains = 0, samples = 0, overflows = 0;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t k = 0; k < sched_num_sensors; k++) {
+        drains += sched_stats[k].drains;
+        samples += sched_stats[k].samples;
+        overflows += sched_stats[k].overflows;
+    }
+    uint32_t period = sched_period_us;
+    uint32_t min_us = sched_adapt.min_us;
+    uint32_t max_us = sched_adapt.max_us;
+    uint32_t fill_q8 = sched_adapt.fill_q8;
+    sched_adapt.min_us = sched_adapt.max_us = period;
+    __set_PRIMASK(primask);
+
+    uint32_t d = drains - sched_adapt.drains;
+    uint32_t batch_x100 = d ? (samples - sched_adapt.samples) * 100U / d : 0;
+    uint32_t lost = overflows - sched_adapt.overflows;
+    sched_adapt.drains = drains;
+    sched_adapt.samples = samples;
+    sched_adapt.overflows = overflows;
+    return snprintf(buffer, size, "#ADAPT,%lu,%lu,%lu,%u,%lu.%02lu,%lu.%02lu,%lu\r\n",
+                    (unsigned long)period,
+                    (unsigned long)min_us,
+                    (unsigned long)max_us,
+                    sched_adapt.target,
+                    (unsigned long)(fill_q8 >> 8), (unsigned long)((fill_q8 & 0xFFU) * 100U / 256U),
+                    (unsigned long)(batch_x100 / 100U), (unsigned long)(batch_x100 % 100U),
+                    (unsigned long)lost);
+}
+
+/**
+ * @brief Format the tracked phase of one sensor against sensor 0 as a CSV report line
+ * @details Sample i of sensor 0 lines up with sample i + lag of this sensor, which
+ *          arrives phase_us later (|phase_us| ≤ half a sample period), at the newest
+ *          sample seen of sensor 0. The uncertainty is the sum of the two bracket
+ *          half-widths. All 0 for sensor 0 and before both are tracked.
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param sensor - Sensor index (0 to num_sensors-1)
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatPhaseReport(char *buffer, uint32_t size, uint8_t sensor) {
+    int32_t lag = 0;
+    int32_t phase_us = 0;
+    uint32_t width_us = 0;
+    int32_t drift_ppm = 0;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint8_t both = (uint8_t)((1U << sensor) | 1U);
+    if ((sched_phase.valid & both) == both) {
+        uint32_t index = sched_phase.ref_index[0];
+        uint32_t t0 = SCHED_PhaseTime(0, index);
+        int32_t offset_us = (int32_t)(SCHED_PhaseTime(sensor, index) - t0);
+        int64_t period_q16 = sched_phase.period_q16[sensor];
+        int64_t offset_q16 = (int64_t)offset_us * 65536;
+        lag = -(int32_t)((offset_q16 + ((offset_q16 >= 0) ? period_q16 / 2 : -period_q16 / 2)) / period_q16);
+        phase_us = (int32_t)(SCHED_PhaseTime(sensor, index + (uint32_t)lag) - t0);
+        width_us = (sched_phase.width_us[sensor] + sched_phase.width_us[0]) / 2U;
+    }
+    if (sched_phase.nominal_q16) {
+        drift_ppm = (int32_t)(((int64_t)sched_phase.period_q16[sensor] - (int64_t)sched_phase.nominal_q16) * 1000000
+                              / (int64_t)sched_phase.nominal_q16);
+    }
+    uint32_t slips = sched_phase.slips[sensor];
+    __set_PRIMASK(primask);
+    return snprintf(buffer, size, "#PHASE,%u,%ld,%ld,%lu,%ld,%lu\r\n",
+                    sensor,
+                    (long)lag,
+                    (long)phase_us,
+                    (unsigned long)width_us,
+                    (long)drift_ppm,
+                    (unsigned long)slips);
+}
@@ -0,0 +1,433 @@
+/**
+ * @file SCHED.h
+ * @brief Phase-staggered multi-sensor acquisition scheduler
+ * @details Splits each acquisition period (1 / SYSTICK_FREQ_HZ) into one time slot per
+ *          MAX30101 sensor. SysTick fires once per slot and SCHED_RunSlot() drains only the
+ *          sensor that owns that slot, so sensor k is always read at phase k / N of the period
+ *          instead of every sensor being drained back to back at the same tick instant.
+ *
+ * ### Slot Layout (example: 4 sensors at 50 Hz)
+ *  ```
+ *  |<------------------------ 20 ms period ------------------------>|
+ *  | slot 0: CH0   | slot 1: CH1   | slot 2: CH2   | slot 3: CH3   |
+ *  |<--- 5 ms ---->|
+ *  ```
+ *
+ * ### Bus Budget
+ *  - Each slot may occupy I2C1 for at most SCHED_BUS_BUDGET_PCT % of the slot length
+ *  - Cost model (I2C.h): channel select + FIFO status read + burst read of 6 bytes/sample
+ *  - Samples beyond the budget stay in the sensor FIFO and are drained in the next slot
+ *    of the same sensor; each slot that leaves a backlog counts once as a "deferral"
+ *
+ * ### Reported Statistics (per sensor)
+ *  - Worst-case slot ISR length (DWT cycles, reported in µs)
+ *  - Sample-age jitter: spread (max − min) of the interval between consecutive drains of
+ *    the same sensor. A sample waits in the FIFO for at most one drain interval, so this
+ *    spread bounds the variation of sample age at read-out.
+ *  - Estimated worst-case bus occupancy of the slot vs. its budget
+ *
+ * ### Frame Handoff (zero copy)
+ *  Each sensor owns one open POOL_Frame. Bursts are read by I2C straight into its RAW
+ *  payload (STREAM_RAW_SAMPLES_OFFSET), consecutive drains appending to the same frame.
+ *  The frame is handed to the main loop by pointer once it holds SCHED_HANDOFF_SAMPLES
+ *  samples or is full, or before a FIFO overflow gap so every frame holds consecutive
+ *  samples. If the pool is empty the slot is skipped (counted as "starved") and the
+ *  samples wait in the sensor FIFO.
+ *
+ * ### Sample Timestamps
+ *  The first sample of a frame gets drain time − (samples queued behind it) ×
+ *  MAX30101_GetSamplePeriodUs(); sample i of the frame is first_time + i × period.
+ *  Without the sensor INT line the arrival phase of the newest sample within its period
+ *  is unknown, so timestamps carry up to one sample period of constant-phase uncertainty.
+ *  With phase tracking (SCHED_SyncStart()) the first sample gets its tracked arrival
+ *  time instead.
+ *
+ * ### DMA Mode (SCHED_EnableDMA)
+ *  The slot ISR only starts the channel select; status read and burst are chained from
+ *  the I2C1 interrupt and the FIFO bytes are moved by DMA1 Channel 3 straight into the
+ *  open frame. Per slot the CPU runs a few short interrupts instead of polling the bus
+ *  for the whole transfer (worst-case ISR length then sums the chain's CPU time only).
+ *
+ * ### Data-Ready Mode (SCHED_EnableDataReady)
+ *  With a single sensor whose INT pin is wired to PA1, the sensor's PPG_RDY interrupt
+ *  triggers the slot as soon as a sample enters the FIFO (EXTI1 pends SysTick). SysTick
+ *  keeps running at twice the slot length as a backstop for a missed edge.
+ *
+ * ### Presence Gating (SCHED_EnablePresence)
+ *  A probe off the skin is detected from its DC level: when the IR current of the newest
+ *  sample of every drain stays below min_na for hold_ms, the sensor is parked at its next
+ *  slot. Its open frame is handed off, and it is put in proximity mode (MAX30101.h): only
+ *  the IR LED runs, at the pilot current, and the FIFO stays empty. From then on its slot
+ *  costs no bus time except one poll of INTR_STATUS1 every poll_ms. Its other slots are
+ *  lent to a present sensor whose last drain left samples in its FIFO because of the bus
+ *  budget ("borrowed"), and the sensor produces no frames, so downstream stages and the
+ *  link only carry the present sensors. When the reflected pilot light exceeds prox_na
+ *  the sensor raises PROX_INT and restarts its conversions by itself. The next poll
+ *  re-admits it: PROX_INT_EN is cleared, the FIFO is emptied, and the samples not taken
+ *  while parked are skipped in its index sequence (±1 sample, as in SCHED_Resume()).
+ *  Reattachment to first drain is bounded by poll_ms + one sample period + one
+ *  acquisition period. The main loop learns of it through SCHED_TakeAdmitted().
+ *
+ * ### Predictive Drain (SCHED_EnablePrediction)
+ *  The FIFO fills at the ODR, so the status read of most slots can be replaced by a
+ *  model: per sensor a bracket [lower, upper) of the unread samples (Q16) is advanced
+ *  by the elapsed TIM2 time × the sample rate and reduced by every burst. A predicted
+ *  slot burst-reads ⌊lower − 1/8⌋ samples straight from FIFO_DATAREG, which keeps the
+ *  read behind WR_PTR when a sample is about to land. The pointers are still read
+ *  (verification):
+ *  - on every slot until the rate has been learned and after any disagreement, then
+ *    with a gap that doubles per agreeing verification up to verify_every slots,
+ *  - after an overflow, SCHED_Resume(), a re-admission, a failed burst or when the
+ *    bracket nears a full FIFO.
+ *  The true fill lies in [available, available + 1): an overlapping bracket is narrowed
+ *  to it (the arrival phase is pinned down over successive reads), otherwise it counts
+ *  "ahead" or "behind" ("unsafe" when a predicted burst would have read past WR_PTR)
+ *  and restarts from the read. The rate starts at the nominal ODR and is re-measured
+ *  from samples produced over the time since an anchor (restarted every ~18 min) once
+ *  SCHED_PREDICT_LEARN samples have been seen, so the drift of the sensor oscillator
+ *  against the MCU crystal is tracked to a few ppm; the bracket widens by 1/256 of
+ *  each advance for the remaining uncertainty. The status read time of the
+ *  verifications is measured with DWT; the bus time saved is that times the predicted
+ *  slots. Off in data-ready mode (the INT line already says when to read).
+ *
+ * ### Synchronised Start (SCHED_SyncStart)
+ *  Sensors configured one after another start sampling at unrelated instants. When
+ *  they are configured in shutdown (MAX30101_MODE_SHDN), SCHED_SyncStart() enables all
+ *  PCA9548 channels at once and broadcasts the FIFO pointer reset and the MODE_CONFIG
+ *  write that leaves shutdown, so every sensor starts at the same STOP condition and
+ *  sample index k of all sensors is taken in the same sample period. The internal
+ *  oscillators then drift apart, so the phase is tracked per sensor from every status
+ *  read: the newest sample had landed by the end of the read and the next one not
+ *  before its start, which brackets its arrival within one sample period. The bracket is carried forward by the learned sample period,
+ *  intersected with each new read and narrows to the status read time as the reads
+ *  fall at different points of the sample period. Frames are time-stamped from the
+ *  bracket, so samples of different sensors line up on the device time axis, and
+ *  the sample lag and sub-sample phase of each sensor against sensor 0 are reported.
+ *
+ * ### Adaptive Polling (SCHED_EnableAdaptive)
+ *  Without the INT line the period can follow the FIFO instead of a fixed rate: the
+ *  slots are pended by a TIM2 CH2 output compare (SysTick's counter stays off), and at
+ *  the end of every period the highest fill found at a drain is smoothed and the period
+ *  scaled by 2·target / (fill + target), so each drain finds about target_fill samples.
+ *  An overflow halves the period at once. The period stays within [floor_us,
+ *  ceiling_us]: the ceiling bounds the sample-to-host latency, the floor the bus load.
+ *  The bus budget, burst limit and report interval follow every retune; deadlines are
+ *  set for the floor (SCHED_GetShortestPeriodUs()). Off in data-ready mode.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-02
+ * @version 1.6
+ * @note Requires DWT_Init(), TIMER_Init(), I2C1_Config() and PCA9548_Init() before SCHED_Start().
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdint.h>
+#include "MAX30101.h"
+#include "POOL.h"
+
+#define SCHED_MAX_SENSORS       8   /**< PCA9548 downstream channels */
+#define SCHED_QUEUE_SIZE        32  /**< ISR → main frame queue depth (power of two, ≥ POOL_BLOCKS) */
+#define SCHED_HANDOFF_SAMPLES   BUFFERBLOCKSIZE /**< Samples per RAW frame before it is handed to the main loop */
+#define SCHED_BUS_BUDGET_PCT    60  /**< Max share of a slot that I2C traffic may occupy (%) */
+#define SCHED_REPORT_PERIODS    250 /**< Acquisition periods between statistics reports at the SCHED_Init() rate (5 s at 50 Hz) */
+#define SCHED_DRDY_IRQ_PRIORITY 1   /**< EXTI1 (sensor INT, data-ready mode): only pends SysTick */
+#define SCHED_PREDICT_MARGIN    0x2000U /**< Predicted bursts stop this far (Q16 samples, 1/8) below the lower bound of the fill */
+#define SCHED_PREDICT_LEARN     256 /**< Samples since the anchor before the measured rate replaces the nominal one */
+#define SCHED_ADAPT_MAX_FILL    16  /**< Highest adaptive target fill (samples): half the FIFO, one drain fits a RAW frame */
+
+/**
+ * @struct SCHED_SensorStats
+ * @brief Per-sensor scheduling statistics
+ */
+typedef struct {
+    uint32_t drains;             /**< Slots executed for this sensor */
+    uint32_t samples;            /**< Samples read from the FIFO */
+    uint32_t deferrals;          /**< Slots that left samples in the FIFO (bus budget, RAW frame room or no pool frame) */
+    uint32_t overflows;          /**< Samples lost in the sensor FIFO (OVF_COUNTER sum) */
+    uint32_t starved;            /**< Slots skipped because no pool frame was free */
+    uint32_t overruns;           /**< Slots skipped because the previous DMA chain was still running */
+    uint32_t isr_max_cycles;     /**< Worst-case slot ISR length (CPU cycles) */
+    uint32_t interval_min_cycles;/**< Shortest interval between two drains (CPU cycles) */
+    uint32_t interval_max_cycles;/**< Longest interval between two drains (CPU cycles) */
+    uint32_t bus_max_ns;         /**< Worst-case estimated bus occupancy of the slot (ns) */
+    uint32_t last_drain_cycles;  /**< DWT timestamp of the previous drain */
+    uint32_t parks;              /**< Times parked in proximity mode (probe off the skin) */
+    uint32_t admits;             /**< Times re-admitted after PROX_INT */
+    uint32_t polls;              /**< INTR_STATUS1 polls while parked */
+    uint32_t skipped;            /**< Samples not taken while parked (index gap) */
+    uint32_t borrowed;           /**< Drains in slots lent by parked sensors */
+    uint32_t predicted;          /**< Drains without a FIFO status read (predictive drain) */
+    uint32_t verified;           /**< Status reads checked against the fill model */
+    uint32_t ahead;              /**< Verifications with the lower bound at or above available + 1 */
+    uint32_t behind;             /**< Verifications with the upper bound at or below available */
+    uint32_t unsafe;             /**< Verifications where a predicted burst would have read past WR_PTR */
+    uint32_t status_cycles;      /**< Measured FIFO status read (CPU cycles, running average) */
+} SCHED_SensorStats;
+
+/**
+ * @struct SCHED_PresenceConfig
+ * @brief Presence gating parameters (SCHED_EnablePresence)
+ */
+typedef struct {
+    float32_t min_na;            /**< IR current below which the probe is off the skin (nA, at the drive LED current) */
+    uint32_t hold_ms;            /**< Time below min_na before the sensor is parked (ms) */
+    uint32_t poll_ms;            /**< Interval between PROX_INT polls of a parked sensor (ms) */
+    float32_t pilot_ma;          /**< IR LED current in proximity mode (mA) */
+    float32_t prox_na;           /**< IR current at pilot_ma that wakes the sensor (nA, 16 nA steps) */
+} SCHED_PresenceConfig;
+
+/**
+ * @struct SCHED_AdaptiveConfig
+ * @brief Adaptive polling parameters (SCHED_EnableAdaptive)
+ */
+typedef struct {
+    uint8_t target_fill;         /**< Samples each drain should find (1–SCHED_ADAPT_MAX_FILL) */
+    uint32_t floor_us;           /**< Shortest acquisition period (µs) */
+    uint32_t ceiling_us;         /**< Longest acquisition period, the latency ceiling (µs) */
+} SCHED_AdaptiveConfig;
+
+/**
+ * @brief Configure the slot table
+ * @param num_sensors - Number of sensors on PCA9548 CH0..CH(num_sensors-1) (1–8)
+ * @param period_hz - Acquisition period rate per sensor (e.g., 50 Hz)
+ * @return void
+ */
+void SCHED_Init(uint8_t num_sensors, uint32_t period_hz);
+
+/**
+ * @brief Change the acquisition period and the RAW frame handoff size
+ * @details The bus budget and burst limit follow the new slot length; the report
+ *          interval stays the same in time. The slot is limited to the 24-bit SysTick
+ *          range (262 ms at 64 MHz). With adaptive polling the period is the start
+ *          value, clamped to the floor and ceiling.
+ * @param period_us - Acquisition period per sensor (µs)
+ * @param handoff - Samples per RAW frame before handoff (1–STREAM_RAW_CAPACITY)
+ * @return Applied period (µs)
+ * @note Main-loop context while stopped (before SCHED_Start() or after SCHED_Stop()).
+ */
+uint32_t SCHED_Configure(uint32_t period_us, uint8_t handoff);
+
+/**
+ * @brief Acquisition period per sensor
+ * @return Period (µs), the current one with adaptive polling
+ */
+uint32_t SCHED_GetPeriodUs(void);
+
+/**
+ * @brief Shortest acquisition period the slots may run at (deadline setting)
+ * @return Adaptive floor (µs), or the configured period
+ */
+uint32_t SCHED_GetShortestPeriodUs(void);
+
+/**
+ * @brief Hand the first frame of every sensor to the main loop after its first drain
+ * @details Boot fast start: the first samples go out without waiting for the handoff
+ *          size; later frames follow SCHED_Configure().
+ * @return void
+ * @note Main-loop context while stopped.
+ */
+void SCHED_HandoffFirst(void);
+
+/**
+ * @brief Trigger slots from the sensor INT line (PA1, PPG_RDY) instead of the period
+ * @param enable - 1 = INT-triggered slots with a SysTick backstop, 0 = periodic slots
+ * @return 1 if applied, 0 if more than one sensor is configured
+ * @note Main-loop context while stopped.
+ */
+uint8_t SCHED_EnableDataReady(uint8_t enable);
+
+/**
+ * @brief EXTI1 interrupt body (data-ready mode): pend the slot
+ * @return void
+ * @note Called from EXTI1_IRQHandler().
+ */
+void SCHED_DataReadyIrq(void);
+
+/**
+ * @brief Park sensors whose probe is off the skin and re-admit them on PROX_INT
+ * @details Writes the pilot current and wake-up threshold to every sensor (blocking) and
+ *          arms the DC-level detector. All sensors start present.
+ * @param cfg - [in] Gating parameters (copied)
+ * @return void
+ * @note Main-loop context before SCHED_Start(), after the sensors are configured.
+ */
+void SCHED_EnablePresence(const SCHED_PresenceConfig *cfg);
+
+/**
+ * @brief Replace most FIFO status reads by a fill prediction from elapsed time and ODR
+ * @param verify_every - Longest run of predicted slots between two status reads
+ *                       (1–255, 0 = off)
+ * @return void
+ * @note Main-loop context before SCHED_Start(). No effect in data-ready mode.
+ */
+void SCHED_EnablePrediction(uint8_t verify_every);
+
+/**
+ * @brief Retune the period from the FIFO fill found at each drain
+ * @param cfg - [in] Target fill, floor and ceiling (copied; the target is limited to
+ *              SCHED_ADAPT_MAX_FILL)
+ * @return void
+ * @note Main-loop context before SCHED_Start(). No effect in data-ready mode.
+ */
+void SCHED_EnableAdaptive(const SCHED_AdaptiveConfig *cfg);
+
+/**
+ * @brief TIM2 interrupt body (adaptive polling): pend the slot, schedule the next
+ * @return void
+ * @note Called from TIM2_IRQHandler() (shared with the deadline monitor).
+ */
+void SCHED_TimerIrq(void);
+
+/**
+ * @brief Release all sensors from shutdown at once and start phase tracking
+ * @details Broadcast through every PCA9548 channel: FIFO pointer reset, then
+ *          MODE_CONFIG without SHDN. Sample indices restart at 0.
+ * @return void
+ * @note Main-loop context before SCHED_Start(), with every sensor configured in
+ *       shutdown (MAX30101_SetShutdown(), BOOT_StartSensors() hold).
+ */
+void SCHED_SyncStart(void);
+
+/**
+ * @brief Sensors currently drained
+ * @return Bit per present sensor (all configured sensors without presence gating)
+ */
+uint8_t SCHED_GetPresent(void);
+
+/**
+ * @brief Take the sensors re-admitted since the last call (main-loop side)
+ * @details Their next frames follow an index gap and may come from a different spot on
+ *          the skin, e.g. a reason to restart a baseline.
+ * @return Bit per re-admitted sensor
+ */
+uint8_t SCHED_TakeAdmitted(void);
+
+/**
+ * @brief Start SysTick at the slot rate (period_hz × num_sensors)
+ * @return void
+ * @warning Arms the acquisition ISR immediately; call last during initialization.
+ */
+void SCHED_Start(void);
+
+/**
+ * @brief Stop the slots and hand the open frames to the main loop
+ * @return void
+ * @note Main-loop context. Waits for an asynchronous chain in flight.
+ */
+void SCHED_Stop(void);
+
+/**
+ * @brief Empty the FIFOs, account the samples missed while stopped and restart SysTick
+ * @return void
+ */
+void SCHED_Resume(void);
+
+/**
+ * @brief Execute the current slot: drain the owning sensor within the bus budget
+ * @details Called from SysTick_Handler. Selects the PCA9548 channel, reads the FIFO
+ *          pointers in one transaction (or predicts the count, SCHED_EnablePrediction())
+ *          and burst-reads up to the budgeted number of samples into the sensor's open
+ *          frame.
+ * @return 1 when this slot closed an acquisition period (slot 0 is next), 0 otherwise
+ */
+uint8_t SCHED_RunSlot(void);
+
+/**
+ * @brief Move the FIFO reads to the asynchronous I2C/DMA chain
+ * @return void
+ * @note Requires I2C1_DMA_Config(); call before SCHED_Start().
+ */
+void SCHED_EnableDMA(void);
+
+/**
+ * @brief Totals over all sensors since SCHED_Init()
+ * @param samples - [out] Samples read from the FIFOs
+ * @param overruns - [out] Slots skipped because the previous DMA chain was still running
+ * @return void
+ */
+void SCHED_GetTotals(uint32_t *samples, uint32_t *overruns);
+
+/**
+ * @brief Take the oldest completed RAW frame (main-loop side)
+ * @details The frame holds frame->count consecutive samples of frame->sensor as 3-byte
+ *          FIFO words at data[STREAM_RAW_SAMPLES_OFFSET]; sample i has index
+ *          first_index + i and time first_time + i × MAX30101_GetSamplePeriodUs().
+ *          Ownership passes to the caller (transmit with STREAM_SendRaw() or POOL_Free()).
+ * @return Frame, or NULL if none is ready
+ */
+POOL_Frame *SCHED_PopFrame(void);
+
+/**
+ * @brief Check and clear the statistics-report request
+ * @return 1 once every SCHED_REPORT_PERIODS acquisition periods, 0 otherwise
+ */
+uint8_t SCHED_ReportDue(void);
+
+/**
+ * @brief Format the statistics of one sensor as a CSV report line
+ * @details Format: `#SCHED,<sensor>,<drains>,<samples>,<deferrals>,<overflows>,<starved>,
+ *          <isr_max_us>,<jitter_us>,<bus_max_us>,<bus_budget_us>\r\n`
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param sensor - Sensor index (0 to num_sensors-1)
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatReport(char *buffer, uint32_t size, uint8_t sensor);
+
+/**
+ * @brief Format the presence state of one sensor as a CSV report line
+ * @details Format: `#PRESENCE,<sensor>,<present>,<parks>,<admits>,<polls>,<skipped>,
+ *          <borrowed>\r\n`
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param sensor - Sensor index (0 to num_sensors-1)
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatPresenceReport(char *buffer, uint32_t size, uint8_t sensor);
+
+/**
+ * @brief Format the predictive-drain state of one sensor as a CSV report line
+ * @details Format: `#PREDICT,<sensor>,<predicted>,<verified>,<ahead>,<behind>,<unsafe>,
+ *          <drift_ppm>,<status_us>,<saved_us>\r\n` (drift of the learned sample rate from
+ *          the nominal ODR, measured status read time, bus time saved since SCHED_Init())
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param sensor - Sensor index (0 to num_sensors-1)
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatPredictReport(char *buffer, uint32_t size, uint8_t sensor);
+
+/**
+ * @brief Format the adaptive polling state as a CSV report line
+ * @details Format: `#ADAPT,<period_us>,<min_us>,<max_us>,<target>,<fill>,<avg_batch>,
+ *          <overflows>\r\n` (current period and its range, smoothed peak fill, samples
+ *          per drain and FIFO overflows of all sensors since the previous report)
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatAdaptiveReport(char *buffer, uint32_t size);
+
+/**
+ * @brief Format the tracked phase of one sensor as a CSV report line
+ * @details Format: `#PHASE,<sensor>,<lag>,<phase_us>,<uncertainty_us>,<drift_ppm>,
+ *          <slips>\r\n`: sample i of sensor 0 lines up with sample i + lag of this
+ *          sensor, which arrives phase_us later (within half a sample period); the
+ *          half-widths of both brackets; drift of the learned sample period from the
+ *          nominal one; brackets restarted from a status read since SCHED_SyncStart()
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param sensor - Sensor index (0 to num_sensors-1)
+ * @return Number of characters written (excluding terminator)
+ */
+int SCHED_FormatPhaseReport(char *buffer, uint32_t size, uint8_t sensor);
+
+/**
+ * @brief Number of sensors configured with SCHED_Init()
+ * @return Sensor count (1–8)
+ */
+uint8_t SCHED_GetNumSensors(void);
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,656 @@
+/**
+ * @file STAGES.c
+ * @brief Pipeline stages of the NIRS processing chain
+ * @author Julio Fajardo, PhD
+ * @date 2026-07-07
+ * @version 1.0
+ */
+
+#include "STAGES.h"
+#include "MAX30101.h"
+#include "NIRS.h"
+#include "SCHED.h"
+#include "STREAM.h"
+#include "UART.h"
+#include <math.h>
+#include <stdio.h>
+
+/**
+ * @brief Acquire: unpack the 3-byte FIFO words of the frame into currents (nA)
+ * @details The words are read where the I2C burst left them in the RAW payload.
+ */
+void STAGE_Unpack(void *state, PIPE_Block *block, const void *config) {
+    MAX30101_Sample *words = (MAX30101_Sample *)&block->frame->data[STREAM_RAW_SAMPLES_OFFSET];
+    for (uint8_t i = 0; i < block->count; i++) {
+        MAX30101_DataSample raw;
+        MAX30101_ConvertSampleToUint32(&words[i], &raw);
+        MAX30101_ConvertUint32ToCurrent(&raw, &block->current[i]);
+    }
+}
+
+/** First link of skip-list node s: 2s − popcount(s) (node j has 1 + ctz(j + 1) levels) */
+static const uint8_t stage_hampel_link[STAGE_HAMPEL_MAX_WINDOW + 1] = {
+    0, 1, 3, 4, 7, 8, 10, 11, 15, 16, 18, 19, 22, 23, 25, 26,
+    31, 32, 34, 35, 38, 39, 41, 42, 46, 47, 49, 50, 53, 54, 56, 57,
+    63, 64, 66, 67, 70, 71, 73, 74, 78, 79, 81, 82, 85, 86, 88, 89,
+    94, 95, 97, 98, 101, 102, 104, 105, 109, 110, 112, 113, 116, 117, 119, 120
+};
+
+/**
+ * @brief Skip list of one channel inside a STAGE_HampelState
+ */
+typedef struct {
+    float32_t *value;           /**< Sample of each slot */
+    uint8_t *next;              /**< Links, stage_hampel_link[node] + level */
+    uint8_t *span;              /**< Spans of levels ≥ 1, stage_hampel_link[node] − node + level − 1 */
+    uint8_t head;               /**< Head node (= window) */
+    uint8_t levels;             /**< Levels of the head */
+} STAGE_SkipList;
+
+static inline uint8_t STAGE_SkipLevels(uint8_t node) {
+    uint32_t x = node + 1U;
+    return (uint8_t)(32U - __CLZ(x & (0U - x)));   // 1 + ctz(node + 1)
+}
+
+static inline uint8_t *STAGE_SkipSpan(const STAGE_SkipList *l, uint8_t node, uint8_t level) {
+    return &l->span[stage_hampel_link[node] - node + level - 1U];
+}
+
+/** Nodes travelled by following level `level` of `node` */
+static inline uint8_t STAGE_SkipStep(const STAGE_SkipList *l, uint8_t node, uint8_t level) {
+    return level ? *STAGE_SkipSpan(l, node, level) : 1U;
+}
+
+/** (value, slot) order: equal samples are ordered by slot, so every node has a unique key */
+static inline uint8_t STAGE_SkipBefore(const STAGE_SkipList *l, uint8_t node, float32_t v, uint8_t slot) {
+    float32_t x = l->value[node];
+    return x < v || (x == v && node < slot);
+}
+
+static void STAGE_SkipBind(STAGE_SkipList *l, STAGE_HampelState *st, uint8_t channel) {
+    uint8_t w = st->window;
+    uint8_t *base = (uint8_t *)(st + 1) + channel * STAGE_HAMPEL_CHANNEL_BYTES(w);
+    l->value = (float32_t *)base;
+    l->next = base + 4U * w;
+    l->span = l->next + stage_hampel_link[w] + st->levels;
+    l->head = w;
+    l->levels = st->levels;
+}
+
+/**
+ * @brief Link slot `slot`, holding value v, into the list
+ * @details chain[i] is the last node before the key on level i and rank[i] its
+ *          position; the new node at position rank[0] + 1 splits the spans it falls into.
+ */
+static void STAGE_SkipInsert(const STAGE_SkipList *l, uint8_t slot, float32_t v) {
+    uint8_t chain[STAGE_HAMPEL_LEVELS];
+    uint8_t rank[STAGE_HAMPEL_LEVELS];
+    uint8_t node = l->head, pos = 0;
+    for (int8_t i = (int8_t)l->levels - 1; i >= 0; i--) {
+        uint8_t nx;
+        while ((nx = l->next[stage_hampel_link[node] + i]) != STAGE_HAMPEL_NIL
+               && STAGE_SkipBefore(l, nx, v, slot)) {
+            pos += STAGE_SkipStep(l, node, (uint8_t)i);
+            node = nx;
+        }
+        chain[i] = node;
+        rank[i] = pos;
+    }
+    l->value[slot] = v;
+    uint8_t k = STAGE_SkipLevels(slot);
+    for (uint8_t i = 0; i < l->levels; i++) {
+        uint8_t *link = &l->next[stage_hampel_link[chain[i]] + i];
+        if (i < k) {
+            l->next[stage_hampel_link[slot] + i] = *link;
+            *link = slot;
+            if (i) {
+                uint8_t *span = STAGE_SkipSpan(l, chain[i], i);
+                *STAGE_SkipSpan(l, slot, i) = (uint8_t)(*span - (rank[0] - rank[i]));
+                *span = (uint8_t)(rank[0] - rank[i] + 1U);
+            }
+        } else {
+            (*STAGE_SkipSpan(l, chain[i], i))++;
+        }
+    }
+}
+
+/**
+ * @brief Unlink slot `slot` (its value still in place) from the list
+ */
+static void STAGE_SkipRemove(const STAGE_SkipList *l, uint8_t slot) {
+    float32_t v = l->value[slot];
+    uint8_t k = STAGE_SkipLevels(slot);
+    uint8_t node = l->head;
+    for (int8_t i = (int8_t)l->levels - 1; i >= 0; i--) {
+        uint8_t nx;
+        while ((nx = l->next[stage_hampel_link[node] + i]) != STAGE_HAMPEL_NIL
+               && STAGE_SkipBefore(l, nx, v, slot)) {
+            node = nx;
+        }
+        if (i < k) {
+            l->next[stage_hampel_link[node] + i] = l->next[stage_hampel_link[slot] + i];
+            if (i) {
+                *STAGE_SkipSpan(l, node, (uint8_t)i) += (uint8_t)(*STAGE_SkipSpan(l, slot, (uint8_t)i) - 1U);
+            }
+        } else {
+            (*STAGE_SkipSpan(l, node, (uint8_t)i))--;
+        }
+    }
+}
+
+/**
+ * @brief Value of rank r (1 = smallest)
+ */
+static float32_t STAGE_SkipSelect(const STAGE_SkipList *l, uint8_t r) {
+    uint8_t node = l->head, pos = 0;
+    for (int8_t i = (int8_t)l->levels - 1; i >= 0; i--) {
+        uint8_t nx;
+        while ((nx = l->next[stage_hampel_link[node] + i]) != STAGE_HAMPEL_NIL
+               && pos + STAGE_SkipStep(l, node, (uint8_t)i) <= r) {
+            pos += STAGE_SkipStep(l, node, (uint8_t)i);
+            node = nx;
+        }
+    }
+    return l->value[node];
+}
+
+/**
+ * @brief Number of samples below v (or_equal = 0) or not above v (or_equal = 1)
+ */
+static uint8_t STAGE_SkipCount(const STAGE_SkipList *l, float32_t v, uint8_t or_equal) {
+    uint8_t node = l->head, pos = 0;
+    for (int8_t i = (int8_t)l->levels - 1; i >= 0; i--) {
+        uint8_t nx;
+        while ((nx = l->next[stage_hampel_link[node] + i]) != STAGE_HAMPEL_NIL
+               && (l->value[nx] < v || (or_equal && l->value[nx] == v))) {
+            pos += STAGE_SkipStep(l, node, (uint8_t)i);
+            node = nx;
+        }
+    }
+    return pos;
+}
+
+/**
+ * @brief Empty both skip lists of one sensor
+ */
+void STAGE_HampelInit(void *state, uint8_t sensor, const void *config) {
+    STAGE_HampelState *st = state;
+    const STAGE_HampelConfig *cfg = config;
+    st->window = cfg->window;
+    st->levels = (uint8_t)(32U - __CLZ(cfg->window));
+    st->fill = 0;
+    st->oldest = 0;
+    for (uint8_t c = 0; c < 2; c++) {
+        STAGE_SkipList l;
+        STAGE_SkipBind(&l, st, c);
+        for (uint8_t i = 0; i < l.levels; i++) {
+            l.next[stage_hampel_link[l.head] + i] = STAGE_HAMPEL_NIL;
+            if (i) {
+                *STAGE_SkipSpan(&l, l.head, i) = 1;   // to the end of an empty list
+            }
+        }
+    }
+}
+
+/**
+ * @brief Condition: Hampel spike removal on the unfiltered currents, in place
+ * @details Per sample and channel: the oldest sample leaves the window, the new one
+ *          enters, and once the window is full the new sample is tested against the
+ *          median m. With D = |x − m| / (1.4826 · threshold), the sample is an outlier
+ *          when the MAD is below D, i.e. when at least (window + 1) / 2 samples lie in
+ *          (m − D, m + D). The window keeps the original samples, not the replacements.
+ */
+void STAGE_Hampel(void *state, PIPE_Block *block, const void *config) {
+    STAGE_HampelState *st = state;
+    const STAGE_HampelConfig *cfg = config;
+    STAGE_SkipList lists[2];
+    uint8_t half = (uint8_t)((st->window + 1U) / 2U);
+    float32_t scale = (cfg->threshold > 0.0f) ? 1.0f / (1.4826f * cfg->threshold) : 0.0f;
+
+    STAGE_SkipBind(&lists[0], st, 0);
+    STAGE_SkipBind(&lists[1], st, 1);
+    for (uint8_t i = 0; i < block->count; i++) {
+        float32_t *x[2] = { &block->current[i].red, &block->current[i].ir };
+        uint8_t slot = st->oldest;
+        uint8_t full = st->fill == st->window;
+        for (uint8_t c = 0; c < 2; c++) {
+            const STAGE_SkipList *l = &lists[c];
+            if (full) {
+                STAGE_SkipRemove(l, slot);
+            }
+            STAGE_SkipInsert(l, slot, *x[c]);
+        }
+        st->oldest = (uint8_t)(slot + 1U == st->window ? 0U : slot + 1U);
+        if (!full) {
+            if (++st->fill < st->window) {
+                continue;
+            }
+        }
+        for (uint8_t c = 0; c < 2; c++) {
+            const STAGE_SkipList *l = &lists[c];
+            float32_t median = STAGE_SkipSelect(l, half);
+            float32_t dev = fabsf(*x[c] - median);
+            if (!(dev > cfg->min_dev)) {
+                continue;
+            }
+            if (scale > 0.0f) {
+                float32_t d = dev * scale;
+                uint8_t within = (uint8_t)(STAGE_SkipCount(l, median + d, 0) - STAGE_SkipCount(l, median - d, 1));
+                if (within < half) {
+                    continue;
+                }
+            }
+            *x[c] = median;
+        }
+    }
+}
+
+/**
+ * @brief Bind the CMSIS-DSP instances of one sensor to its state buffers
+ */
+void STAGE_BiquadInit(void *state, uint8_t sensor, const void *config) {
+    STAGE_BiquadState *st = state;
+    const STAGE_BiquadConfig *cfg = config;
+    arm_biquad_cascade_df2T_init_f32(&st->red, cfg->num_sections, cfg->coeffs, st->state_red);
+    arm_biquad_cascade_df2T_init_f32(&st->ir, cfg->num_sections, cfg->coeffs, st->state_ir);
+    st->warm = 0;
+}
+
+/**
+ * @brief Steady state of a df2T cascade for a constant input x
+ * @details Per section (feedback coefficients negated as in CMSIS-DSP):
+ *          y = x·(b0 + b1 + b2) / (1 − a1 − a2), d2 = b2·x + a2·y, d1 = b1·x + a1·y + d2;
+ *          y is the input of the next section.
+ */
+static void STAGE_BiquadSteady(const float32_t *coeffs, uint8_t sections, float32_t *state, float32_t x) {
+    for (uint8_t s = 0; s < sections; s++, coeffs += 5, state += 2) {
+        float32_t y = x * (coeffs[0] + coeffs[1] + coeffs[2]) / (1.0f - coeffs[3] - coeffs[4]);
+        state[1] = coeffs[2] * x + coeffs[4] * y;
+        state[0] = coeffs[1] * x + coeffs[3] * y + state[1];
+        x = y;
+    }
+}
+
+/**
+ * @brief Condition: biquad cascade high-pass over the whole block
+ * @details Red and IR are de-interleaved into contiguous buffers so each channel is
+ *          filtered by one arm_biquad_cascade_df2T_f32() call per block instead of one
+ *          call per sample. The first sample of a sensor only warms the filter up, or
+ *          sets its steady state and is filtered too (STAGE_WARMUP_STEADY).
+ */
+void STAGE_Biquad(void *state, PIPE_Block *block, const void *config) {
+    STAGE_BiquadState *st = state;
+    const STAGE_BiquadConfig *cfg = config;
+    float32_t red[PIPE_BLOCK_SAMPLES];
+    float32_t ir[PIPE_BLOCK_SAMPLES];
+    uint8_t first = 0;
+
+    if (!st->warm) {
+        float32_t dummy;
+        float32_t x_red = block->current[0].red;
+        float32_t x_ir = block->current[0].ir;
+        if (cfg->warmup == STAGE_WARMUP_STEADY) {
+            STAGE_BiquadSteady(cfg->coeffs, cfg->num_sections, st->state_red, x_red);
+            STAGE_BiquadSteady(cfg->coeffs, cfg->num_sections, st->state_ir, x_ir);
+        } else {
+            for (uint16_t i = 0; i < cfg->warmup; i++) {
+                arm_biquad_cascade_df2T_f32(&st->red, &x_red, &dummy, 1);
+                arm_biquad_cascade_df2T_f32(&st->ir, &x_ir, &dummy, 1);
+            }
+            first = 1;
+        }
+        st->warm = 1;
+    }
+    block->filtered_from = first;
+    uint8_t n = block->count - first;
+    if (n == 0) {
+        return;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        red[i] = block->current[first + i].red;
+        ir[i] = block->current[first + i].ir;
+    }
+    arm_biquad_cascade_df2T_f32(&st->red, red, red, n);
+    arm_biquad_cascade_df2T_f32(&st->ir, ir, ir, n);
+    for (uint8_t i = 0; i < n; i++) {
+        block->filtered[first + i].red = red[i];
+        block->filtered[first + i].ir = ir[i];
+    }
+}
+
+/**
+ * @brief Condition: first-order DC blocker (MAX30101_FirstOrderDC_Blocker)
+ * @details Steady state for a constant input x (STAGE_WARMUP_STEADY): w = x / (1 − α).
+ */
+void STAGE_DCBlocker(void *state, PIPE_Block *block, const void *config) {
+    STAGE_DCBlockerState *st = state;
+    const STAGE_DCBlockerConfig *cfg = config;
+    uint8_t first = 0;
+
+    if (!st->warm) {
+        if (cfg->warmup == STAGE_WARMUP_STEADY) {
+            st->w_red = block->current[0].red / (1.0f - cfg->alpha);
+            st->w_ir = block->current[0].ir / (1.0f - cfg->alpha);
+        } else {
+            for (uint16_t i = 0; i < cfg->warmup; i++) {
+                (void)MAX30101_FirstOrderDC_Blocker(block->current[0].red, &st->w_red, cfg->alpha);
+                (void)MAX30101_FirstOrderDC_Blocker(block->current[0].ir, &st->w_ir, cfg->alpha);
+            }
+            first = 1;
+        }
+        st->warm = 1;
+    }
+    block->filtered_from = first;
+    for (uint8_t i = first; i < block->count; i++) {
+        block->filtered[i].red = MAX30101_FirstOrderDC_Blocker(block->current[i].red, &st->w_red, cfg->alpha);
+        block->filtered[i].ir = MAX30101_FirstOrderDC_Blocker(block->current[i].ir, &st->w_ir, cfg->alpha);
+    }
+}
+
+/**
+ * @brief Feature: ΔHbO2/ΔHHb from the unfiltered currents (NIRS.c)
+ */
+void STAGE_DeltaHb(void *state, PIPE_Block *block, const void *config) {
+    for (uint8_t i = 0; i < block->count; i++) {
+        if (NIRS_ComputeDeltaHb(block->sensor, &block->current[i], &block->hb[i])) {
+            block->hb_valid |= 1U << i;
+        }
+    }
+}
+
+/**
+ * @brief Feature: ΔHbO2/ΔHHb by the Kalman estimator (NIRS_KalmanUpdate())
+ * @details The baseline sample itself yields no ΔOD; the estimate starts (x = 0) with
+ *          the first ΔOD after it.
+ */
+void STAGE_DeltaHbKalman(void *state, PIPE_Block *block, const void *config) {
+    STAGE_HbKalmanState *st = state;
+    const NIRS_KalmanModel *model = config;
+    for (uint8_t i = 0; i < block->count; i++) {
+        float32_t od[NIRS_WAVELENGTHS];
+        if (!NIRS_ComputeDeltaOD(block->sensor, &block->current[i], od)) {
+            continue;
+        }
+        if (!st->started) {
+            NIRS_KalmanStart(model, &st->filter);
+            st->started = 1;
+        }
+        NIRS_KalmanUpdate(model, &st->filter, od, &block->hb[i]);
+        block->hb_valid |= 1U << i;
+    }
+}
+
+/**
+ * @brief Start a channel's statistics at its first sample
+ */
+static inline void STAGE_WelfordStart(STAGE_Welford *w, float32_t x) {
+    w->origin = x;
+    w->mean = 0.0f;
+    w->m2 = 0.0f;
+    w->min = x;
+    w->max = x;
+}
+
+/**
+ * @brief Add one sample to a channel's statistics
+ * @param w - [in,out] Statistics
+ * @param x - Sample
+ * @param inv_n - 1 / (samples including x)
+ */
+static inline void STAGE_WelfordAdd(STAGE_Welford *w, float32_t x, float32_t inv_n) {
+    float32_t u = x - w->origin;
+    float32_t d = u - w->mean;
+    w->mean += d * inv_n;
+    w->m2 += d * (u - w->mean);
+    if (x < w->min) w->min = x;
+    if (x > w->max) w->max = x;
+}
+
+/**
+ * @brief Final statistics of one channel over n samples
+ */
+static void STAGE_WelfordFinish(const STAGE_Welford *w, uint16_t n, STREAM_ChannelSummary *out) {
+    float32_t mean = w->origin + w->mean;
+    float32_t var = (n > 1U) ? w->m2 / (float32_t)(n - 1U) : 0.0f;
+    float32_t ms = mean * mean + w->m2 / (float32_t)n;
+    arm_sqrt_f32(var, &out->std);
+    arm_sqrt_f32(ms, &out->rms);
+    out->mean = mean;
+    out->min = w->min;
+    out->max = w->max;
+}
+
+/**
+ * @brief Feature: windowed Red/IR statistics of the unfiltered currents
+ * @details Welford's update on samples shifted by the window's first one keeps the
+ *          variance accurate in single precision although the currents carry a large DC
+ *          level (a sum of squares would cancel). The frame is dated at the last sample
+ *          of the window.
+ */
+void STAGE_Summary(void *state, PIPE_Block *block, const void *config) {
+    STAGE_SummaryState *st = state;
+    const STAGE_SummaryConfig *cfg = config;
+    uint16_t window = cfg->window;
+
+    if (window == 0) {
+        st->count = 0;
+        return;
+    }
+    for (uint8_t i = 0; i < block->count; i++) {
+        const MAX30101_CurrentSample *x = &block->current[i];
+        if (st->count == 0) {
+            st->first_index = block->first_index + i;
+            STAGE_WelfordStart(&st->red, x->red);
+            STAGE_WelfordStart(&st->ir, x->ir);
+        }
+        st->count++;
+        float32_t inv_n = 1.0f / (float32_t)st->count;
+        STAGE_WelfordAdd(&st->red, x->red, inv_n);
+        STAGE_WelfordAdd(&st->ir, x->ir, inv_n);
+        if (st->count >= window) {
+            STREAM_ChannelSummary stats[2];
+            STAGE_WelfordFinish(&st->red, st->count, &stats[0]);
+            STAGE_WelfordFinish(&st->ir, st->count, &stats[1]);
+            STREAM_PutSummary(block->sensor, st->first_index, st->count,
+                              block->first_time + i * block->period_us, stats);
+            st->count = 0;
+        }
+    }
+}
+
+/** Fit of the interval being collected, shared by all sensors (STAGE_TSI) */
+static struct {
+    NIRS_TsiFit fit;
+    uint32_t interval;          /**< Interval of the fit */
+    uint32_t end;               /**< Its end (TIM2 µs); the first sample seen sets the grid */
+    uint8_t expected;           /**< Sensors with a distance */
+    uint8_t seen;               /**< Sensors that closed the interval */
+    uint8_t mask;               /**< Sensors in the fit (seen, with positive currents) */
+    uint8_t started;            /**< 1 once the grid is set */
+} stage_tsi PIPE_CCM;
+
+/**
+ * @brief Per-sensor init of STAGE_TSI: sensor 0 clears the shared fit, every sensor
+ *        with a distance joins it
+ */
+void STAGE_TsiInit(void *state, uint8_t sensor, const void *config) {
+    const STAGE_TsiConfig *cfg = config;
+    if (sensor == 0) {
+        stage_tsi.expected = 0;
+        stage_tsi.seen = 0;
+        stage_tsi.mask = 0;
+        stage_tsi.started = 0;
+        NIRS_TsiReset(&stage_tsi.fit);
+    }
+    if (cfg->distance_mm[sensor] > 0.0f) {
+        stage_tsi.expected |= (uint8_t)(1U << sensor);
+    }
+}
+
+/**
+ * @brief Solve and send the shared fit, then start an empty one
+ */
+static void STAGE_TsiSend(void) {
+    if (stage_tsi.mask) {
+        NIRS_TsiResult result = {0};
+        uint8_t valid = NIRS_TsiSolve(&stage_tsi.fit, &result);
+        STREAM_PutTsi(stage_tsi.interval, stage_tsi.mask, valid, &result, stage_tsi.end);
+    }
+    NIRS_TsiReset(&stage_tsi.fit);
+    stage_tsi.seen = 0;
+    stage_tsi.mask = 0;
+}
+
+/**
+ * @brief Add the mean currents of one sensor's finished interval to the shared fit
+ * @details An interval newer than the shared one sends the shared fit as it is (a
+ *          sensor more than one interval behind is left out of it); an older one is
+ *          dropped. The fit is sent as soon as every expected sensor has closed it,
+ *          parked sensors (SCHED_GetPresent()) excepted.
+ */
+static void STAGE_TsiClose(STAGE_TsiState *st, uint8_t sensor, const STAGE_TsiConfig *cfg) {
+    int32_t ahead = (int32_t)(st->interval - stage_tsi.interval);
+    if (st->count && ahead >= 0) {
+        if (ahead > 0) {
+            STAGE_TsiSend();
+            stage_tsi.interval = st->interval;
+            stage_tsi.end = st->end;
+        }
+        float32_t inv_n = 1.0f / (float32_t)st->count;
+        const MAX30101_CurrentSample mean = { st->sum.red * inv_n, st->sum.ir * inv_n };
+        if (NIRS_TsiAdd(&stage_tsi.fit, cfg->distance_mm[sensor], &mean)) {
+            stage_tsi.mask |= (uint8_t)(1U << sensor);
+        }
+        stage_tsi.seen |= (uint8_t)(1U << sensor);
+        if (!(stage_tsi.expected & SCHED_GetPresent() & (uint8_t)~stage_tsi.seen)) {
+            STAGE_TsiSend();
+            stage_tsi.interval++;
+            stage_tsi.end += cfg->period_us;
+        }
+    }
+    st->sum.red = 0.0f;
+    st->sum.ir = 0.0f;
+    st->count = 0;
+}
+
+/**
+ * @brief Feature: multi-distance tissue saturation index (TSI frames)
+ * @details Samples are binned into intervals of config->period_us by acquisition time,
+ *          on one grid for all sensors, so the means that meet in a fit cover the same
+ *          time span whatever the frame order. Per sample: one time comparison and two
+ *          additions; per sensor and interval: two log10f() (NIRS_TsiAdd()); per interval:
+ *          one NIRS_TsiSolve() and one frame, in the block of the last sensor to close it.
+ */
+void STAGE_Tsi(void *state, PIPE_Block *block, const void *config) {
+    STAGE_TsiState *st = state;
+    const STAGE_TsiConfig *cfg = config;
+    uint32_t period = cfg->period_us;
+
+    if (period == 0 || !(stage_tsi.expected & (1U << block->sensor))) {
+        return;
+    }
+    for (uint8_t i = 0; i < block->count; i++) {
+        uint32_t t = block->first_time + i * block->period_us;
+        if (!stage_tsi.started) {
+            stage_tsi.end = t + period;
+            stage_tsi.interval = 0;
+            stage_tsi.started = 1;
+        }
+        if (!st->started) {
+            // Join the grid at the interval holding t (possibly before the shared one)
+            int32_t d = (int32_t)(t - stage_tsi.end);
+            uint32_t back = (d < 0) ? (uint32_t)(-(d + 1)) / period : 0U;
+            st->end = stage_tsi.end - back * period;
+            st->interval = stage_tsi.interval - back;
+            st->started = 1;
+        }
+        if ((int32_t)(t - st->end) >= 0) {
+            STAGE_TsiClose(st, block->sensor, cfg);
+            uint32_t skip = (t - st->end) / period + 1U;
+            st->end += skip * period;
+            st->interval += skip;
+        }
+        st->sum.red += block->current[i].red;
+        st->sum.ir += block->current[i].ir;
+        st->count++;
+    }
+}
+
+/**
+ * @brief Encode: change-driven filtered values (DEADBAND frames)
+ * @details One frame per block that has updates, based at the block's first sample.
+ *          The comparison is against the value the host holds, so the error never
+ *          accumulates across updates.
+ */
+void STAGE_Deadband(void *state, PIPE_Block *block, const void *config) {
+    static uint8_t tags[2 * PIPE_BLOCK_SAMPLES];
+    static float32_t values[2 * PIPE_BLOCK_SAMPLES];
+    STAGE_DeadbandState *st = state;
+    const STAGE_DeadbandConfig *cfg = config;
+    float32_t threshold = cfg->threshold;
+    uint8_t n = 0;
+
+    if (!(threshold > 0.0f)) {
+        st->primed = 0;
+        return;
+    }
+    for (uint8_t i = block->filtered_from; i < block->count; i++) {
+        uint32_t index = block->first_index + i;
+        const float32_t x[2] = { block->filtered[i].red, block->filtered[i].ir };
+        for (uint8_t c = 0; c < 2; c++) {
+            float32_t d = x[c] - st->sent[c];
+            if (!(st->primed & (1U << c)) || d > threshold || d < -threshold
+                || (cfg->max_silence && index - st->sent_index[c] >= cfg->max_silence)) {
+                st->sent[c] = x[c];
+                st->sent_index[c] = index;
+                st->primed |= (uint8_t)(1U << c);
+                tags[n] = (uint8_t)(i | (c ? STREAM_DEADBAND_IR : 0U));
+                values[n++] = x[c];
+            }
+        }
+    }
+    if (n) {
+        STREAM_PutDeadband(block->sensor, block->first_index, block->first_time, n, tags, values);
+    }
+}
+
+/**
+ * @brief Encode: FILTERED and HB frames (decimated inside STREAM)
+ */
+void STAGE_EncodeFrames(void *state, PIPE_Block *block, const void *config) {
+    for (uint8_t i = 0; i < block->count; i++) {
+        uint32_t index = block->first_index + i;
+        uint32_t timestamp = block->first_time + i * block->period_us;
+        if (block->hb_valid & (1U << i)) {
+            STREAM_PutHb(block->sensor, index, timestamp, &block->hb[i]);
+        }
+        if (i >= block->filtered_from) {
+            STREAM_PutFiltered(block->sensor, index, timestamp, &block->filtered[i]);
+        }
+    }
+}
+
+/**
+ * @brief Encode: legacy CSV lines "<red>,<ir>" or "<sensor>,<red>,<ir>" (blocking UART)
+ */
+void STAGE_EncodeCsv(void *state, PIPE_Block *block, const void *config) {
+    const STAGE_CsvConfig *cfg = config;
+    char line[48];
+    for (uint8_t i = block->filtered_from; i < block->count; i++) {
+        if (cfg && cfg->with_sensor) {
+            snprintf(line, sizeof(line), "%u,%.4f,%.4f\r\n", block->sensor, block->filtered[i].red, block->filtered[i].ir);
+        } else {
+            snprintf(line, sizeof(line), "%.4f,%.4f\r\n", block->filtered[i].red, block->filtered[i].ir);
+        }
+        USART2_putString(line);
+    }
+}
+
+/**
+ * @brief Transmit: hand the RAW frame to the output multiplexer unchanged
+ * @details Ownership moves to STREAM; the frame returns to the pool after UART DMA.
+ */
+void STAGE_TransmitRaw(void *state, PIPE_Block *block, const void *config) {
+    STREAM_SendRaw(block->frame);
+    PIPE_ReleaseFrame(block);
+}
@@ -0,0 +1,290 @@
+/**
+ * @file STAGES.h
+ * @brief Pipeline stages of the NIRS processing chain (see PIPE.h)
+ * @details Each stage is a PIPE_Stage initializer; parameters come from a const config
+ *          structure defined next to the pipeline table.
+ *
+ *  | Stage | Role | Reads | Writes | State |
+ *  |-------|------|-------|--------|-------|
+ *  | STAGE_UNPACK | acquire | frame FIFO words | current | – |
+ *  | STAGE_HAMPEL | condition | current | current (spikes replaced) | STAGE_HampelState |
+ *  | STAGE_BIQUAD_HP | condition | current | filtered | STAGE_BiquadState |
+ *  | STAGE_DC_BLOCKER | condition | current | filtered | STAGE_DCBlockerState |
+ *  | STAGE_DELTA_HB | feature | current | hb, hb_valid | – (NIRS.c baselines) |
+ *  | STAGE_DELTA_HB_KALMAN | feature | current | hb, hb_valid | STAGE_HbKalmanState |
+ *  | STAGE_SUMMARY | feature | current | SUMMARY frames | STAGE_SummaryState |
+ *  | STAGE_TSI | feature | current | TSI frames | STAGE_TsiState (+ one shared fit) |
+ *  | STAGE_DEADBAND | encode | filtered | DEADBAND frames | STAGE_DeadbandState |
+ *  | STAGE_ENCODE_FRAMES | encode | filtered, hb | FILTERED/HB frames | – |
+ *  | STAGE_ENCODE_CSV | encode | filtered | CSV lines (USART2) | – |
+ *  | STAGE_TRANSMIT_RAW | transmit | frame | RAW frame (UART DMA) | – |
+ *
+ *  Conditioning stages warm their filter up on the first sample of each sensor
+ *  (config->warmup iterations) and leave that sample out of the filtered output
+ *  (block->filtered_from = 1), as the main loop did before the pipeline. With warmup
+ *  STAGE_WARMUP_STEADY the state is instead set to the steady state of a constant input
+ *  equal to the first sample (exact limit of an unbounded warm-up, O(sections)), and
+ *  that sample is output as well (boot fast start).
+ *
+ *  STAGE_HAMPEL replaces single-sample spikes in the unfiltered currents before the
+ *  high-pass, which would otherwise ring for seconds at a 0.04 Hz edge. The newest sample
+ *  of each channel is compared with the median of the last config->window samples
+ *  (itself included): if it is further than config->threshold × 1.4826 × MAD (median
+ *  absolute deviation, ≈ σ for Gaussian noise) and than config->min_dev, it is replaced
+ *  by the median. The window is causal, so no latency is added; a genuine step is held
+ *  at the old median for about window / 2 samples. The first window − 1 samples of a
+ *  sensor pass unchanged. A threshold of 0 makes the stage a running median.
+ *
+ *  The window of each channel is kept sorted in an indexable skip list: the window
+ *  slots are the nodes (ring order), node s has 1 + ctz(s + 1) levels (the perfect
+ *  skip-list pattern along the ring, no random numbers) and the links carry their span
+ *  in nodes. Removing the oldest sample, inserting the newest, the median (select by
+ *  rank) and the MAD test are each O(log window). The MAD itself is never formed:
+ *  MAD < D exactly when at least (window + 1) / 2 samples lie strictly within
+ *  median ± D, which is two rank queries. Equal values are ordered by slot, so the
+ *  removal always finds its own node. Memory is static, about 14 bytes per window
+ *  sample and sensor (STAGE_HAMPEL_STATE_BYTES()).
+ *
+ *  STAGE_DELTA_HB_KALMAN replaces STAGE_DELTA_HB with the Kalman estimator of NIRS.h:
+ *  the ΔOD of each sample updates a per-sensor random-walk estimate of ΔHbO2/ΔHHb
+ *  instead of being inverted on its own. The estimate starts at the sensor's baseline.
+ *
+ *  STAGE_SUMMARY keeps running statistics of the unfiltered Red and IR currents of each
+ *  sensor (Welford's update for mean and variance, min, max; RMS from mean² + variance)
+ *  and sends one SUMMARY frame per config->window samples. The update runs on the
+ *  samples minus the first one of the window, so the float32 mean keeps resolving the
+ *  per-sample steps of long windows on a large DC level (std within ~1e-6 of a
+ *  double-precision two-pass reference up to 65535 samples). The update is O(1) per
+ *  sample with one division shared by both channels and no sample history, so the
+ *  window length costs no memory. A window of 0 turns the stage off (the partial window
+ *  is discarded); changing it takes effect in the window being accumulated.
+ *
+ *  STAGE_TSI combines all sensors: each is a detector at config->distance_mm[sensor]
+ *  and its mean Red and IR currents over an interval of config->period_us go into one
+ *  shared least-squares fit of attenuation over distance (NIRS_TsiAdd()), solved for
+ *  the tissue saturation index when the last sensor has closed the interval
+ *  (NIRS_TsiSolve(), one TSI frame). The intervals are a grid in acquisition time
+ *  (TIM2 µs) started by the first sample, so frames of different sensors that arrive
+ *  out of order still meet in the right fit; a sensor that falls more than one
+ *  interval behind is left out of the earlier fit instead of stalling it, and a sensor
+ *  parked by presence gating (SCHED.h) is not waited for. Memory is
+ *  constant: 24 bytes per sensor plus one 52-byte fit, whatever the interval length
+ *  and sensor count. Sensors with a distance of 0 are not part of the fit.
+ *
+ *  STAGE_DEADBAND sends a filtered Red or IR value only when it differs from the last
+ *  value sent on that channel by more than config->threshold, or when config->max_silence
+ *  samples have passed since then (keep-alive, also bounds the recovery from a dropped
+ *  frame). Holding each sent value until the channel's next update reconstructs every
+ *  sample within ±threshold. A threshold of 0 turns the stage off; the first sample
+ *  after it is turned on is always sent.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-07-07
+ * @version 1.0
+ */
+
+#ifndef STAGES_H_
+#define STAGES_H_
+
+#include <stdint.h>
+#include "arm_math.h"
+#include "PIPE.h"
+
+#define STAGE_BIQUAD_MAX_SECTIONS   4   /**< Largest cascade supported by STAGE_BIQUAD_HP */
+#define STAGE_WARMUP_STEADY     0xFFFFU /**< warmup: start at the steady state of the first sample */
+#define STAGE_HAMPEL_MIN_WINDOW     5   /**< Shortest STAGE_HAMPEL window */
+#define STAGE_HAMPEL_MAX_WINDOW     63  /**< Longest STAGE_HAMPEL window (6 skip-list levels) */
+#define STAGE_HAMPEL_LEVELS         6   /**< Skip-list levels of the longest window */
+#define STAGE_HAMPEL_NIL            0xFFU /**< End of a skip-list level */
+
+/** Skip-list bytes of one channel: window × (value, level-0 link) + upper links and spans (bound) */
+#define STAGE_HAMPEL_CHANNEL_BYTES(w)   ((7U * (w) + 2U * STAGE_HAMPEL_LEVELS + 3U) & ~3U)
+/** Per-sensor state of STAGE_HAMPEL for a window of w samples (header + Red + IR) */
+#define STAGE_HAMPEL_STATE_BYTES(w)     (sizeof(STAGE_HampelState) + 2U * STAGE_HAMPEL_CHANNEL_BYTES(w))
+
+/**
+ * @struct STAGE_BiquadConfig
+ * @brief Parameters of STAGE_BIQUAD_HP
+ */
+typedef struct {
+    const float32_t *coeffs;    /**< CMSIS-DSP df2T coefficients, 5 per section */
+    uint8_t num_sections;       /**< Sections (1–STAGE_BIQUAD_MAX_SECTIONS) */
+    uint16_t warmup;            /**< Warm-up iterations on the first sample */
+} STAGE_BiquadConfig;
+
+/**
+ * @struct STAGE_BiquadState
+ * @brief Per-sensor state of STAGE_BIQUAD_HP
+ */
+typedef struct {
+    arm_biquad_cascade_df2T_instance_f32 red;
+    arm_biquad_cascade_df2T_instance_f32 ir;
+    float32_t state_red[2 * STAGE_BIQUAD_MAX_SECTIONS];
+    float32_t state_ir[2 * STAGE_BIQUAD_MAX_SECTIONS];
+    uint8_t warm;               /**< 1 after the warm-up */
+} STAGE_BiquadState;
+
+/**
+ * @struct STAGE_DCBlockerConfig
+ * @brief Parameters of STAGE_DC_BLOCKER
+ */
+typedef struct {
+    float32_t alpha;            /**< Pole of H(z) = (1 − z⁻¹) / (1 − α·z⁻¹) */
+    uint16_t warmup;            /**< Warm-up iterations on the first sample */
+} STAGE_DCBlockerConfig;
+
+/**
+ * @struct STAGE_DCBlockerState
+ * @brief Per-sensor state of STAGE_DC_BLOCKER
+ */
+typedef struct {
+    float32_t w_red;
+    float32_t w_ir;
+    uint8_t warm;
+} STAGE_DCBlockerState;
+
+/**
+ * @struct STAGE_HampelConfig
+ * @brief Parameters of STAGE_HAMPEL (threshold and min_dev may be changed at run time)
+ */
+typedef struct {
+    uint8_t window;             /**< Samples in the window (odd, STAGE_HAMPEL_MIN_WINDOW–STAGE_HAMPEL_MAX_WINDOW) */
+    float32_t threshold;        /**< Outlier limit in scaled MADs (0 = running median) */
+    float32_t min_dev;          /**< Deviations up to this are kept (nA; a flat quantised signal has MAD 0) */
+} STAGE_HampelConfig;
+
+/**
+ * @struct STAGE_HampelState
+ * @brief Per-sensor state header of STAGE_HAMPEL
+ * @details Followed by the skip lists of Red and IR, STAGE_HAMPEL_CHANNEL_BYTES(window)
+ *          each: value[window] (float, ring order), next[] (links, level by level per
+ *          node, head last), span[] (levels ≥ 1; level 0 always spans one node).
+ */
+typedef struct {
+    uint8_t window;             /**< Window of the state (config->window at init) */
+    uint8_t levels;             /**< Levels of the head node */
+    uint8_t fill;               /**< Samples in the window */
+    uint8_t oldest;             /**< Slot of the oldest sample (overwritten next) */
+} STAGE_HampelState;
+
+/**
+ * @struct STAGE_HbKalmanState
+ * @brief Per-sensor state of STAGE_DELTA_HB_KALMAN (config: NIRS_KalmanModel)
+ */
+typedef struct {
+    NIRS_KalmanState filter;
+    uint8_t started;            /**< 1 once the first ΔOD after the baseline has arrived */
+} STAGE_HbKalmanState;
+
+/**
+ * @struct STAGE_SummaryConfig
+ * @brief Parameters of STAGE_SUMMARY (may be changed at run time)
+ */
+typedef struct {
+    uint16_t window;            /**< Samples per summary window (0 = off) */
+} STAGE_SummaryConfig;
+
+/**
+ * @struct STAGE_Welford
+ * @brief Running statistics of one channel
+ */
+typedef struct {
+    float32_t origin;           /**< First sample of the window (the update runs on x − origin) */
+    float32_t mean;             /**< Running mean of x − origin */
+    float32_t m2;               /**< Sum of squared deviations from the mean */
+    float32_t min;
+    float32_t max;
+} STAGE_Welford;
+
+/**
+ * @struct STAGE_SummaryState
+ * @brief Per-sensor state of STAGE_SUMMARY
+ */
+typedef struct {
+    STAGE_Welford red;
+    STAGE_Welford ir;
+    uint32_t first_index;       /**< Index of the first sample of the window */
+    uint16_t count;             /**< Samples in the window so far */
+} STAGE_SummaryState;
+
+/**
+ * @struct STAGE_TsiConfig
+ * @brief Parameters of STAGE_TSI
+ */
+typedef struct {
+    float32_t distance_mm[NIRS_MAX_SENSORS]; /**< Source–detector distance per sensor (mm, 0 = not in the fit) */
+    uint32_t period_us;         /**< Fit interval, one TSI frame each (µs, 0 = off) */
+} STAGE_TsiConfig;
+
+/**
+ * @struct STAGE_TsiState
+ * @brief Per-sensor state of STAGE_TSI
+ */
+typedef struct {
+    MAX30101_CurrentSample sum; /**< Sum of the currents in the interval (nA) */
+    uint32_t end;               /**< End of the interval being summed (TIM2 µs) */
+    uint32_t interval;          /**< Its number on the shared grid */
+    uint16_t count;             /**< Samples summed */
+    uint8_t started;            /**< 1 once the sensor has joined the grid */
+} STAGE_TsiState;
+
+/**
+ * @struct STAGE_DeadbandConfig
+ * @brief Parameters of STAGE_DEADBAND (may be changed at run time)
+ */
+typedef struct {
+    float32_t threshold;        /**< Send when |value − last sent| > threshold (nA, 0 = off) */
+    uint16_t max_silence;       /**< Send at least every max_silence samples (0 = no limit) */
+} STAGE_DeadbandConfig;
+
+/**
+ * @struct STAGE_DeadbandState
+ * @brief Per-sensor state of STAGE_DEADBAND
+ */
+typedef struct {
+    float32_t sent[2];          /**< Last value sent (Red, IR) */
+    uint32_t sent_index[2];     /**< Its sample index */
+    uint8_t primed;             /**< Bit c set once channel c has sent a value */
+} STAGE_DeadbandState;
+
+/**
+ * @struct STAGE_CsvConfig
+ * @brief Parameters of STAGE_ENCODE_CSV
+ */
+typedef struct {
+    uint8_t with_sensor;        /**< 1 = prefix each line with the sensor index */
+} STAGE_CsvConfig;
+
+void STAGE_Unpack(void *state, PIPE_Block *block, const void *config);
+void STAGE_HampelInit(void *state, uint8_t sensor, const void *config);
+void STAGE_Hampel(void *state, PIPE_Block *block, const void *config);
+void STAGE_BiquadInit(void *state, uint8_t sensor, const void *config);
+void STAGE_Biquad(void *state, PIPE_Block *block, const void *config);
+void STAGE_DCBlocker(void *state, PIPE_Block *block, const void *config);
+void STAGE_DeltaHb(void *state, PIPE_Block *block, const void *config);
+void STAGE_DeltaHbKalman(void *state, PIPE_Block *block, const void *config);
+void STAGE_Summary(void *state, PIPE_Block *block, const void *config);
+void STAGE_TsiInit(void *state, uint8_t sensor, const void *config);
+void STAGE_Tsi(void *state, PIPE_Block *block, const void *config);
+void STAGE_Deadband(void *state, PIPE_Block *block, const void *config);
+void STAGE_EncodeFrames(void *state, PIPE_Block *block, const void *config);
+void STAGE_EncodeCsv(void *state, PIPE_Block *block, const void *config);
+void STAGE_TransmitRaw(void *state, PIPE_Block *block, const void *config);
+
+/** @name Stage descriptors (budget = CPU cycles per sample)
+ * @{ */
+#define STAGE_UNPACK(budget)            { "unpack",  NULL, STAGE_Unpack,       NULL, 0, (budget) }
+#define STAGE_HAMPEL(cfg, window, budget) { "hampel", STAGE_HampelInit, STAGE_Hampel, (cfg), STAGE_HAMPEL_STATE_BYTES(window), (budget) }
+#define STAGE_BIQUAD_HP(cfg, budget)    { "biquad",  STAGE_BiquadInit, STAGE_Biquad, (cfg), sizeof(STAGE_BiquadState), (budget) }
+#define STAGE_DC_BLOCKER(cfg, budget)   { "dcblock", NULL, STAGE_DCBlocker,    (cfg), sizeof(STAGE_DCBlockerState), (budget) }
+#define STAGE_DELTA_HB(budget)          { "deltahb", NULL, STAGE_DeltaHb,      NULL, 0, (budget) }
+#define STAGE_DELTA_HB_KALMAN(model, budget) { "hbkalman", NULL, STAGE_DeltaHbKalman, (model), sizeof(STAGE_HbKalmanState), (budget) }
+#define STAGE_SUMMARY(cfg, budget)      { "summary", NULL, STAGE_Summary,      (cfg), sizeof(STAGE_SummaryState), (budget) }
+#define STAGE_TSI(cfg, budget)          { "tsi",     STAGE_TsiInit, STAGE_Tsi, (cfg), sizeof(STAGE_TsiState), (budget) }
+#define STAGE_DEADBAND(cfg, budget)     { "deadband", NULL, STAGE_Deadband,    (cfg), sizeof(STAGE_DeadbandState), (budget) }
+#define STAGE_ENCODE_FRAMES(budget)     { "frames",  NULL, STAGE_EncodeFrames, NULL, 0, (budget) }
+#define STAGE_ENCODE_CSV(cfg, budget)   { "csv",     NULL, STAGE_EncodeCsv,    (cfg), 0, (budget) }
+#define STAGE_TRANSMIT_RAW(budget)      { "rawtx",   NULL, STAGE_TransmitRaw,  NULL, 0, (budget) }
+/** @} */
+
+#endif /* STAGES_H_ */
@@ -0,0 +1,559 @@
+/**
+ * @file STREAM.c
+ * @brief Framed output multiplexer implementation
+ * @details Frame assembly, CRC-16/CCITT-FALSE, per-stream decimation and the
+ *          token-bucket bandwidth scheduler described in STREAM.h.
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-09
+ * @version 1.0
+ */
+
+#include "STREAM.h"
+#include "UART.h"
+#include "DWT.h"
+#include "TIMER.h"
+#include "POOL.h"
+#include "TRACE.h"
+#include "CRC.h"
+#include "stm32f303x8.h"
+#include <stdio.h>
+#include <string.h>
+
+#define STREAM_RAW_FRAME_MAX    (STREAM_HEADER_BYTES + STREAM_RAW_PAYLOAD(STREAM_RAW_BATCH) + STREAM_CRC_BYTES)
+#define STREAM_TX_QUEUE         32      /**< Frames awaiting UART DMA (power of two, > POOL_BLOCKS) */
+
+#if STREAM_TX_QUEUE <= POOL_BLOCKS
+#error "STREAM_TX_QUEUE must hold every pool frame"
+#endif
+
+/**
+ * @struct STREAM_Accumulator
+ * @brief Per-sensor block-mean decimator for two channels
+ */
+typedef struct {
+    float32_t sum_a;     /**< Channel A sum (Red or ΔHbO2) */
+    float32_t sum_b;     /**< Channel B sum (IR or ΔHHb) */
+    uint16_t count;      /**< Samples accumulated in the current block */
+} STREAM_Accumulator;
+
+static STREAM_Counters stream_counters[STREAM_COUNT];
+static uint8_t stream_seq[STREAM_COUNT];
+static STREAM_Accumulator stream_filtered[STREAM_MAX_SENSORS];
+static STREAM_Accumulator stream_hb[STREAM_MAX_SENSORS];
+
+/* Transmit queue: main loop writes head, DMA completion ISR advances tail */
+static POOL_Frame *stream_tx_queue[STREAM_TX_QUEUE];
+static volatile uint8_t stream_tx_head;
+static volatile uint8_t stream_tx_tail;
+static POOL_Frame *volatile stream_tx_active;   /**< Frame on the DMA channel (NULL = idle) */
+static volatile uint32_t stream_tx_start[STREAM_COUNT]; /**< TIM2 time the last frame of each stream started */
+
+static uint16_t stream_decimation[2] = { STREAM_FILTERED_DECIMATION, STREAM_HB_DECIMATION }; /**< FILTERED, HB base */
+static uint8_t stream_full_rate = 1;     /**< 0 = RAW, FILTERED and HB suppressed (summary-only output) */
+static STREAM_TxHook stream_tx_hook;     /**< Called with every frame whose transfer completed */
+
+static uint32_t stream_cycles_per_byte;  /**< CPU cycles per budgeted link byte */
+static uint32_t stream_credit;           /**< Token bucket fill (bytes) */
+static uint32_t stream_last_refill;      /**< DWT timestamp of the last refill */
+
+/**
+ * @brief Map a stream ID to its counter slot (priority order)
+ */
+static uint8_t STREAM_Slot(STREAM_Id id) {
+    switch (id) {
+        case STREAM_RAW:      return 0;
+        case STREAM_FILTERED: return 1;
+        case STREAM_HB:       return 2;
+        case STREAM_SUMMARY:  return 3;
+        case STREAM_DEADBAND: return 4;
+        case STREAM_TSI:      return 5;
+        case STREAM_TRACE:    return 6;
+        case STREAM_EVENT:    return 7;
+        case STREAM_SYNC:     return 8;
+        default:              return 9;
+    }
+}
+
+static inline void STREAM_PutU32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief Add link credit for the time elapsed since the last refill
+ */
+static void STREAM_Refill(void) {
+    uint32_t now = DWT_GetCycles();
+    uint32_t earned = (now - stream_last_refill) / stream_cycles_per_byte;
+    if (earned) {
+        stream_last_refill += earned * stream_cycles_per_byte;
+        stream_credit += earned;
+        if (stream_credit > STREAM_BUCKET_BYTES) {
+            stream_credit = STREAM_BUCKET_BYTES;
+        }
+    }
+}
+
+/**
+ * @brief Start the next queued frame on the DMA channel, or mark the channel idle
+ * @details Runs in the main loop when the channel is idle and in the DMA completion
+ *          interrupt otherwise; the two never overlap because the interrupt only fires
+ *          while a transfer is active.
+ */
+static void STREAM_StartNext(void) {
+    uint8_t tail = stream_tx_tail;
+    if (tail == stream_tx_head) {
+        stream_tx_active = NULL;
+        return;
+    }
+    POOL_Frame *frame = stream_tx_queue[tail];
+    stream_tx_tail = (uint8_t)((tail + 1U) & (STREAM_TX_QUEUE - 1U));
+    stream_tx_active = frame;
+    stream_tx_start[STREAM_Slot((STREAM_Id)frame->data[2])] = TIMER_GetMicros();
+    USART2_SendDMA(frame->data, frame->length);
+}
+
+/**
+ * @brief Admit, frame and queue one pool frame whose payload is already in place
+ * @details Applies the bandwidth policy: RAW, EVENT and SYNC always go out; other
+ *          streams need credit for themselves plus one worst-case RAW frame. Header and
+ *          CRC are written into the frame itself, which then moves by pointer to the
+ *          UART DMA queue and returns to the pool on transfer completion.
+ * @param frame - Frame with the payload at data[STREAM_HEADER_BYTES] (ownership is taken)
+ * @param id - Stream identifier
+ * @param length - Payload length
+ * @param timestamp - Device time written into the header (TIM2 µs)
+ * @return 1 if the frame was queued, 0 if it was dropped (and freed)
+ */
+static uint8_t STREAM_Send(POOL_Frame *frame, STREAM_Id id, uint16_t length, uint32_t timestamp) {
+    uint8_t slot = STREAM_Slot(id);
+    STREAM_Counters *c = &stream_counters[slot];
+    uint16_t total = STREAM_HEADER_BYTES + length + STREAM_CRC_BYTES;
+
+    STREAM_Refill();
+    if (id == STREAM_RAW || id == STREAM_EVENT || id == STREAM_SYNC) {
+        if (stream_credit < total) {
+            c->overruns++;
+        }
+    } else if (stream_credit < (uint32_t)total + STREAM_RAW_FRAME_MAX) {
+        c->dropped++;
+        if (c->level < STREAM_MAX_LEVEL) {
+            c->level++;
+        }
+        POOL_Free(frame);
+        return 0;
+    }
+    stream_credit = (stream_credit > total) ? stream_credit - total : 0;
+
+    uint8_t *f = frame->data;
+    f[0] = STREAM_SYNC0;
+    f[1] = STREAM_SYNC1;
+    f[2] = (uint8_t)id;
+    f[3] = stream_seq[slot]++;
+    f[4] = (uint8_t)length;
+    f[5] = (uint8_t)(length >> 8);
+    STREAM_PutU32(&f[6], timestamp);
+    uint16_t crc = CRC_Ccitt16(CRC_CCITT_INIT, &f[2], (uint16_t)(length + STREAM_HEADER_BYTES - 2));
+    f[STREAM_HEADER_BYTES + length] = (uint8_t)crc;
+    f[STREAM_HEADER_BYTES + length + 1] = (uint8_t)(crc >> 8);
+    frame->length = total;
+
+    uint8_t head = stream_tx_head;
+    stream_tx_queue[head] = frame;
+    stream_tx_head = (uint8_t)((head + 1U) & (STREAM_TX_QUEUE - 1U)); // Publish after the entry is written
+    TRACE_Event(TRACE_UART_QUEUE, ((uint32_t)id << 8) | ((head + 1U - stream_tx_tail) & (STREAM_TX_QUEUE - 1U)));
+    if (stream_tx_active == NULL) {
+        STREAM_StartNext();
+    }
+
+    c->frames++;
+    c->bytes += total;
+    // Relax the extra decimation once the link has spare capacity again
+    if (c->level && stream_credit > STREAM_BUCKET_BYTES / 2) {
+        c->level--;
+    }
+    return 1;
+}
+
+/**
+ * @brief Allocate a frame for a payload encoded by this module
+ * @details Pool exhaustion counts as a drop on the stream.
+ * @param id - Stream identifier
+ * @return Frame, or NULL
+ */
+static POOL_Frame *STREAM_Alloc(STREAM_Id id) {
+    POOL_Frame *frame = POOL_Alloc();
+    if (frame == NULL) {
+        stream_counters[STREAM_Slot(id)].dropped++;
+    }
+    return frame;
+}
+
+/**
+ * @brief DMA1 Channel 7 transfer-complete handler body
+ * @details Returns the transmitted frame to the pool and starts the next one.
+ * @return void
+ */
+void STREAM_TxComplete(void) {
+    DMA1->IFCR = DMA_IFCR_CTCIF7;
+    if (stream_tx_active) {
+        if (stream_tx_hook) {
+            stream_tx_hook(stream_tx_active, TIMER_GetMicros());
+        }
+        POOL_Free(stream_tx_active);
+    }
+    STREAM_StartNext();
+    TRACE_Event(TRACE_UART_DONE, (uint8_t)(stream_tx_head - stream_tx_tail) & (STREAM_TX_QUEUE - 1U));
+}
+
+/**
+ * @brief Install a transfer-complete hook (NULL to remove)
+ * @param hook - Function called from STREAM_TxComplete() before the frame is freed
+ * @return void
+ */
+void STREAM_SetTxHook(STREAM_TxHook hook) {
+    stream_tx_hook = hook;
+}
+
+/**
+ * @brief Change the base decimation of the FILTERED and HB streams
+ * @details Takes effect at the end of the block being accumulated.
+ * @param filtered - FILTERED samples per frame (≥ 1)
+ * @param hb - HB samples per frame (≥ 1)
+ * @return void
+ */
+void STREAM_SetDecimation(uint16_t filtered, uint16_t hb) {
+    stream_decimation[0] = filtered ? filtered : 1U;
+    stream_decimation[1] = hb ? hb : 1U;
+}
+
+/**
+ * @brief Enable or stop the full-rate streams (RAW, FILTERED, HB)
+ * @details While stopped, RAW frames go back to the pool unsent and the FILTERED/HB
+ *          accumulators are left idle; they restart empty when the streams come back.
+ * @param enable - 1 = full-rate streams on, 0 = summary-only output
+ * @return void
+ */
+void STREAM_SetFullRate(uint8_t enable) {
+    if (enable && !stream_full_rate) {
+        memset(stream_filtered, 0, sizeof(stream_filtered));
+        memset(stream_hb, 0, sizeof(stream_hb));
+    }
+    stream_full_rate = enable ? 1U : 0U;
+}
+
+/**
+ * @brief Whether the full-rate streams are on
+ * @return 1 if RAW, FILTERED and HB frames are sent
+ */
+uint8_t STREAM_GetFullRate(void) {
+    return stream_full_rate;
+}
+
+/**
+ * @brief TIM2 time at which the last frame of a stream started transmission
+ * @param id - Stream identifier
+ * @return Device time (µs)
+ */
+uint32_t STREAM_GetTxStart(STREAM_Id id) {
+    return stream_tx_start[STREAM_Slot(id)];
+}
+
+/**
+ * @brief Initialize the multiplexer and the link token bucket
+ * @details Link byte rate = baud / 10 (8N1). The bucket starts full and the transmit
+ *          queue empty.
+ * @param baud_rate - UART baud rate
+ * @return void
+ */
+void STREAM_Init(uint32_t baud_rate) {
+    uint32_t bytes_per_s = (baud_rate / 10U) * STREAM_LINK_HEADROOM_PCT / 100U;
+    stream_cycles_per_byte = SystemCoreClock / bytes_per_s;
+    stream_credit = STREAM_BUCKET_BYTES;
+    stream_last_refill = DWT_GetCycles();
+    memset(stream_counters, 0, sizeof(stream_counters));
+    memset(stream_seq, 0, sizeof(stream_seq));
+    stream_tx_head = stream_tx_tail = 0;
+    stream_tx_active = NULL;
+    memset(stream_filtered, 0, sizeof(stream_filtered));
+    memset(stream_hb, 0, sizeof(stream_hb));
+}
+
+/**
+ * @brief Transmit a RAW frame filled by the acquisition scheduler
+ * @details The samples are already in place as 3-byte big-endian FIFO words; only the
+ *          payload prefix (sensor, first index, count), header and CRC are written.
+ *          In summary-only output the frame is freed instead.
+ * @param frame - RAW frame from SCHED_PopFrame() (ownership is taken)
+ * @return void
+ */
+void STREAM_SendRaw(POOL_Frame *frame) {
+    if (!stream_full_rate) {
+        POOL_Free(frame);
+        return;
+    }
+    uint8_t *p = &frame->data[STREAM_HEADER_BYTES];
+    p[0] = frame->sensor;
+    STREAM_PutU32(&p[1], frame->first_index);
+    p[5] = frame->count;
+    STREAM_Send(frame, STREAM_RAW, (uint16_t)STREAM_RAW_PAYLOAD(frame->count), frame->first_time);
+}
+
+/**
+ * @brief Accumulate one filtered sample; sends the block mean at the decimated rate
+ * @details Block length = base decimation (STREAM_FILTERED_DECIMATION unless changed
+ *          with STREAM_SetDecimation()) × 2^level. The reported index and
+ *          timestamp are those of the last sample in the block.
+ * @param sensor - Sensor index
+ * @param index - Per-sensor sample index
+ * @param timestamp - Estimated acquisition time of the sample (TIM2 µs)
+ * @param filtered - [in] DC-removed currents (nA)
+ * @return void
+ */
+void STREAM_PutFiltered(uint8_t sensor, uint32_t index, uint32_t timestamp, const MAX30101_CurrentSample *filtered) {
+    if (!stream_full_rate) {
+        return;
+    }
+    STREAM_Accumulator *a = &stream_filtered[sensor];
+    a->sum_a += filtered->red;
+    a->sum_b += filtered->ir;
+    uint16_t block = (uint16_t)(stream_decimation[0] << stream_counters[1].level);
+    if (++a->count < block) {
+        return;
+    }
+    float32_t red = a->sum_a / a->count;
+    float32_t ir  = a->sum_b / a->count;
+    *a = (STREAM_Accumulator){0};
+
+    POOL_Frame *frame = STREAM_Alloc(STREAM_FILTERED);
+    if (frame == NULL) {
+        return;
+    }
+    uint8_t *p = &frame->data[STREAM_HEADER_BYTES];
+    p[0] = sensor;
+    STREAM_PutU32(&p[1], index);
+    memcpy(&p[5], &red, 4);
+    memcpy(&p[9], &ir, 4);
+    STREAM_Send(frame, STREAM_FILTERED, 13, timestamp);
+}
+
+/**
+ * @brief Accumulate one ΔHb sample; sends the block mean at the decimated rate
+ * @details Values are sent as signed 16-bit integers in 0.01 µM units, saturated to
+ *          ±327.67 µM.
+ * @param sensor - Sensor index
+ * @param index - Per-sensor sample index
+ * @param timestamp - Estimated acquisition time of the sample (TIM2 µs)
+ * @param hb - [in] Concentration changes (µM)
+ * @return void
+ */
+void STREAM_PutHb(uint8_t sensor, uint32_t index, uint32_t timestamp, const NIRS_HbSample *hb) {
+    if (!stream_full_rate) {
+        return;
+    }
+    STREAM_Accumulator *a = &stream_hb[sensor];
+    a->sum_a += hb->hbo2;
+    a->sum_b += hb->hhb;
+    uint16_t block = (uint16_t)(stream_decimation[1] << stream_counters[2].level);
+    if (++a->count < block) {
+        return;
+    }
+    float32_t v[2] = { a->sum_a * 100.0f / a->count, a->sum_b * 100.0f / a->count };
+    *a = (STREAM_Accumulator){0};
+
+    POOL_Frame *frame = STREAM_Alloc(STREAM_HB);
+    if (frame == NULL) {
+        return;
+    }
+    uint8_t *p = &frame->data[STREAM_HEADER_BYTES];
+    p[0] = sensor;
+    STREAM_PutU32(&p[1], index);
+    for (uint8_t i = 0; i < 2; i++) {
+        float32_t x = v[i];
+        if (x > 32767.0f) x = 32767.0f;
+        if (x < -32768.0f) x = -32768.0f;
+        int16_t q = (int16_t)x;
+        p[5 + 2 * i] = (uint8_t)q;
+        p[6 + 2 * i] = (uint8_t)((uint16_t)q >> 8);
+    }
+    STREAM_Send(frame, STREAM_HB, 9, timestamp);
+}
+
+/**
+ * @brief Send one summary frame
+ * @details Payload: sensor u8, first index u32, count u16, then mean, std, min, max and
+ *          rms of Red followed by the same for IR (f32 nA), 47 bytes. Subject to the
+ *          bandwidth policy like FILTERED.
+ * @param sensor - Sensor index
+ * @param first_index - Index of the first sample in the window
+ * @param count - Samples in the window
+ * @param timestamp - Estimated acquisition time of the last sample (TIM2 µs)
+ * @param stats - [in] Red and IR statistics
+ * @return void
+ */
+void STREAM_PutSummary(uint8_t sensor, uint32_t first_index, uint16_t count, uint32_t timestamp, const STREAM_ChannelSummary stats[2]) {
+    POOL_Frame *frame = STREAM_Alloc(STREAM_SUMMARY);
+    if (frame == NULL) {
+        return;
+    }
+    uint8_t *p = &frame->data[STREAM_HEADER_BYTES];
+    p[0] = sensor;
+    STREAM_PutU32(&p[1], first_index);
+    p[5] = (uint8_t)count;
+    p[6] = (uint8_t)(count >> 8);
+    for (uint8_t c = 0; c < 2; c++) {
+        const float32_t v[5] = { stats[c].mean, stats[c].std, stats[c].min, stats[c].max, stats[c].rms };
+        memcpy(&p[7 + 20 * c], v, sizeof(v));
+    }
+    STREAM_Send(frame, STREAM_SUMMARY, 47, timestamp);
+}
+
+/**
+ * @brief Send the deadband updates of one block
+ * @details Payload: sensor u8, base index u32, count u8, then count × (tag u8, value f32),
+ *          at most STREAM_DEADBAND_UPDATES per frame; the rest follows in further
+ *          frames with the same base. Subject to the bandwidth policy like FILTERED:
+ *          a dropped frame leaves the host holding the previous value until the channel's
+ *          next update.
+ * @param sensor - Sensor index
+ * @param base_index - Index the tags are relative to
+ * @param timestamp - Estimated acquisition time of sample base_index (TIM2 µs)
+ * @param count - Number of updates
+ * @param tags - [in] Sample offset | STREAM_DEADBAND_IR per update
+ * @param values - [in] Filtered value per update (nA)
+ * @return void
+ */
+void STREAM_PutDeadband(uint8_t sensor, uint32_t base_index, uint32_t timestamp, uint8_t count, const uint8_t *tags, const float32_t *values) {
+    while (count) {
+        uint8_t n = (count > STREAM_DEADBAND_UPDATES) ? STREAM_DEADBAND_UPDATES : count;
+        POOL_Frame *frame = STREAM_Alloc(STREAM_DEADBAND);
+        if (frame == NULL) {
+            return;
+        }
+        uint8_t *p = &frame->data[STREAM_HEADER_BYTES];
+        p[0] = sensor;
+        STREAM_PutU32(&p[1], base_index);
+        p[5] = n;
+        for (uint8_t i = 0; i < n; i++) {
+            p[6 + 5 * i] = tags[i];
+            memcpy(&p[7 + 5 * i], &values[i], 4);
+        }
+        STREAM_Send(frame, STREAM_DEADBAND, (uint16_t)(6U + 5U * n), timestamp);
+        tags += n;
+        values += n;
+        count -= n;
+    }
+}
+
+/**
+ * @brief Send one tissue saturation frame
+ * @details Payload: interval u32, sensors u8, valid u8, then TSI (%), ∂A/∂ρ of Red and
+ *          IR (OD/mm) and the mean distance (mm) as f32, 22 bytes. The TSI field is 0
+ *          when not valid. Subject to the bandwidth policy like SUMMARY.
+ * @param interval - Interval number
+ * @param sensors - Bit k set if sensor k is in the fit
+ * @param valid - 1 if result->tsi is valid
+ * @param result - [in] TSI, slopes and mean distance
+ * @param timestamp - End of the interval (TIM2 µs)
+ * @return void
+ */
+void STREAM_PutTsi(uint32_t interval, uint8_t sensors, uint8_t valid, const NIRS_TsiResult *result, uint32_t timestamp) {
+    POOL_Frame *frame = STREAM_Alloc(STREAM_TSI);
+    if (frame == NULL) {
+        return;
+    }
+    uint8_t *p = &frame->data[STREAM_HEADER_BYTES];
+    STREAM_PutU32(&p[0], interval);
+    p[4] = sensors;
+    p[5] = valid;
+    const float32_t v[4] = { valid ? result->tsi : 0.0f, result->slope[0], result->slope[1], result->distance_mm };
+    memcpy(&p[6], v, sizeof(v));
+    STREAM_Send(frame, STREAM_TSI, 22, timestamp);
+}
+
+/**
+ * @brief Send one marker event frame
+ * @details Payload: sequence u32, sensor count u8, then per sensor the index of the
+ *          sample nearest to the edge (u32) and the edge time relative to that sample
+ *          (i16 µs, |offset| ≤ half a sample period).
+ * @param seq - Marker sequence number
+ * @param timestamp - Captured edge time (TIM2 µs)
+ * @param num_sensors - Number of sensors referenced
+ * @param index - [in] Nearest sample index per sensor
+ * @param offset_us - [in] Edge offset per sensor (µs)
+ * @return void
+ */
+void STREAM_PutEvent(uint32_t seq, uint32_t timestamp, uint8_t num_sensors, const uint32_t *index, const int16_t *offset_us) {
+    if (num_sensors > STREAM_MAX_SENSORS) {
+        num_sensors = STREAM_MAX_SENSORS;
+    }
+    POOL_Frame *frame = STREAM_Alloc(STREAM_EVENT);
+    if (frame == NULL) {
+        return;
+    }
+    uint8_t *p = &frame->data[STREAM_HEADER_BYTES];
+    STREAM_PutU32(&p[0], seq);
+    p[4] = num_sensors;
+    for (uint8_t k = 0; k < num_sensors; k++) {
+        uint8_t *e = &p[5 + 6 * k];
+        STREAM_PutU32(&e[0], index[k]);
+        e[4] = (uint8_t)offset_us[k];
+        e[5] = (uint8_t)((uint16_t)offset_us[k] >> 8);
+    }
+    STREAM_Send(frame, STREAM_EVENT, (uint16_t)(5U + 6U * num_sensors), timestamp);
+}
+
+/**
+ * @brief Send one text report line on the STATUS stream
+ * @param line - Null-terminated report
+ * @return void
+ */
+void STREAM_PutStatus(const char *line) {
+    STREAM_PutFrame(STREAM_STATUS, (const uint8_t *)line, (uint16_t)strlen(line), TIMER_GetMicros());
+}
+
+/**
+ * @brief Send an arbitrary payload on one stream, subject to the bandwidth policy
+ * @param id - Stream identifier
+ * @param payload - Payload bytes (truncated to STREAM_MAX_PAYLOAD)
+ * @param length - Payload length
+ * @param timestamp - Device time carried in the header (TIM2 µs)
+ * @return 1 if the frame was queued, 0 if it was dropped
+ */
+uint8_t STREAM_PutFrame(STREAM_Id id, const uint8_t *payload, uint16_t length, uint32_t timestamp) {
+    if (length > STREAM_MAX_PAYLOAD) {
+        length = STREAM_MAX_PAYLOAD;
+    }
+    POOL_Frame *frame = STREAM_Alloc(id);
+    if (frame == NULL) {
+        return 0;
+    }
+    memcpy(&frame->data[STREAM_HEADER_BYTES], payload, length);
+    return STREAM_Send(frame, id, length, timestamp);
+}
+
+/**
+ * @brief Get the counters of one stream
+ * @param id - Stream identifier
+ * @return Pointer to the counters
+ */
+const STREAM_Counters *STREAM_GetCounters(STREAM_Id id) {
+    return &stream_counters[STREAM_Slot(id)];
+}
+
+/**
+ * @brief Format one stream's counters as a report line
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param id - Stream identifier
+ * @return Number of characters written (excluding terminator)
+ */
+int STREAM_FormatReport(char *buffer, uint32_t size, STREAM_Id id) {
+    const STREAM_Counters *c = STREAM_GetCounters(id);
+    return snprintf(buffer, size, "#STREAM,%u,%lu,%lu,%lu,%lu,%u\r\n",
+                    (unsigned)id,
+                    (unsigned long)c->frames,
+                    (unsigned long)c->bytes,
+                    (unsigned long)c->dropped,
+                    (unsigned long)c->overruns,
+                    (unsigned)c->level);
+}
@@ -0,0 +1,302 @@
+/**
+ * @file STREAM.h
+ * @brief Framed output multiplexer with per-stream rates, encodings and link budgeting
+ * @details Interleaves several logical streams into one framed byte transport on USART2.
+ *          Every frame is self-delimiting and CRC-protected, so a host can demultiplex the
+ *          streams and resynchronise after a lost byte.
+ *
+ * ### Frame Format (little-endian)
+ *  | Offset | Size | Field |
+ *  |--------|------|-------|
+ *  | 0 | 2 | Sync: 0xA5 0x5A |
+ *  | 2 | 1 | Stream ID (STREAM_Id) |
+ *  | 3 | 1 | Sequence number (per stream, wraps at 256) |
+ *  | 4 | 2 | Payload length N |
+ *  | 6 | 4 | Device time (TIM2 µs, wraps every ~71.6 min) |
+ *  | 10 | N | Payload |
+ *  | 10+N | 2 | CRC-16/CCITT-FALSE over bytes 2 … 9+N |
+ *
+ *  The device time is the estimated acquisition time of the first sample in the frame
+ *  (RAW), of the last sample of the block (FILTERED, HB) or window (SUMMARY), of the base
+ *  index (DEADBAND), the end of the fit interval (TSI), the captured edge time (EVENT)
+ *  or the transmit time (STATUS, SYNC, TRACE). The host maps it to its own clock with the estimate carried by SYNC frames.
+ *
+ * ### Streams
+ *  | ID | Stream | Rate | Payload encoding |
+ *  |----|--------|------|------------------|
+ *  | 0x01 | RAW | full ODR, one frame per SCHED_HANDOFF_SAMPLES samples | sensor u8, first index u32, count u8, count × (Red, IR) 3-byte big-endian 18-bit counts |
+ *  | 0x02 | FILTERED | ODR / STREAM_FILTERED_DECIMATION (block mean) | sensor u8, index u32, Red f32 nA, IR f32 nA |
+ *  | 0x03 | HB | ODR / STREAM_HB_DECIMATION (block mean) | sensor u8, index u32, ΔHbO2 i16, ΔHHb i16 (0.01 µM) |
+ *  | 0x04 | EVENT | per marker edge | marker sequence u32, sensors u8, sensors × (nearest index u32, offset i16 µs) |
+ *  | 0x05 | SUMMARY | one frame per window (STAGE_SUMMARY) | sensor u8, first index u32, count u16, Red then IR × (mean, std, min, max, rms) f32 nA |
+ *  | 0x06 | DEADBAND | per block with changes (STAGE_DEADBAND) | sensor u8, base index u32, count u8, count × (tag u8, value f32 nA); tag bits 0–6 = index − base, bit 7 = IR |
+ *  | 0x07 | TSI | one frame per interval (STAGE_TSI) | interval u32, sensors u8 (bit per detector in the fit), valid u8, TSI f32 %, ∂A/∂ρ Red f32, ∂A/∂ρ IR f32 (OD/mm), mean distance f32 mm |
+ *  | 0x08 | TRACE | on TRACE command or fault | first record u32, count u8, count × (DWT cycles u32, argument u24, event ID u8) (TRACE.h) |
+ *  | 0x10 | SYNC | per host ping | clock synchronisation echo and estimate (SYNC.h) |
+ *  | 0x7F | STATUS | on event | ASCII report line ("#SCHED,…", "#STREAM,…") |
+ *
+ * ### Bandwidth Scheduler
+ *  - A token bucket refilled at STREAM_LINK_HEADROOM_PCT % of the UART byte rate models
+ *    link capacity (DWT timestamps, no extra timer)
+ *  - RAW, EVENT and SYNC are guaranteed: they are always sent; if the bucket cannot cover a
+ *    frame it is still sent and counted as an overrun (configuration exceeds the link)
+ *  - Lower-priority frames are sent only if the bucket covers them plus one full RAW
+ *    frame; otherwise the frame is dropped and the stream's decimation level is raised
+ *    (effective decimation = base × 2^level, up to STREAM_MAX_LEVEL)
+ *  - The level steps back down when frames go out with more than half the bucket left
+ *
+ * ### Summary-Only Output
+ *  STREAM_SetFullRate(0) stops the RAW, FILTERED and HB frames (RAW frames are freed
+ *  unsent) while SUMMARY, EVENT, SYNC and STATUS continue, for monitoring over a slow
+ *  or shared link; STREAM_SetFullRate(1) brings the full-rate streams back at the next
+ *  frame. A SUMMARY frame is 59 bytes on the wire per sensor and window, against about
+ *  17.5 bytes per sample for RAW + FILTERED + HB at the default rates, i.e. a
+ *  reduction of ~0.3 × window samples (×59 for 4 s at 50 Hz, ×296 for 10 s at 100 Hz).
+ *
+ * ### Transmission
+ *  Frames are POOL_Frame blocks: the payload is encoded (or, for RAW, read by I2C) in
+ *  place, header and CRC are added in the same buffer and the frame pointer is queued
+ *  for USART2 TX DMA (DMA1 Channel 7). STREAM_TxComplete() frees it after the transfer.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-09
+ * @version 1.1
+ * @note Call the Put/Send functions only from the main loop (single producer of the
+ *       transmit queue). Requires POOL_Init() and UART_DMA_Config().
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <stdint.h>
+#include "MAX30101.h"
+#include "NIRS.h"
+#include "POOL.h"
+
+#define STREAM_SYNC0                0xA5    /**< First sync byte */
+#define STREAM_SYNC1                0x5A    /**< Second sync byte */
+#define STREAM_HEADER_BYTES         10      /**< Sync + ID + sequence + length + device time */
+#define STREAM_CRC_BYTES            2       /**< CRC-16 trailer */
+#define STREAM_MAX_PAYLOAD          (POOL_FRAME_BYTES - STREAM_HEADER_BYTES - STREAM_CRC_BYTES) /**< Largest payload of any stream (116 bytes) */
+#define STREAM_MAX_SENSORS          8       /**< One accumulator per PCA9548 channel */
+
+#define STREAM_RAW_BATCH            BUFFERBLOCKSIZE /**< Nominal samples per RAW frame (link budget reservation) */
+#define STREAM_RAW_SAMPLES_OFFSET   (STREAM_HEADER_BYTES + 6) /**< First FIFO word in a RAW frame */
+#define STREAM_RAW_PAYLOAD(n)       (6U + (n) * MAX30101_SAMPLE_BYTES) /**< RAW payload bytes: sensor + index + count + samples */
+#define STREAM_RAW_CAPACITY         ((STREAM_MAX_PAYLOAD - 6) / MAX30101_SAMPLE_BYTES) /**< Max samples in one RAW frame (18) */
+#define STREAM_FILTERED_DECIMATION  5       /**< FILTERED base decimation (50 Hz → 10 Hz) */
+#define STREAM_HB_DECIMATION        5       /**< HB base decimation (50 Hz → 10 Hz) */
+#define STREAM_DEADBAND_UPDATES ((STREAM_MAX_PAYLOAD - 6) / 5) /**< Updates per DEADBAND frame (22) */
+#define STREAM_DEADBAND_IR      0x80    /**< DEADBAND tag: IR channel (clear = Red) */
+#define STREAM_MAX_LEVEL            4       /**< Max extra decimation under pressure (×16) */
+#define STREAM_LINK_HEADROOM_PCT    90      /**< Share of the UART byte rate the scheduler may plan with (%) */
+#define STREAM_BUCKET_BYTES         512     /**< Token bucket depth (bytes) */
+
+/**
+ * @enum STREAM_Id
+ * @brief Logical stream identifiers (frame byte 2); lower index = higher priority
+ */
+typedef enum {
+    STREAM_RAW      = 0x01,  /**< Full-rate raw 18-bit counts (guaranteed) */
+    STREAM_FILTERED = 0x02,  /**< Decimated DC-removed currents */
+    STREAM_HB       = 0x03,  /**< Decimated ΔHbO2 / ΔHHb */
+    STREAM_EVENT    = 0x04,  /**< External marker events (guaranteed) */
+    STREAM_SUMMARY  = 0x05,  /**< Windowed statistics (STAGE_SUMMARY) */
+    STREAM_DEADBAND = 0x06,  /**< Change-driven filtered values (STAGE_DEADBAND) */
+    STREAM_TSI      = 0x07,  /**< Multi-distance tissue saturation index (STAGE_TSI) */
+    STREAM_TRACE    = 0x08,  /**< Event trace dump (TRACE.h) */
+    STREAM_SYNC     = 0x10,  /**< Clock synchronisation echo (guaranteed) */
+    STREAM_STATUS   = 0x7F   /**< Text statistics reports (lowest priority) */
+} STREAM_Id;
+
+#define STREAM_COUNT    10   /**< Number of logical streams */
+
+/**
+ * @struct STREAM_Counters
+ * @brief Per-stream transport counters
+ */
+typedef struct {
+    uint32_t frames;     /**< Frames transmitted */
+    uint32_t bytes;      /**< Bytes transmitted (header + payload + CRC) */
+    uint32_t dropped;    /**< Frames dropped for lack of link budget */
+    uint32_t overruns;   /**< Guaranteed frames sent without budget (RAW, EVENT, SYNC) */
+    uint8_t level;       /**< Current extra decimation level (×2^level) */
+} STREAM_Counters;
+
+/**
+ * @struct STREAM_ChannelSummary
+ * @brief Statistics of one channel over one summary window
+ */
+typedef struct {
+    float32_t mean;      /**< Mean (nA) */
+    float32_t std;       /**< Sample standard deviation (nA, 0 for a single sample) */
+    float32_t min;       /**< Minimum (nA) */
+    float32_t max;       /**< Maximum (nA) */
+    float32_t rms;       /**< Root mean square (nA) */
+} STREAM_ChannelSummary;
+
+/**
+ * @brief Transfer-complete hook: frame just handed to USART2 (DMA1 Ch7 ISR context)
+ * @param frame - [in] Transmitted frame (wire bytes in data[0 … length-1])
+ * @param now - TIM2 time of the completion (µs)
+ */
+typedef void (*STREAM_TxHook)(const POOL_Frame *frame, uint32_t now);
+
+/**
+ * @brief Initialize the multiplexer and the link token bucket
+ * @param baud_rate - UART baud rate (8N1, 10 bits per byte)
+ * @return void
+ * @note Requires DWT_Init() and UART_Config().
+ */
+void STREAM_Init(uint32_t baud_rate);
+
+/**
+ * @brief Transmit a RAW frame filled in place by the acquisition scheduler
+ * @param frame - Frame from SCHED_PopFrame() (ownership is taken)
+ * @return void
+ */
+void STREAM_SendRaw(POOL_Frame *frame);
+
+/**
+ * @brief Accumulate one filtered sample; sends the block mean at the decimated rate
+ * @param sensor - Sensor index
+ * @param index - Per-sensor sample index
+ * @param timestamp - Estimated acquisition time of the sample (TIM2 µs)
+ * @param filtered - [in] DC-removed currents (nA)
+ * @return void
+ */
+void STREAM_PutFiltered(uint8_t sensor, uint32_t index, uint32_t timestamp, const MAX30101_CurrentSample *filtered);
+
+/**
+ * @brief Accumulate one ΔHb sample; sends the block mean at the decimated rate
+ * @param sensor - Sensor index
+ * @param index - Per-sensor sample index
+ * @param timestamp - Estimated acquisition time of the sample (TIM2 µs)
+ * @param hb - [in] Concentration changes (µM)
+ * @return void
+ */
+void STREAM_PutHb(uint8_t sensor, uint32_t index, uint32_t timestamp, const NIRS_HbSample *hb);
+
+/**
+ * @brief Send one summary frame (one window of one sensor)
+ * @param sensor - Sensor index
+ * @param first_index - Per-sensor index of the first sample in the window
+ * @param count - Samples in the window
+ * @param timestamp - Estimated acquisition time of the last sample (TIM2 µs)
+ * @param stats - [in] Red and IR statistics
+ * @return void
+ */
+void STREAM_PutSummary(uint8_t sensor, uint32_t first_index, uint16_t count, uint32_t timestamp, const STREAM_ChannelSummary stats[2]);
+
+/**
+ * @brief Send the deadband updates of one block
+ * @param sensor - Sensor index
+ * @param base_index - Per-sensor index the update tags are relative to
+ * @param timestamp - Estimated acquisition time of sample base_index (TIM2 µs)
+ * @param count - Number of updates
+ * @param tags - [in] Per update: index − base_index, | STREAM_DEADBAND_IR for IR
+ * @param values - [in] Per update: filtered value (nA)
+ * @return void
+ * @note More than STREAM_DEADBAND_UPDATES updates are split over several frames.
+ */
+void STREAM_PutDeadband(uint8_t sensor, uint32_t base_index, uint32_t timestamp, uint8_t count, const uint8_t *tags, const float32_t *values);
+
+/**
+ * @brief Send one tissue saturation frame
+ * @param interval - Interval number (counts from the first interval after boot)
+ * @param sensors - Bit k set if sensor k is in the fit
+ * @param valid - 1 if result->tsi is valid
+ * @param result - [in] TSI, slopes and mean distance (NIRS_TsiSolve())
+ * @param timestamp - End of the interval (TIM2 µs)
+ * @return void
+ */
+void STREAM_PutTsi(uint32_t interval, uint8_t sensors, uint8_t valid, const NIRS_TsiResult *result, uint32_t timestamp);
+
+/**
+ * @brief Send one marker event frame (guaranteed)
+ * @param seq - Marker sequence number
+ * @param timestamp - Captured edge time (TIM2 µs)
+ * @param num_sensors - Number of sensors referenced (≤ STREAM_MAX_SENSORS)
+ * @param index - [in] Per-sensor index of the sample nearest to the edge
+ * @param offset_us - [in] Per-sensor edge time − that sample's time (µs)
+ * @return void
+ */
+void STREAM_PutEvent(uint32_t seq, uint32_t timestamp, uint8_t num_sensors, const uint32_t *index, const int16_t *offset_us);
+
+/**
+ * @brief Send an arbitrary payload on one stream, subject to the bandwidth policy
+ * @param id - Stream identifier
+ * @param payload - Payload bytes (≤ STREAM_MAX_PAYLOAD)
+ * @param length - Payload length
+ * @param timestamp - Device time carried in the header (TIM2 µs)
+ * @return 1 if the frame was queued, 0 if it was dropped
+ */
+uint8_t STREAM_PutFrame(STREAM_Id id, const uint8_t *payload, uint16_t length, uint32_t timestamp);
+
+/**
+ * @brief DMA1 Channel 7 transfer-complete handler body: free the frame, start the next
+ * @return void
+ * @note Called from DMA1_Channel7_IRQHandler().
+ */
+void STREAM_TxComplete(void);
+
+/**
+ * @brief Install a transfer-complete hook (NULL to remove)
+ * @param hook - Function called for every transmitted frame before it is freed
+ * @return void
+ */
+void STREAM_SetTxHook(STREAM_TxHook hook);
+
+/**
+ * @brief Change the base decimation of the FILTERED and HB streams
+ * @param filtered - FILTERED samples per frame (default STREAM_FILTERED_DECIMATION)
+ * @param hb - HB samples per frame (default STREAM_HB_DECIMATION)
+ * @return void
+ */
+void STREAM_SetDecimation(uint16_t filtered, uint16_t hb);
+
+/**
+ * @brief Enable or stop the full-rate streams (RAW, FILTERED, HB)
+ * @param enable - 1 = full-rate streams on (default), 0 = summary-only output
+ * @return void
+ */
+void STREAM_SetFullRate(uint8_t enable);
+
+/**
+ * @brief Whether the full-rate streams are on
+ * @return 1 if RAW, FILTERED and HB frames are sent, 0 in summary-only output
+ */
+uint8_t STREAM_GetFullRate(void);
+
+/**
+ * @brief TIM2 time at which the last frame of a stream started transmission
+ * @param id - Stream identifier
+ * @return Device time (µs)
+ */
+uint32_t STREAM_GetTxStart(STREAM_Id id);
+
+/**
+ * @brief Send one text report line on the STATUS stream (budget permitting)
+ * @param line - Null-terminated report (truncated to STREAM_MAX_PAYLOAD)
+ * @return void
+ */
+void STREAM_PutStatus(const char *line);
+
+/**
+ * @brief Get the counters of one stream
+ * @param id - Stream identifier
+ * @return Pointer to the counters (valid for the lifetime of the program)
+ */
+const STREAM_Counters *STREAM_GetCounters(STREAM_Id id);
+
+/**
+ * @brief Format one stream's counters as a report line
+ * @details Format: `#STREAM,<id>,<frames>,<bytes>,<dropped>,<overruns>,<level>\r\n`
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param id - Stream identifier
+ * @return Number of characters written (excluding terminator)
+ */
+int STREAM_FormatReport(char *buffer, uint32_t size, STREAM_Id id);
+
+#endif /* STREAM_H_ */
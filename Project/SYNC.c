@@ -0,0 +1,184 @@
+/**
+ * @file SYNC.c
+ * @brief Host–device clock synchronisation implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-16
+ * @version 1.0
+ */
+
+#include "SYNC.h"
+#include "STREAM.h"
+#include "TIMER.h"
+#include <string.h>
+
+/**
+ * @struct SYNC_Point
+ * @brief Midpoint pair of one accepted exchange
+ */
+typedef struct {
+    uint32_t dev;        /**< Device midpoint (t2 + t3) / 2 */
+    int64_t host;        /**< Host midpoint (t1 + t4) / 2 */
+} SYNC_Point;
+
+static SYNC_Point sync_points[SYNC_WINDOW];
+static uint8_t sync_num_points;
+static uint8_t sync_next_point;
+static uint32_t sync_delays[SYNC_WINDOW];    /**< Recent round-trip delays (accepted or not) */
+static uint8_t sync_next_delay;
+static uint8_t sync_num_delays;
+static SYNC_Estimate sync_estimate;
+
+/** Last echo sent, waiting for its t4 in the next ping */
+static struct {
+    uint64_t t1;
+    uint32_t t2;
+    uint8_t pending;
+} sync_last;
+
+static inline uint64_t SYNC_GetU64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int8_t i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static inline void SYNC_PutU32(uint8_t *p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline void SYNC_PutU64(uint8_t *p, uint64_t v) {
+    for (uint8_t i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+/**
+ * @brief Least-squares fit of the accepted midpoint pairs
+ * @details Coordinates are taken relative to the newest point so that 32-bit device
+ *          wrap-around and large host epochs do not reach the float arithmetic:
+ *          x = device − ref_dev, y = (host − ref_host) − x (offset change).
+ *          y = a + b·x gives ref_host += a and drift = b.
+ */
+static void SYNC_Fit(void) {
+    uint8_t newest = (uint8_t)((sync_next_point + SYNC_WINDOW - 1) % SYNC_WINDOW);
+    const SYNC_Point *ref = &sync_points[newest];
+    float32_t x[SYNC_WINDOW], y[SYNC_WINDOW];
+    float32_t mx = 0.0f, my = 0.0f;
+    uint8_t n = sync_num_points;
+
+    for (uint8_t i = 0; i < n; i++) {
+        int32_t dx = (int32_t)(sync_points[i].dev - ref->dev);
+        x[i] = (float32_t)dx;
+        y[i] = (float32_t)((sync_points[i].host - ref->host) - dx);
+        mx += x[i];
+        my += y[i];
+    }
+    mx /= n;
+    my /= n;
+    float32_t sxx = 0.0f, sxy = 0.0f;
+    for (uint8_t i = 0; i < n; i++) {
+        sxx += (x[i] - mx) * (x[i] - mx);
+        sxy += (x[i] - mx) * (y[i] - my);
+    }
+    float32_t b = (n > 1 && sxx > 0.0f) ? sxy / sxx : 0.0f;
+    float32_t a = my - b * mx;
+
+    sync_estimate.ref_dev = ref->dev;
+    sync_estimate.ref_host = ref->host + (int64_t)a;
+    sync_estimate.drift = b;
+    sync_estimate.points = n;
+}
+
+/**
+ * @brief Add a completed exchange and refresh the estimate if it is accepted
+ * @param t1 - Host send time of the ping
+ * @param t2 - Device receive time
+ * @param t3 - Device transmit time of the echo
+ * @param t4 - Host receive time of the echo
+ */
+static void SYNC_AddExchange(uint64_t t1, uint32_t t2, uint32_t t3, uint64_t t4) {
+    uint32_t turnaround = t3 - t2;
+    int64_t round_trip = (int64_t)(t4 - t1) - (int64_t)turnaround;
+    if (t4 <= t1 || round_trip < 0) {
+        return; // Inconsistent timestamps (host clock step or stale report)
+    }
+    uint32_t delay = (uint32_t)round_trip;
+
+    sync_delays[sync_next_delay] = delay;
+    sync_next_delay = (uint8_t)((sync_next_delay + 1) % SYNC_WINDOW);
+    if (sync_num_delays < SYNC_WINDOW) sync_num_delays++;
+    uint32_t min_delay = UINT32_MAX;
+    for (uint8_t i = 0; i < sync_num_delays; i++) {
+        if (sync_delays[i] < min_delay) min_delay = sync_delays[i];
+    }
+    if (delay > min_delay + SYNC_DELAY_TOLERANCE_US) {
+        return; // Queued somewhere on the path: asymmetric, reject
+    }
+
+    SYNC_Point *p = &sync_points[sync_next_point];
+    p->dev = t2 + turnaround / 2U;
+    p->host = (int64_t)(t1 + (t4 - t1) / 2U);
+    sync_next_point = (uint8_t)((sync_next_point + 1) % SYNC_WINDOW);
+    if (sync_num_points < SYNC_WINDOW) sync_num_points++;
+    SYNC_Fit();
+}
+
+/**
+ * @brief Clear the exchange history and estimate
+ * @return void
+ */
+void SYNC_Init(void) {
+    sync_num_points = sync_next_point = 0;
+    sync_num_delays = sync_next_delay = 0;
+    memset(&sync_estimate, 0, sizeof(sync_estimate));
+    memset(&sync_last, 0, sizeof(sync_last));
+}
+
+/**
+ * @brief PING command handler
+ * @details 1. If the ping reports t4 for the echo we sent last, complete that exchange
+ *          2. Queue the SYNC echo for this ping; the echo carries the queueing time as t3
+ *             (also the frame header time), while the estimator uses the DMA start time
+ *             recorded by STREAM, which is known by the next ping
+ * @param frame - [in] Received PING command
+ * @return void
+ */
+void SYNC_HandlePing(const CMD_Frame *frame) {
+    if (frame->length < SYNC_PING_PAYLOAD) {
+        return;
+    }
+    uint64_t t1 = SYNC_GetU64(&frame->payload[0]);
+    uint64_t prev_t1 = SYNC_GetU64(&frame->payload[8]);
+    uint64_t prev_t4 = SYNC_GetU64(&frame->payload[16]);
+
+    if (sync_last.pending && prev_t4 && prev_t1 == sync_last.t1) {
+        // The echo waited in the transmit queue: use the time its DMA transfer started
+        SYNC_AddExchange(sync_last.t1, sync_last.t2, STREAM_GetTxStart(STREAM_SYNC), prev_t4);
+    }
+
+    uint8_t echo[SYNC_ECHO_PAYLOAD];
+    SYNC_PutU64(&echo[0], t1);
+    SYNC_PutU32(&echo[8], frame->rx_time_us);
+    SYNC_PutU32(&echo[16], sync_estimate.ref_dev);
+    SYNC_PutU64(&echo[20], (uint64_t)sync_estimate.ref_host);
+    SYNC_PutU32(&echo[28], (uint32_t)(int32_t)(sync_estimate.drift * 1.0e9f));
+    echo[32] = sync_estimate.points;
+    uint32_t t3 = TIMER_GetMicros();
+    SYNC_PutU32(&echo[12], t3);
+    if (STREAM_PutFrame(STREAM_SYNC, echo, sizeof(echo), t3)) {
+        sync_last.t1 = t1;
+        sync_last.t2 = frame->rx_time_us;
+        sync_last.pending = 1;
+    }
+}
+
+/**
+ * @brief Get the current device → host mapping
+ * @return Pointer to the estimate
+ */
+const SYNC_Estimate *SYNC_GetEstimate(void) {
+    return &sync_estimate;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file SYNC.h
+ * @brief Host–device clock synchronisation over USART2
+ * @details Two-way time transfer in the style of NTP. The host periodically sends PING
+ *          commands stamped with its own clock; the device timestamps their arrival with
+ *          TIM2, echoes them on the SYNC stream and, once the host reports when that echo
+ *          arrived, has all four timestamps of the exchange:
+ *
+ *  ```
+ *  host   t1 ──PING──▶            ┌──────▶ t4
+ *  device          t2 (rx) … t3 (tx) ─SYNC┘
+ *  ```
+ *
+ *  - Round-trip delay δ = (t4 − t1) − (t3 − t2)
+ *  - Midpoint pair: device (t2 + t3) / 2 ↔ host (t1 + t4) / 2
+ *
+ * ### Estimator
+ *  - Exchanges whose δ exceeds the recent minimum by more than SYNC_DELAY_TOLERANCE_US
+ *    are rejected (USB/serial queueing makes the path asymmetric)
+ *  - The last SYNC_WINDOW accepted midpoint pairs are fitted by least squares:
+ *    host = ref_host + (1 + drift) · (device − ref_dev)
+ *  - The fit is refreshed on every accepted exchange and carried in each SYNC frame
+ *
+ * ### PING Payload (host → device, command 0x80, 24 bytes, little-endian)
+ *  | Offset | Size | Field |
+ *  |--------|------|-------|
+ *  | 0 | 8 | t1: host send time of this ping (µs) |
+ *  | 8 | 8 | t1 of the previous ping (0 if none) |
+ *  | 16 | 8 | t4: host receive time of the previous SYNC echo (0 if none) |
+ *
+ * ### SYNC Payload (device → host, stream 0x10, 33 bytes, little-endian)
+ *  | Offset | Size | Field |
+ *  |--------|------|-------|
+ *  | 0 | 8 | t1 echoed |
+ *  | 8 | 4 | t2: device receive time (µs) |
+ *  | 12 | 4 | t3: device time the echo was queued (µs, also the frame header time); the device-side estimator uses the DMA start time instead |
+ *  | 16 | 4 | ref_dev: device reference time of the estimate (µs) |
+ *  | 20 | 8 | ref_host: host time at ref_dev (µs) |
+ *  | 28 | 4 | drift (parts per 10⁹, host rate − device rate) |
+ *  | 32 | 1 | Points in the fit (0 = no estimate yet) |
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-16
+ * @version 1.0
+ * @note The device runs from the HSI oscillator (±1 %), so drift tracking is essential;
+ *       a ping period of 0.5–1 s keeps the mapping error well below 1 ms.
+ */
+
+#ifndef SYNC_H_
+#define SYNC_H_
+
+#include <stdint.h>
+#include "arm_math_types.h"
+#include "CMD.h"
+
+#define SYNC_WINDOW                 16      /**< Accepted exchanges kept for the drift fit */
+#define SYNC_DELAY_TOLERANCE_US     400     /**< Accept δ ≤ min recent δ + tolerance */
+#define SYNC_PING_PAYLOAD           24      /**< PING payload length */
+#define SYNC_ECHO_PAYLOAD           33      /**< SYNC payload length */
+
+/**
+ * @struct SYNC_Estimate
+ * @brief Current device → host clock mapping
+ */
+typedef struct {
+    uint32_t ref_dev;    /**< Device reference time (µs) */
+    int64_t ref_host;    /**< Host time at ref_dev (µs) */
+    float32_t drift;     /**< Relative rate error (host − device) / device */
+    uint8_t points;      /**< Exchanges in the fit (0 = invalid) */
+} SYNC_Estimate;
+
+/**
+ * @brief Clear the exchange history and estimate
+ * @return void
+ */
+void SYNC_Init(void);
+
+/**
+ * @brief PING command handler (registered with CMD_Register(CMD_PING, ...))
+ * @details Completes the previous exchange with the host-reported t4, updates the
+ *          estimate and sends the SYNC echo for this ping.
+ * @param frame - [in] Received PING command
+ * @return void
+ */
+void SYNC_HandlePing(const CMD_Frame *frame);
+
+/**
+ * @brief Get the current device → host mapping
+ * @return Pointer to the estimate
+ */
+const SYNC_Estimate *SYNC_GetEstimate(void);
+
+#endif /* SYNC_H_ */
@@ -0,0 +1,32 @@
+/**
+ * @file TIMER.c
+ * @brief TIM2 free-running 1 MHz device timebase implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-16
+ * @version 1.0
+ */
+
+#include "TIMER.h"
+
+/**
+ * @brief Start TIM2 as a free-running 1 MHz counter
+ * @details Configuration sequence:
+ *          1. Enable TIM2 clock (APB1)
+ *          2. PSC = SystemCoreClock / 1 MHz − 1 (timer clock equals SYSCLK because the
+ *             APB1 prescaler is 2)
+ *          3. ARR = 0xFFFFFFFF (full 32-bit range)
+ *          4. Force an update event to load PSC, then start the counter
+ * @return void
+ */
+void TIMER_Init(void) {
+    // Enable TIM2 clock
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+    // 1 MHz tick from the 64 MHz timer clock
+    TIM2->PSC = (SystemCoreClock / 1000000U) - 1U;
+    TIM2->ARR = 0xFFFFFFFFU;
+    TIM2->CNT = 0;
+    // Load the prescaler immediately (it is otherwise applied at the next overflow)
+    TIM2->EGR = TIM_EGR_UG;
+    TIM2->SR = 0;
+    TIM2->CR1 |= TIM_CR1_CEN;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file TIMER.h
+ * @brief TIM2 free-running 1 MHz device timebase
+ * @details 32-bit general-purpose timer TIM2 counts microseconds since TIMER_Init().
+ *          It is the hardware time reference for sample timestamps, UART receive
+ *          timestamps and the host clock synchronisation (SYNC.c).
+ *
+ * ### Configuration
+ *  - **Timer clock**: 64 MHz (APB1 = 32 MHz with prescaler 2 → timer clock ×2)
+ *  - **Prescaler**: 64 → 1 MHz tick (1 µs resolution)
+ *  - **Auto-reload**: 0xFFFFFFFF (wraps every ~71.6 min)
+ *  - **Interrupts**: none
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-06-16
+ * @version 1.0
+ * @note Unsigned 32-bit subtraction of two timestamps is valid for intervals < 71 min.
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stdint.h>
+#include "stm32f303x8.h"
+
+/**
+ * @brief Start TIM2 as a free-running 1 MHz counter
+ * @return void
+ * @note Call after clk_config(); the prescaler is derived from SystemCoreClock.
+ */
+void TIMER_Init(void);
+
+/**
+ * @brief Current device time
+ * @return Microseconds since TIMER_Init() (modulo 2^32)
+ */
+static inline uint32_t TIMER_GetMicros(void) {
+    return TIM2->CNT;
+}
+
+#endif /* TIMER_H_ */
@@ -0,0 +1,200 @@
+/**
+ * @file TRACE.c
+ * @brief Binary event trace ring implementation
+ * @author Julio Fajardo, PhD
+ * @date 2026-10-17
+ * @version 1.0
+ */
+
+#include "TRACE.h"
+
+#if TRACE_RECORDS
+
+#include "STREAM.h"
+#include "TIMER.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_OP_DUMP       0       /**< Command: freeze and dump now */
+#define TRACE_OP_ARM        1       /**< Command: freeze and dump at the next fault */
+
+/** @name Dump phases
+ * @{ */
+#define TRACE_PHASE_IDLE    0
+#define TRACE_PHASE_HEADER  1       /**< #TRACE line */
+#define TRACE_PHASE_RECORDS 2       /**< TRACE frames */
+#define TRACE_PHASE_END     3       /**< #TRACEEND line */
+/** @} */
+
+uint64_t trace_ring[TRACE_RECORDS];
+volatile uint32_t trace_written;
+volatile uint8_t trace_frozen;
+
+static volatile uint8_t trace_armed;        /**< Next fault freezes the ring */
+static volatile uint8_t trace_pending;      /**< Frozen, dump not started yet */
+static uint8_t trace_state;                 /**< TRACE_STATE_* of the pending dump */
+static uint32_t trace_freeze_micros;        /**< TIM2 time of the freeze */
+static uint32_t trace_freeze_cycles;        /**< DWT time of the freeze */
+
+/** Dump in progress (main loop) */
+static struct {
+    uint8_t phase;
+    uint32_t first;             /**< Oldest record in the ring */
+    uint32_t next;              /**< Next record to send */
+    uint32_t end;               /**< Records written at the freeze */
+    uint32_t frames;            /**< TRACE frames sent */
+} trace_dump;
+
+/**
+ * @brief Stop recording and request a dump
+ * @param state - TRACE_STATE_DUMP or TRACE_STATE_FAULT
+ */
+static void TRACE_Freeze(uint8_t state) {
+    trace_frozen = 1;
+    trace_freeze_cycles = DWT_GetCycles();
+    trace_freeze_micros = TIMER_GetMicros();
+    trace_state = state;
+    trace_pending = 1;
+}
+
+/**
+ * @brief Fault hook: freeze the ring if the trigger is armed
+ * @details One-shot: the host arms it again after the dump.
+ * @return void
+ */
+void TRACE_Trigger(void) {
+    if (trace_armed) {
+        trace_armed = 0;
+        TRACE_Freeze(TRACE_STATE_FAULT);
+    }
+}
+
+/**
+ * @brief Format the dump header line
+ * @param buffer - [out] Destination string
+ * @param size - Capacity of buffer in bytes
+ * @param state - TRACE_STATE_*
+ * @return Number of characters written (excluding terminator)
+ */
+static int TRACE_FormatHeader(char *buffer, uint32_t size, uint8_t state) {
+    return snprintf(buffer, size, "#TRACE,%u,%lu,%u,%lu,%lu,%lu,%lu\r\n",
+                    state,
+                    (unsigned long)SystemCoreClock,
+                    (unsigned)TRACE_RECORDS,
+                    (unsigned long)trace_dump.end,
+                    (unsigned long)trace_dump.first,
+                    (unsigned long)trace_freeze_micros,
+                    (unsigned long)trace_freeze_cycles);
+}
+
+/**
+ * @brief TRACE command handler
+ * @details Ignored while a dump is in progress. Arming answers with a header line of
+ *          state 1 (no records follow) and resumes recording.
+ * @param frame - [in] Received command (payload: op u8, default 0)
+ * @return void
+ */
+void TRACE_HandleCommand(const CMD_Frame *frame) {
+    uint8_t op = frame->length ? frame->payload[0] : TRACE_OP_DUMP;
+    if (trace_dump.phase != TRACE_PHASE_IDLE || trace_pending) {
+        return;
+    }
+    if (op == TRACE_OP_ARM) {
+        char line[96];
+        trace_dump.end = trace_written;
+        trace_dump.first = 0;
+        trace_freeze_micros = trace_freeze_cycles = 0;
+        trace_frozen = 0;
+        trace_armed = 1;
+        TRACE_FormatHeader(line, sizeof(line), TRACE_STATE_ARMED);
+        STREAM_PutStatus(line);
+    } else {
+        trace_armed = 0;
+        TRACE_Freeze(TRACE_STATE_DUMP);
+    }
+}
+
+/**
+ * @brief Send one step of the dump
+ * @return 1 if it was queued, 0 if the link had no room (try again later)
+ */
+static uint8_t TRACE_SendNext(void) {
+    char line[96];
+    int n;
+    switch (trace_dump.phase) {
+        case TRACE_PHASE_HEADER:
+            n = TRACE_FormatHeader(line, sizeof(line), trace_state);
+            if (!STREAM_PutFrame(STREAM_STATUS, (const uint8_t *)line, (uint16_t)n, TIMER_GetMicros())) {
+                return 0;
+            }
+            trace_dump.phase = TRACE_PHASE_RECORDS;
+            return 1;
+
+        case TRACE_PHASE_RECORDS: {
+            uint32_t count = trace_dump.end - trace_dump.next;
+            if (count == 0) {
+                trace_dump.phase = TRACE_PHASE_END;
+                return 1;
+            }
+            if (count > TRACE_FRAME_RECORDS) {
+                count = TRACE_FRAME_RECORDS;
+            }
+            uint8_t payload[5 + TRACE_FRAME_RECORDS * 8];
+            uint32_t k = trace_dump.next;
+            payload[0] = (uint8_t)k;
+            payload[1] = (uint8_t)(k >> 8);
+            payload[2] = (uint8_t)(k >> 16);
+            payload[3] = (uint8_t)(k >> 24);
+            payload[4] = (uint8_t)count;
+            for (uint32_t i = 0; i < count; i++) {
+                memcpy(&payload[5 + i * 8], &trace_ring[(k + i) & (TRACE_RECORDS - 1U)], 8);
+            }
+            if (!STREAM_PutFrame(STREAM_TRACE, payload, (uint16_t)(5 + count * 8), TIMER_GetMicros())) {
+                return 0;
+            }
+            trace_dump.next += count;
+            trace_dump.frames++;
+            return 1;
+        }
+
+        case TRACE_PHASE_END:
+            n = snprintf(line, sizeof(line), "#TRACEEND,%lu,%lu\r\n",
+                         (unsigned long)trace_dump.frames,
+                         (unsigned long)(trace_dump.end - trace_dump.first));
+            if (!STREAM_PutFrame(STREAM_STATUS, (const uint8_t *)line, (uint16_t)n, TIMER_GetMicros())) {
+                return 0;
+            }
+            trace_dump.phase = TRACE_PHASE_IDLE;
+            trace_frozen = 0;
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Send the pending dump, a few frames per call
+ * @details The frames are offered to the link budget like any other low-priority
+ *          stream; a dropped one is retried on a later call, so the dump takes as long
+ *          as the spare link capacity requires and never displaces RAW frames.
+ * @return void
+ */
+void TRACE_Service(void) {
+    if (trace_pending) {
+        trace_pending = 0;
+        uint32_t written = trace_written;
+        trace_dump.end = written;
+        trace_dump.first = (written > TRACE_RECORDS) ? written - TRACE_RECORDS : 0;
+        trace_dump.next = trace_dump.first;
+        trace_dump.frames = 0;
+        trace_dump.phase = TRACE_PHASE_HEADER;
+    }
+    for (uint8_t i = 0; i < TRACE_FRAMES_PER_PASS && trace_dump.phase != TRACE_PHASE_IDLE; i++) {
+        if (!TRACE_SendNext()) {
+            break;
+        }
+    }
+}
+
+#endif /* TRACE_RECORDS */
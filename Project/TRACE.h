@@ -0,0 +1,150 @@
+/**
+ * @file TRACE.h
+ * @brief Binary event trace ring with on-demand dump over the framed link
+ * @details Records what the firmware is doing, at cycle resolution, into a static ring
+ *          of 8-byte records that a host tool (Tools/nirs_trace.py) turns into a
+ *          Chrome / Perfetto timeline:
+ *
+ *  | Offset | Size | Field |
+ *  |--------|------|-------|
+ *  | 0 | 4 | DWT cycle counter (wraps every ~67 s at 64 MHz) |
+ *  | 4 | 3 | Argument (bits 0–23) |
+ *  | 7 | 1 | Event ID (TRACE_END set on the end of a span) |
+ *
+ * ### Recording
+ *  TRACE_Event() claims the next index with LDREX/STREX (safe from any interrupt
+ *  priority, no masking) and writes the record with a single 64-bit store, so an event
+ *  costs about 12 cycles. The trace points sit in the existing instrumentation:
+ *
+ *  | ID | Event | Source | Argument |
+ *  |----|-------|--------|----------|
+ *  | 0x01 | Task span | DEADLINE_Begin() / DEADLINE_End() | task |
+ *  | 0x02 | Stage | DEADLINE_SetStage() (I2C phases, pipeline stages) | task << 8 \| stage |
+ *  | 0x03 | Interrupt span | main.c handlers | exception number (IRQn + 16) |
+ *  | 0x04 | I2C1 transfer done | I2C1_EventHandler() (DMA data landed) | ok |
+ *  | 0x05 | USART2 TX DMA done | STREAM_TxComplete() | frames still queued |
+ *  | 0x06 | Frame queued | STREAM_Send() | stream ID << 8 \| frames queued |
+ *  | 0x07 | FIFO overflow | SCHED_Plan() | sensor << 8 \| samples lost |
+ *  | 0x08 | RAW frame handoff | SCHED_Handoff() | sensor |
+ *  | 0x09 | Deadline miss | DEADLINE_TimerIrq() / DEADLINE_End() | task << 8 \| stage |
+ *
+ *  With TRACE_RECORDS = 0 (default) every trace point compiles to nothing.
+ *
+ * ### Dump
+ *  The TRACE command (0x86) freezes the ring (op 0) or arms a trigger (op 1): the next
+ *  FIFO overflow or deadline miss freezes it, so the ring holds the TRACE_RECORDS
+ *  events that led up to the fault. TRACE_Service() in the main loop then sends
+ *
+ *  - `#TRACE,<state>,<core_hz>,<records>,<written>,<first>,<micros>,<cycles>\r\n` on
+ *    STATUS (state 0 = dump follows, 1 = armed, 2 = triggered dump follows; micros and
+ *    cycles are TIM2 and DWT read together at the freeze, to place the trace on the
+ *    device time axis),
+ *  - TRACE frames (0x08): first record number u32, count u8, count × 8-byte records,
+ *    oldest first, paced by the link budget (a dropped frame is sent again),
+ *  - `#TRACEEND,<frames>,<records>\r\n`, after which recording resumes.
+ *
+ *  The index is claimed before the record is stored, so the newest records may be
+ *  torn: a slot claimed by a context the freeze preempted, or one whose late store lands
+ *  after a higher-priority interrupt wrapped the ring, can still hold the zeroed or
+ *  previous-lap contents. Readers drop records with an unknown event ID.
+ *
+ * @author Julio Fajardo, PhD
+ * @date 2026-10-17
+ * @version 1.0
+ * @note Requires DWT_Init() and OUTPUT_FRAMED. The ring costs TRACE_RECORDS × 8 bytes
+ *       of RAM (128 records = 1 KB).
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include "CMD.h"
+#include "DWT.h"
+
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS       0       /**< Ring size in records (power of two, 0 = tracing compiled out) */
+#endif
+#define TRACE_FRAME_RECORDS 13      /**< Records per TRACE frame (5 + 13 × 8 = 109 payload bytes) */
+#define TRACE_FRAMES_PER_PASS 2     /**< TRACE frames offered per TRACE_Service() call */
+
+#if TRACE_RECORDS & (TRACE_RECORDS - 1)
+#error "TRACE_RECORDS must be a power of two"
+#endif
+
+/** @name Event IDs
+ * @{ */
+#define TRACE_TASK          0x01    /**< Task span (arg: DEADLINE task) */
+#define TRACE_STAGE         0x02    /**< Stage change (arg: task << 8 | stage) */
+#define TRACE_IRQ           0x03    /**< Interrupt span (arg: exception number) */
+#define TRACE_I2C_DONE      0x04    /**< Asynchronous I2C1 transfer complete (arg: ok) */
+#define TRACE_UART_DONE     0x05    /**< USART2 TX DMA complete (arg: frames queued) */
+#define TRACE_UART_QUEUE    0x06    /**< Frame queued for USART2 (arg: stream << 8 | frames queued) */
+#define TRACE_FIFO_OVF      0x07    /**< Sensor FIFO overflow (arg: sensor << 8 | samples lost) */
+#define TRACE_HANDOFF       0x08    /**< RAW frame handed to the main loop (arg: sensor) */
+#define TRACE_DEADLINE_MISS 0x09    /**< Deadline miss (arg: task << 8 | stage) */
+#define TRACE_END           0x80    /**< Flag: end of a span */
+/** @} */
+
+/** @name Dump states (#TRACE line)
+ * @{ */
+#define TRACE_STATE_DUMP    0       /**< Frozen on command, dump follows */
+#define TRACE_STATE_ARMED   1       /**< Recording until the next fault */
+#define TRACE_STATE_FAULT   2       /**< Frozen by a fault, dump follows */
+/** @} */
+
+#if TRACE_RECORDS
+extern uint64_t trace_ring[TRACE_RECORDS];  /**< cycles | tag << 32 */
+extern volatile uint32_t trace_written;     /**< Records written since boot */
+extern volatile uint8_t trace_frozen;       /**< Recording suspended (dump) */
+#endif
+
+/**
+ * @brief Record one event
+ * @param id - Event ID (| TRACE_END for the end of a span)
+ * @param arg - Argument (24 bits)
+ * @return void
+ */
+static inline void TRACE_Event(uint8_t id, uint32_t arg) {
+#if TRACE_RECORDS
+    if (trace_frozen) {
+        return;
+    }
+    uint32_t n;
+    do {
+        n = __LDREXW(&trace_written);
+    } while (__STREXW(n + 1U, &trace_written));
+    uint32_t tag = ((uint32_t)id << 24) | (arg & 0xFFFFFFU);
+    trace_ring[n & (TRACE_RECORDS - 1U)] = ((uint64_t)tag << 32) | DWT_GetCycles();
+#else
+    (void)id;
+    (void)arg;
+#endif
+}
+
+/**
+ * @brief Fault hook: freeze the ring if the trigger is armed
+ * @return void
+ * @note Called from interrupt context (SCHED_Plan(), DEADLINE_TimerIrq()).
+ */
+#if TRACE_RECORDS
+void TRACE_Trigger(void);
+#else
+static inline void TRACE_Trigger(void) {
+}
+#endif
+
+/**
+ * @brief TRACE command handler (payload: op u8, 0 = dump now, 1 = arm the trigger)
+ * @param frame - [in] Received command
+ * @return void
+ */
+void TRACE_HandleCommand(const CMD_Frame *frame);
+
+/**
+ * @brief Send the pending dump, a few frames per call (main loop)
+ * @return void
+ */
+void TRACE_Service(void);
+
+#endif /* TRACE_H_ */
@@ -96,4 +96,64 @@ void USART2_putString(char *string) {
         USART2_Send(*string);
         string++;
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Send a binary buffer via USART2
+ * @details Transmits length bytes using USART2_Send(). Used for framed binary output
+ *          where payload bytes may be zero.
+ *
+ * @param data - Pointer to the bytes to transmit
+ * @param length - Number of bytes
+ * @return void
+ *
+ * @note Blocking function; waits for each byte's transmission
+ * @see USART2_Send, USART2_putString
+ */
+void USART2_SendBuffer(const uint8_t *data, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+        USART2_Send(data[i]);
+    }
+}
+
+/**
+ * @brief Prepare DMA1 Channel 7 for USART2 transmission
+ * @details DMA1 Channel 7 is hard-wired to USART2_TX on the STM32F303 (no remap):
+ *          1. Enable DMA1 clock and USART2 TX DMA requests (CR3.DMAT)
+ *          2. Channel 7: memory → peripheral, memory increment, 8-bit, transfer-complete
+ *             interrupt; destination USART2->TDR
+ *          3. NVIC priority UART_DMA_IRQ_PRIORITY, enabled
+ *
+ * @return void
+ * @note Call after UART_Config(). Do not mix with the blocking USART2_Send() functions
+ *       while a transfer is active.
+ * @see USART2_SendDMA
+ */
+void UART_DMA_Config(void) {
+    RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+    USART2->CR3 |= USART_CR3_DMAT;
+    DMA1_Channel7->CCR = 0;
+    DMA1_Channel7->CPAR = (uint32_t)&USART2->TDR;
+    DMA1_Channel7->CCR = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_TCIE;
+    NVIC_SetPriority(DMA1_Channel7_IRQn, UART_DMA_IRQ_PRIORITY);
+    NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+}
+
+/**
+ * @brief Start a DMA transmission of a buffer via USART2
+ * @details Returns immediately; completion is signalled by the DMA1 Channel 7
+ *          transfer-complete interrupt. The buffer must stay valid until then.
+ *
+ * @param data - Pointer to the bytes to transmit
+ * @param length - Number of bytes (1–65535)
+ * @return void
+ * @note The channel must be idle (previous transfer complete).
+ * @see UART_DMA_Config
+ */
+void USART2_SendDMA(const uint8_t *data, uint16_t length) {
+    DMA1_Channel7->CCR &= ~DMA_CCR_EN;
+    DMA1_Channel7->CMAR = (uint32_t)data;
+    DMA1_Channel7->CNDTR = length;
+    DMA1->IFCR = DMA_IFCR_CGIF7;
+    DMA1_Channel7->CCR |= DMA_CCR_EN;
+}
@@ -2,6 +2,7 @@
  * @file UART.h
  * @brief USART2 driver for MAX30101 data transmission
  * @details Configures USART2 (PA2=TX, PA15=RX) at variable baud rate with blocking transmission
+ *          or DMA transmission on DMA1 Channel 7
  * @author Julio Fajardo, PhD
  * @date 2026-03-26
  */
@@ -11,6 +12,8 @@
 
 #include <stdint.h>
 
+#define UART_DMA_IRQ_PRIORITY   2   /**< DMA1 Channel 7 (TX complete): below USART2 RX, above SysTick */
+
 /**
  * @brief Initialize USART2 for configurable baud rate transmission
  * @details Configuration sequence:
@@ -79,4 +82,40 @@ void USART2_Send(uint8_t c);
  */
 void USART2_putString(char *string);
 
+/**
+ * @brief Send a binary buffer via UART
+ * @details Transmits length bytes using USART2_Send(); unlike USART2_putString() the
+ *          data may contain 0x00 bytes (binary frames).
+ *
+ * @param data - Pointer to the bytes to transmit
+ * @param length - Number of bytes
+ * @return void
+ * @retval N/A (blocking)
+ *
+ * @timing
+ *  - ~21.7 µs per byte at 460800 baud
+ *
+ * @see USART2_Send, USART2_SendDMA
+ */
+void USART2_SendBuffer(const uint8_t *data, uint16_t length);
+
+/**
+ * @brief Prepare DMA1 Channel 7 for USART2 transmission
+ * @return void
+ */
+void UART_DMA_Config(void);
+
+/**
+ * @brief Start a DMA transmission of a buffer via USART2 (non-blocking)
+ * @param data - Bytes to transmit (must stay valid until transfer complete)
+ * @param length - Number of bytes
+ * @return void
+ *
+ * @timing
+ *  - CPU cost: a few register writes; the wire time is unchanged (~21.7 µs per byte)
+ *
+ * @see UART_DMA_Config, STREAM_TxComplete
+ */
+void USART2_SendDMA(const uint8_t *data, uint16_t length);
+
 #endif /* UART_H_ */
@@ -8,13 +8,14 @@
  * @author Julio Fajardo, PhD
  * @date 2026-03-26
  * @version 2.0
- * @see clk_config, LED_config, I2C1_Config, MAX30101_InitNIRSLite, SysTick_Handler
+ * @see clk_config, LED_config, I2C1_Config, MAX30101_InitNIRSLite, SysTick_Handler, USART2_IRQHandler
  */
 
 #include "arm_math_types.h"
 #include "stm32f303x8.h"
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "PLL.h"
 #include "LED.h"
@@ -22,178 +23,607 @@
 #include "PCA9548.h"
 #include "MAX30101.h"
 #include "UART.h"
+#include "DWT.h"
+#include "SCHED.h"
+#include "NIRS.h"
+#include "STREAM.h"
+#include "TIMER.h"
+#include "CMD.h"
+#include "SYNC.h"
+#include "MARKER.h"
+#include "POOL.h"
+#include "PIPE.h"
+#include "STAGES.h"
+#include "DEADLINE.h"
+#include "BENCH.h"
+#include "PROFILE.h"
+#include "IIR.h"
+#include "CONFIG.h"
+#include "BOOT.h"
+#include "TRACE.h"
+#include "CRC.h"
 
 #include "arm_math.h"
 
 #define SYSTICK_FREQ_HZ     50 /**< SysTick interrupt frequency (Hz) */
-#define NUM_SENSORS         1  /**< Active MAX30101 sensors (1–4, routed via PCA9548 CH0–CH3) */
-#define IIR_NUM_SECTIONS    2  /**< Number of biquad sections in the IIR filter */
+#define NUM_SENSORS         1  /**< Active MAX30101 sensors (1–8, routed via PCA9548 CH0–CH7, one scheduler slot each); boot default, see CONFIG.h */
 #define FILTER_TYPE         1  /**< Filter type identifier (1 for high-pass Chebyshev type II, 0 for First-Order IIR High-Pass (DC-Blocker): H(z) = (1 - z^-1) / (1 - alpha*z^-1) */
-#define ALPHA               0.995f /**< Alpha coefficient for first-order IIR DC-Blocker (0.95 corresponds to fc ~0.4 Hz at 50 Hz sampling, 0.995 corresponds to fc ~0.04 Hz at 50 Hz sampling) */
-#define WARMUP_SAMPLES      600 /**< Number of initial samples to process for filter warm-up before entering normal operation state */
+#define FILTER_ORDER        4  /**< Chebyshev type II high-pass order (FILTER_TYPE 1): ⌈order/2⌉ biquad sections, designed at boot for the ODR (IIR.h) */
+#define FILTER_CUTOFF_HZ    0.04f /**< High-pass edge: Chebyshev II stopband edge (FILTER_TYPE 1), DC-Blocker −3 dB point (FILTER_TYPE 0; 0.04 Hz gives alpha ≈ 0.995 at 50 Hz) */
+#define FILTER_STOP_DB      80.0f /**< Chebyshev II stopband attenuation (dB) */
+#define WARMUP_SAMPLES      600 /**< Number of initial samples to process for filter warm-up before entering normal operation state (BOOT_FAST_START: steady-state start instead) */
+#define OUTPUT_FRAMED       1  /**< Output format: 1 = framed multi-stream transport (RAW + FILTERED + HB + STATUS, see STREAM.h), 0 = legacy filtered CSV lines */
+#define UART_BAUD_RATE      460800 /**< USART2 baud rate (also sizes the STREAM link budget) */
+#define LED_RED_MA          10.0f /**< Red LED current (mA, up to 51 mA) */
+#define LED_IR_MA           10.0f /**< IR LED current (mA, up to 51 mA) */
+#define OUTPUT_PASSTHROUGH  0  /**< 1 = raw passthrough: FIFO bytes go by I2C DMA into RAW frames and by UART DMA to the host, no unpacking/filtering (requires OUTPUT_FRAMED) */
+#define PASSTHROUGH_ODR_HZ  400 /**< Sensor ODR in passthrough mode (50, 100, 200 or 400 Hz) */
+#define PASSTHROUGH_PERIOD_HZ 25 /**< Drain rate per sensor in passthrough mode (16 samples per drain at 400 Hz) */
+
+#define WATCHDOG_MS         0  /**< IWDG timeout (ms) reloaded only while acquisition and main loop both progress; 0 = watchdog off */
+#define BENCH_MODE          1  /**< On-target benchmark (BENCH.h): 0 = off, 1 = on host command CMD_BENCH, 2 = also once at boot. Its buffers take ~1.2 KB of RAM0 and 916 B of CCM: with them ~1.1 KB of RAM0 and 56 B of CCM stay free, 0 frees both */
+#define OPERATING_PROFILE   PROFILE_STANDARD /**< Boot profile (PROFILE.h): standard, latency or throughput; CMD_PROFILE switches at run time */
+#define SENSOR_INT_WIRED    0  /**< 1 = INT of the sensor on CH0 wired to PA1: the latency profile drains on PPG_RDY (single sensor only) */
+#define SUMMARY_WINDOW_MS   0  /**< Summary statistics window per sensor (ms): one SUMMARY frame of Red/IR mean, std, min, max, rms per window; 0 = off. CMD_SUMMARY changes it at run time */
+#define SUMMARY_FULL_RATE   1  /**< 0 = boot with summary-only output (no RAW/FILTERED/HB frames until CMD_SUMMARY turns them on; requires OUTPUT_FRAMED) */
+#define DEADBAND_THRESHOLD_NA 0.0f /**< Change-driven output: DEADBAND frames carry a filtered Red/IR value only when it moved more than this since the last one sent (nA); 0 = off. CMD_DEADBAND changes it at run time */
+#define DEADBAND_MAX_SILENCE_MS 1000 /**< Longest interval without a DEADBAND update per channel (ms, 0 = no limit) */
+#define HAMPEL_WINDOW       0  /**< Spike removal before the high-pass: Hampel filter over the last HAMPEL_WINDOW samples of each channel (odd, 5–63; 0 = off); a sample further than HAMPEL_THRESHOLD scaled MADs from the window median is replaced by the median */
+#define HAMPEL_THRESHOLD    3.0f /**< Hampel limit in scaled MADs (1.4826·MAD ≈ σ); 0 = running median */
+#define HAMPEL_MIN_DEV_NA   0.1f /**< Deviations from the median up to this are never replaced (nA; ~6 LSB, a flat quantised signal has MAD 0) */
+#define HB_KALMAN           0  /**< ΔHbO2/ΔHHb estimator: 0 = per-sample modified Beer-Lambert inversion, 1 = Kalman filter on the ΔOD of every wavelength slot (NIRS.h) */
+#define HB_KALMAN_Q_RATE    0.2f /**< Kalman random-walk rate of ΔHbO2/ΔHHb (µM/√s): larger follows faster, smaller smooths more (Tools/nirs_kalman.py) */
+#define HB_KALMAN_OD_NOISE  1.5e-4f /**< ΔOD noise per sample assumed by the Kalman filter (1 σ, Red and IR; 0.5 nA on 1.5 µA) */
+#define TSI_PERIOD_MS       0  /**< Multi-distance tissue saturation index: one TSI frame per interval from all sensors at TSI_DISTANCES_MM (ms); 0 = off */
+#define TSI_DISTANCES_MM    { 20.0f, 25.0f, 30.0f, 35.0f } /**< Source–detector distance of the sensor on each PCA9548 channel (mm); channels not listed or at 0 are left out of the fit */
+#define PRESENCE_GATING     0  /**< 1 = park a sensor whose IR stays below PRESENCE_MIN_NA for PRESENCE_HOLD_MS (probe off the skin) in MAX30101 proximity mode, poll it every PRESENCE_POLL_MS and re-admit it on PROX_INT (SCHED.h); its slots go to the other sensors */
+#define PRESENCE_MIN_NA     50.0f /**< IR current at LED_IR_MA below which the probe counts as off the skin (nA) */
+#define PRESENCE_HOLD_MS    2000 /**< Time below PRESENCE_MIN_NA before the sensor is parked (ms) */
+#define PRESENCE_POLL_MS    500 /**< PROX_INT poll interval of a parked sensor (ms): bounds the re-admission delay */
+#define PRESENCE_PILOT_MA   5.0f /**< IR LED current while parked (mA) */
+#define PRESENCE_PROX_NA    48.0f /**< IR current at PRESENCE_PILOT_MA that wakes a parked sensor (nA, 16 nA steps; ~2 × PRESENCE_MIN_NA at the drive current here, for hysteresis) */
+#define ADAPTIVE_POLL_FILL  0  /**< FIFO fill (samples) each drain should find: the acquisition period is retuned after every period within [ADAPTIVE_POLL_MIN_US, ADAPTIVE_POLL_MAX_US] and the slots are timed by TIM2 CH2 (SCHED.h); 0 = fixed period. Ignored in data-ready mode */
+#define ADAPTIVE_POLL_MIN_US 5000 /**< Shortest adaptive period (µs): bounds the bus load */
+#define ADAPTIVE_POLL_MAX_US 200000 /**< Longest adaptive period (µs): latency ceiling from a sample to its drain */
+#define SYNC_START          0  /**< 1 = configure every sensor in shutdown and release all of them with one broadcast write through the PCA9548 (SCHED_SyncStart()), then track their phases and time-stamp frames from them; "#PHASE" reports the offset to sensor 0 */
+#define PREDICTIVE_DRAIN    0  /**< Predicted slots between two FIFO status reads (SCHED.h): the burst count comes from elapsed time × the learned sample rate, WR_PTR/OVF are read at most every PREDICTIVE_DRAIN slots to verify the model; 0 = status read on every slot */
+#define BOOT_FAST_START     0  /**< 1 = sensor configuration by I2C1 interrupt while UART and filters are set up, steady-state filter start, first frame handed off at once (BOOT.h) */
+
+#if OUTPUT_PASSTHROUGH && !OUTPUT_FRAMED
+#error "OUTPUT_PASSTHROUGH requires OUTPUT_FRAMED"
+#endif
+#if HAMPEL_WINDOW && (HAMPEL_WINDOW < STAGE_HAMPEL_MIN_WINDOW || HAMPEL_WINDOW > STAGE_HAMPEL_MAX_WINDOW || HAMPEL_WINDOW % 2 == 0)
+#error "HAMPEL_WINDOW must be 0 or an odd number from 5 to 63"
+#endif
+#if TRACE_RECORDS && !OUTPUT_FRAMED
+#error "TRACE_RECORDS (TRACE.h) requires OUTPUT_FRAMED"
+#endif
+#if TSI_PERIOD_MS && (!OUTPUT_FRAMED || OUTPUT_PASSTHROUGH)
+#error "TSI_PERIOD_MS requires OUTPUT_FRAMED and no passthrough"
+#endif
+#if !SUMMARY_FULL_RATE && (!OUTPUT_FRAMED || OUTPUT_PASSTHROUGH || !SUMMARY_WINDOW_MS)
+#error "SUMMARY_FULL_RATE 0 requires OUTPUT_FRAMED, no passthrough and a SUMMARY_WINDOW_MS"
+#endif
+
+#if OUTPUT_PASSTHROUGH
+#define ACQ_PERIOD_HZ       PASSTHROUGH_PERIOD_HZ
+#else
+#define ACQ_PERIOD_HZ       SYSTICK_FREQ_HZ
+#endif
+
+/** @name Stage budgets (CPU cycles per sample, see #PIPE reports)
+ * @{ */
+#define BUDGET_UNPACK       80
+#define BUDGET_HAMPEL       1500
+#define BUDGET_FILTER       300
+#define BUDGET_DELTA_HB     800
+#define BUDGET_HB_KALMAN    1000
+#define BUDGET_SUMMARY      150
+#define BUDGET_TSI          100
+#define BUDGET_DEADBAND     150
+#define BUDGET_ENCODE       400
+#define BUDGET_CSV          30000
+#define BUDGET_TRANSMIT     400
+/** @} */
 
 volatile uint8_t data_ready = 0; /**< Flag set by SysTick_Handler when new data is available for processing in main loop */
-uint8_t process_state = 0; /**< State 0 is for filter warm-up, 1 is for normal operation  */
 
 char tx_buffer[128];  /**< General-purpose buffer for UART transmission */
 
-/**
- * @brief FINAL PROCESSED DATA: Calibrated current in nanoamps (nA)
- * @details 32-sample buffer holding calibrated photodiode current values (0–4096nA).
- *          This is the primary output buffer for post-processing and external transmission.
- *          Updated by SysTick ISR approximately every 20 ms (variable latency based on FIFO fill).
- *          @see SysTick_Handler
- *          @note SpO2 mode memory: 8 samples × 8 bytes (2 × float32_t) = 64 bytes
- *          @note Typically accessed in main loop after ISR completion
- */
+/** Compiled-in configuration, used until one is stored in flash (CMD_CONFIG)
+    * @details The filter defaults give a 4th-order Chebyshev type II high-pass with its stopband edge at
+    *          0.04 Hz and 80 dB stopband attenuation. At 50 Hz the run-time design reproduces the MATLAB
+    *          fdesign.highpass cascade the firmware used to carry as a constant table (Tools/nirs_iir.py).
+    *          @see CONFIG_Load, DesignFilters
+*/
+static const CONFIG_Params config_defaults = {
+    UART_BAUD_RATE, FILTER_CUTOFF_HZ, LED_RED_MA, LED_IR_MA,
+    OUTPUT_PASSTHROUGH ? PASSTHROUGH_ODR_HZ : MAX30101_ODR_HZ,
+    NUM_SENSORS, OPERATING_PROFILE, FILTER_ORDER, (uint8_t)FILTER_STOP_DB
+};
 
- /** Global variables for storing current samples */
-volatile MAX30101_CurrentSample MAX30101_NIRS_SingleCurrentSample;
-MAX30101_CurrentSample FilteredSample;
+static CONFIG_Params config;    /**< Configuration in effect (CONFIG_Load() at boot) */
 
-/** Chebyshev High-pass (dc-blocker) IIR Filter Coefficients 
-    * @details 4th-order Chebyshev type II high-pass filter with 0.04 Hz cutoff frequency, designed using MATLAB's fdesign.highpass and implemented as a cascade of biquads.
-    *          Coefficients are in the form [b0, b1, b2, a1, a2] for each biquad section, with feedback coefficients negated for CMSIS-DSP compatibility.
-    *          The filter is applied to the raw current samples to remove DC offset and low-frequency drift before further processing.
-    *          @see iir_init, iir
-    *          @note Designed for a sampling frequency of 50 Hz (matching MAX30101 ODR)
-    *          @note Coefficients must be in single-precision float format for CMSIS-DSP
-*/
-const float32_t iirCoeffs[5 * IIR_NUM_SECTIONS] = {         
-    0.98855555f,    -1.9770899f,    0.98855555f,    1.9766545f,     -0.97754645f,
-    0.97310543f,    -1.9462072f,    0.97310543f,    1.9457787f,     -0.94663936f
- };
+#if FILTER_TYPE == 1 || BENCH_MODE
+/** Biquad coefficients [b0, b1, b2, a1, a2] per section, feedback negated for CMSIS-DSP (DesignFilters()) */
+static float32_t iirCoeffs[5 * STAGE_BIQUAD_MAX_SECTIONS];
+#endif
+
+#if FILTER_ORDER < 1 || FILTER_ORDER > 2 * STAGE_BIQUAD_MAX_SECTIONS
+#error "FILTER_ORDER must be 1 to 2 * STAGE_BIQUAD_MAX_SECTIONS"
+#endif
+#if NUM_SENSORS < 1 || NUM_SENSORS > CONFIG_MAX_SENSORS
+#error "NUM_SENSORS must be 1 to CONFIG_MAX_SENSORS"
+#endif
+
+#if BOOT_FAST_START
+#define FILTER_WARMUP       STAGE_WARMUP_STEADY
+#else
+#define FILTER_WARMUP       WARMUP_SAMPLES
+#endif
+
+/** Kalman ΔHb model, designed for the ODR with the filters (DesignHbModel()) */
+static NIRS_KalmanModel hb_model;
+#if HAMPEL_WINDOW && !OUTPUT_PASSTHROUGH
+static const STAGE_HampelConfig hampel_config = { HAMPEL_WINDOW, HAMPEL_THRESHOLD, HAMPEL_MIN_DEV_NA };
+#endif
+#if FILTER_TYPE == 1
+static STAGE_BiquadConfig filter_config = { iirCoeffs, 0, FILTER_WARMUP };
+#else
+static STAGE_DCBlockerConfig filter_config = { 0.0f, FILTER_WARMUP };
+#endif
+#if OUTPUT_FRAMED && !OUTPUT_PASSTHROUGH
+static STAGE_SummaryConfig summary_config = { 0 };  /* window set at boot and by CMD_SUMMARY */
+static STAGE_DeadbandConfig deadband_config = { 0.0f, 0 };  /* set at boot and by CMD_DEADBAND */
+#endif
+#if TSI_PERIOD_MS
+static const STAGE_TsiConfig tsi_config = { TSI_DISTANCES_MM, TSI_PERIOD_MS * 1000U };
+#endif
+#if !OUTPUT_FRAMED
+static STAGE_CsvConfig csv_config = { 0 };  /* with_sensor set at boot */
+#endif
+#if BENCH_MODE
+/* Both filter options are benchmarked, whichever FILTER_TYPE is built */
+static STAGE_BiquadConfig bench_biquad = { iirCoeffs, 0, 0 };
+static STAGE_DCBlockerConfig bench_dcblock = { 0.0f, 0 };
+static const BENCH_Config bench_config = { &bench_biquad, &bench_dcblock, &hb_model, 0 };
+#endif
 
-float32_t iirStatesRed[2 * IIR_NUM_SECTIONS] = {0}; /**< State buffer for the IIR filter, initialized to zero */
-arm_biquad_cascade_df2T_instance_f32 IIR_Red; /**< CMSIS-DSP IIR filter instance structure */
-float32_t iirStatesIR[2 * IIR_NUM_SECTIONS] = {0}; /**< State buffer for the IIR filter, initialized to zero */
-arm_biquad_cascade_df2T_instance_f32 IIR_IR; /**< CMSIS-DSP IIR filter instance structure */
+/**
+ * @brief Main-loop processing pipeline (PIPE.h), one block per RAW frame
+ * @details acquire → condition → feature → encode → transmit. Stages are chained here
+ *          only; reordering or adding a stage does not touch the acquisition ISR.
+ */
+static const PIPE_Stage pipeline[] = {
+#if OUTPUT_PASSTHROUGH
+    STAGE_TRANSMIT_RAW(BUDGET_TRANSMIT),
+#else
+    STAGE_UNPACK(BUDGET_UNPACK),
+    #if HAMPEL_WINDOW
+    STAGE_HAMPEL(&hampel_config, HAMPEL_WINDOW, BUDGET_HAMPEL),
+    #endif
+    #if FILTER_TYPE == 1
+    STAGE_BIQUAD_HP(&filter_config, BUDGET_FILTER),
+    #else
+    STAGE_DC_BLOCKER(&filter_config, BUDGET_FILTER),
+    #endif
+    #if OUTPUT_FRAMED
+    #if HB_KALMAN
+    STAGE_DELTA_HB_KALMAN(&hb_model, BUDGET_HB_KALMAN),
+    #else
+    STAGE_DELTA_HB(BUDGET_DELTA_HB),
+    #endif
+    STAGE_SUMMARY(&summary_config, BUDGET_SUMMARY),
+    #if TSI_PERIOD_MS
+    STAGE_TSI(&tsi_config, BUDGET_TSI),
+    #endif
+    STAGE_DEADBAND(&deadband_config, BUDGET_DEADBAND),
+    STAGE_ENCODE_FRAMES(BUDGET_ENCODE),
+    STAGE_TRANSMIT_RAW(BUDGET_TRANSMIT),
+    #else
+    STAGE_ENCODE_CSV(&csv_config, BUDGET_CSV),
+    #endif
+#endif
+};
+
+/* Last sample taken from the scheduler, per sensor (reference for marker events) */
+uint32_t last_index[CONFIG_MAX_SENSORS] = {0}; /**< Index of the last processed sample */
+uint32_t last_time[CONFIG_MAX_SENSORS] = {0};  /**< Estimated acquisition time of that sample (TIM2 µs) */
+uint8_t sensors_seen = 0;               /**< Bit k set once sensor k has delivered a sample */
 
-/* First-order DC-Blocker states */
-float32_t w_red = 0.0f; /**< First-order DC-Blocker intermediate state for red channel */
-float32_t w_ir  = 0.0f; /**< First-order DC-Blocker intermediate state for IR channel */
+/* CPU load accounting for the passthrough report (DWT cycles). The handlers run at
+ * different priorities, so each owns one counter (a handler cannot preempt itself and no
+ * update is lost) and SendPassReport() sums them. */
+#define ISR_SYSTICK     0
+#define ISR_I2C1_EV     1
+#define ISR_DMA1_CH7    2
+#define ISR_COUNTED     3
+volatile uint32_t isr_cycles[ISR_COUNTED] = {0}; /**< Cycles spent in the SysTick, I2C1 and DMA1 Ch7 handlers */
+uint32_t main_cycles = 0;               /**< Cycles spent handling frames in the main loop */
 
 /* Function prototypes */
-static inline void IIR_FilterWarmup(const MAX30101_CurrentSample *s);
+static void SendReport(const char *line);
+static void SendMarker(const MARKER_Event *marker);
+#if OUTPUT_PASSTHROUGH
+static void SendPassReport(void);
+#endif
+#if BENCH_MODE
+static void SendPacedReport(const char *line);
+static void HandleBench(const CMD_Frame *frame);
+#endif
+static void HandleProfile(const CMD_Frame *frame);
+static void HandleConfig(const CMD_Frame *frame);
+#if OUTPUT_FRAMED && !OUTPUT_PASSTHROUGH
+static void SetSummary(uint16_t window_ms, uint8_t full_rate);
+static void HandleSummary(const CMD_Frame *frame);
+static void SetDeadband(float32_t threshold_na, uint16_t max_silence_ms);
+static void HandleDeadband(const CMD_Frame *frame);
+#endif
+static void DesignFilters(float32_t fs_hz);
+static void DesignHbModel(float32_t fs_hz);
 
 /**
  * @brief System initialization and main control loop
  * @details Initializes all peripherals in sequence:
  *          1. **Clock**: PLL to 64 MHz (HSI 8 MHz × 16)
- *          2. **GPIO**: Status LED on PB3 (push-pull output)
- *          3. **I2C1**: 400 kHz fast-mode on PB6 (SCL), PB7 (SDA)
- *          4. **Sensor**: MAX30101 NIRS Lite mode — Red + IR at 50 Hz, 10.0 mA each
- *          5. **UART**: USART2 at 460800 baud (PA2=TX, PA15=RX)
- *          6. **Timer**: SysTick at 50 Hz (20 ms period), enabling the acquisition ISR
+ *          2. **Configuration**: newest valid record of the flash configuration pages
+ *             (CONFIG.h), or the compiled-in defaults (NUM_SENSORS, LED_RED_MA, ...)
+ *          3. **GPIO**: Status LED on PB3 (push-pull output)
+ *          4. **I2C1**: 400 kHz fast-mode on PB6 (SCL), PB7 (SDA)
+ *          5. **Sensor**: MAX30101 NIRS Lite mode — Red + IR at the configured ODR and LED
+ *             currents (50 Hz, 10.0 mA each by default), on every PCA9548 channel in use
+ *          6. **UART**: USART2 at the configured baud rate (460800, PA2=TX, PA15=RX)
+ *          7. **Timer**: SysTick at SYSTICK_FREQ_HZ × sensors, one phase-staggered slot per sensor
  *
  *          After initialization, the main loop waits for data_ready (set by SysTick ISR),
- *          applies the selected high-pass filter to remove DC offset, and transmits each
- *          filtered Red/IR sample pair over UART as a CSV string.
+ *          takes the completed RAW pool frames from the scheduler and runs each one as a
+ *          block through the stage table `pipeline` (PIPE.h, STAGES.h):
+ *          - unpack: FIFO words of the frame → currents (nA)
+ *          - condition: Hampel spike removal on the currents (HAMPEL_WINDOW)
+ *          - condition: the selected high-pass filter of the originating sensor
+ *          - feature: ΔHbO2/ΔHHb (NIRS.c) from the unfiltered currents, per sample or
+ *            by the Kalman estimator (HB_KALMAN)
+ *          - summary: windowed Red/IR statistics (SUMMARY_WINDOW_MS), one SUMMARY frame
+ *            per window and sensor
+ *          - tsi: tissue saturation index across sensors at different distances
+ *            (TSI_PERIOD_MS), one TSI frame per interval
+ *          - encode: change-driven DEADBAND frames (DEADBAND_THRESHOLD_NA), decimated
+ *            FILTERED and HB frames
+ *          - transmit: the RAW frame itself, unchanged, by UART DMA (no copy of the FIFO
+ *            bytes between I2C and the wire); it returns to the pool afterwards
+ *          Per-stage cycle budgets and profiling totals are reported as "#PIPE" lines.
+ *          With OUTPUT_PASSTHROUGH == 1 the sensors run at PASSTHROUGH_ODR_HZ, the FIFO
+ *          reads run as an I2C/DMA chain (SCHED_EnableDMA) and the pipeline is only the
+ *          transmit stage: no unpacking, filtering, HB or FILTERED streams. A "#PASS"
+ *          line reports the sustained sample rate and CPU load with the other reports.
+ *          With OUTPUT_FRAMED == 0 the encode stage produces the legacy output instead: one filtered Red/IR
+ *          CSV line per sample (prefixed with the sensor index when NUM_SENSORS > 1).
+ *          Every SCHED_REPORT_PERIODS periods "#SCHED" (with "#PRESENCE" under
+ *          PRESENCE_GATING, "#PREDICT" under PREDICTIVE_DRAIN, "#PHASE" under
+ *          SYNC_START and "#ADAPT" under ADAPTIVE_POLL_FILL) and "#STREAM"
+ *          statistics lines are sent (STATUS stream when
+ *          framed), followed by "#MARKER", "#POOL", "#PIPE"
+ *          and "#DEADLINE" (slot and consumer-pass deadline misses with the stage that
+ *          was running; WATCHDOG_MS arms the IWDG as a last resort against hangs) and,
+ *          when framed, "#LATENCY" (sample-to-UART percentiles of RAW and FILTERED).
+ *          CMD_SUMMARY sets the summary window and switches between the full-rate
+ *          streams and summary-only output ("#SUMMARY"; SUMMARY_FULL_RATE at boot),
+ *          CMD_DEADBAND the change-driven output threshold ("#DEADBAND").
+ *          CMD_CONFIG reads and stores the configuration ("#CONFIG", also sent once at
+ *          boot); stored values take effect after a reset (CONFIG_OP_RESET).
+ *          The boot phases are time-stamped with DWT and reported once, as "#BOOT",
+ *          after the first sample has passed the pipeline (BOOT.h). BOOT_FAST_START
+ *          overlaps the sensor register writes (I2C1 interrupt chain) with the UART and
+ *          filter set-up, starts the filters at the steady state of the first sample
+ *          instead of WARMUP_SAMPLES iterations and outputs that sample, and hands the
+ *          first frame of each sensor off after its first drain.
+ *          OPERATING_PROFILE selects the boot profile (PROFILE.h): standard, latency
+ *          (one sample per drain and frame, PPG_RDY-triggered with SENSOR_INT_WIRED) or
+ *          throughput (deep FIFO batches, full RAW frames); CMD_PROFILE switches it.
+ *          PRESENCE_GATING parks a sensor whose probe is off the skin in proximity mode
+ *          and re-admits it, with a new ΔHb baseline, when it is reattached (SCHED.h).
+ *          PREDICTIVE_DRAIN skips most FIFO status reads: the burst count is predicted
+ *          from elapsed time and the learned sample rate and verified every few slots.
+ *          ADAPTIVE_POLL_FILL lets the drain period follow the FIFO fill when the INT
+ *          pin is not wired, between a bus-load floor and a latency ceiling.
+ *          SYNC_START holds the sensors in shutdown until one broadcast write starts
+ *          them together, then tracks their phases so frames line up on the device.
+ *          Marker edges on PA0 are output as soon as the main loop sees them, as EVENT
+ *          frames (or "#EVENT" lines) referencing the nearest sample of every sensor.
+ *          Host commands received on USART2 are dispatched by CMD_Poll() at the top of
+ *          every loop iteration; with OUTPUT_FRAMED == 1 sync pings are answered by
+ *          SYNC_HandlePing() so the host can map device time stamps to its own clock.
+ *          With TRACE_RECORDS (TRACE.h) set, task, stage, interrupt, I2C and UART events
+ *          go to a cycle-stamped ring that CMD_TRACE dumps, now or at the next fault.
  *          All sensor acquisition runs in the ISR; filtering and transmission run in main.
  *
  *          Two DC-removal filters are available, selected at compile time via FILTER_TYPE:
  *          - **FILTER_TYPE 0** (default): First-order IIR DC-Blocker H(z) = (1 - z^-1) / (1 - alpha*z^-1),
- *            alpha = 0.95, fc ~= 0.4 Hz, alpha = 0.995, fc ~= 0.04 Hz. Minimal CPU cost, suitable for resource-constrained operation.
+ *            alpha ≈ 0.95 for fc = 0.4 Hz, alpha ≈ 0.995 for fc = 0.04 Hz at 50 Hz. Minimal CPU cost, suitable for resource-constrained operation.
  *          - **FILTER_TYPE 1**: 4th-order Chebyshev type II high-pass filter, fc = 0.04 Hz, implemented as a
  *            cascade of 2 biquad sections via CMSIS-DSP. Maximally flat passband; preferred for
  *            clean PPG signal extraction in NIRS applications.
+ *          Both are designed at boot for the configured ODR (DesignFilters(), IIR.h), so the
+ *          cut-off stays at FILTER_CUTOFF_HZ whatever the sample rate.
  *
  * @param None
  * @return int - Never returns (infinite loop)
  * @note Initialization order is critical: I2C must be configured before MAX30101,
  *       and UART before SysTick to avoid transmitting before the port is ready.
- *       When FILTER_TYPE == 1, arm_biquad_cascade_df2T_init_f32() must be called
- *       after clk_config() to ensure the PLL and stack are stable.
+ *       PIPE_Init() (which initialises the filter stages) must run after DWT_Init(),
+ *       and DWT_Init() comes before clk_config() so the boot timeline covers it.
  * @warning Enabling SysTick (last step) immediately arms the ISR. Any initialization
  *          that must complete before the first ISR fires should precede SysTick_Config().
  * @execution
  *   - Blocking operations during init: PLL lock (~few µs), I2C configuration
- *   - Time to first ISR: ~20 ms after SysTick_Config()
- * @see clk_config, LED_config, I2C1_Config, MAX30101_InitNIRSLite, SysTick_Handler
+ *   - Time to first ISR: one slot (20 ms / NUM_SENSORS) after SCHED_Start()
+ * @see clk_config, LED_config, I2C1_Config, MAX30101_InitNIRSLite, SysTick_Handler, USART2_IRQHandler
  * @example
- *   // After init, main loop outputs one filtered line per sample at 50 Hz:
+ *   // OUTPUT_FRAMED == 1: RAW frames every 8 samples, FILTERED and HB frames at 10 Hz
+ *   // OUTPUT_FRAMED == 0: one filtered line per sample at 50 Hz:
  *   // "1234.567,2345.678\r\n"  (Red nA, IR nA -- DC removed)
+ *   // NUM_SENSORS > 1: "2,1234.567,2345.678\r\n"  (sensor, Red nA, IR nA)
  */
 int main(void) {
+    // Start the DWT cycle counter (boot timeline, scheduler timing statistics)
+    DWT_Init();
     // Configure system clock to 64 MHz via PLL
     clk_config();
-     #if FILTER_TYPE == 1
-        // Coefficients already defined for high-pass Chebyshev type II
-        arm_biquad_cascade_df2T_init_f32(&IIR_Red, IIR_NUM_SECTIONS, iirCoeffs, iirStatesRed);
-        arm_biquad_cascade_df2T_init_f32(&IIR_IR, IIR_NUM_SECTIONS, iirCoeffs, iirStatesIR);
-    #endif
+    BOOT_Mark(BOOT_CLOCK);
+    // Start the TIM2 1 MHz device timebase (sample and receive timestamps)
+    TIMER_Init();
+    // CRC unit for the stored configuration, output frames and benchmark (software fallback)
+    CRC_Init();
+    // Stored configuration (sensors, ODR, LED currents, filter, baud, profile) before anything uses it
+    CONFIG_Load(&config_defaults, &config);
+    BOOT_Mark(BOOT_CONFIG);
     // Configure GPIO port B pin 3 as push-pull output for LED
     LED_config();
     // Configure I2C1 (400 kHz) for MAX30101 communication
     I2C1_Config();
-    // Initialize PCA9548 I2C switch (disable all channels) and select the active channel
+    // Initialize PCA9548 I2C switch (disable all channels)
     PCA9548_Init();
-    PCA9548_SelectChannel(0); // Select channel 0 (first sensor)
-    // Initialize MAX30101 for NIRS measurement with medium LED power
-    MAX30101_InitNIRSLite(10.0f,10.0f);  // 10.0 mA LED current for low power operation (up to 51 mA max)
-    // Configure USART2 (PA2=TX, PA15=RX) at 460800 baud for data transmission
-    UART_Config(460800);
-    // Configure SysTick for 20 ms interrupts (SYSTICK_FREQ_HZ = 50 Hz)
-    SysTick_Config(SystemCoreClock / SYSTICK_FREQ_HZ);
+    BOOT_Mark(BOOT_BUS);
+    // Initialize every MAX30101 for NIRS measurement at the configured LED currents and ODR
+    #if BOOT_FAST_START
+        // Register writes chained by the I2C1 interrupt while the link and filters are set up
+        I2C1_DMA_Config();
+        BOOT_StartSensors(config.num_sensors, config.led_red_ma, config.led_ir_ma, config.odr_hz, SYNC_START);
+    #else
+        for (uint8_t k = 0; k < config.num_sensors; k++) {
+            PCA9548_SelectChannel(k);
+            MAX30101_InitNIRSLite(config.led_red_ma, config.led_ir_ma);
+            if (config.odr_hz != MAX30101_ODR_HZ) {
+                MAX30101_SetSampleRate(config.odr_hz);
+            }
+            #if SYNC_START
+                MAX30101_SetShutdown(1); // Held until SCHED_SyncStart()
+            #endif
+        }
+        BOOT_Mark(BOOT_SENSORS);
+    #endif
+    // Configure USART2 (PA2=TX, PA15=RX) for data transmission
+    UART_Config(config.baud_rate);
+    // Frame pool shared by acquisition, encoding and UART DMA
+    POOL_Init();
+    #if OUTPUT_FRAMED
+        UART_DMA_Config();
+    #endif
+    // Output multiplexer and hemoglobin conversion
+    STREAM_Init(config.baud_rate);
+    NIRS_Init();
+    // Host command receiver (USART2 RX interrupt) and clock synchronisation
+    CMD_Init(config.baud_rate);
+    #if OUTPUT_FRAMED
+        SYNC_Init();
+        CMD_Register(CMD_PING, SYNC_HandlePing);
+    #endif
+    #if BENCH_MODE
+        CMD_Register(CMD_BENCH, HandleBench);
+    #endif
+    CMD_Register(CMD_PROFILE, HandleProfile);
+    CMD_Register(CMD_CONFIG, HandleConfig);
+    #if OUTPUT_FRAMED && !OUTPUT_PASSTHROUGH
+        CMD_Register(CMD_SUMMARY, HandleSummary);
+        CMD_Register(CMD_DEADBAND, HandleDeadband);
+    #endif
+    #if TRACE_RECORDS
+        CMD_Register(CMD_TRACE, TRACE_HandleCommand);
+    #endif
+    // External event marker input on PA0 (TIM2_CH1 capture + EXTI0)
+    MARKER_Init();
+    BOOT_Mark(BOOT_LINK);
+    // DC-removal filters and Kalman ΔHb model for the configured ODR, then the main-loop
+    // processing chain (filter state per sensor in the pipeline arena)
+    float32_t fs_hz = 1000000.0f / (float32_t)MAX30101_GetSamplePeriodUs();
+    DesignFilters(fs_hz);
+    DesignHbModel(fs_hz);
+    #if !OUTPUT_FRAMED
+        csv_config.with_sensor = config.num_sensors > 1;
+    #endif
+    #if OUTPUT_FRAMED && !OUTPUT_PASSTHROUGH
+        SetSummary(SUMMARY_WINDOW_MS, SUMMARY_FULL_RATE);
+        SetDeadband(DEADBAND_THRESHOLD_NA, DEADBAND_MAX_SILENCE_MS);
+    #endif
+    if (!PIPE_Init(pipeline, sizeof(pipeline) / sizeof(pipeline[0]), config.num_sensors)) {
+        // Stage state of this many sensors exceeds PIPE_ARENA_BYTES (e.g. a long HAMPEL_WINDOW)
+        SendReport("#PIPEERR,state does not fit the arena\r\n");
+    }
+    BOOT_Mark(BOOT_FILTERS);
+    #if BOOT_FAST_START
+        BOOT_WaitSensors();
+    #endif
+    // Deadlines: a slot must end before the next slot, a consumer pass within one period
+    DEADLINE_Init(1000000U / (ACQ_PERIOD_HZ * config.num_sensors), 1000000U / ACQ_PERIOD_HZ);
+    // One slot per sensor within each acquisition period (20 ms at SYSTICK_FREQ_HZ = 50 Hz)
+    SCHED_Init(config.num_sensors, ACQ_PERIOD_HZ);
+    #if PRESENCE_GATING
+        // Off-skin detector and proximity wake-up of every sensor
+        static const SCHED_PresenceConfig presence = { PRESENCE_MIN_NA, PRESENCE_HOLD_MS, PRESENCE_POLL_MS,
+                                                       PRESENCE_PILOT_MA, PRESENCE_PROX_NA };
+        SCHED_EnablePresence(&presence);
+    #endif
+    #if PREDICTIVE_DRAIN
+        // FIFO fill predicted from elapsed time and ODR, status read only to verify
+        SCHED_EnablePrediction(PREDICTIVE_DRAIN);
+    #endif
+    #if ADAPTIVE_POLL_FILL
+        // Drain period retuned to the FIFO fill, slots timed by TIM2 CH2
+        static const SCHED_AdaptiveConfig adaptive = { ADAPTIVE_POLL_FILL, ADAPTIVE_POLL_MIN_US, ADAPTIVE_POLL_MAX_US };
+        SCHED_EnableAdaptive(&adaptive);
+    #endif
+    #if OUTPUT_PASSTHROUGH
+        // FIFO reads by I2C1 interrupt + DMA1 Channel 3 instead of polling in SysTick
+        I2C1_DMA_Config();
+        SCHED_EnableDMA();
+    #endif
+    // Operating profile: drain period, RAW frame size, summary decimation, slot trigger
+    PROFILE_Init(SCHED_GetPeriodUs(), SENSOR_INT_WIRED);
+    PROFILE_Apply(config.profile);
+    CONFIG_FormatReport(tx_buffer, sizeof(tx_buffer));
+    SendReport(tx_buffer);
+    #if BENCH_MODE == 2
+        // Driver and kernel timings of this board and build, before acquisition starts
+        BENCH_Run(&bench_config, SendPacedReport);
+    #endif
+    #if WATCHDOG_MS
+        DEADLINE_EnableWatchdog(WATCHDOG_MS);
+    #endif
+    #if BOOT_FAST_START
+        SCHED_HandoffFirst();
+    #endif
+    #if SYNC_START
+        // Every sensor leaves shutdown with the same broadcast write
+        SCHED_SyncStart();
+    #endif
+    SCHED_Start();
+    BOOT_Mark(BOOT_READY);
     
     // Main loop: real work happens in SysTick_Handler ISR
     for (;;) {
+        CMD_Poll(); // Host commands (sync pings) are answered between sample batches
+        DEADLINE_Service(); // Watchdog reload once acquisition and consumer both progressed
+        #if TRACE_RECORDS
+            TRACE_Service(); // Event trace dump, paced by the link budget
+        #endif
+        MARKER_Event marker;
+        while (MARKER_Pop(&marker)) {
+            SendMarker(&marker);
+        }
         if(data_ready) {
             data_ready = 0; // Clear flag for next ISR cycle
-            uint32_t primask = __get_PRIMASK();
-            __disable_irq(); // Disable interrupts to safely access shared data 
-            MAX30101_CurrentSample sample = (MAX30101_CurrentSample)MAX30101_NIRS_SingleCurrentSample;
-            __set_PRIMASK(primask); // Restore previous interrupt state
-            if(process_state) { // Normal operation: apply IIR filter to incoming samples
-                #if FILTER_TYPE == 1
-                    arm_biquad_cascade_df2T_f32(&IIR_Red, (float32_t *)&sample.red, (float32_t *)&FilteredSample.red, 1);
-                    arm_biquad_cascade_df2T_f32(&IIR_IR, (float32_t *)&sample.ir, (float32_t *)&FilteredSample.ir, 1);
-                #else
-                    FilteredSample.red = MAX30101_FirstOrderDC_Blocker(sample.red, &w_red, ALPHA);
-                    FilteredSample.ir  = MAX30101_FirstOrderDC_Blocker(sample.ir,  &w_ir, ALPHA);
+            DEADLINE_Begin(DEADLINE_BATCH);
+            uint32_t t_frames = DWT_GetCycles();
+            #if PRESENCE_GATING && !OUTPUT_PASSTHROUGH
+                // A re-attached probe sits on a different spot: new ΔHb baseline
+                uint8_t admitted = SCHED_TakeAdmitted();
+                for (uint8_t k = 0; admitted; k++, admitted >>= 1) {
+                    if (admitted & 1U) {
+                        NIRS_ResetBaseline(k);
+                    }
+                }
+            #endif
+            POOL_Frame *frame;
+            while ((frame = SCHED_PopFrame()) != NULL) {
+                uint8_t k = frame->sensor;
+                last_index[k] = frame->first_index + frame->count - 1U;
+                last_time[k] = frame->first_time + (frame->count - 1U) * MAX30101_GetSamplePeriodUs();
+                sensors_seen |= (uint8_t)(1U << k);
+                BOOT_Mark(BOOT_FIRST_SAMPLE);
+                PIPE_Run(frame); // Unpack, filter, encode; the RAW frame goes out as read (freed on DMA completion)
+                if (BOOT_Mark(BOOT_FIRST_OUTPUT)) {
+                    BOOT_FormatReport(tx_buffer, sizeof(tx_buffer), BOOT_FAST_START);
+                    SendReport(tx_buffer);
+                }
+                DEADLINE_SetStage(DEADLINE_BATCH, DEADLINE_STAGE_POP);
+            }
+            main_cycles += DWT_GetCycles() - t_frames;
+            if (SCHED_ReportDue()) {
+                DEADLINE_SetStage(DEADLINE_BATCH, DEADLINE_STAGE_REPORT);
+                for (uint8_t k = 0; k < config.num_sensors; k++) {
+                    SCHED_FormatReport(tx_buffer, sizeof(tx_buffer), k);
+                    SendReport(tx_buffer);
+                    #if PRESENCE_GATING
+                        SCHED_FormatPresenceReport(tx_buffer, sizeof(tx_buffer), k);
+                        SendReport(tx_buffer);
+                    #endif
+                    #if PREDICTIVE_DRAIN
+                        SCHED_FormatPredictReport(tx_buffer, sizeof(tx_buffer), k);
+                        SendReport(tx_buffer);
+                    #endif
+                    #if SYNC_START
+                        SCHED_FormatPhaseReport(tx_buffer, sizeof(tx_buffer), k);
+                        SendReport(tx_buffer);
+                    #endif
+                }
+                #if ADAPTIVE_POLL_FILL
+                    SCHED_FormatAdaptiveReport(tx_buffer, sizeof(tx_buffer));
+                    SendReport(tx_buffer);
+                #endif
+                #if OUTPUT_FRAMED
+                    static const STREAM_Id ids[STREAM_COUNT] = { STREAM_RAW, STREAM_FILTERED, STREAM_HB, STREAM_SUMMARY, STREAM_DEADBAND, STREAM_TSI, STREAM_TRACE, STREAM_EVENT, STREAM_SYNC, STREAM_STATUS };
+                    for (uint8_t i = 0; i < STREAM_COUNT; i++) {
+                        STREAM_FormatReport(tx_buffer, sizeof(tx_buffer), ids[i]);
+                        SendReport(tx_buffer);
+                    }
+                #endif
+                MARKER_FormatReport(tx_buffer, sizeof(tx_buffer));
+                SendReport(tx_buffer);
+                POOL_FormatReport(tx_buffer, sizeof(tx_buffer));
+                SendReport(tx_buffer);
+                for (uint8_t i = 0; i < PIPE_GetNumStages(); i++) {
+                    PIPE_FormatReport(tx_buffer, sizeof(tx_buffer), i);
+                    SendReport(tx_buffer);
+                }
+                for (uint8_t t = 0; t < DEADLINE_TASKS; t++) {
+                    DEADLINE_FormatReport(tx_buffer, sizeof(tx_buffer), t);
+                    SendReport(tx_buffer);
+                }
+                #if OUTPUT_FRAMED
+                    for (uint8_t p = 0; p < PROFILE_PATHS; p++) {
+                        PROFILE_FormatReport(tx_buffer, sizeof(tx_buffer), p);
+                        SendReport(tx_buffer);
+                    }
+                #endif
+                #if OUTPUT_PASSTHROUGH
+                    SendPassReport();
                 #endif
-            } else { // Filter warm-up: process initial samples to fill IIR state buffers before normal operation
-                IIR_FilterWarmup(&sample); // Process initial samples through the IIR filter to fill state buffers
-                process_state = 1; // After warm-up, switch to normal operation
-                continue; // Skip transmission during warm-up phase
             }
-            sprintf(tx_buffer, "%.4f,%.4f\r\n", FilteredSample.red, FilteredSample.ir);
-            USART2_putString(tx_buffer);
+            DEADLINE_End(DEADLINE_BATCH);
         }
     }
 }
 
 /**
- * @brief SysTick Timer Interrupt Service Routine (20 ms period)
- * @details Core real-time data acquisition routine:
- *          1. Queries MAX30101 FIFO for available samples
- *          2. If samples available: reads one sample and converts to nanoamps
- *          3. Advances FIFO read pointer and signals main loop via data_ready flag
- *          4. Toggles status LED (visual heartbeat)
+ * @brief SysTick Timer Interrupt Service Routine (one acquisition slot)
+ * @details Core real-time data acquisition routine. SysTick runs at
+ *          SYSTICK_FREQ_HZ × NUM_SENSORS and every interrupt is one scheduler slot:
+ *          1. SCHED_RunSlot() selects the sensor owning the slot on the PCA9548
+ *          2. Reads the FIFO pointers and burst-reads the pending samples within the slot bus budget
+ *          3. Hands full RAW pool frames to the main loop and signals data_ready
+ *          4. Toggles status LED once per acquisition period (visual heartbeat)
  *
- *          This ISR runs non-preemptively (highest priority) every 20 milliseconds,
- *          synchronized with the MAX30101 output data rate (50 Hz). In steady state,
- *          exactly one sample is available per interrupt.
+ *          Sensor k is always read at phase k / NUM_SENSORS of the 20 ms period, so I2C
+ *          traffic is spread over the period instead of bursting at one tick instant.
  *
  * @param None
  * @return void
  * @note ISR Context
- *       - Execution time: ~1–2 ms (I2C reads dominate; ~0.5 ms per transaction)
+ *       - Execution time: one sensor per slot (~0.5 ms for a single-sample drain)
  *       - Called at SysTick interrupt (cannot nest itself)
  *       - All registers preserved; no clobbering of main loop state
  *
  * @data_output
  *       Upon samples available:
- *       - Populates MAX30101_NIRS_SingleCurrentSample (Red, IR fields in nanoamps)
+ *       - Reads the samples straight into the sensor's open pool frame; full frames are
+ *         queued for the main loop by pointer
  *       - Sets data_ready = 1 to signal main loop
- *       - Data valid until next ISR fires (~20 ms window)
  *
  * @timing
- *       - ISR rate: 50 Hz (20 ms period), matching MAX30101 ODR of 50 Hz
- *       - Steady state: exactly 1 sample per interrupt
- *       - At startup: up to 2 samples may be present before the first ISR fires;
- *         only the most recent is read, the pointer advances past all pending samples
- *       - Sample age at read: 0–20 ms depending on arrival time within the period
+ *       - Slot rate: 50 Hz × NUM_SENSORS; each sensor is drained once per 20 ms
+ *       - Steady state: exactly 1 sample per sensor per period
+ *       - At startup: every pending sample is drained in one burst (bounded by the bus budget)
+ *       - Worst-case slot length and drain jitter are reported in the "#SCHED" lines
  *
  * @warning
  *       - data_ready is declared volatile so the compiler does not cache it in a
@@ -201,51 +631,452 @@ int main(void) {
  *         optimize away the flag check in the main loop (undefined behavior in C).
  *       - I2C blocking: If I2C bus is busy, ISR execution may extend by several ms
  *
- * @see MAX30101_GetNumAvailableSamples, MAX30101_ReadSingleCurrentData, LED_Toggle
+ * @see SCHED_RunSlot, MAX30101_ReadFIFOStatus, MAX30101_ReadFIFOBurst, LED_Toggle
  * @example
- *   // ISR fires every 20 ms (50 Hz), synchronized to sensor output
- *   // MAX30101_NIRS_SingleCurrentSample updated with one fresh Red/IR nA pair
- *   // LED toggles each tick → 25 Hz blink (20 ms on, 20 ms off)
+ *   // NUM_SENSORS = 2: ISR fires every 10 ms; CH0 at 0 ms, CH1 at 10 ms, CH0 at 20 ms, ...
+ *   // LED toggles each period → 25 Hz blink (20 ms on, 20 ms off)
  */
 
 void SysTick_Handler(void) {
-    PCA9548_SelectChannel(0);
-    uint8_t available_samples = MAX30101_GetNumAvailableSamples();
-    if (available_samples > 0) {
-        MAX30101_ReadSingleCurrentData((MAX30101_CurrentSample *)&MAX30101_NIRS_SingleCurrentSample);
-        MAX30101_UpdateReadPointer(available_samples);
-        data_ready = 1; // Set flag for main loop to process new data
+    uint32_t t0 = DWT_GetCycles();
+    TRACE_Event(TRACE_IRQ, SysTick_IRQn + 16);
+    uint8_t period_end = SCHED_RunSlot();
+    data_ready = 1; // Set flag for main loop to process new data
+    if (period_end) {
+        LED_Toggle();
+    }
+    TRACE_Event(TRACE_IRQ | TRACE_END, SysTick_IRQn + 16);
+    isr_cycles[ISR_SYSTICK] += DWT_GetCycles() - t0;
+}
+
+/**
+ * @brief USART2 Interrupt Service Routine (host command receiver)
+ * @details Reads each received byte together with the TIM2 time and feeds it to the
+ *          command parser. Runs at CMD_IRQ_PRIORITY, above SysTick, so bytes arriving
+ *          while the acquisition slot blocks on I2C are neither lost nor late-stamped.
+ *
+ * @param None
+ * @return void
+ * @note Overrun, framing and noise errors are cleared and the byte is dropped; the
+ *       frame CRC then rejects the affected command.
+ * @see CMD_RxByte, SYNC_HandlePing
+ */
+void USART2_IRQHandler(void) {
+    uint32_t now = TIMER_GetMicros();
+    TRACE_Event(TRACE_IRQ, USART2_IRQn + 16);
+    uint32_t isr = USART2->ISR;
+    if (isr & (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE)) {
+        USART2->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF;
+    }
+    if (isr & USART_ISR_RXNE) {
+        CMD_RxByte((uint8_t)USART2->RDR, now);
     }
-    LED_Toggle();
+    TRACE_Event(TRACE_IRQ | TRACE_END, USART2_IRQn + 16);
 }
 
 /**
- * @brief Filter Warm-Up Routine
- * @details This function can be called at startup to process initial samples through the IIR filter
- *          to fill the state buffers before normal operation begins. This helps avoid transient artifacts
- *          in the first few seconds of data.
+ * @brief EXTI0 Interrupt Service Routine (event marker input, PA0)
+ * @details The edge time has already been latched by TIM2 input capture; the ISR only
+ *          collects it and queues the event, so its own latency does not affect the
+ *          timestamp. Highest priority (MARKER_IRQ_PRIORITY) keeps the queue ordered
+ *          even while the acquisition slot or the command receiver is running.
  *
- * @param s Pointer to the current sample structure containing raw Red and IR values to be processed for warm-up.
+ * @param None
  * @return void
- * @note This routine is typically called once at startup, before entering the main loop.
- *       It processes a predefined number of samples (WARMUP_SAMPLES) through the IIR filter
- *       without transmitting data, allowing the filter's internal state to stabilize.
- *       After warm-up, the system transitions to normal operation where filtered data is transmitted.
+ * @see MARKER_Capture, SendMarker
+ */
+void EXTI0_IRQHandler(void) {
+    TRACE_Event(TRACE_IRQ, EXTI0_IRQn + 16);
+    MARKER_Capture();
+    TRACE_Event(TRACE_IRQ | TRACE_END, EXTI0_IRQn + 16);
+}
+
+/**
+ * @brief EXTI1 Interrupt Service Routine (sensor INT on PA1, data-ready mode)
+ * @details PPG_RDY of the sensor pends SysTick, so the slot drains the new sample at
+ *          once instead of waiting for the next period (latency profile, SENSOR_INT_WIRED).
  *
- * @see IIR_Red, IIR_IR, iirCoeffs, iirStatesRed, iirStatesIR
+ * @param None
+ * @return void
+ * @see SCHED_DataReadyIrq, PROFILE_Apply
  */
-static inline void IIR_FilterWarmup(const MAX30101_CurrentSample *s) {
-    float32_t dummy;
-    float32_t red = s->red; // In this way the compiler keeps the sample values in registers across the loop iterations 
-    float32_t ir  = s->ir;  //minimizing memory access and maximizing warm-up speed
-    for (int i = 0; i < WARMUP_SAMPLES; i++) {
-        #if FILTER_TYPE == 1
-            arm_biquad_cascade_df2T_f32(&IIR_Red, &red, &dummy, 1);
-            arm_biquad_cascade_df2T_f32(&IIR_IR,  &ir,  &dummy, 1);
-        #else
-            dummy = MAX30101_FirstOrderDC_Blocker(red, &w_red, ALPHA);
-            dummy = MAX30101_FirstOrderDC_Blocker(ir,  &w_ir,  ALPHA);       
-        #endif
+void EXTI1_IRQHandler(void) {
+    TRACE_Event(TRACE_IRQ, EXTI1_IRQn + 16);
+    SCHED_DataReadyIrq();
+    TRACE_Event(TRACE_IRQ | TRACE_END, EXTI1_IRQn + 16);
+}
+
+/**
+ * @brief DMA1 Channel 7 Interrupt Service Routine (USART2 TX complete)
+ * @details Returns the transmitted frame to the pool and starts the next queued frame,
+ *          so the link stays busy without main-loop involvement.
+ *
+ * @param None
+ * @return void
+ * @see STREAM_TxComplete, USART2_SendDMA
+ */
+void DMA1_Channel7_IRQHandler(void) {
+    uint32_t t0 = DWT_GetCycles();
+    TRACE_Event(TRACE_IRQ, DMA1_Channel7_IRQn + 16);
+    STREAM_TxComplete();
+    TRACE_Event(TRACE_IRQ | TRACE_END, DMA1_Channel7_IRQn + 16);
+    isr_cycles[ISR_DMA1_CH7] += DWT_GetCycles() - t0;
+}
+
+/**
+ * @brief TIM2 Interrupt Service Routine (deadline compare channels CH3/CH4, adaptive
+ *        polling compare CH2)
+ * @details CH3/CH4 fire when an acquisition slot or a consumer pass is still running at
+ *          its deadline; the miss is attributed to the stage active at that instant.
+ *          CH2 pends the next slot with ADAPTIVE_POLL_FILL.
+ *
+ * @param None
+ * @return void
+ * @see DEADLINE_TimerIrq, SCHED_TimerIrq
+ */
+void TIM2_IRQHandler(void) {
+    TRACE_Event(TRACE_IRQ, TIM2_IRQn + 16);
+    SCHED_TimerIrq();
+    DEADLINE_TimerIrq();
+    TRACE_Event(TRACE_IRQ | TRACE_END, TIM2_IRQn + 16);
+}
+
+/**
+ * @brief I2C1 Event Interrupt Service Routine (asynchronous FIFO reads)
+ * @details Advances the select → status → burst chain started by SCHED_RunSlot() in
+ *          DMA mode; the FIFO bytes themselves are moved by DMA1 Channel 3. Completed
+ *          frames are queued for the main loop from here, so data_ready is raised too.
+ *
+ * @param None
+ * @return void
+ * @see I2C1_EventHandler, SCHED_EnableDMA
+ */
+void I2C1_EV_IRQHandler(void) {
+    uint32_t t0 = DWT_GetCycles();
+    TRACE_Event(TRACE_IRQ, I2C1_EV_IRQn + 16);
+    I2C1_EventHandler();
+    data_ready = 1;
+    TRACE_Event(TRACE_IRQ | TRACE_END, I2C1_EV_IRQn + 16);
+    isr_cycles[ISR_I2C1_EV] += DWT_GetCycles() - t0;
+}
+
+/**
+ * @brief I2C1 Error Interrupt Service Routine
+ * @details Bus and arbitration errors end the current asynchronous transfer through
+ *          the same state machine (the callback reports failure).
+ *
+ * @param None
+ * @return void
+ * @see I2C1_EventHandler
+ */
+void I2C1_ER_IRQHandler(void) {
+    I2C1_EV_IRQHandler();
+}
+
+/**
+ * @brief Send one statistics report line
+ * @details Routes the line to the STATUS stream when OUTPUT_FRAMED is enabled, or
+ *          straight to USART2 in legacy CSV mode.
+ * @param line Null-terminated report line ("#SCHED,...", "#STREAM,...")
+ * @return void
+ */
+static void SendReport(const char *line) {
+    #if OUTPUT_FRAMED
+        STREAM_PutStatus(line);
+    #else
+        USART2_putString((char *)line);
+    #endif
+}
+
+/**
+ * @brief Output one marker event referencing the nearest sample of every sensor
+ * @details The nearest index is extrapolated from the last sample processed for each
+ *          sensor, so markers are not held back until later samples arrive. Sensors that
+ *          have not delivered a sample yet are referenced as index 0, offset 0.
+ *          Framed: EVENT frame (header time = edge time). Legacy CSV:
+ *          "#EVENT,<seq>,<time_us>,<index_0>,<offset_0>,...". The end-to-end latency
+ *          is recorded once the output has been handed to the UART.
+ * @param marker - [in] Event from MARKER_Pop()
+ * @return void
+ */
+static void SendMarker(const MARKER_Event *marker) {
+    uint32_t index[CONFIG_MAX_SENSORS];
+    int16_t offset[CONFIG_MAX_SENSORS];
+    for (uint8_t k = 0; k < config.num_sensors; k++) {
+        if (sensors_seen & (1U << k)) {
+            index[k] = MARKER_NearestSample(marker->time, last_index[k], last_time[k], &offset[k]);
+        } else {
+            index[k] = 0;
+            offset[k] = 0;
+        }
+    }
+    #if OUTPUT_FRAMED
+        STREAM_PutEvent(marker->seq, marker->time, config.num_sensors, index, offset);
+    #else
+        static char event_buffer[32 + CONFIG_MAX_SENSORS * 18];
+        int n = sprintf(event_buffer, "#EVENT,%lu,%lu", (unsigned long)marker->seq, (unsigned long)marker->time);
+        for (uint8_t k = 0; k < config.num_sensors; k++) {
+            n += sprintf(&event_buffer[n], ",%lu,%d", (unsigned long)index[k], offset[k]);
+        }
+        sprintf(&event_buffer[n], "\r\n");
+        USART2_putString(event_buffer);
+    #endif
+    MARKER_NoteOutput(marker, TIMER_GetMicros());
+}
+
+#if BENCH_MODE
+/**
+ * @brief Send one report line and wait for its wire time
+ * @details A burst of STATUS lines would outrun the STREAM token bucket and be
+ *          dropped; waiting the frame's share of the planned link rate lets every
+ *          benchmark line through.
+ * @param line Null-terminated report line
+ * @return void
+ */
+static void SendPacedReport(const char *line) {
+    uint32_t bytes = (uint32_t)strlen(line) + STREAM_HEADER_BYTES + STREAM_CRC_BYTES;
+    uint32_t wait_us = bytes * 10U * (1000000U / STREAM_LINK_HEADROOM_PCT) / (config.baud_rate / 100U);
+    SendReport(line);
+    uint32_t t0 = TIMER_GetMicros();
+    while (TIMER_GetMicros() - t0 < wait_us) {
+    }
+}
+
+/**
+ * @brief CMD_BENCH handler: run the benchmark suite between two acquisition slots
+ * @details Acquisition is stopped for the duration of the suite (a few hundred ms); the
+ *          samples missed meanwhile appear as overflows and an index gap (SCHED_Resume()).
+ * @param frame - [in] Command frame (no payload)
+ * @return void
+ * @note With WATCHDOG_MS set, keep the timeout above the suite duration ("#BENCHEND").
+ */
+static void HandleBench(const CMD_Frame *frame) {
+    SCHED_Stop();
+    BENCH_Run(&bench_config, SendPacedReport);
+    SCHED_Resume();
+}
+#endif
+
+/**
+ * @brief Design the DC-removal filters for a sample rate
+ * @details Fills iirCoeffs with the configured Chebyshev II high-pass (IIR_Design()) and
+ *          sets the DC-Blocker alpha for the configured cut-off, for the conditioning
+ *          stage and the benchmark alike; only the filters the build uses are designed.
+ *          Runs at boot; after a sample-rate change (acquisition stopped) call it again,
+ *          with DesignHbModel(), followed by PIPE_Init(), which restarts the filters.
+ *          A specification IIR_Design() rejects leaves the signal unfiltered; the default
+ *          one is checked at every supported ODR by Tools/nirs_iir.py.
+ * @param fs_hz - Sample rate (Hz)
+ * @return void
+ */
+static void DesignFilters(float32_t fs_hz) {
+    #if FILTER_TYPE == 1 || BENCH_MODE
+        const IIR_Spec spec = { IIR_CHEBYSHEV2, IIR_HIGHPASS, config.filter_order, config.filter_cutoff_hz,
+                                0.0f, (float32_t)config.filter_stop_db };
+        uint8_t sections = IIR_Design(&spec, fs_hz, iirCoeffs, STAGE_BIQUAD_MAX_SECTIONS);
+        if (sections == 0) {
+            // Not realisable at this rate: one pass-through section rather than an empty cascade
+            for (uint8_t i = 0; i < 5; i++) {
+                iirCoeffs[i] = (i == 0) ? 1.0f : 0.0f;
+            }
+            sections = 1;
+        }
+    #endif
+    #if FILTER_TYPE == 1
+        filter_config.num_sections = sections;
+    #else
+        filter_config.alpha = IIR_DCBlockerAlpha(config.filter_cutoff_hz, fs_hz);
+    #endif
+    #if BENCH_MODE
+        bench_biquad.num_sections = sections;
+        bench_dcblock.alpha = IIR_DCBlockerAlpha(config.filter_cutoff_hz, fs_hz);
+    #endif
+}
+
+/**
+ * @brief Design the Kalman ΔHb model for a sample rate
+ * @details Process noise from HB_KALMAN_Q_RATE over one sample period and the ΔOD
+ *          noise HB_KALMAN_OD_NOISE on both wavelengths (NIRS_KalmanDesign()), for the
+ *          HB stage and the benchmark alike. Runs at boot with DesignFilters(), and again
+ *          with it after a sample-rate change.
+ * @param fs_hz - Sample rate (Hz)
+ * @return void
+ */
+static void DesignHbModel(float32_t fs_hz) {
+    const float32_t od_noise[NIRS_WAVELENGTHS] = { HB_KALMAN_OD_NOISE, HB_KALMAN_OD_NOISE };
+    NIRS_KalmanDesign(&hb_model, HB_KALMAN_Q_RATE, od_noise, 1.0f / fs_hz);
+}
+
+/**
+ * @brief CMD_PROFILE handler: switch the operating profile between two acquisition slots
+ * @details Payload: profile ID u8 (PROFILE.h). The "#PROFILE" line confirms the profile
+ *          in effect (unchanged for an unknown ID).
+ * @param frame - [in] Command frame
+ * @return void
+ */
+static void HandleProfile(const CMD_Frame *frame) {
+    if (frame->length >= 1) {
+        PROFILE_Select(frame->payload[0]);
+    }
+    PROFILE_FormatInfo(tx_buffer, sizeof(tx_buffer));
+    SendReport(tx_buffer);
+}
+
+/**
+ * @brief CMD_CONFIG handler: read or change the stored configuration
+ * @details Payload: operation u8 (CONFIG.h), then for CONFIG_OP_SET up to six
+ *          (key u8, value u32) pairs applied to the stored configuration and saved as one
+ *          record. An unknown key, no pairs or only values already stored save nothing
+ *          (seq unchanged): no flash is programmed and the page is not advanced. The
+ *          "#CONFIG" line reports the outcome and what the next boot will use;
+ *          CONFIG_OP_RESET restarts into it once the line has left the UART.
+ *          A save only programs its record (interrupts still run between half-words);
+ *          the page erase runs at boot, and a save that would need one is refused with
+ *          CONFIG_ERASE_PENDING until the next reset.
+ * @param frame - [in] Command frame
+ * @return void
+ */
+static void HandleConfig(const CMD_Frame *frame) {
+    uint8_t op = (frame->length >= 1) ? frame->payload[0] : CONFIG_OP_READ;
+    if (op == CONFIG_OP_SET) {
+        CONFIG_Params params = *CONFIG_GetStored();
+        uint8_t known = 1, changed = 0;
+        for (uint8_t i = 1; i + 5U <= frame->length; i += 5U) {
+            const uint8_t *p = &frame->payload[i];
+            uint32_t value = (uint32_t)p[1] | ((uint32_t)p[2] << 8) | ((uint32_t)p[3] << 16) | ((uint32_t)p[4] << 24);
+            uint8_t field = CONFIG_SetField(&params, p[0], value);
+            known &= (field != CONFIG_FIELD_UNKNOWN);
+            changed |= (field == CONFIG_FIELD_CHANGED);
+        }
+        if (known && changed) {
+            CONFIG_Save(&params);
+        }
+    } else if (op == CONFIG_OP_DEFAULTS) {
+        CONFIG_Save(&config_defaults);
+    }
+    CONFIG_FormatReport(tx_buffer, sizeof(tx_buffer));
+    SendReport(tx_buffer);
+    if (op == CONFIG_OP_RESET) {
+        uint32_t t0 = TIMER_GetMicros();
+        while (TIMER_GetMicros() - t0 < 20000U) {
+            // Let the report leave the STATUS queue and the UART
+        }
+        NVIC_SystemReset();
+    }
+}
+
+#if OUTPUT_FRAMED && !OUTPUT_PASSTHROUGH
+/**
+ * @brief Set the summary window and the full-rate streams
+ * @details The window is converted to samples at the sensor ODR (at least one sample,
+ *          at most 65535).
+ * @param window_ms - Summary window (ms, 0 = summary off)
+ * @param full_rate - 1 = RAW, FILTERED and HB on, 0 = summary-only output
+ * @return void
+ */
+static void SetSummary(uint16_t window_ms, uint8_t full_rate) {
+    uint32_t samples = 0;
+    if (window_ms) {
+        samples = (uint32_t)window_ms * 1000U / MAX30101_GetSamplePeriodUs();
+        samples = (samples == 0) ? 1U : (samples > 0xFFFFU) ? 0xFFFFU : samples;
+    }
+    summary_config.window = (uint16_t)samples;
+    STREAM_SetFullRate(full_rate);
+}
+
+/**
+ * @brief CMD_SUMMARY handler: summary window and full-rate streams
+ * @details Payload: window ms u16 (0 = off), then optionally full rate u8 (default 1).
+ *          An empty payload changes nothing. Answered by
+ *          `#SUMMARY,<window_ms>,<window_samples>,<full_rate>\r\n`.
+ * @param frame - [in] Command frame
+ * @return void
+ */
+static void HandleSummary(const CMD_Frame *frame) {
+    static uint16_t window_ms = SUMMARY_WINDOW_MS;
+    if (frame->length >= 2) {
+        window_ms = (uint16_t)(frame->payload[0] | (frame->payload[1] << 8));
+        SetSummary(window_ms, (frame->length >= 3) ? frame->payload[2] : 1U);
+    }
+    snprintf(tx_buffer, sizeof(tx_buffer), "#SUMMARY,%u,%u,%u\r\n",
+             (unsigned)window_ms, (unsigned)summary_config.window, (unsigned)STREAM_GetFullRate());
+    SendReport(tx_buffer);
+}
+
+/**
+ * @brief Set the change-driven output threshold
+ * @details The silence limit is converted to samples at the sensor ODR (at least one
+ *          sample, at most 65535).
+ * @param threshold_na - Deadband (nA, 0 = DEADBAND frames off)
+ * @param max_silence_ms - Longest interval without an update per channel (ms, 0 = no limit)
+ * @return void
+ */
+static void SetDeadband(float32_t threshold_na, uint16_t max_silence_ms) {
+    uint32_t samples = 0;
+    if (max_silence_ms) {
+        samples = (uint32_t)max_silence_ms * 1000U / MAX30101_GetSamplePeriodUs();
+        samples = (samples == 0) ? 1U : (samples > 0xFFFFU) ? 0xFFFFU : samples;
     }
+    deadband_config.max_silence = (uint16_t)samples;
+    deadband_config.threshold = (threshold_na > 0.0f) ? threshold_na : 0.0f;
 }
 
+/**
+ * @brief CMD_DEADBAND handler: change-driven output threshold
+ * @details Payload: threshold f32 nA (0 = off), max silence ms u16. An empty payload
+ *          changes nothing. Answered by
+ *          `#DEADBAND,<threshold_nA>,<max_silence_ms>,<max_silence_samples>\r\n`.
+ * @param frame - [in] Command frame
+ * @return void
+ */
+static void HandleDeadband(const CMD_Frame *frame) {
+    static uint16_t max_silence_ms = DEADBAND_MAX_SILENCE_MS;
+    if (frame->length >= 6) {
+        float32_t threshold;
+        memcpy(&threshold, frame->payload, 4);
+        max_silence_ms = (uint16_t)(frame->payload[4] | (frame->payload[5] << 8));
+        SetDeadband(threshold, max_silence_ms);
+    }
+    snprintf(tx_buffer, sizeof(tx_buffer), "#DEADBAND,%.3f,%u,%u\r\n",
+             (double)deadband_config.threshold, (unsigned)max_silence_ms, (unsigned)deadband_config.max_silence);
+    SendReport(tx_buffer);
+}
+#endif
+
+#if OUTPUT_PASSTHROUGH
+/**
+ * @brief Send the passthrough throughput/load report
+ * @details Format: `#PASS,<sensors>,<odr_hz>,<samples_per_s>,<isr_load_permille>,
+ *          <main_load_permille>,<overruns>\r\n` over the interval since the previous
+ *          report. samples_per_s is the sustained aggregate rate read from the FIFOs;
+ *          the load columns are the shares of CPU time spent in the acquisition/transmit
+ *          interrupts and in main-loop frame handling. Raise the sensor count or the
+ *          ODR (CMD_CONFIG, or NUM_SENSORS / PASSTHROUGH_ODR_HZ) until samples_per_s
+ *          falls short of sensors × ODR, overruns grow or "#SCHED" reports overflows to
+ *          find the sustainable limit.
+ * @return void
+ */
+static void SendPassReport(void) {
+    static uint32_t prev_cycles, prev_samples, prev_isr, prev_main;
+    uint32_t samples, overruns;
+    uint32_t now = DWT_GetCycles();
+    SCHED_GetTotals(&samples, &overruns);
+    uint32_t elapsed = now - prev_cycles;
+    uint32_t isr = 0;
+    for (uint8_t i = 0; i < ISR_COUNTED; i++) {
+        isr += isr_cycles[i];
+    }
+    uint32_t per_s = (uint32_t)((uint64_t)(samples - prev_samples) * SystemCoreClock / elapsed);
+    uint32_t isr_load = (uint32_t)((uint64_t)(isr - prev_isr) * 1000U / elapsed);
+    uint32_t main_load = (uint32_t)((uint64_t)(main_cycles - prev_main) * 1000U / elapsed);
+    prev_cycles = now;
+    prev_samples = samples;
+    prev_isr = isr;
+    prev_main = main_cycles;
+    snprintf(tx_buffer, sizeof(tx_buffer), "#PASS,%u,%u,%lu,%lu,%lu,%lu\r\n",
+             (unsigned)config.num_sensors, (unsigned)config.odr_hz,
+             (unsigned long)per_s, (unsigned long)isr_load, (unsigned long)main_load,
+             (unsigned long)overruns);
+    SendReport(tx_buffer);
+}
+#endif
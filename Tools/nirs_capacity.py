@@ -0,0 +1,589 @@
+#!/usr/bin/env python3
+"""Capacity planner for the MiB-NIRS firmware: sensors x ODR x drain rate x link.
+
+Every constant comes from the firmware sources (#define lines in Project/*.h and
+Project/main.c), so the model follows the code when a header changes:
+
+    I2C       I2C1_BYTE_NS, I2C1_WRITE_COST_NS(n), I2C1_READ_COST_NS(n)
+    scheduler SCHED_BUS_BUDGET_PCT, SCHED_HANDOFF_SAMPLES, MAX30101_FIFO_DEPTH
+    frames    STREAM_HEADER_BYTES, STREAM_CRC_BYTES, STREAM_RAW_CAPACITY,
+              STREAM_*_DECIMATION, STREAM_MAX_LEVEL, STREAM_LINK_HEADROOM_PCT
+    CPU       BUDGET_* (cycles per sample of each pipeline stage, main.c)
+
+For one configuration it computes, per second and per slot:
+
+    I2C   bus occupancy of the FIFO drains and the largest drain against the slot
+          budget; FIFO overflow when a drain cannot keep up with the ODR
+    CPU   acquisition ISR (blocking transfers keep the core busy for the whole bus
+          time, the DMA chain only for its callbacks) plus main-loop pipeline cycles
+    UART  RAW, FILTERED, HB and STATUS bytes against the planned link rate, and the
+          extra decimation level STREAM would settle on
+
+and flags the configuration as OK, WARN (runs degraded: decimation, thin margins) or
+FAIL (samples lost or deadlines missed).
+
+Usage:
+    nirs_capacity.py --sensors 4 --odr 100                 # framed mode, SysTick drain rate
+    nirs_capacity.py --mode passthrough --sensors 8 --odr 400 --period-hz 25
+    nirs_capacity.py --sweep --mode passthrough            # sensors x ODR feasibility table
+    nirs_capacity.py --sensors 8 --odr 200 --simulate 20   # check against a slot-level simulation
+    nirs_capacity.py --sensors 2 --odr 50 --validate capture.bin   # check against the device
+
+--validate reads the STATUS reports (#SCHED, #PIPE, #STREAM, #PASS) of a framed capture
+(nirs_frames.py), prints measured next to predicted values and re-evaluates the model
+with the measured per-stage cycle counts in place of the BUDGET_* ceilings.
+"""
+
+import argparse
+import math
+import os
+import random
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Project")
+SOURCES = ("I2C.h", "MAX30101.h", "POOL.h", "STREAM.h", "SCHED.h", "main.c")
+
+CORE_HZ = 64000000          # SYSCLK (PLL.c)
+UART_BITS_PER_BYTE = 10     # 8N1
+
+# Acquisition ISR overheads not covered by the bus model (cycles, estimates; --validate
+# shows the measured #SCHED isr_max next to them)
+SLOT_OVERHEAD_CYCLES = 600      # SysTick entry, plan/commit, deadline bookkeeping
+DMA_CHAIN_CYCLES = 2400         # three transfers: I2C1 EV interrupts + completion callbacks
+UART_FRAME_CYCLES = 200         # DMA1 Ch7 completion + next frame start
+STATUS_LINE_BYTES = 60          # Typical report line, before framing
+ODR_TOLERANCE = 0.01            # MAX30101 sample-rate spread the drains must absorb
+
+# Pipeline stage -> BUDGET_* macro (main.c); the names are those of STAGES.h
+STAGE_BUDGET = {
+    "unpack": "BUDGET_UNPACK",
+    "biquad": "BUDGET_FILTER",
+    "dcblock": "BUDGET_FILTER",
+    "deltahb": "BUDGET_DELTA_HB",
+    "frames": "BUDGET_ENCODE",
+    "csv": "BUDGET_CSV",
+    "rawtx": "BUDGET_TRANSMIT",
+}
+MODE_STAGES = {
+    "framed": ("unpack", "biquad", "deltahb", "frames", "rawtx"),
+    "csv": ("unpack", "biquad", "csv"),
+    "passthrough": ("rawtx",),
+}
+FILTERED_PAYLOAD = 13       # <BIff
+HB_PAYLOAD = 9              # <BIhh
+CSV_LINE_BYTES = 21         # "1234.5678,2345.6789\r\n"
+
+
+# ---------------------------------------------------------------------------------------
+# Firmware constants
+
+_DEFINE = re.compile(r"^\s*#define\s+(\w+)(\(\w+\))?\s+(.*)$")
+_NUMBER = re.compile(r"\b(0[xX][0-9a-fA-F]+|\d+\.?\d*(?:[eE][-+]?\d+)?)[uUlLfF]*\b")
+
+
+class Constants:
+    """#define values of the firmware, evaluated on demand (first definition wins)."""
+
+    def __init__(self, root=ROOT):
+        self.exprs = {}
+        self.macros = {}
+        self.cache = {}
+        for name in SOURCES:
+            with open(os.path.join(root, name), encoding="utf-8", errors="replace") as handle:
+                for line in handle:
+                    m = _DEFINE.match(line)
+                    if not m:
+                        continue
+                    expr = re.sub(r"/\*.*?(\*/|$)|//.*$", "", m.group(3)).strip()
+                    if not expr:
+                        continue
+                    if m.group(2):
+                        self.macros.setdefault(m.group(1), (m.group(2)[1:-1], expr))
+                    else:
+                        self.exprs.setdefault(m.group(1), expr)
+
+    def _eval(self, expr, local=None):
+        expr = _NUMBER.sub(r"\1", expr)
+        if "." not in expr:
+            expr = expr.replace("/", "//")
+        names = {}
+        for name in set(re.findall(r"[A-Za-z_]\w*", expr)):
+            if local and name in local:
+                names[name] = local[name]
+            elif name in self.macros:
+                names[name] = self.macro(name)
+            elif name in self.exprs:
+                names[name] = self[name]
+        return eval(expr, {"__builtins__": {}}, names)
+
+    def __getitem__(self, name):
+        if name not in self.cache:
+            if name not in self.exprs:
+                raise KeyError("%s not defined in %s" % (name, ", ".join(SOURCES)))
+            self.cache[name] = self._eval(self.exprs[name])
+        return self.cache[name]
+
+    def macro(self, name):
+        arg, expr = self.macros[name]
+        return lambda value: self._eval(expr, {arg: value})
+
+
+# ---------------------------------------------------------------------------------------
+# Analytic model
+
+class Config:
+    def __init__(self, args, c):
+        self.mode = args.mode
+        self.sensors = args.sensors
+        self.odr = args.odr
+        self.baud = args.baud or c["UART_BAUD_RATE"]
+        if args.period_hz:
+            self.period_hz = args.period_hz
+        elif self.mode == "passthrough":
+            self.period_hz = c["PASSTHROUGH_PERIOD_HZ"]
+        else:
+            self.period_hz = c["SYSTICK_FREQ_HZ"]
+        self.dma = args.dma or self.mode == "passthrough"
+
+    def describe(self):
+        return "mode=%s sensors=%d odr=%d Hz drain=%d Hz baud=%d i2c=%s" % (
+            self.mode, self.sensors, self.odr, self.period_hz, self.baud,
+            "dma" if self.dma else "blocking")
+
+
+class Model:
+    """Steady-state load of one configuration (mirrors SCHED_Init/STREAM arithmetic)."""
+
+    def __init__(self, cfg, c, stage_cycles=None):
+        self.cfg = cfg
+        self.c = c
+        write = c.macro("I2C1_WRITE_COST_NS")
+        read = c.macro("I2C1_READ_COST_NS")
+        sample_bytes = c["MAX30101_SAMPLE_BYTES"]
+        self.burst_ns = lambda n: read(sample_bytes * n) if n else 0
+        self.fixed_ns = write(1) + read(3)
+        self.report_lines = cfg.sensors + c["STREAM_COUNT"] + len(MODE_STAGES[cfg.mode]) + 4
+
+        # SCHED_Init()
+        self.slot_hz = cfg.period_hz * cfg.sensors
+        self.slot_ns = 1e9 / self.slot_hz
+        self.budget_ns = (1000000000 // self.slot_hz) // 100 * c["SCHED_BUS_BUDGET_PCT"]
+        batch = 0
+        if self.budget_ns > self.fixed_ns + read(sample_bytes):
+            batch = (self.budget_ns - self.fixed_ns - read(0)) // (sample_bytes * c["I2C1_BYTE_NS"])
+        self.max_batch = max(1, min(batch, c["MAX30101_FIFO_DEPTH"]))
+
+        # I2C
+        self.per_drain = cfg.odr / cfg.period_hz
+        # Sensor and SysTick clocks drift apart: a drain sees up to one sample more
+        self.worst_drain = min(int(self.per_drain) + 1, c["MAX30101_FIFO_DEPTH"])
+        self.drain_bus_ns = self.fixed_ns + self.burst_ns(min(self.worst_drain, self.max_batch))
+        drains_per_s = cfg.period_hz * cfg.sensors
+        self.samples_per_s = cfg.odr * cfg.sensors
+        self.bus_util = (drains_per_s * self.fixed_ns
+                         + drains_per_s * read(0)
+                         + self.samples_per_s * sample_bytes * c["I2C1_BYTE_NS"]) / 1e9
+        self.drain_capacity = self.max_batch * cfg.period_hz
+        self.lost_per_s = max(0.0, cfg.odr - self.drain_capacity) * cfg.sensors
+        self.fifo_fill_ms = c["MAX30101_FIFO_DEPTH"] / cfg.odr * 1000
+
+        # RAW frames: drains append to the open frame until SCHED_HANDOFF_SAMPLES
+        handoff = c["SCHED_HANDOFF_SAMPLES"]
+        per = min(self.per_drain, self.max_batch)
+        self.frame_samples = min(per * math.ceil(handoff / per), c["STREAM_RAW_CAPACITY"])
+        self.raw_frames_per_s = self.samples_per_s / self.frame_samples
+        framing = c["STREAM_HEADER_BYTES"] + c["STREAM_CRC_BYTES"]
+        raw_bytes = self.raw_frames_per_s * (framing + 6 + sample_bytes * self.frame_samples)
+
+        # CPU: acquisition ISR
+        if cfg.dma:
+            self.isr_s = drains_per_s * (SLOT_OVERHEAD_CYCLES + DMA_CHAIN_CYCLES) / CORE_HZ
+            self.acq_slot_us = self.drain_bus_ns / 1000
+        else:
+            self.isr_s = self.bus_util + drains_per_s * SLOT_OVERHEAD_CYCLES / CORE_HZ
+            self.acq_slot_us = self.drain_bus_ns / 1000 + SLOT_OVERHEAD_CYCLES / (CORE_HZ / 1e6)
+
+        # CPU: pipeline
+        self.stage_cycles = {}
+        for name in MODE_STAGES[cfg.mode]:
+            if stage_cycles and name in stage_cycles:
+                self.stage_cycles[name] = stage_cycles[name]
+            elif name == "csv":
+                # Blocking USART2: the CPU waits out the wire time of the line
+                self.stage_cycles[name] = self.csv_line_bytes() * UART_BITS_PER_BYTE * CORE_HZ / cfg.baud
+            else:
+                self.stage_cycles[name] = c[STAGE_BUDGET[name]]
+        self.main_cycles_per_sample = sum(self.stage_cycles.values())
+        self.main_s = self.samples_per_s * self.main_cycles_per_sample / CORE_HZ
+
+        # UART
+        self.link_bytes = cfg.baud / UART_BITS_PER_BYTE
+        self.plan_bytes = self.link_bytes * c["STREAM_LINK_HEADROOM_PCT"] / 100
+        report_s = c["SCHED_REPORT_PERIODS"] / cfg.period_hz
+        if cfg.mode == "csv":
+            self.streams = {"CSV": self.samples_per_s * self.csv_line_bytes()}
+            self.level = 0
+        else:
+            self.streams = {"RAW": raw_bytes,
+                            "STATUS": self.report_lines * (STATUS_LINE_BYTES + framing) / report_s}
+            self.level = None
+            if cfg.mode == "framed":
+                fixed = raw_bytes + self.streams["STATUS"]
+                for level in range(c["STREAM_MAX_LEVEL"] + 1):
+                    filt = self.samples_per_s / (c["STREAM_FILTERED_DECIMATION"] << level) * (framing + FILTERED_PAYLOAD)
+                    hb = self.samples_per_s / (c["STREAM_HB_DECIMATION"] << level) * (framing + HB_PAYLOAD)
+                    if fixed + filt + hb <= self.plan_bytes or level == c["STREAM_MAX_LEVEL"]:
+                        break
+                self.streams["FILTERED"] = filt
+                self.streams["HB"] = hb
+                self.level = level if fixed + filt + hb <= self.plan_bytes else None
+            frames_per_s = self.raw_frames_per_s
+            if "FILTERED" in self.streams:
+                frames_per_s += (self.streams["FILTERED"] / (framing + FILTERED_PAYLOAD)
+                                 + self.streams["HB"] / (framing + HB_PAYLOAD))
+            self.isr_s += frames_per_s * UART_FRAME_CYCLES / CORE_HZ
+        self.uart_bytes = sum(self.streams.values())
+        self.uart_util = self.uart_bytes / self.link_bytes
+        self.cpu_util = self.isr_s + self.main_s
+        self.batch_pass_us = self.main_cycles_per_sample * cfg.odr * cfg.sensors / cfg.period_hz / (CORE_HZ / 1e6)
+
+    def csv_line_bytes(self):
+        return CSV_LINE_BYTES + (2 if self.cfg.sensors > 1 else 0)
+
+    def verdicts(self):
+        """List of (severity, message); severity is FAIL or WARN."""
+        c = self.c
+        cfg = self.cfg
+        out = []
+        if cfg.odr not in (50, 100, 200, 400) or cfg.odr > c["MAX30101_ODR_MAX_HZ"]:
+            out.append(("FAIL", "ODR %d Hz is not a MAX30101 SpO2 rate at 18-bit (50/100/200/400)" % cfg.odr))
+        if cfg.sensors > c["SCHED_MAX_SENSORS"]:
+            out.append(("FAIL", "%d sensors: the PCA9548 has %d channels" % (cfg.sensors, c["SCHED_MAX_SENSORS"])))
+        if self.per_drain >= c["MAX30101_FIFO_DEPTH"]:
+            out.append(("FAIL", "%.0f samples accumulate between drains, the FIFO holds %d" % (
+                self.per_drain, c["MAX30101_FIFO_DEPTH"])))
+        if self.lost_per_s > 0:
+            out.append(("FAIL", "drain capacity %d samples/s per sensor (batch %d) < ODR: %.0f samples/s lost" % (
+                self.drain_capacity, self.max_batch, self.lost_per_s)))
+        elif self.drain_capacity < cfg.odr * (1 + ODR_TOLERANCE):
+            out.append(("FAIL", "drain capacity %d samples/s per sensor (batch %d) leaves no margin for a %.0f %% fast sensor" % (
+                self.drain_capacity, self.max_batch, 100 * ODR_TOLERANCE)))
+        elif self.worst_drain > self.max_batch:
+            out.append(("WARN", "drains of %d samples exceed the budgeted batch %d: backlog carried to the next slot" % (
+                self.worst_drain, self.max_batch)))
+        if self.drain_bus_ns > self.slot_ns:
+            out.append(("FAIL", "largest drain %.0f us > slot %.0f us: ACQ deadline missed" % (
+                self.drain_bus_ns / 1000, self.slot_ns / 1000)))
+        if self.bus_util > 1:
+            out.append(("FAIL", "I2C bus over-subscribed (%.0f %%)" % (100 * self.bus_util)))
+        if self.cpu_util > 1:
+            out.append(("FAIL", "CPU over-subscribed (%.0f %%)" % (100 * self.cpu_util)))
+        elif self.cpu_util > 0.8:
+            out.append(("WARN", "CPU load %.0f %% leaves little margin" % (100 * self.cpu_util)))
+        if self.batch_pass_us > 1e6 / cfg.period_hz:
+            out.append(("FAIL", "pipeline pass %.0f us > acquisition period %.0f us: BATCH deadline missed" % (
+                self.batch_pass_us, 1e6 / cfg.period_hz)))
+        guaranteed = self.streams.get("RAW", 0) + self.streams.get("CSV", 0)
+        if guaranteed > self.plan_bytes:
+            out.append(("FAIL", "RAW/CSV alone need %.0f B/s, link plan is %.0f B/s" % (guaranteed, self.plan_bytes)))
+        elif cfg.mode == "framed" and self.level is None:
+            out.append(("WARN", "FILTERED/HB do not fit even at the maximum decimation: frames dropped"))
+        elif self.level:
+            out.append(("WARN", "FILTERED/HB decimated x%d to fit the link" % (1 << self.level)))
+        return out
+
+    def status(self):
+        severities = [s for s, _ in self.verdicts()]
+        return "FAIL" if "FAIL" in severities else "WARN" if severities else "OK"
+
+    def report(self, out):
+        c = self.c
+        print("# %s" % self.cfg.describe(), file=out)
+        print("I2C   slot=%.0f us budget=%.0f us max_batch=%d drain=%.1f (worst %d) samples, %.0f us; bus=%.1f %%" % (
+            self.slot_ns / 1000, self.budget_ns / 1000, self.max_batch, self.per_drain, self.worst_drain,
+            self.drain_bus_ns / 1000, 100 * self.bus_util), file=out)
+        print("FIFO  fills in %.0f ms; drain capacity %d samples/s per sensor" % (
+            self.fifo_fill_ms, self.drain_capacity), file=out)
+        print("CPU   isr=%.1f %% main=%.1f %% (%d cycles/sample: %s) total=%.1f %%" % (
+            100 * self.isr_s, 100 * self.main_s, self.main_cycles_per_sample,
+            " ".join("%s=%d" % kv for kv in self.stage_cycles.items()), 100 * self.cpu_util), file=out)
+        print("UART  %s; total=%.0f B/s of %.0f (%.1f %%, plan %d %%)%s" % (
+            " ".join("%s=%.0f" % kv for kv in self.streams.items()), self.uart_bytes, self.link_bytes,
+            100 * self.uart_util, c["STREAM_LINK_HEADROOM_PCT"],
+            " level=%d" % self.level if self.level else ""), file=out)
+        for severity, message in self.verdicts():
+            print("%s  %s" % (severity, message), file=out)
+        print("=> %s" % self.status(), file=out)
+
+
+# ---------------------------------------------------------------------------------------
+# Slot-level simulation
+
+def simulate(model, seconds, ppm, seed=1):
+    """Run the SysTick slots against drifting sensors, the frame handoff, the STREAM
+    token bucket and the UART, and measure what the model predicts."""
+    cfg, c = model.cfg, model.c
+    rng = random.Random(seed)
+    depth = c["MAX30101_FIFO_DEPTH"]
+    capacity = c["STREAM_RAW_CAPACITY"]
+    handoff = c["SCHED_HANDOFF_SAMPLES"]
+    framing = c["STREAM_HEADER_BYTES"] + c["STREAM_CRC_BYTES"]
+    sample_bytes = c["MAX30101_SAMPLE_BYTES"]
+    raw_max = framing + 6 + sample_bytes * c["STREAM_RAW_BATCH"]
+    bucket_max = c["STREAM_BUCKET_BYTES"]
+
+    rate = [cfg.odr * (1 + rng.uniform(-ppm, ppm) * 1e-6) for _ in range(cfg.sensors)]
+    phase = [rng.random() for _ in range(cfg.sensors)]
+    read = [0] * cfg.sensors
+    open_count = [0] * cfg.sensors
+    acc = {name: [0] * cfg.sensors for name in ("FILTERED", "HB")}
+    level = {"FILTERED": 0, "HB": 0}
+    decimation = {"FILTERED": c["STREAM_FILTERED_DECIMATION"], "HB": c["STREAM_HB_DECIMATION"]}
+    payload = {"FILTERED": FILTERED_PAYLOAD, "HB": HB_PAYLOAD}
+
+    r = {"bus_ns": 0.0, "isr_cycles": 0.0, "main_cycles": 0.0, "lost": 0, "deferrals": 0,
+         "acq_misses": 0, "max_batch": 0, "max_bus_ns": 0.0, "dropped": 0, "samples": 0,
+         "uart": {}, "max_queue": 0.0, "max_level": 0}
+    credit = bucket_max
+    queue = 0.0             # bytes waiting for / in UART DMA
+    queue_frames = []       # sizes, to count pool blocks in flight
+    last_t = 0.0
+    plan_rate = model.plan_bytes
+    link_rate = model.link_bytes
+    slots = int(seconds * model.slot_hz)
+
+    def send(name, size, guaranteed):
+        nonlocal credit, queue
+        if not guaranteed and credit < size + raw_max:
+            r["dropped"] += 1
+            if level.get(name, 0) < c["STREAM_MAX_LEVEL"]:
+                level[name] = level.get(name, 0) + 1
+            return
+        if len(queue_frames) + cfg.sensors >= c["POOL_BLOCKS"]:
+            r["dropped"] += 1
+            return
+        credit = max(0, credit - size)
+        queue += size
+        queue_frames.append(size)
+        r["uart"][name] = r["uart"].get(name, 0) + size
+        r["isr_cycles"] += UART_FRAME_CYCLES
+        if level.get(name) and credit > bucket_max // 2:
+            level[name] -= 1
+
+    for k in range(slots):
+        t = k / model.slot_hz
+        dt = t - last_t
+        last_t = t
+        credit = min(bucket_max, credit + plan_rate * dt)
+        sent = link_rate * dt
+        queue = max(0.0, queue - sent)
+        while queue_frames and sum(queue_frames) > queue + 1e-9:
+            queue_frames.pop(0)
+
+        if cfg.mode != "csv" and k and k % (c["SCHED_REPORT_PERIODS"] * cfg.sensors) == 0:
+            for _ in range(model.report_lines):
+                send("STATUS", framing + STATUS_LINE_BYTES, False)
+
+        i = k % cfg.sensors
+        produced = int(t * rate[i] + phase[i])
+        fifo = produced - read[i]
+        if fifo > depth:
+            r["lost"] += fifo - depth
+            read[i] += fifo - depth
+            fifo = depth
+            if open_count[i]:
+                frames_done = [open_count[i]]
+                open_count[i] = 0
+            else:
+                frames_done = []
+        else:
+            frames_done = []
+        batch = min(fifo, model.max_batch, capacity - open_count[i])
+        r["deferrals"] += batch < fifo   # slots that leave a backlog, as #SCHED counts them
+        bus = model.fixed_ns + model.burst_ns(batch)
+        r["bus_ns"] += bus
+        r["max_bus_ns"] = max(r["max_bus_ns"], bus)
+        r["max_batch"] = max(r["max_batch"], batch)
+        if bus > model.slot_ns:
+            r["acq_misses"] += 1
+        if cfg.dma:
+            r["isr_cycles"] += SLOT_OVERHEAD_CYCLES + DMA_CHAIN_CYCLES
+        else:
+            r["isr_cycles"] += bus * CORE_HZ / 1e9 + SLOT_OVERHEAD_CYCLES
+        read[i] += batch
+        r["samples"] += batch
+        open_count[i] += batch
+        if open_count[i] >= handoff:
+            frames_done.append(open_count[i])
+            open_count[i] = 0
+
+        # Main loop: pipeline and encoders for every handed-off frame
+        for count in frames_done:
+            r["main_cycles"] += count * model.main_cycles_per_sample
+            if cfg.mode == "csv":
+                r["uart"]["CSV"] = r["uart"].get("CSV", 0) + count * model.csv_line_bytes()
+                continue
+            send("RAW", framing + 6 + sample_bytes * count, True)
+            if cfg.mode == "framed":
+                for name in ("FILTERED", "HB"):
+                    acc[name][i] += count
+                    block = decimation[name] << level[name]
+                    while acc[name][i] >= block:
+                        acc[name][i] -= block
+                        send(name, framing + payload[name], False)
+                        block = decimation[name] << level[name]
+                    r["max_level"] = max(r["max_level"], level[name])
+        r["max_queue"] = max(r["max_queue"], queue)
+
+    r["seconds"] = slots / model.slot_hz
+    return r
+
+
+def compare_simulation(model, r, out):
+    s = r["seconds"]
+    rows = [
+        ("samples/s", model.samples_per_s - model.lost_per_s, r["samples"] / s),
+        ("lost samples/s", model.lost_per_s, r["lost"] / s),
+        ("I2C bus %", 100 * model.bus_util, 100 * r["bus_ns"] / 1e9 / s),
+        ("largest drain us", model.drain_bus_ns / 1000, r["max_bus_ns"] / 1000),
+        ("CPU isr %", 100 * model.isr_s, 100 * r["isr_cycles"] / CORE_HZ / s),
+        ("CPU main %", 100 * model.main_s, 100 * r["main_cycles"] / CORE_HZ / s),
+        ("UART B/s", model.uart_bytes, sum(r["uart"].values()) / s),
+    ]
+    print("# simulation: %.1f s, %d slots" % (s, int(s * model.slot_hz)), file=out)
+    print("%-18s %12s %12s %8s" % ("metric", "model", "simulated", "diff"), file=out)
+    for name, predicted, measured in rows:
+        diff = (measured - predicted) / predicted * 100 if predicted else 0.0
+        print("%-18s %12.1f %12.1f %7.1f%%" % (name, predicted, measured, diff), file=out)
+    print("# sim: deferrals=%d acq_misses=%d dropped=%d max_batch=%d max_level=%d max_uart_queue=%.0f B" % (
+        r["deferrals"], r["acq_misses"], r["dropped"], r["max_batch"], r["max_level"], r["max_queue"]), file=out)
+
+
+# ---------------------------------------------------------------------------------------
+# Validation against device reports
+
+def read_reports(path):
+    """Collect (device_time, fields) of every STATUS report line in a capture."""
+    sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+    from nirs_frames import FrameParser, STREAM_STATUS
+
+    parser = FrameParser()
+    reports = []
+    with open(path, "rb") as handle:
+        while True:
+            chunk = handle.read(4096)
+            if not chunk:
+                break
+            for stream_id, _seq, time, payload in parser.feed(chunk):
+                if stream_id == STREAM_STATUS:
+                    text = payload.decode("ascii", "replace").strip()
+                    if text.startswith("#"):
+                        reports.append((time, text[1:].split(",")))
+    return reports
+
+
+def first_last(reports, tag, key):
+    """First and last (time, fields) of the report lines `tag` with fields[1] == key."""
+    lines = [(t, f) for t, f in reports if f[0] == tag and f[1] == key]
+    return (lines[0], lines[-1]) if len(lines) > 1 else (None, None)
+
+
+def rate(first, last, column):
+    dt = ((last[0] - first[0]) & 0xFFFFFFFF) / 1e6
+    return (int(last[1][column]) - int(first[1][column])) / dt if dt > 0 else 0.0
+
+
+def validate(model, reports, out):
+    """Print measured next to predicted; returns measured pipeline cycles per stage."""
+    cfg = model.cfg
+    rows = []
+    total_rate = 0.0
+    overflows = 0
+    for k in range(cfg.sensors):
+        first, last = first_last(reports, "SCHED", str(k))
+        if first is None:
+            print("# no #SCHED reports for sensor %d" % k, file=out)
+            continue
+        total_rate += rate(first, last, 3)
+        overflows += int(last[1][5])
+        rows.append(("s%d largest drain us" % k, model.drain_bus_ns / 1000, float(last[1][9])))
+        rows.append(("s%d ISR max us" % k, model.acq_slot_us, float(last[1][7])))
+    rows.append(("samples/s", model.samples_per_s - model.lost_per_s, total_rate))
+    rows.append(("FIFO overflows", 0.0, float(overflows)))
+
+    stage_cycles = {}
+    for t, f in reports:
+        if f[0] == "PIPE" and int(f[4]):
+            stage_cycles[f[2]] = int(f[5])
+    for name, cycles in stage_cycles.items():
+        rows.append(("%s cycles/sample" % name, float(model.stage_cycles.get(name, 0)), float(cycles)))
+
+    passes = [(t, f) for t, f in reports if f[0] == "PASS"]
+    if passes:
+        f = passes[-1][1]
+        rows.append(("CPU isr %", 100 * model.isr_s, int(f[4]) / 10.0))
+        rows.append(("CPU main %", 100 * model.main_s, int(f[5]) / 10.0))
+
+    names = {"1": "RAW", "2": "FILTERED", "3": "HB", "127": "STATUS"}
+    for key, name in names.items():
+        first, last = first_last(reports, "STREAM", key)
+        if first is not None and name in model.streams:
+            rows.append(("%s B/s" % name, model.streams[name], rate(first, last, 3)))
+
+    print("# validation: %d report lines" % len(reports), file=out)
+    print("%-24s %12s %12s" % ("metric", "model", "device"), file=out)
+    for name, predicted, measured in rows:
+        print("%-24s %12.1f %12.1f" % (name, predicted, measured), file=out)
+    return stage_cycles
+
+
+# ---------------------------------------------------------------------------------------
+
+def sweep(args, c, out):
+    odrs = (50, 100, 200, 400)
+    print("# mode=%s baud=%d; cells: status bus%%/cpu%%/uart%%" % (
+        args.mode, args.baud or c["UART_BAUD_RATE"]), file=out)
+    print("sensors " + "".join("%24s" % ("%d Hz" % odr) for odr in odrs), file=out)
+    for sensors in range(1, c["SCHED_MAX_SENSORS"] + 1):
+        cells = []
+        for odr in odrs:
+            args.sensors, args.odr = sensors, odr
+            m = Model(Config(args, c), c)
+            cells.append("%4s %3.0f/%3.0f/%3.0f" % (m.status(), 100 * m.bus_util, 100 * m.cpu_util, 100 * m.uart_util))
+        print("%7d " % sensors + "".join("%24s" % cell for cell in cells), file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--mode", choices=sorted(MODE_STAGES), default="framed")
+    parser.add_argument("--sensors", type=int, default=1)
+    parser.add_argument("--odr", type=int, default=50, help="sensor output data rate (Hz)")
+    parser.add_argument("--period-hz", type=int, help="drains per sensor per second (default: firmware setting)")
+    parser.add_argument("--baud", type=int, help="USART2 baud rate (default: UART_BAUD_RATE)")
+    parser.add_argument("--dma", action="store_true", help="asynchronous I2C (always on in passthrough)")
+    parser.add_argument("--sweep", action="store_true", help="feasibility table over sensors x ODR")
+    parser.add_argument("--simulate", type=float, metavar="SECONDS", help="compare with a slot-level simulation")
+    parser.add_argument("--ppm", type=float, default=ODR_TOLERANCE * 1e6, help="simulated sensor clock spread (+/- ppm)")
+    parser.add_argument("--validate", metavar="CAPTURE", help="compare with the STATUS reports of a capture")
+    parser.add_argument("--root", default=ROOT, help="firmware source directory")
+    args = parser.parse_args()
+
+    c = Constants(args.root)
+    if args.sweep:
+        sweep(args, c, sys.stdout)
+        return 0
+    model = Model(Config(args, c), c)
+    model.report(sys.stdout)
+    if args.simulate:
+        compare_simulation(model, simulate(model, args.simulate, args.ppm), sys.stdout)
+    if args.validate:
+        measured = validate(model, read_reports(args.validate), sys.stdout)
+        if measured:
+            print("# re-evaluated with the measured pipeline cycles", file=sys.stdout)
+            Model(model.cfg, c, measured).report(sys.stdout)
+    return 1 if model.status() == "FAIL" else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,340 @@
+#!/usr/bin/env python3
+"""Reconstruction and bandwidth evaluation of the MiB-NIRS change-driven output.
+
+The DEADBAND stream (0x06, Project/STAGES.h STAGE_DEADBAND) carries a filtered Red
+or IR value only when it has moved more than the threshold since the last value sent
+on that channel, or when the maximum silence interval has passed. Each update is
+tagged with its sample index, so holding every value until the next update of the
+same channel rebuilds the full-rate signal within +/- threshold.
+
+    reconstruct   decode the DEADBAND frames of a capture into one step-wise row per
+                  sample: sensor,index,red_nA,ir_nA (stdout or --out). The summary on
+                  stderr gives the DEADBAND link use from the device time stamps and
+                  the frames lost (sequence gaps).
+    evaluate      replay a recorded session with full-rate RAW frames through a model
+                  of the firmware chain: counts -> nA, the firmware high-pass
+                  (FILTER_ORDER, FILTER_CUTOFF_HZ, FILTER_STOP_DB in Project/main.c,
+                  designed by IIR.c built for the host, WARMUP_SAMPLES warm-up), then
+                  the deadband encoder block by block as the RAW frames arrived. For
+                  each threshold it prints the DEADBAND bytes against full-rate
+                  FILTERED frames and legacy CSV lines, and the reconstruction error.
+                  --simulate replaces the capture with a synthetic rest/activity session.
+
+Usage:
+    nirs_deadband.py reconstruct capture.bin --out steps.csv
+    nirs_deadband.py evaluate capture.bin --threshold 0.5 1 2 5 --silence-ms 1000
+    nirs_deadband.py evaluate --simulate 600 --odr 50
+"""
+
+import argparse
+import math
+import os
+import random
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from nirs_frames import (FrameParser, STREAM_DEADBAND, STREAM_RAW, build_frame,  # noqa: E402
+                         decode_payload)
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Project")
+
+HEADER_CRC_BYTES = 12           # STREAM_HEADER_BYTES + STREAM_CRC_BYTES
+DEADBAND_UPDATES = 22           # STREAM_DEADBAND_UPDATES
+FILTERED_FRAME = HEADER_CRC_BYTES + 13
+LSB_NA = 15.625 / 1000.0        # MAX30101_CURRENT_LSB_NA
+ODRS = (50, 100, 200, 400)
+
+
+def read_frames(path):
+    parser = FrameParser()
+    frames = []
+    with open(path, "rb") as handle:
+        while True:
+            chunk = handle.read(65536)
+            if not chunk:
+                break
+            frames.extend(parser.feed(chunk))
+    return frames, parser
+
+
+# --- reconstruction -------------------------------------------------------------------
+
+def reconstruct(frames):
+    """Step-wise rows per sensor from DEADBAND frames; returns (rows, stats)."""
+    held = {}        # sensor -> [red, ir]
+    updates = {}     # sensor -> {index: {channel: value}}
+    wire = 0
+    lost = 0
+    last_seq = None
+    first_time = last_time = None
+    for stream_id, seq, time, payload in frames:
+        if stream_id != STREAM_DEADBAND:
+            continue
+        wire += HEADER_CRC_BYTES + len(payload)
+        if last_seq is not None:
+            lost += (seq - last_seq - 1) & 0xFF
+        last_seq = seq
+        first_time = time if first_time is None else first_time
+        last_time = time
+        for row in decode_payload(stream_id, payload):
+            per = updates.setdefault(row["sensor"], {})
+            per.setdefault(row["index"], {})[row["channel"]] = row["value_nA"]
+    rows = []
+    counts = {}
+    for sensor in sorted(updates):
+        per = updates[sensor]
+        indices = sorted(per)
+        value = held.setdefault(sensor, [None, None])
+        counts[sensor] = (indices[-1] - indices[0] + 1, sum(len(v) for v in per.values()))
+        for index in range(indices[0], indices[-1] + 1):
+            for channel, v in per.get(index, {}).items():
+                value[0 if channel == "red" else 1] = v
+            rows.append((sensor, index, value[0], value[1]))
+    seconds = ((last_time - first_time) & 0xFFFFFFFF) / 1e6 if first_time is not None else 0.0
+    return rows, {"wire": wire, "lost": lost, "seconds": seconds, "counts": counts}
+
+
+def run_reconstruct(args):
+    frames, parser = read_frames(args.capture)
+    rows, st = reconstruct(frames)
+    out = open(args.out, "w") if args.out else sys.stdout
+    print("sensor,index,red_nA,ir_nA", file=out)
+    for sensor, index, red, ir in rows:
+        print("%d,%d,%s,%s" % (sensor, index, "" if red is None else "%.4f" % red,
+                              "" if ir is None else "%.4f" % ir), file=out)
+    for sensor, (samples, n) in sorted(st["counts"].items()):
+        print("# sensor=%d samples=%d updates=%d (%.1f %% of channel samples)" % (
+            sensor, samples, n, 100.0 * n / (2 * samples)), file=sys.stderr)
+    total = sum(samples for samples, _ in st["counts"].values())
+    if total:
+        rate = " = %.1f B/s" % (st["wire"] / st["seconds"]) if st["seconds"] > 0 else ""
+        print("# deadband bytes=%d%s, %.2f B/sample vs %d B/sample full-rate FILTERED (x%.1f), lost frames=%d"
+              % (st["wire"], rate, st["wire"] / total, FILTERED_FRAME, FILTERED_FRAME * total / max(st["wire"], 1),
+                 st["lost"]), file=sys.stderr)
+    print("# crc_errors=%d resyncs=%d" % (parser.crc_errors, parser.resyncs), file=sys.stderr)
+
+
+# --- evaluation -----------------------------------------------------------------------
+
+def firmware_filter(root, odr, cc):
+    """Firmware high-pass sections for the ODR, and the warm-up length."""
+    from nirs_iir import CHEBYSHEV2, HIGHPASS, Designer
+
+    text = open(os.path.join(root, "main.c"), encoding="utf-8", errors="replace").read()
+    value = lambda name: float(re.search(r"#define\s+%s\s+([\d.]+)" % name, text).group(1))
+    sections = Designer(cc, root, "float").design(CHEBYSHEV2, HIGHPASS, int(value("FILTER_ORDER")),
+                                                  value("FILTER_CUTOFF_HZ"), odr,
+                                                  stop_db=value("FILTER_STOP_DB"))
+    return sections or [(1.0, 0.0, 0.0, 0.0, 0.0)], int(value("WARMUP_SAMPLES"))
+
+
+class Cascade:
+    """CMSIS-DSP arm_biquad_cascade_df2T_f32 (feedback coefficients already negated)."""
+
+    def __init__(self, sections):
+        self.sections = sections
+        self.state = [[0.0, 0.0] for _ in sections]
+
+    def step(self, x):
+        for (b0, b1, b2, a1, a2), d in zip(self.sections, self.state):
+            y = b0 * x + d[0]
+            d[0] = b1 * x + a1 * y + d[1]
+            d[1] = b2 * x + a2 * y
+            x = y
+        return x
+
+
+def session_blocks(frames):
+    """Per-sensor RAW blocks [(first_index, [(red_nA, ir_nA), ...]), ...] and the ODR."""
+    blocks = {}
+    spans = []
+    for stream_id, _seq, time, payload in frames:
+        if stream_id != STREAM_RAW:
+            continue
+        rows = decode_payload(stream_id, payload)
+        if not rows:
+            continue
+        sensor = rows[0]["sensor"]
+        blocks.setdefault(sensor, []).append(
+            (rows[0]["index"], [(r["red"] * LSB_NA, r["ir"] * LSB_NA) for r in rows]))
+        spans.append((sensor, rows[0]["index"], time))
+    odr = None
+    for sensor in blocks:
+        own = [(i, t) for k, i, t in spans if k == sensor]
+        if len(own) > 1 and own[-1][0] != own[0][0]:
+            period = ((own[-1][1] - own[0][1]) & 0xFFFFFFFF) / (own[-1][0] - own[0][0])
+            odr = min(ODRS, key=lambda f: abs(1e6 / f - period))
+            break
+    return blocks, odr
+
+
+def simulate(seconds, odr, sensors, seed=1):
+    """Synthetic session: alternating 60 s rest and 30 s activity, 8-sample RAW blocks.
+
+    Rest: 2 nA cardiac pulse, 0.15 nA white noise, slow drift. Activity: 1 Hz
+    contractions of 80 nA (Red) / 120 nA (IR) with motion bursts on top.
+    """
+    rng = random.Random(seed)
+    blocks = {}
+    for sensor in range(sensors):
+        samples = []
+        dc = (1800.0 + 100 * sensor, 2400.0 + 100 * sensor)
+        phase = rng.random()
+        for n in range(int(seconds * odr)):
+            t = n / odr
+            active = (t % 90.0) >= 60.0
+            pulse = math.sin(2 * math.pi * (1.2 * t + phase))
+            drift = 5.0 * math.sin(2 * math.pi * t / 300.0)
+            values = []
+            for c in range(2):
+                x = dc[c] + drift + 2.0 * pulse + rng.gauss(0.0, 0.15)
+                if active:
+                    x += (80.0, 120.0)[c] * max(0.0, math.sin(2 * math.pi * t)) + rng.gauss(0.0, 3.0)
+                values.append(round(x / LSB_NA) * LSB_NA)
+            samples.append(tuple(values))
+        blocks[sensor] = [(i, samples[i:i + 8]) for i in range(0, len(samples), 8)]
+    return blocks
+
+
+def filter_blocks(blocks, sections, warmup):
+    """Filtered samples per sensor, excluding the warm-up sample, as the firmware does."""
+    filtered = {}
+    for sensor, seq in blocks.items():
+        out = []
+        cascades = [Cascade(sections), Cascade(sections)]
+        first = True
+        for base, samples in seq:
+            rows = []
+            for i, x in enumerate(samples):
+                if first:
+                    for _ in range(warmup):
+                        cascades[0].step(x[0])
+                        cascades[1].step(x[1])
+                    first = False
+                    continue
+                rows.append((i, cascades[0].step(x[0]), cascades[1].step(x[1])))
+            out.append((base, rows))
+        filtered[sensor] = out
+    return filtered
+
+
+def encode(filtered, threshold, max_silence):
+    """Model of STAGE_DEADBAND + STREAM_PutDeadband: wire bytes and reconstruction error."""
+    wire = updates = samples = 0
+    err_max = [0.0, 0.0]
+    err_sq = [0.0, 0.0]
+    for seq in filtered.values():
+        sent = [None, None]
+        sent_index = [0, 0]
+        for base, rows in seq:
+            n = 0
+            for i, red, ir in rows:
+                index = base + i
+                for c, x in enumerate((red, ir)):
+                    if (sent[c] is None or abs(x - sent[c]) > threshold
+                            or (max_silence and index - sent_index[c] >= max_silence)):
+                        sent[c] = x
+                        sent_index[c] = index
+                        n += 1
+                    e = abs(x - sent[c])
+                    err_max[c] = max(err_max[c], e)
+                    err_sq[c] += e * e
+                samples += 1
+            updates += n
+            while n:
+                k = min(n, DEADBAND_UPDATES)
+                wire += HEADER_CRC_BYTES + 6 + 5 * k
+                n -= k
+    rms = [math.sqrt(v / samples) if samples else 0.0 for v in err_sq]
+    return wire, updates, samples, err_max, rms
+
+
+def csv_bytes(filtered, with_sensor):
+    total = 0
+    for sensor, seq in filtered.items():
+        for _base, rows in seq:
+            for _i, red, ir in rows:
+                line = "%.4f,%.4f\r\n" % (red, ir)
+                total += len(line) + (len("%d," % sensor) if with_sensor else 0)
+    return total
+
+
+def run_evaluate(args):
+    if args.simulate:
+        odr = args.odr
+        blocks = simulate(args.simulate, odr, args.sensors)
+        source = "simulated %g s, %d sensor(s)" % (args.simulate, args.sensors)
+    else:
+        if not args.capture:
+            raise SystemExit("evaluate: give a capture with RAW frames or --simulate SECONDS")
+        frames, _parser = read_frames(args.capture)
+        blocks, odr = session_blocks(frames)
+        if not blocks:
+            raise SystemExit("evaluate: no RAW frames in %s" % args.capture)
+        odr = args.odr or odr or 50
+        source = args.capture
+    sections, warmup = firmware_filter(args.root, odr, args.cc)
+    filtered = filter_blocks(blocks, sections, warmup)
+    max_silence = args.silence_ms * odr // 1000 if args.silence_ms else 0
+    csv = csv_bytes(filtered, len(filtered) > 1)
+    print("# %s at %d Hz, max silence %d ms (%d samples)" % (source, odr, args.silence_ms, max_silence))
+    print("threshold_nA,updates_pct,deadband_B_per_sample,filtered_B_per_sample,csv_B_per_sample,"
+          "saving_vs_filtered,saving_vs_csv,max_err_red_nA,max_err_ir_nA,rms_err_red_nA,rms_err_ir_nA")
+    for threshold in args.threshold:
+        wire, updates, samples, err_max, rms = encode(filtered, threshold, max_silence)
+        if not samples:
+            break
+        print("%g,%.1f,%.2f,%d,%.2f,x%.1f,x%.1f,%.3f,%.3f,%.3f,%.3f" % (
+            threshold, 100.0 * updates / (2 * samples), wire / samples, FILTERED_FRAME, csv / samples,
+            FILTERED_FRAME * samples / max(wire, 1), csv / max(wire, 1),
+            err_max[0], err_max[1], rms[0], rms[1]))
+    if args.write_capture:
+        write_capture(args.write_capture, blocks, odr)
+
+
+def write_capture(path, blocks, odr):
+    """Store a (simulated) session as RAW frames, so it can be replayed like a recording."""
+    period = 1000000 // odr
+    seq = 0
+    with open(path, "wb") as handle:
+        for sensor, seq_blocks in blocks.items():
+            for base, samples in seq_blocks:
+                payload = struct.pack("<BIB", sensor, base, len(samples))
+                for red, ir in samples:
+                    for x in (red, ir):
+                        c = int(round(x / LSB_NA))
+                        payload += bytes(((c >> 16) & 0x03, (c >> 8) & 0xFF, c & 0xFF))
+                handle.write(build_frame(STREAM_RAW, seq & 0xFF, payload, (base * period) & 0xFFFFFFFF))
+                seq += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="mode", required=True)
+    rec = sub.add_parser("reconstruct", help="step-wise signal from DEADBAND frames")
+    rec.add_argument("capture")
+    rec.add_argument("--out", help="CSV file (default stdout)")
+    ev = sub.add_parser("evaluate", help="bandwidth and error of the deadband encoder on a session")
+    ev.add_argument("capture", nargs="?", help="binary capture with full-rate RAW frames")
+    ev.add_argument("--threshold", type=float, nargs="+", default=[0.25, 0.5, 1.0, 2.0, 5.0],
+                    help="deadbands to evaluate (nA)")
+    ev.add_argument("--silence-ms", type=int, default=1000, help="max silence (DEADBAND_MAX_SILENCE_MS)")
+    ev.add_argument("--odr", type=int, choices=ODRS, help="sample rate (default: from the capture, or 50)")
+    ev.add_argument("--simulate", type=float, metavar="SECONDS", help="synthetic session instead of a capture")
+    ev.add_argument("--sensors", type=int, default=1, help="sensors in the synthetic session")
+    ev.add_argument("--write-capture", metavar="PATH", help="also store the session as RAW frames")
+    ev.add_argument("--cc", default=os.environ.get("CC", "cc"), help="host C compiler (IIR.c)")
+    ev.add_argument("--root", default=ROOT, help="firmware source directory")
+    args = parser.parse_args()
+    if args.mode == "reconstruct":
+        run_reconstruct(args)
+    else:
+        if args.simulate and args.odr is None:
+            args.odr = 50
+        run_evaluate(args)
+
+
+if __name__ == "__main__":
+    main()
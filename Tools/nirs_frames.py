@@ -0,0 +1,426 @@
+#!/usr/bin/env python3
+"""Decoder for the framed multi-stream output of the MiB-NIRS firmware.
+
+Frame layout (see Project/STREAM.h):
+
+    A5 5A | id u8 | seq u8 | len u16 | time u32 | payload[len] | crc16 u16
+
+time is the device TIM2 microsecond counter (first sample of the frame for
+data streams). Host commands use the same layout with the host time in the
+time field. CRC-16/CCITT-FALSE over id..payload. All multi-byte fields are little-endian
+except the raw 18-bit counts, which keep the MAX30101 FIFO byte order.
+
+Usage:
+    nirs_frames.py capture.bin            # decode a binary capture
+    nirs_frames.py /dev/ttyACM0 --baud 460800   # decode live (needs pyserial)
+    nirs_frames.py capture.bin --stats    # per-sensor RAW rate, index gaps, link use
+    nirs_frames.py /dev/ttyACM0 --bench   # run the on-target benchmark, print it as CSV
+    nirs_frames.py /dev/ttyACM0 --profile latency --stream status   # switch profile, watch #LATENCY
+    nirs_frames.py /dev/ttyACM0 --config sensors=4 odr=100 reset --stream status   # store, reboot into it
+    nirs_frames.py /dev/ttyACM0 --summary 10000 --summary-only   # 10 s statistics only
+    nirs_frames.py /dev/ttyACM0 --deadband 1.0 1000 > capture.bin   # change-driven output
+
+--stats measures the sustained RAW throughput (e.g. in passthrough mode) from
+device time stamps, so host-side buffering does not distort the rate.
+
+--bench sends the BENCH command (0x81) to a live port, or reads a capture, and prints
+the "#BENCH" report lines as CSV with the build and clock columns of "#BENCHINFO" on
+every row, ready to append to a per-board performance log. A "#BENCHCHECK" line with
+mismatches (STAGE_Hampel() against its reference) is printed to stderr and the exit
+status is 1.
+
+--profile sends the PROFILE command (0x82) before decoding: standard, latency
+(one sample per drain and RAW frame) or throughput (deep FIFO batches, full RAW
+frames). The device answers with a "#PROFILE" line; every report interval it sends
+"#LATENCY" lines with sample-to-UART percentiles of the RAW and FILTERED streams.
+
+--config sends CONFIG commands (0x83) before decoding. Without arguments it reads the
+stored configuration; KEY=VALUE pairs (sensors, odr, led_red, led_ir, baud, profile,
+filter_order, cutoff, stop_db) are stored in flash, "defaults" stores the compiled-in
+configuration and "reset" reboots the device into the stored one. Each command is
+answered by a "#CONFIG" line:
+
+    #CONFIG,<status>,<seq>,<load_cycles>,<sensors>,<odr_hz>,<led_red_ma>,<led_ir_ma>,
+            <baud>,<profile>,<filter_order>,<cutoff_hz>,<stop_db>
+
+status 0 = stored record in use, 1 = nothing stored, 2 = rejected (out of range),
+3 = flash error, 4 = refused until a reset (the spare flash page is erased at boot; send
+"reset" and repeat). A new baud rate applies after the reset: reopen with --baud.
+
+--summary sends the SUMMARY command (0x84) with a window in ms (0 = off): every
+window each sensor sends one SUMMARY frame with mean, std, min, max and rms of its
+Red and IR currents (nA). --summary-only also stops the RAW, FILTERED and HB streams;
+--summary without it turns them back on. The answer is a
+"#SUMMARY,<window_ms>,<window_samples>,<full_rate>" line.
+
+--deadband sends the DEADBAND command (0x85): threshold in nA (0 = off) and the
+maximum silence in ms. DEADBAND frames then carry a filtered Red or IR value, tagged
+with its sample index, whenever it has moved more than the threshold since the last
+one sent; Tools/nirs_deadband.py rebuilds the step-wise signal and measures the savings.
+
+TRACE frames (0x08) carry a dump of the firmware event trace ring (Project/TRACE.h);
+Tools/nirs_trace.py requests one and converts it into a Chrome / Perfetto timeline.
+"""
+
+import argparse
+import struct
+import sys
+from time import sleep
+
+SYNC = b"\xA5\x5A"
+STREAM_RAW = 0x01
+STREAM_FILTERED = 0x02
+STREAM_HB = 0x03
+STREAM_EVENT = 0x04
+STREAM_SUMMARY = 0x05
+STREAM_DEADBAND = 0x06
+STREAM_TSI = 0x07
+STREAM_TRACE = 0x08
+STREAM_SYNC = 0x10
+STREAM_STATUS = 0x7F
+CMD_BENCH = 0x81
+CMD_PROFILE = 0x82
+CMD_CONFIG = 0x83
+CMD_SUMMARY = 0x84
+CMD_DEADBAND = 0x85
+CMD_TRACE = 0x86
+
+PROFILES = {"standard": 0, "latency": 1, "throughput": 2}
+
+CONFIG_OP_READ, CONFIG_OP_SET, CONFIG_OP_DEFAULTS, CONFIG_OP_RESET = range(4)
+CONFIG_MAX_PAIRS = 6    # (key u8, value u32) pairs per command (CMD_MAX_PAYLOAD 32)
+# name: (key, is_float)
+CONFIG_KEYS = {
+    "sensors": (0, False),
+    "odr": (1, False),
+    "led_red": (2, True),
+    "led_ir": (3, True),
+    "baud": (4, False),
+    "profile": (5, False),
+    "filter_order": (6, False),
+    "cutoff": (7, True),
+    "stop_db": (8, False),
+}
+
+STREAM_NAMES = {
+    STREAM_RAW: "RAW",
+    STREAM_FILTERED: "FILTERED",
+    STREAM_HB: "HB",
+    STREAM_EVENT: "EVENT",
+    STREAM_SUMMARY: "SUMMARY",
+    STREAM_DEADBAND: "DEADBAND",
+    STREAM_TSI: "TSI",
+    STREAM_TRACE: "TRACE",
+    STREAM_SYNC: "SYNC",
+    STREAM_STATUS: "STATUS",
+}
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection)."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+HEADER_BYTES = 10
+
+
+def build_frame(stream_id, seq, payload, time):
+    """Encode one frame (used for host commands and by the device stand-ins)."""
+    body = struct.pack("<BBHI", stream_id, seq & 0xFF, len(payload), time & 0xFFFFFFFF) + bytes(payload)
+    return SYNC + body + struct.pack("<H", crc16_ccitt(body))
+
+
+class FrameParser:
+    """Incremental frame parser; feed() bytes, iterate over (id, seq, time, payload)."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.crc_errors = 0
+        self.resyncs = 0
+
+    def feed(self, data):
+        self.buffer.extend(data)
+        frames = []
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                # keep a trailing 0xA5 in case the sync is split
+                del self.buffer[:-1]
+                break
+            if start:
+                self.resyncs += 1
+                del self.buffer[:start]
+            if len(self.buffer) < HEADER_BYTES:
+                break
+            stream_id, seq, length, time = struct.unpack_from("<BBHI", self.buffer, 2)
+            total = HEADER_BYTES + length + 2
+            if len(self.buffer) < total:
+                break
+            (crc,) = struct.unpack_from("<H", self.buffer, HEADER_BYTES + length)
+            if crc16_ccitt(self.buffer[2:HEADER_BYTES + length]) != crc:
+                self.crc_errors += 1
+                del self.buffer[:2]
+                continue
+            frames.append((stream_id, seq, time, bytes(self.buffer[HEADER_BYTES:HEADER_BYTES + length])))
+            del self.buffer[:total]
+        return frames
+
+
+def decode_payload(stream_id, payload):
+    """Return a list of row dicts for one frame payload."""
+    if stream_id == STREAM_RAW:
+        sensor, first, count = struct.unpack_from("<BIB", payload, 0)
+        rows = []
+        for i in range(count):
+            b = payload[6 + 6 * i:12 + 6 * i]
+            red = ((b[0] & 0x03) << 16) | (b[1] << 8) | b[2]
+            ir = ((b[3] & 0x03) << 16) | (b[4] << 8) | b[5]
+            rows.append({"sensor": sensor, "index": first + i, "red": red, "ir": ir})
+        return rows
+    if stream_id == STREAM_FILTERED:
+        sensor, index, red, ir = struct.unpack_from("<BIff", payload, 0)
+        return [{"sensor": sensor, "index": index, "red_nA": red, "ir_nA": ir}]
+    if stream_id == STREAM_HB:
+        sensor, index, hbo2, hhb = struct.unpack_from("<BIhh", payload, 0)
+        return [{"sensor": sensor, "index": index, "hbo2_uM": hbo2 / 100.0, "hhb_uM": hhb / 100.0}]
+    if stream_id == STREAM_EVENT:
+        seq, count = struct.unpack_from("<IB", payload, 0)
+        rows = []
+        for k in range(count):
+            index, offset = struct.unpack_from("<Ih", payload, 5 + 6 * k)
+            rows.append({"marker": seq, "sensor": k, "index": index, "offset_us": offset})
+        return rows
+    if stream_id == STREAM_SUMMARY:
+        sensor, first, count = struct.unpack_from("<BIH", payload, 0)
+        row = {"sensor": sensor, "index": first, "count": count}
+        for c, channel in enumerate(("red", "ir")):
+            values = struct.unpack_from("<5f", payload, 7 + 20 * c)
+            for name, v in zip(("mean", "std", "min", "max", "rms"), values):
+                row["%s_%s_nA" % (channel, name)] = "%.3f" % v
+        return [row]
+    if stream_id == STREAM_DEADBAND:
+        sensor, base, count = struct.unpack_from("<BIB", payload, 0)
+        rows = []
+        for k in range(count):
+            tag, value = struct.unpack_from("<Bf", payload, 6 + 5 * k)
+            rows.append({"sensor": sensor, "index": base + (tag & 0x7F),
+                         "channel": "ir" if tag & 0x80 else "red", "value_nA": value})
+        return rows
+    if stream_id == STREAM_TSI:
+        interval, sensors, valid, tsi, slope_red, slope_ir, distance = struct.unpack_from("<IBBffff", payload, 0)
+        return [{"interval": interval, "sensors": "0x%02x" % sensors, "valid": valid,
+                 "tsi_pct": "%.2f" % tsi if valid else "", "slope_red_od_mm": "%.5f" % slope_red,
+                 "slope_ir_od_mm": "%.5f" % slope_ir, "distance_mm": "%.2f" % distance}]
+    if stream_id == STREAM_TRACE:
+        first, count = struct.unpack_from("<IB", payload, 0)
+        rows = []
+        for k in range(count):
+            cycles, tag = struct.unpack_from("<II", payload, 5 + 8 * k)
+            rows.append({"record": first + k, "cycles": cycles, "event": "0x%02x" % (tag >> 24),
+                         "arg": tag & 0xFFFFFF})
+        return rows
+    if stream_id == STREAM_SYNC:
+        t1, t2, t3, ref_dev, ref_host, drift, points = struct.unpack_from("<QIIIQiB", payload, 0)
+        return [{"t1": t1, "t2": t2, "t3": t3, "ref_dev": ref_dev, "ref_host": ref_host,
+                 "drift_ppb": drift, "points": points}]
+    if stream_id == STREAM_STATUS:
+        return [{"text": payload.decode("ascii", "replace").rstrip()}]
+    return [{"payload": payload.hex()}]
+
+
+class RawStats:
+    """Per-sensor RAW sample rate and index continuity, plus total wire bytes."""
+
+    def __init__(self):
+        self.sensors = {}
+        self.wire_bytes = 0
+        self.last_time = None
+        self.elapsed_us = 0
+
+    def add(self, stream_id, time, payload):
+        self.wire_bytes += 12 + len(payload)
+        # frame times are not strictly ordered across streams: only forward steps count
+        step = (time - self.last_time) & 0xFFFFFFFF if self.last_time is not None else 0
+        if step < 0x80000000:
+            self.elapsed_us += step
+            self.last_time = time
+        if stream_id != STREAM_RAW:
+            return
+        sensor, first, count = struct.unpack_from("<BIB", payload, 0)
+        st = self.sensors.setdefault(sensor, {"samples": 0, "lost": 0, "next": None})
+        if st["next"] is not None and first != st["next"]:
+            st["lost"] += (first - st["next"]) & 0xFFFFFFFF
+        st["next"] = first + count
+        st["samples"] += count
+
+    def report(self, out):
+        seconds = self.elapsed_us / 1e6
+        if seconds <= 0:
+            print("# stats: not enough frames", file=out)
+            return
+        total = 0
+        for sensor in sorted(self.sensors):
+            st = self.sensors[sensor]
+            total += st["samples"]
+            print("# sensor=%d samples=%d rate=%.1f/s lost=%d" % (
+                sensor, st["samples"], st["samples"] / seconds, st["lost"]), file=out)
+        print("# total=%.1f samples/s over %.1f s, link=%.0f B/s (%.1f B/sample)" % (
+            total / seconds, seconds, self.wire_bytes / seconds,
+            self.wire_bytes / total if total else 0.0), file=out)
+
+
+class BenchReport:
+    """Rows of one on-target benchmark run (BENCH.h report lines)."""
+
+    COLUMNS = ("build", "core_hz", "flash_ws", "prefetch", "kernel", "n", "runs",
+               "min_cycles", "mean_cycles", "max_cycles", "min_us", "min_cycles_per_n")
+
+    def __init__(self):
+        self.info = None
+        self.rows = []
+        self.mismatches = []
+        self.done = False
+
+    def add(self, text):
+        fields = text.strip().split(",")
+        if fields[0] == "#BENCHINFO" and len(fields) >= 8:
+            self.info = {"build": "%s %s" % (fields[1], fields[2]), "core_hz": int(fields[3]),
+                         "flash_ws": int(fields[4]), "prefetch": int(fields[5])}
+            self.rows = []
+        elif fields[0] == "#BENCH" and self.info and len(fields) >= 7:
+            n, runs, lo, mean, hi = (int(v) for v in fields[2:7])
+            row = dict(self.info, kernel=fields[1], n=n, runs=runs, min_cycles=lo,
+                       mean_cycles=mean, max_cycles=hi,
+                       min_us="%.2f" % (lo * 1e6 / self.info["core_hz"]),
+                       min_cycles_per_n="%.1f" % (lo / n if n else 0.0))
+            self.rows.append(row)
+        elif fields[0] == "#BENCHCHECK" and len(fields) >= 5:
+            window, tested, mismatches = (int(v) for v in fields[2:5])
+            if mismatches:
+                self.mismatches.append("%s window %d: %d of %d values differ from the reference"
+                                       % (fields[1], window, mismatches, tested))
+        elif fields[0] == "#BENCHEND":
+            self.done = True
+
+    def write(self, out):
+        print(",".join(self.COLUMNS), file=out)
+        for row in self.rows:
+            print(",".join(str(row[c]) for c in self.COLUMNS), file=out)
+        for line in self.mismatches:
+            print("# check failed: " + line, file=sys.stderr)
+
+
+def open_source(path, baud):
+    """Return (read, write); write is None for a capture file."""
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial  # pyserial
+
+        port = serial.Serial(path, baud, timeout=0.1)
+        return (lambda: port.read(4096)), port.write
+    handle = open(path, "rb")
+    return (lambda: handle.read(4096)), None
+
+
+def config_commands(items):
+    """CONFIG command payloads for the --config arguments (see Project/CONFIG.h)."""
+    pairs, payloads = [], []
+    for item in items:
+        if item in ("defaults", "reset"):
+            continue
+        name, sep, value = item.partition("=")
+        if not sep or name not in CONFIG_KEYS:
+            raise SystemExit("--config: expected KEY=VALUE with KEY in %s, 'defaults' or 'reset', got %r"
+                             % (", ".join(CONFIG_KEYS), item))
+        key, is_float = CONFIG_KEYS[name]
+        if name == "profile" and value in PROFILES:
+            value = PROFILES[value]
+        raw = struct.pack("<f", float(value)) if is_float else struct.pack("<I", int(value))
+        pairs.append(bytes([key]) + raw)
+    for i in range(0, len(pairs), CONFIG_MAX_PAIRS):
+        payloads.append(bytes([CONFIG_OP_SET]) + b"".join(pairs[i:i + CONFIG_MAX_PAIRS]))
+    if "defaults" in items:
+        payloads.append(bytes([CONFIG_OP_DEFAULTS]))
+    if "reset" in items:
+        payloads.append(bytes([CONFIG_OP_RESET]))
+    return payloads or [bytes([CONFIG_OP_READ])]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="binary capture file or serial port")
+    parser.add_argument("--baud", type=int, default=460800)
+    parser.add_argument("--stream", choices=[n.lower() for n in STREAM_NAMES.values()],
+                        help="print only this stream")
+    parser.add_argument("--stats", action="store_true",
+                        help="print only RAW throughput statistics (at the end / on Ctrl-C)")
+    parser.add_argument("--bench", action="store_true",
+                        help="run (live port) or extract (capture) the on-target benchmark as CSV")
+    parser.add_argument("--profile", choices=sorted(PROFILES, key=PROFILES.get),
+                        help="switch the operating profile first (live port)")
+    parser.add_argument("--config", nargs="*", metavar="KEY=VALUE",
+                        help="read or store the persistent configuration first (live port)")
+    parser.add_argument("--summary", type=int, metavar="MS",
+                        help="set the summary statistics window in ms, 0 = off (live port)")
+    parser.add_argument("--summary-only", action="store_true",
+                        help="with --summary: stop the RAW, FILTERED and HB streams")
+    parser.add_argument("--deadband", type=float, nargs="+", metavar=("NA", "SILENCE_MS"),
+                        help="set the change-driven output threshold (nA, 0 = off) and max silence (live port)")
+    args = parser.parse_args()
+    stats = RawStats() if args.stats else None
+    bench = BenchReport() if args.bench else None
+
+    read, write = open_source(args.source, args.baud)
+    if args.config is not None and write:
+        for seq, payload in enumerate(config_commands(args.config)):
+            write(build_frame(CMD_CONFIG, seq, payload, 0))
+            sleep(0.1)          # a save stalls the device (USART2 RX included) for up to 40 ms
+    if args.summary is not None and write:
+        payload = struct.pack("<HB", args.summary, 0 if args.summary_only else 1)
+        write(build_frame(CMD_SUMMARY, 0, payload, 0))
+    if args.deadband and write:
+        silence = int(args.deadband[1]) if len(args.deadband) > 1 else 1000
+        write(build_frame(CMD_DEADBAND, 0, struct.pack("<fH", args.deadband[0], silence), 0))
+    if args.profile and write:
+        write(build_frame(CMD_PROFILE, 0, bytes([PROFILES[args.profile]]), 0))
+    if bench and write:
+        write(build_frame(CMD_BENCH, 0, b"", 0))
+    frames = FrameParser()
+    is_file = not (args.source.startswith("/dev/") or args.source.upper().startswith("COM"))
+    try:
+        while True:
+            chunk = read()
+            if not chunk and is_file:
+                break
+            for stream_id, _seq, time, payload in frames.feed(chunk):
+                if stats:
+                    stats.add(stream_id, time, payload)
+                    continue
+                if bench:
+                    if stream_id == STREAM_STATUS:
+                        bench.add(payload.decode("ascii", "replace"))
+                    continue
+                name = STREAM_NAMES.get(stream_id, "0x%02X" % stream_id)
+                if args.stream and name.lower() != args.stream:
+                    continue
+                for row in decode_payload(stream_id, payload):
+                    print(name, "time=%d" % time, ",".join("%s=%s" % kv for kv in row.items()), sep=",")
+            if bench and bench.done and not is_file:
+                break
+    except KeyboardInterrupt:
+        pass
+    if stats:
+        stats.report(sys.stdout)
+    if bench:
+        bench.write(sys.stdout)
+    print("# crc_errors=%d resyncs=%d" % (frames.crc_errors, frames.resyncs), file=sys.stderr)
+    if bench and bench.mismatches:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
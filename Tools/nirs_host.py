@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+"""Host builds of the MiB-NIRS firmware sources for the ctypes checks.
+
+Shared by nirs_iir.py, nirs_kalman.py and nirs_tsi.py: compiles Project/*.c with the
+host C compiler, float32_t declared as float (the firmware build) or double through a
+stand-in arm_math_types.h, and declares the firmware structs the checks pass across.
+"""
+
+import ctypes
+import os
+import shutil
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Project")
+CFLAGS = ["-std=c99", "-O2", "-Wall"]
+
+WAVELENGTHS = 2             # NIRS_WAVELENGTHS
+LSB_NA = 0.015625           # MAX30101_CURRENT_LSB_NA
+
+
+class Current(ctypes.Structure):
+    """MAX30101_CurrentSample (nA)."""
+    _fields_ = [("red", ctypes.c_float), ("ir", ctypes.c_float)]
+
+
+def write_types(tmp, real="float"):
+    with open(os.path.join(tmp, "arm_math_types.h"), "w") as handle:
+        handle.write("typedef %s float32_t;\n" % real)
+
+
+def load(cc, root, sources, real="float"):
+    """Build sources (file names in root) as a shared library and load it."""
+    tmp = tempfile.mkdtemp(prefix="nirs_host_")
+    try:
+        write_types(tmp, real)
+        lib = os.path.join(tmp, "libnirs_host.so")
+        subprocess.check_call([cc] + CFLAGS + ["-shared", "-fPIC", "-I", tmp, "-I", root, "-o", lib]
+                              + [os.path.join(root, s) for s in sources] + ["-lm"])
+        return ctypes.CDLL(lib)
+    finally:
+        shutil.rmtree(tmp, ignore_errors=True)
+
+
+def run(cc, root, sources, main_c):
+    """Build main_c (C source text) with sources into a program, run it and return its output."""
+    tmp = tempfile.mkdtemp(prefix="nirs_host_")
+    try:
+        write_types(tmp)
+        src, exe = os.path.join(tmp, "main.c"), os.path.join(tmp, "main")
+        with open(src, "w") as handle:
+            handle.write(main_c)
+        subprocess.check_call([cc] + CFLAGS + ["-I", tmp, "-I", root, "-o", exe, src]
+                              + [os.path.join(root, s) for s in sources] + ["-lm"])
+        return subprocess.check_output([exe]).decode()
+    finally:
+        shutil.rmtree(tmp, ignore_errors=True)
+
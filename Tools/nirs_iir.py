@@ -0,0 +1,326 @@
+#!/usr/bin/env python3
+"""Host validation of the run-time IIR designer of the MiB-NIRS firmware (Project/IIR.c).
+
+Builds IIR.c with the host C compiler and calls IIR_Design() / IIR_DCBlockerAlpha()
+through ctypes, so the code under test is the code that runs on the board: once with
+float32_t as float (the firmware build) and once as double, which keeps the
+coefficients unrounded and isolates the design method. Designs are checked against:
+
+    reference   the MATLAB fdesign.highpass cascade the firmware used to carry as a
+                constant table (Chebyshev II, order 4, Fst 0.04 Hz, Ast 80 dB, fs 50 Hz),
+                and closed-form Butterworth biquads (prewarped bilinear sections with
+                Q_k = 1 / (2 sin((2k+1)pi/(2N)))); coefficients must agree to float
+                rounding
+    response    the exact magnitude of the ideal design, |H|^2 = 1 / (1 + v^2N)
+                (Butterworth) or 1 / (1 + 1 / (eps^2 T_N(1/v)^2)) (Chebyshev II), with v
+                the prototype frequency of the prewarped analog LP/HP/BP transformation.
+                The double build must follow it within DESIGN_TOL_DB down to the
+                stopband level and never rise above it
+    stability   poles of the float32 coefficients inside the unit circle; designs
+                IIR_Design() rejects must be unstable once rounded
+
+for Butterworth and Chebyshev II low-, high- and band-pass filters of every order
+the firmware accepts, at every MAX30101 ODR. The firmware filter (FILTER_ORDER,
+FILTER_CUTOFF_HZ, FILTER_STOP_DB in Project/main.c) is then listed per ODR with its
+float32 coefficients, worst stopband level, passband error from 5 x the edge, and
+DC-blocker alpha. The float32 rounding, not the method, limits the firmware filter
+at high ODRs: its poles move towards z = 1 as fs grows.
+
+Usage:
+    nirs_iir.py                 # full check, exit status 1 on any failure
+    nirs_iir.py --firmware      # only the per-ODR table of the firmware filter
+    nirs_iir.py --cc clang      # other host compiler
+"""
+
+import argparse
+import cmath
+import ctypes
+import math
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from nirs_host import ROOT, load  # noqa: E402
+
+BUTTERWORTH, CHEBYSHEV2 = 0, 1
+LOWPASS, HIGHPASS, BANDPASS = 0, 1, 2
+FAMILIES = {BUTTERWORTH: "butter", CHEBYSHEV2: "cheby2"}
+RESPONSES = {LOWPASS: "lp", HIGHPASS: "hp", BANDPASS: "bp"}
+
+MAX_SECTIONS = 4            # STAGE_BIQUAD_MAX_SECTIONS
+ODRS = (50, 100, 200, 400)  # MAX30101_SetSampleRate()
+COEFF_TOL = 2e-6            # float32 rounding of the reference coefficients
+DESIGN_TOL_DB = 1e-3        # double build vs exact response
+PASSBAND_FROM = 5.0         # firmware filter: passband check from 5 x FILTER_CUTOFF_HZ
+PASS_TOL_DB = 0.1           # float32 cascade vs exact response there
+STOP_TOL_DB = 6.0           # float32 stopband floor above -FILTER_STOP_DB
+GRID_POINTS = 400
+
+# MATLAB fdesign.highpass('N,Fst,Ast', 4, 0.04, 80, 50), Chebyshev II, df2T sections
+MATLAB_HP = (
+    (0.98855555, -1.9770899, 0.98855555, 1.9766545, -0.97754645),
+    (0.97310543, -1.9462072, 0.97310543, 1.9457787, -0.94663936),
+)
+
+
+def spec_type(real):
+    class Spec(ctypes.Structure):
+        _fields_ = [("family", ctypes.c_uint8), ("response", ctypes.c_uint8), ("order", ctypes.c_uint8),
+                    ("f1_hz", real), ("f2_hz", real), ("stop_db", real)]
+    return Spec
+
+
+def f32(x):
+    return struct.unpack("<f", struct.pack("<f", x))[0]
+
+
+class Designer:
+    """IIR.c built for the host. real="float" is the firmware build; real="double" keeps
+    the coefficients unrounded and isolates the design method from float32 quantisation."""
+
+    def __init__(self, cc, root, real="float"):
+        self.real = ctypes.c_float if real == "float" else ctypes.c_double
+        self.spec = spec_type(self.real)
+        self.dll = load(cc, root, ["IIR.c"], real)
+        self.dll.IIR_Design.argtypes = [ctypes.POINTER(self.spec), self.real, ctypes.POINTER(self.real), ctypes.c_uint8]
+        self.dll.IIR_Design.restype = ctypes.c_uint8
+        self.dll.IIR_DCBlockerAlpha.argtypes = [self.real, self.real]
+        self.dll.IIR_DCBlockerAlpha.restype = self.real
+
+    def design(self, family, response, order, f1, fs, f2=0.0, stop_db=0.0):
+        """Sections [(b0, b1, b2, a1, a2), ...] in CMSIS layout (feedback negated), or None."""
+        buf = (self.real * (5 * MAX_SECTIONS))()
+        spec = self.spec(family, response, order, f1, f2, stop_db)
+        n = self.dll.IIR_Design(ctypes.byref(spec), fs, buf, MAX_SECTIONS)
+        if n == 0:
+            return None
+        return [tuple(buf[5 * s:5 * s + 5]) for s in range(n)]
+
+    def alpha(self, fc, fs):
+        return self.dll.IIR_DCBlockerAlpha(fc, fs)
+
+
+def cascade_gain(sections, f, fs):
+    q = cmath.exp(-2j * math.pi * f / fs)
+    h = 1.0
+    for b0, b1, b2, a1, a2 in sections:
+        h *= (b0 + b1 * q + b2 * q * q) / (1.0 - a1 * q - a2 * q * q)
+    return abs(h)
+
+
+def max_pole_radius(sections):
+    radius = 0.0
+    for _, _, _, a1, a2 in sections:
+        # z^2 - a1 z - a2 = 0
+        d = cmath.sqrt(a1 * a1 + 4.0 * a2)
+        radius = max(radius, abs((a1 + d) / 2.0), abs((a1 - d) / 2.0))
+    return radius
+
+
+def chebyshev(n, x):
+    if abs(x) <= 1.0:
+        return math.cos(n * math.acos(x))
+    return math.cosh(n * math.acosh(abs(x))) * (1 if x > 0 or n % 2 == 0 else -1)
+
+
+def exact_gain(family, response, order, f1, f2, stop_db, f, fs):
+    """Magnitude of the ideal (infinite precision) bilinear design at f."""
+    warp = lambda x: 2.0 * fs * math.tan(math.pi * x / fs)
+    w = warp(f)
+    w1 = warp(f1)
+    if response == LOWPASS:
+        v = w / w1
+    elif response == HIGHPASS:
+        v = w1 / w if w > 0 else math.inf
+    else:
+        w2 = warp(f2)
+        v = abs(w * w - w1 * w2) / (w * (w2 - w1)) if w > 0 else math.inf
+    if family == BUTTERWORTH:
+        return 0.0 if math.isinf(v) else 1.0 / math.sqrt(1.0 + v ** (2 * order))
+    eps2 = 1.0 / (10.0 ** (0.1 * stop_db) - 1.0)
+    if v == 0.0:
+        return 1.0
+    if math.isinf(v):
+        return 0.0 if order % 2 else math.sqrt(1.0 / (1.0 + 1.0 / (eps2 * chebyshev(order, 0.0) ** 2)))
+    t = chebyshev(order, 1.0 / v)
+    if t == 0.0:
+        return 0.0
+    return 1.0 / math.sqrt(1.0 + 1.0 / (eps2 * t * t))
+
+
+def db(x):
+    return 20.0 * math.log10(max(x, 1e-15))
+
+
+def butterworth_reference(response, order, fc, fs):
+    """Closed-form Butterworth LP/HP biquads (float32-rounded), sorted by a2."""
+    k = math.tan(math.pi * fc / fs)
+    sections = []
+    for i in range(order // 2):
+        q = 1.0 / (2.0 * math.sin((2 * i + 1) * math.pi / (2 * order)))
+        den = 1.0 + k / q + k * k
+        a1 = -2.0 * (k * k - 1.0) / den
+        a2 = -(1.0 - k / q + k * k) / den
+        if response == LOWPASS:
+            b = (k * k / den, 2 * k * k / den, k * k / den)
+        else:
+            b = (1.0 / den, -2.0 / den, 1.0 / den)
+        sections.append(b + (a1, a2))
+    if order % 2:
+        den = 1.0 + k
+        a1 = -(k - 1.0) / den
+        b = (k / den, k / den, 0.0) if response == LOWPASS else (1.0 / den, -1.0 / den, 0.0)
+        sections.append(b + (a1, 0.0))
+    return sorted((tuple(f32(x) for x in s) for s in sections), key=lambda s: s[4])
+
+
+def coeff_error(got, ref):
+    return max(abs(a - b) for gs, rs in zip(got, ref) for a, b in zip(gs, rs))
+
+
+def response_error(sections, family, response, order, f1, f2, stop_db, fs, f_from=None):
+    """Largest dB deviation from the exact response over a log grid up to Nyquist.
+
+    Where the exact response is within 1 dB of the stopband level (-stop_db, or -80 dB
+    for Butterworth) or below, only rising above it counts.
+    """
+    worst = 0.0
+    floor = -stop_db if family == CHEBYSHEV2 else -80.0
+    lo = f_from or min(f1, 0.01 * fs) / 20.0
+    for i in range(GRID_POINTS):
+        f = lo * (0.5 * fs * 0.999 / lo) ** (i / (GRID_POINTS - 1))
+        got = db(cascade_gain(sections, f, fs))
+        ref = db(exact_gain(family, response, order, f1, f2, stop_db, f, fs))
+        if ref >= floor + 1.0:
+            worst = max(worst, abs(got - ref))
+        else:
+            worst = max(worst, got - max(ref, floor))
+    return worst
+
+
+def check_method(exact, rounded, out):
+    """Design method against the references and the exact responses."""
+    failures = 0
+    out.write("# reference designs (float32 build)\n")
+    err = coeff_error(rounded.design(CHEBYSHEV2, HIGHPASS, 4, 0.04, 50.0, stop_db=80.0), MATLAB_HP)
+    ok = err <= COEFF_TOL
+    failures += not ok
+    out.write("matlab cheby2 hp 4, 0.04 Hz @ 50 Hz, 80 dB   max|dc| = %.2e  %s\n" % (err, "OK" if ok else "FAIL"))
+    worst = 0.0
+    for response in (LOWPASS, HIGHPASS):
+        for order in range(1, 2 * MAX_SECTIONS + 1):
+            for fs in ODRS:
+                for fc in (0.04, 0.5, 5.0, 0.2 * fs):
+                    got = rounded.design(BUTTERWORTH, response, order, fc, fs)
+                    worst = max(worst, coeff_error(sorted(got, key=lambda s: s[4]),
+                                                   butterworth_reference(response, order, fc, fs)))
+    ok = worst <= COEFF_TOL
+    failures += not ok
+    out.write("closed-form butterworth lp/hp, orders 1-8    max|dc| = %.2e  %s\n" % (worst, "OK" if ok else "FAIL"))
+
+    out.write("# exact response (double build) and float32 stability\n")
+    cases = 0
+    unrealisable = 0
+    worst_all = 0.0
+    for family in (BUTTERWORTH, CHEBYSHEV2):
+        for response in (LOWPASS, HIGHPASS, BANDPASS):
+            orders = range(1, (MAX_SECTIONS if response == BANDPASS else 2 * MAX_SECTIONS) + 1)
+            for order in orders:
+                for fs in ODRS:
+                    for f1, f2 in ((0.04, 0.5), (0.5, 5.0), (0.1 * fs, 0.3 * fs)):
+                        for stop_db in ((40.0, 80.0) if family == CHEBYSHEV2 else (0.0,)):
+                            cases += 1
+                            sections = exact.design(family, response, order, f1, fs, f2, stop_db)
+                            single = rounded.design(family, response, order, f1, fs, f2, stop_db)
+                            if sections is None:
+                                worst, stable = math.nan, False
+                            else:
+                                worst = response_error(sections, family, response, order, f1, f2, stop_db, fs)
+                                worst_all = max(worst_all, worst)
+                                if single is None:
+                                    # Rejected by the float32 stability check: must really be unstable
+                                    rounded_exact = [tuple(f32(c) for c in s) for s in sections]
+                                    stable = max_pole_radius(rounded_exact) >= 1.0
+                                    unrealisable += stable
+                                else:
+                                    stable = max_pole_radius(single) < 1.0
+                            if not (worst <= DESIGN_TOL_DB and stable):
+                                failures += 1
+                                out.write("FAIL %s,%s,%d,%g,%g,%g @ %g Hz: %.2e dB%s\n" % (
+                                    FAMILIES[family], RESPONSES[response], order, f1,
+                                    f2 if response == BANDPASS else 0.0, stop_db, fs, worst,
+                                    "" if stable else ", unstable"))
+    out.write("%d designs, worst deviation %.2e dB, %d rejected as unstable in float32, %d failures\n"
+              % (cases, worst_all, unrealisable, failures))
+
+    out.write("# invalid specifications are rejected\n")
+    invalid = (
+        (BUTTERWORTH, LOWPASS, 0, 1.0, 0.0, 0.0),
+        (BUTTERWORTH, LOWPASS, 2 * MAX_SECTIONS + 1, 1.0, 0.0, 0.0),
+        (BUTTERWORTH, BANDPASS, MAX_SECTIONS + 1, 1.0, 2.0, 0.0),
+        (BUTTERWORTH, HIGHPASS, 2, 25.0, 0.0, 0.0),
+        (BUTTERWORTH, BANDPASS, 2, 2.0, 1.0, 0.0),
+        (CHEBYSHEV2, HIGHPASS, 2, 1.0, 0.0, 0.0),
+    )
+    rejected = 0
+    for family, response, order, f1, f2, stop_db in invalid:
+        if rounded.design(family, response, order, f1, 50.0, f2, stop_db) is None:
+            rejected += 1
+        else:
+            failures += 1
+            out.write("FAIL accepted %s,%s,%d,%g,%g,%g @ 50 Hz\n" % (
+                FAMILIES[family], RESPONSES[response], order, f1, f2, stop_db))
+    out.write("%d/%d rejected\n" % (rejected, len(invalid)))
+    return failures
+
+
+def check_firmware(rounded, root, out):
+    """Firmware filter per ODR, float32 coefficients as the board uses them."""
+    text = open(os.path.join(root, "main.c"), encoding="utf-8", errors="replace").read()
+    value = lambda name: float(re.search(r"#define\s+%s\s+([\d.]+)" % name, text).group(1))
+    order, fc, stop_db = int(value("FILTER_ORDER")), value("FILTER_CUTOFF_HZ"), value("FILTER_STOP_DB")
+    failures = 0
+    out.write("# firmware: cheby2 hp order %d, fst %g Hz, %g dB; dcblock -3 dB at %g Hz (float32)\n"
+              % (order, fc, stop_db, fc))
+    out.write("odr_hz,sections,stopband_max_db,passband_err_db,max_pole_radius,alpha,dcblock_fc_db,coefficients\n")
+    for fs in ODRS:
+        sections = rounded.design(CHEBYSHEV2, HIGHPASS, order, fc, fs, stop_db=stop_db)
+        if sections is None:
+            failures += 1
+            out.write("%d,FAIL\n" % fs)
+            continue
+        alpha = rounded.alpha(fc, fs)
+        q = cmath.exp(-2j * math.pi * fc / fs)
+        dc_db = db(abs((1 - q) / (1 - alpha * q)))
+        stop_max = max(db(cascade_gain(sections, fc * i / 100.0, fs)) for i in range(1, 101))
+        pass_err = response_error(sections, CHEBYSHEV2, HIGHPASS, order, fc, 0.0, stop_db, fs,
+                                  f_from=PASSBAND_FROM * fc)
+        ok = (stop_max <= -stop_db + STOP_TOL_DB and pass_err <= PASS_TOL_DB
+              and max_pole_radius(sections) < 1.0 and abs(dc_db + 3.0103) < 0.01)
+        failures += not ok
+        out.write("%d,%d,%.2f,%.4f,%.7f,%.7f,%.4f,%s%s\n" % (
+            fs, len(sections), stop_max, pass_err, max_pole_radius(sections), alpha, dc_db,
+            " ".join("%.8g" % c for s in sections for c in s), "" if ok else ",FAIL"))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--firmware", action="store_true", help="only the per-ODR table of the firmware filter")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"), help="host C compiler")
+    parser.add_argument("--root", default=ROOT, help="firmware source directory")
+    args = parser.parse_args()
+
+    rounded = Designer(args.cc, args.root, "float")
+    failures = 0
+    if not args.firmware:
+        failures += check_method(Designer(args.cc, args.root, "double"), rounded, sys.stdout)
+    failures += check_firmware(rounded, args.root, sys.stdout)
+    print("PASS" if failures == 0 else "FAIL (%d)" % failures)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
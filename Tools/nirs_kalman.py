@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+"""Host evaluation of the ΔHb Kalman estimator of the MiB-NIRS firmware (Project/NIRS.c).
+
+Builds NIRS.c with the host C compiler and calls NIRS_ComputeDeltaOD(),
+NIRS_ComputeDeltaHb() and NIRS_KalmanDesign/Start/Update() through ctypes, so the
+code under test is the code that runs on the board (float32). A simulated recording
+drives both estimators:
+
+    truth       ΔHbO2/ΔHHb of a block task (smooth rise to +A / −A/3 µM, 20 s on,
+                20 s off), a 0.1 Hz Mayer wave and a slow random walk
+    currents    I(λ) = I0(λ) · 10^(−H·x) with white current noise and the 15.625 pA
+                ADC step, H = d · DPF · ε · 1e-6 as in NIRS.h
+
+and reports per estimator:
+
+    rmse        RMS error against the truth (µM), ΔHbO2 and ΔHHb
+    lag_ms      delay of the estimate that best matches the truth (cross-correlation)
+    gain        steady-state Kalman gain (fraction of each new inversion taken)
+
+for the per-sample inversion and the Kalman filter over a range of random-walk rates
+q (µM/√s), with the ΔOD noise of the model matched to the simulated noise. The
+firmware values (HB_KALMAN_Q_RATE, HB_KALMAN_OD_NOISE in Project/main.c) are marked.
+
+The float32 information-form update is also checked against a double-precision
+Kalman filter in gain form (x += P·HᵀR⁻¹·(z − H·x)) on the same ΔOD; both must agree
+to float rounding (ref_diff_um, exit status 1 otherwise). --timing builds a C loop around both
+estimators and reports host ns per sample: a relative figure only, the on-target
+cycles come from the BENCH "kalman" case and the "hbkalman" #PIPE line.
+
+Usage:
+    nirs_kalman.py                          # 50 Hz, 300 s, 0.5 nA noise
+    nirs_kalman.py --odr 100 --noise-na 1.0 --dc-na 800 1500
+    nirs_kalman.py --q 0.05 0.1 0.2 0.5     # rates to compare
+    nirs_kalman.py --timing
+"""
+
+import argparse
+import ctypes
+import math
+import os
+import random
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from nirs_host import LSB_NA, ROOT, WAVELENGTHS, Current, load, run  # noqa: E402
+
+REF_TOL_UM = 2e-3           # float32 firmware vs double reference (µM)
+TASK_PERIOD_S = 40.0
+TASK_AMPLITUDE_UM = 3.0
+RISE_S = 5.0
+
+
+class Model(ctypes.Structure):
+    _fields_ = [("q", ctypes.c_float), ("g", ctypes.c_float * 3), ("p0", ctypes.c_float * 3),
+                ("h_r", (ctypes.c_float * WAVELENGTHS) * 2)]
+
+
+class State(ctypes.Structure):
+    _fields_ = [("x", ctypes.c_float * 2), ("p", ctypes.c_float * 3)]
+
+
+class Hb(ctypes.Structure):
+    _fields_ = [("hbo2", ctypes.c_float), ("hhb", ctypes.c_float)]
+
+
+class Nirs:
+    """MBLL and Kalman estimators of the host build."""
+
+    def __init__(self, cc, root):
+        self.dll = load(cc, root, ["NIRS.c"])
+        self.dll.NIRS_KalmanDesign.argtypes = [ctypes.POINTER(Model), ctypes.c_float,
+                                               ctypes.POINTER(ctypes.c_float), ctypes.c_float]
+        self.dll.NIRS_ComputeDeltaOD.restype = ctypes.c_uint8
+        self.dll.NIRS_ComputeDeltaHb.restype = ctypes.c_uint8
+        self.dll.NIRS_Init()
+
+    def design(self, q_rate, od_noise, period_s):
+        model = Model()
+        noise = (ctypes.c_float * WAVELENGTHS)(*od_noise)
+        self.dll.NIRS_KalmanDesign(ctypes.byref(model), q_rate, noise, period_s)
+        return model
+
+    def run(self, currents, model=None, sensor=0):
+        """Estimates per sample (None for the baseline), with the ΔOD fed to the filter."""
+        self.dll.NIRS_ResetBaseline(sensor)
+        state, started = State(), False
+        od = (ctypes.c_float * WAVELENGTHS)()
+        hb, cur = Hb(), Current()
+        out, ods = [], []
+        for red, ir in currents:
+            cur.red, cur.ir = red, ir
+            if model is None:
+                ok = self.dll.NIRS_ComputeDeltaHb(sensor, ctypes.byref(cur), ctypes.byref(hb))
+            else:
+                ok = self.dll.NIRS_ComputeDeltaOD(sensor, ctypes.byref(cur), od)
+                if ok:
+                    if not started:
+                        self.dll.NIRS_KalmanStart(ctypes.byref(model), ctypes.byref(state))
+                        started = True
+                    self.dll.NIRS_KalmanUpdate(ctypes.byref(model), ctypes.byref(state), od, ctypes.byref(hb))
+                    ods.append((od[0], od[1]))
+            out.append((hb.hbo2, hb.hhb) if ok else None)
+        return out, ods
+
+
+def firmware_constants(root):
+    nirs = open(os.path.join(root, "NIRS.h"), encoding="utf-8", errors="replace").read()
+    main = open(os.path.join(root, "main.c"), encoding="utf-8", errors="replace").read()
+    value = lambda text, name: float(re.search(r"#define\s+%s\s+([-\d.eE]+)f?" % name, text).group(1))
+    k = value(nirs, "NIRS_SD_DISTANCE_CM") * value(nirs, "NIRS_DPF") * 1e-6
+    h = [[k * value(nirs, "NIRS_EPS_HBO2_RED"), k * value(nirs, "NIRS_EPS_HHB_RED")],
+         [k * value(nirs, "NIRS_EPS_HBO2_IR"), k * value(nirs, "NIRS_EPS_HHB_IR")]]
+    return h, value(main, "HB_KALMAN_Q_RATE"), value(main, "HB_KALMAN_OD_NOISE")
+
+
+def simulate(h, fs, seconds, dc, noise_na, amplitude, seed):
+    rng = random.Random(seed)
+    n = int(seconds * fs)
+    walk = [0.0, 0.0]
+    truth, currents = [], []
+    for i in range(n):
+        t = i / fs
+        phase = t % TASK_PERIOD_S
+        if phase < TASK_PERIOD_S / 2:
+            level = 1.0 - math.exp(-phase / (RISE_S / 3))
+        else:
+            level = math.exp(-(phase - TASK_PERIOD_S / 2) / (RISE_S / 3)) * (1.0 - math.exp(-TASK_PERIOD_S / 2 / (RISE_S / 3)))
+        for s in range(2):
+            walk[s] += rng.gauss(0.0, 0.05 / math.sqrt(fs))
+        mayer = 0.3 * math.sin(2 * math.pi * 0.1 * t)
+        x = (amplitude * level + mayer + walk[0],
+             -amplitude / 3 * level + 0.3 * mayer + walk[1])
+        truth.append(x)
+        sample = []
+        for l in range(WAVELENGTHS):
+            od = h[l][0] * x[0] + h[l][1] * x[1]
+            i_na = dc[l] * 10.0 ** (-od) + rng.gauss(0.0, noise_na)
+            sample.append(round(i_na / LSB_NA) * LSB_NA)
+        currents.append(tuple(sample))
+    return truth, currents
+
+
+def metrics(estimate, truth, fs):
+    pairs = [(e, t) for e, t in zip(estimate, truth) if e is not None]
+    warm = len(pairs) // 10         # skip the start-up transient
+    pairs = pairs[warm:]
+    rmse = [math.sqrt(sum((e[s] - t[s]) ** 2 for e, t in pairs) / len(pairs)) for s in range(2)]
+    # lag: shift of the estimate (samples) that minimises the ΔHbO2 error
+    best = min(range(0, int(fs) + 1),
+               key=lambda d: sum((pairs[i + d][0][0] - pairs[i][1][0]) ** 2 for i in range(0, len(pairs) - d, 4)))
+    return rmse, best * 1000.0 / fs
+
+
+def reference_check(h, model, ods, estimates, q, od_noise):
+    """Double-precision Kalman on the same ΔOD, gain form x += P·HᵀR⁻¹·(z − H·x); max |difference| (µM).
+
+    The posterior covariance is taken as (P⁻¹ + HᵀR⁻¹H)⁻¹: the textbook P − K·H·P loses
+    positive definiteness over long runs when R is this small relative to P.
+    """
+    r = [od_noise[l] ** 2 for l in range(WAVELENGTHS)]
+    g = [[sum(h[l][i] * h[l][j] / r[l] for l in range(WAVELENGTHS)) for j in range(2)] for i in range(2)]
+
+    def inverse(m):
+        det = m[0][0] * m[1][1] - m[0][1] * m[1][0]
+        return [[m[1][1] / det, -m[0][1] / det], [-m[1][0] / det, m[0][0] / det]]
+
+    p = inverse(g)
+    x = [0.0, 0.0]
+    worst = 0.0
+    for z, est in zip(ods, [e for e in estimates if e is not None]):
+        prior = inverse([[p[0][0] + q, p[0][1]], [p[1][0], p[1][1] + q]])
+        p = inverse([[prior[i][j] + g[i][j] for j in range(2)] for i in range(2)])
+        innov = [(z[l] - (h[l][0] * x[0] + h[l][1] * x[1])) / r[l] for l in range(WAVELENGTHS)]
+        grad = [sum(h[l][i] * innov[l] for l in range(WAVELENGTHS)) for i in range(2)]
+        x = [x[i] + p[i][0] * grad[0] + p[i][1] * grad[1] for i in range(2)]
+        worst = max(worst, abs(x[0] - est[0]), abs(x[1] - est[1]))
+    return worst
+
+
+def steady_gain(model, fs):
+    """Fraction of a new inversion in the estimate after convergence: 1 − P_post / P_prior (ΔHbO2)."""
+    a, b, c = model.p0[0], model.p0[1], model.p0[2]
+    for _ in range(int(60 * fs)):
+        pa, pb, pc = a + model.q, b, c + model.q
+        det = pa * pc - pb * pb
+        y00, y01, y11 = pc / det + model.g[0], -pb / det + model.g[1], pa / det + model.g[2]
+        det2 = y00 * y11 - y01 * y01
+        a, b, c = y11 / det2, -y01 / det2, y00 / det2
+    return 1.0 - a / (a + model.q)
+
+
+TIMING_C = r"""
+#define _POSIX_C_SOURCE 199309L
+#include "NIRS.h"
+#include <stdio.h>
+#include <time.h>
+static double now(void) { struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t); return t.tv_sec + t.tv_nsec * 1e-9; }
+int main(void) {
+    enum { N = 2000000 };
+    const float32_t noise[NIRS_WAVELENGTHS] = { 1e-4f, 1e-4f };
+    NIRS_KalmanModel model; NIRS_KalmanState state; NIRS_HbSample hb;
+    MAX30101_CurrentSample cur = { 1500.0f, 2500.0f };
+    volatile float32_t sink = 0.0f;
+    NIRS_Init();
+    NIRS_KalmanDesign(&model, 0.2f, noise, 0.02f);
+    NIRS_KalmanStart(&model, &state);
+    NIRS_ComputeDeltaHb(0, &cur, &hb);
+    double t0 = now();
+    for (int i = 0; i < N; i++) {
+        float32_t od[NIRS_WAVELENGTHS] = { 1e-5f * (float32_t)(i & 15), -1e-5f * (float32_t)(i & 7) };
+        NIRS_KalmanUpdate(&model, &state, od, &hb);
+        sink += hb.hbo2;
+    }
+    double t1 = now();
+    for (int i = 0; i < N; i++) {
+        cur.red = 1500.0f + (float32_t)(i & 15);
+        NIRS_ComputeDeltaHb(0, &cur, &hb);
+        sink += hb.hbo2;
+    }
+    double t2 = now();
+    for (int i = 0; i < N; i++) {
+        float32_t od[NIRS_WAVELENGTHS];
+        cur.red = 1500.0f + (float32_t)(i & 15);
+        NIRS_ComputeDeltaOD(0, &cur, od);
+        NIRS_KalmanUpdate(&model, &state, od, &hb);
+        sink += hb.hbo2;
+    }
+    double t3 = now();
+    printf("kalman_update,%.1f\nmbll_sample,%.1f\nkalman_sample,%.1f\n",
+           (t1 - t0) / N * 1e9, (t2 - t1) / N * 1e9, (t3 - t2) / N * 1e9);
+    return sink == 1.0f;
+}
+"""
+
+
+def timing(cc, root, out):
+    result = run(cc, root, ["NIRS.c"], TIMING_C)
+    out.write("# host ns per sample (relative only; on target see BENCH kalman / #PIPE hbkalman)\n")
+    out.write("case,ns\n" + result)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--odr", type=float, default=50.0, help="sample rate (Hz)")
+    parser.add_argument("--seconds", type=float, default=300.0, help="simulated recording length")
+    parser.add_argument("--dc-na", type=float, nargs=2, default=(1500.0, 2500.0), metavar=("RED", "IR"),
+                        help="baseline currents (nA)")
+    parser.add_argument("--noise-na", type=float, default=0.5, help="white current noise (nA rms)")
+    parser.add_argument("--amplitude", type=float, default=TASK_AMPLITUDE_UM, help="task ΔHbO2 (µM)")
+    parser.add_argument("--q", type=float, nargs="+", help="random-walk rates to compare (µM/√s)")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--timing", action="store_true", help="also time both estimators on the host")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"), help="host C compiler")
+    parser.add_argument("--root", default=ROOT, help="firmware source directory")
+    args = parser.parse_args()
+
+    h, fw_q, fw_noise = firmware_constants(args.root)
+    nirs = Nirs(args.cc, args.root)
+    truth, currents = simulate(h, args.odr, args.seconds, args.dc_na, args.noise_na, args.amplitude, args.seed)
+    od_noise = [args.noise_na / (args.dc_na[l] * math.log(10)) for l in range(WAVELENGTHS)]
+    rates = sorted(set((args.q or [0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0]) + [fw_q]))
+
+    out = sys.stdout
+    out.write("# %g Hz, %g s, I0 %g/%g nA, noise %g nA -> OD noise %.2e/%.2e; firmware q %g µM/√s, OD noise %.1e\n"
+              % (args.odr, args.seconds, args.dc_na[0], args.dc_na[1], args.noise_na,
+                 od_noise[0], od_noise[1], fw_q, fw_noise))
+    out.write("estimator,q_um_rt_s,gain,rmse_hbo2_um,rmse_hhb_um,lag_ms,ref_diff_um\n")
+    est, _ = nirs.run(currents)
+    rmse, lag = metrics(est, truth, args.odr)
+    out.write("mbll,,1.000,%.4f,%.4f,%.0f,\n" % (rmse[0], rmse[1], lag))
+    failures = 0
+    for q in rates:
+        model = nirs.design(q, od_noise, 1.0 / args.odr)
+        est, ods = nirs.run(currents, model)
+        rmse, lag = metrics(est, truth, args.odr)
+        diff = reference_check(h, model, ods, est, model.q, od_noise)
+        ok = diff <= REF_TOL_UM
+        failures += not ok
+        out.write("kalman%s,%g,%.3f,%.4f,%.4f,%.0f,%.1e%s\n" % (
+            "(firmware)" if q == fw_q else "", q, steady_gain(model, args.odr), rmse[0], rmse[1], lag, diff,
+            "" if ok else ",FAIL"))
+    if args.timing:
+        timing(args.cc, args.root, out)
+    print("PASS" if failures == 0 else "FAIL (%d)" % failures)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
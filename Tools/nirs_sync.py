@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+"""Host side of the MiB-NIRS clock synchronisation (see Project/SYNC.h).
+
+Sends PING commands (0x80) every --period seconds, collects the SYNC echoes
+(stream 0x10) and maps device time stamps to the host clock using the
+estimate the device carries in every echo:
+
+    host = ref_host + (1 + drift) * (device - ref_dev)     (device wraps at 2^32 us)
+
+Each PING reports the host receive time t4 of the previous echo, so the
+device sees all four timestamps of every exchange.
+
+--simulate runs a device stand-in on a pseudo-terminal: a clock with an
+offset near the 32-bit wrap and an HSI-like rate error, random link delays,
+and a port of the firmware estimator. The stand-in also emits STATUS frames
+"#TRUE,<host_us>" stamped with its device time, so the alignment error of the
+mapping can be measured directly.
+
+Usage:
+    nirs_sync.py /dev/ttyACM0 --baud 460800 --duration 60
+    nirs_sync.py --simulate --drift-ppm 3000 --duration 30
+"""
+
+import argparse
+import os
+import random
+import select
+import struct
+import sys
+import threading
+import time
+import tty
+
+from nirs_frames import FrameParser, STREAM_STATUS, STREAM_SYNC, build_frame
+
+CMD_PING = 0x80
+SYNC_WINDOW = 16
+SYNC_DELAY_TOLERANCE_US = 400
+
+
+def host_us():
+    return time.monotonic_ns() // 1000
+
+
+def wrap32(value):
+    """Signed difference of two 32-bit device times."""
+    value &= 0xFFFFFFFF
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+class Estimator:
+    """Port of SYNC_AddExchange()/SYNC_Fit() (device side)."""
+
+    def __init__(self):
+        self.points = []
+        self.delays = []
+        self.ref_dev = 0
+        self.ref_host = 0
+        self.drift = 0.0
+
+    def add(self, t1, t2, t3, t4):
+        turnaround = (t3 - t2) & 0xFFFFFFFF
+        delay = (t4 - t1) - turnaround
+        if t4 <= t1 or delay < 0:
+            return
+        self.delays = (self.delays + [delay])[-SYNC_WINDOW:]
+        if delay > min(self.delays) + SYNC_DELAY_TOLERANCE_US:
+            return
+        self.points = (self.points + [((t2 + turnaround // 2) & 0xFFFFFFFF, t1 + (t4 - t1) // 2)])[-SYNC_WINDOW:]
+        ref_dev, ref_host = self.points[-1]
+        xs = [wrap32(d - ref_dev) for d, _ in self.points]
+        ys = [(h - ref_host) - x for (_, h), x in zip(self.points, xs)]
+        n = len(xs)
+        mx, my = sum(xs) / n, sum(ys) / n
+        sxx = sum((x - mx) ** 2 for x in xs)
+        sxy = sum((x - mx) * (y - my) for x, y in zip(xs, ys))
+        b = sxy / sxx if n > 1 and sxx > 0 else 0.0
+        self.ref_dev = ref_dev
+        self.ref_host = ref_host + int(my - b * mx)
+        self.drift = b
+
+    def echo(self, t1, t2, t3):
+        return struct.pack("<QIIIQiB", t1, t2, t3, self.ref_dev, self.ref_host,
+                           int(self.drift * 1e9), len(self.points))
+
+
+class SyncClient:
+    """Builds PING frames and keeps the device -> host mapping from SYNC echoes."""
+
+    def __init__(self):
+        self.seq = 0
+        self.prev_t1 = 0
+        self.prev_t4 = 0
+        self.pending_t1 = None
+        self.ref_dev = 0
+        self.ref_host = 0
+        self.drift = 0.0
+        self.points = 0
+        self.residuals = []
+
+    def ping(self):
+        t1 = host_us()
+        payload = struct.pack("<QQQ", t1, self.prev_t1, self.prev_t4)
+        self.pending_t1 = t1
+        self.seq += 1
+        return build_frame(CMD_PING, self.seq, payload, t1)
+
+    def on_echo(self, payload, t4):
+        t1, t2, t3, ref_dev, ref_host, drift_ppb, points = struct.unpack_from("<QIIIQiB", payload, 0)
+        if t1 != self.pending_t1:
+            return
+        self.prev_t1, self.prev_t4 = t1, t4
+        self.ref_dev, self.ref_host, self.drift, self.points = ref_dev, ref_host, drift_ppb * 1e-9, points
+        if points:
+            # midpoint residual: bounded by half the round-trip delay
+            mid_dev = (t2 + ((t3 - t2) & 0xFFFFFFFF) // 2) & 0xFFFFFFFF
+            self.residuals.append(self.to_host(mid_dev) - (t1 + t4) / 2)
+
+    def valid(self):
+        return self.points > 0
+
+    def to_host(self, device_us):
+        return self.ref_host + (1.0 + self.drift) * wrap32(device_us - self.ref_dev)
+
+
+class DeviceStandIn(threading.Thread):
+    """Simulated device on the slave side of a pty."""
+
+    def __init__(self, fd, drift_ppm, delay_us, jitter_us, truth_hz):
+        super().__init__(daemon=True)
+        self.fd = fd
+        self.rate = 1.0 + drift_ppm * 1e-6
+        self.origin = host_us()
+        self.offset = 0xFFFFFFFF - 5_000_000  # wraps 5 s into the run
+        self.delay_us = delay_us
+        self.jitter_us = jitter_us
+        self.truth_period = 1.0 / truth_hz
+        self.estimator = Estimator()
+        self.last = None
+        self.seq = 0
+        self.running = True
+
+    def device_us(self, host):
+        return int((host - self.origin) * self.rate + self.offset) & 0xFFFFFFFF
+
+    def link_delay(self):
+        # one-way delay with occasional queueing spikes (USB frames, OS scheduling)
+        delay = self.delay_us + random.expovariate(1.0 / self.jitter_us)
+        if random.random() < 0.1:
+            delay += random.uniform(1000, 5000)
+        time.sleep(delay / 1e6)
+
+    def send(self, stream_id, payload, device_time):
+        self.seq += 1
+        os.write(self.fd, build_frame(stream_id, self.seq, payload, device_time))
+
+    def run(self):
+        parser = FrameParser()
+        next_truth = time.monotonic()
+        while self.running:
+            ready, _, _ = select.select([self.fd], [], [], 0.005)
+            if ready:
+                for stream_id, _seq, _time, payload in parser.feed(os.read(self.fd, 256)):
+                    if stream_id == CMD_PING:
+                        self.handle_ping(payload)
+            if time.monotonic() >= next_truth:
+                next_truth += self.truth_period
+                now = host_us()
+                self.send(STREAM_STATUS, ("#TRUE,%d\r\n" % now).encode(), self.device_us(now))
+
+    def handle_ping(self, payload):
+        t1, prev_t1, prev_t4 = struct.unpack_from("<QQQ", payload, 0)
+        self.link_delay()
+        t2 = self.device_us(host_us())
+        if self.last and prev_t4 and prev_t1 == self.last[0]:
+            self.estimator.add(*self.last, prev_t4)
+        t3 = self.device_us(host_us())
+        self.last = (t1, t2, t3)
+        self.link_delay()
+        self.send(STREAM_SYNC, self.estimator.echo(t1, t2, t3), t3)
+
+
+def percentile(values, p):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(p / 100.0 * len(ordered)))]
+
+
+def summary(name, values):
+    if not values:
+        return "%s: no samples" % name
+    mags = [abs(v) for v in values]
+    return "%s: n=%d mean=%+.1f us |p95|=%.1f us |max|=%.1f us" % (
+        name, len(values), sum(values) / len(values), percentile(mags, 95), max(mags))
+
+
+def run(read, write, args, client, truth_errors):
+    parser = FrameParser()
+    next_ping = time.monotonic()
+    end = next_ping + args.duration
+    while time.monotonic() < end:
+        if time.monotonic() >= next_ping:
+            next_ping += args.period
+            write(client.ping())
+        chunk = read()
+        t4 = host_us()
+        for stream_id, _seq, device_time, payload in parser.feed(chunk):
+            if stream_id == STREAM_SYNC:
+                client.on_echo(payload, t4)
+            elif stream_id == STREAM_STATUS and payload.startswith(b"#TRUE,") and client.valid():
+                truth = int(payload[6:].split(b"\r")[0])
+                truth_errors.append(client.to_host(device_time) - truth)
+    print("estimate: ref_dev=%d ref_host=%d drift=%+.1f ppm points=%d" % (
+        client.ref_dev, client.ref_host, client.drift * 1e6, client.points))
+    print(summary("midpoint residual", client.residuals[len(client.residuals) // 4:]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", nargs="?", help="serial port of the device")
+    parser.add_argument("--baud", type=int, default=460800)
+    parser.add_argument("--period", type=float, default=0.5, help="ping period (s)")
+    parser.add_argument("--duration", type=float, default=30.0, help="run time (s)")
+    parser.add_argument("--simulate", action="store_true", help="use a device stand-in on a pty")
+    parser.add_argument("--drift-ppm", type=float, default=3000.0, help="stand-in clock rate error")
+    parser.add_argument("--delay-us", type=float, default=500.0, help="stand-in one-way base delay")
+    parser.add_argument("--jitter-us", type=float, default=150.0, help="stand-in mean extra delay")
+    args = parser.parse_args()
+
+    client = SyncClient()
+    truth_errors = []
+    if args.simulate:
+        master, slave = os.openpty()
+        tty.setraw(master)
+        tty.setraw(slave)  # binary frames: no echo, no CR/LF translation
+        device = DeviceStandIn(slave, args.drift_ppm, args.delay_us, args.jitter_us, truth_hz=20.0)
+        device.start()
+
+        def read():
+            ready, _, _ = select.select([master], [], [], 0.005)
+            return os.read(master, 4096) if ready else b""
+
+        run(read, lambda data: os.write(master, data), args, client, truth_errors)
+        device.running = False
+        # discard the first quarter (estimator settling)
+        print(summary("alignment error", truth_errors[len(truth_errors) // 4:]))
+    else:
+        if not args.port:
+            parser.error("port required unless --simulate")
+        import serial  # pyserial
+
+        port = serial.Serial(args.port, args.baud, timeout=0.005)
+        run(lambda: port.read(4096), port.write, args, client, truth_errors)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
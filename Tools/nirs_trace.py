@@ -0,0 +1,278 @@
+#!/usr/bin/env python3
+"""Timeline export of the MiB-NIRS firmware event trace.
+
+The firmware keeps a ring of 8-byte records (Project/TRACE.h, enabled with
+TRACE_RECORDS): DWT cycle count, event ID and a 24-bit argument for task and stage
+changes, interrupt entry/exit, I2C1 transfer completions, USART2 queue and DMA
+events, FIFO overflows, frame handoffs and deadline misses. The TRACE command (0x86)
+freezes the ring and dumps it as
+
+    #TRACE,<state>,<core_hz>,<records>,<written>,<first>,<micros>,<cycles>   (STATUS)
+    TRACE frames (0x08): first record u32, count u8, count x (cycles u32, tag u32)
+    #TRACEEND,<frames>,<records>                                            (STATUS)
+
+state 0 = dumped on command, 2 = dumped at a fault (FIFO overflow or deadline miss)
+after --arm. This tool collects the dumps of a capture (or requests one from a live
+port) and writes Chrome trace-event JSON, which chrome://tracing and
+https://ui.perfetto.dev open directly:
+
+    tracks   "acquisition" and "main loop" (task spans with their stages nested:
+             select/status/burst of the I2C chain, pipeline stages by name when the
+             capture also holds the "#PIPE" report lines), one track per interrupt,
+             instants for I2C/DMA completions, handoffs, overflows and misses, and a
+             counter of the USART2 transmit queue depth
+    time     device TIM2 microseconds (the frame time stamp axis), from the DWT cycle
+             counter of each record and the TIM2/DWT pair latched at the freeze
+
+The firmware claims a ring slot before storing its record, so the newest records of a
+dump may be torn; records with an unknown event ID (a slot never written, or half
+written) are dropped and counted in the summary on stderr, which also lists count,
+total and longest duration per span.
+
+Usage:
+    nirs_trace.py capture.bin -o trace.json              # dumps found in a capture
+    nirs_trace.py /dev/ttyACM0 -o trace.json             # freeze and dump now
+    nirs_trace.py /dev/ttyACM0 --arm -o trace.json       # wait for the next fault
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import time as systime
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from nirs_frames import (CMD_TRACE, STREAM_STATUS, STREAM_TRACE, FrameParser,  # noqa: E402
+                         build_frame, open_source)
+
+TRACE_TASK, TRACE_STAGE, TRACE_IRQ = 0x01, 0x02, 0x03
+TRACE_I2C_DONE, TRACE_UART_DONE, TRACE_UART_QUEUE = 0x04, 0x05, 0x06
+TRACE_FIFO_OVF, TRACE_HANDOFF, TRACE_DEADLINE_MISS = 0x07, 0x08, 0x09
+TRACE_END = 0x80
+TRACE_KINDS = range(TRACE_TASK, TRACE_DEADLINE_MISS + 1)
+STATE_DUMP, STATE_ARMED, STATE_FAULT = 0, 1, 2
+
+TASKS = {0: "acquisition", 1: "main loop"}
+STAGES = {0: {0: "slot", 1: "select", 2: "status", 3: "burst", 4: "commit"},
+          1: {0: "pop", 1: "report"}}
+STAGE_PIPE = 2                  # DEADLINE_STAGE_PIPE
+IRQS = {15: "SysTick", 22: "EXTI0", 23: "EXTI1", 33: "DMA1_CH7", 44: "TIM2", 47: "I2C1", 54: "USART2"}
+TID_IRQ = 10                    # interrupt tracks: TID_IRQ + exception number
+TID_LINK = 100                  # I2C / UART completion instants
+
+
+class Dump:
+    """One frozen ring: header values and the records received for it."""
+
+    def __init__(self, fields):
+        (self.state, self.core_hz, self.capacity, self.written, self.first,
+         self.micros, self.cycles) = (int(v) for v in fields[:7])
+        self.records = {}
+        self.complete = False
+        self.torn = 0
+
+    def ordered(self):
+        """Records oldest first, without the torn ones (unknown event ID)."""
+        records = [self.records[k] for k in sorted(self.records)]
+        valid = [r for r in records if ((r[1] >> 24) & ~TRACE_END) in TRACE_KINDS]
+        self.torn = len(records) - len(valid)
+        return valid
+
+    def missing(self):
+        return (self.written - self.first) - len(self.records)
+
+
+def collect(frames, dumps, pipe_names):
+    """Feed decoded frames; returns True once a dump with records is complete."""
+    done = False
+    for stream_id, _seq, _time, payload in frames:
+        if stream_id == STREAM_STATUS:
+            text = payload.decode("ascii", "replace").strip()
+            fields = text.split(",")
+            if fields[0] == "#TRACE" and len(fields) >= 8:
+                dumps.append(Dump(fields[1:]))
+            elif fields[0] == "#TRACEEND" and dumps:
+                dumps[-1].complete = True
+                done = done or dumps[-1].state != STATE_ARMED
+            elif fields[0] == "#PIPE" and len(fields) >= 3:
+                pipe_names[int(fields[1])] = fields[2]
+        elif stream_id == STREAM_TRACE and dumps:
+            first, count = struct.unpack_from("<IB", payload, 0)
+            for k in range(count):
+                dumps[-1].records[first + k] = struct.unpack_from("<II", payload, 5 + 8 * k)
+    return done
+
+
+def stage_name(task, stage, pipe_names):
+    if task == 1 and stage >= STAGE_PIPE:
+        n = stage - STAGE_PIPE
+        return pipe_names.get(n, "stage %d" % n)
+    return STAGES.get(task, {}).get(stage, "stage %d" % stage)
+
+
+def timeline(dump, pid, pipe_names, stats):
+    """Chrome trace events of one dump."""
+    records = dump.ordered()
+    if not records:
+        return []
+    # unwrap the 32-bit cycle counter with signed steps (records of preempting
+    # interrupts may be a few cycles out of order)
+    t, last = 0, records[0][0]
+    absolute = []
+    for cycles, tag in records:
+        t += ((cycles - last + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+        last = cycles
+        absolute.append((t, tag))
+    t_freeze = t + ((dump.cycles - last + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+    to_us = lambda c: dump.micros + (c - t_freeze) * 1e6 / dump.core_hz
+
+    label = {STATE_DUMP: "dump", STATE_FAULT: "fault"}.get(dump.state, "trace")
+    events = [{"ph": "M", "pid": pid, "name": "process_name",
+               "args": {"name": "MiB-NIRS %s @%d" % (label, dump.micros)}}]
+    tracks = {}
+    open_spans = {}             # tid -> stack of (name, start µs)
+    open_stage = {}             # task -> stage name
+
+    def track(tid, name):
+        if tid not in tracks:
+            tracks[tid] = name
+            events.append({"ph": "M", "pid": pid, "tid": tid, "name": "thread_name", "args": {"name": name}})
+
+    def begin(tid, name, ts, args=None):
+        open_spans.setdefault(tid, []).append((name, ts))
+        ev = {"ph": "B", "pid": pid, "tid": tid, "name": name, "ts": ts}
+        if args:
+            ev["args"] = args
+        events.append(ev)
+
+    def end(tid, name, ts):
+        stack = open_spans.get(tid)
+        if not stack or stack[-1][0] != name:
+            return              # began before the oldest record
+        _, start = stack.pop()
+        events.append({"ph": "E", "pid": pid, "tid": tid, "name": name, "ts": ts})
+        st = stats.setdefault(name, [0, 0.0, 0.0])
+        st[0] += 1
+        st[1] += ts - start
+        st[2] = max(st[2], ts - start)
+
+    def instant(tid, name, ts, args):
+        events.append({"ph": "i", "s": "t", "pid": pid, "tid": tid, "name": name, "ts": ts, "args": args})
+
+    for c, tag in absolute:
+        ts = to_us(c)
+        event, arg = tag >> 24, tag & 0xFFFFFF
+        kind, is_end = event & ~TRACE_END, bool(event & TRACE_END)
+        if kind == TRACE_TASK:
+            task = arg
+            tid = 1 + task
+            track(tid, TASKS.get(task, "task %d" % task))
+            name = TASKS.get(task, "task %d" % task)
+            if is_end:
+                if task in open_stage:
+                    end(tid, open_stage.pop(task), ts)
+                end(tid, name, ts)
+            else:
+                begin(tid, name, ts)
+                open_stage[task] = stage_name(task, 0, pipe_names)
+                begin(tid, open_stage[task], ts)
+        elif kind == TRACE_STAGE:
+            task, stage = arg >> 8, arg & 0xFF
+            tid = 1 + task
+            if task not in open_stage:
+                continue        # task began before the oldest record
+            end(tid, open_stage[task], ts)
+            open_stage[task] = stage_name(task, stage, pipe_names)
+            begin(tid, open_stage[task], ts)
+        elif kind == TRACE_IRQ:
+            name = IRQS.get(arg, "IRQ %d" % (arg - 16))
+            tid = TID_IRQ + arg
+            track(tid, "irq " + name)
+            if is_end:
+                end(tid, name, ts)
+            else:
+                begin(tid, name, ts)
+        elif kind == TRACE_I2C_DONE:
+            track(TID_LINK, "I2C1 / USART2")
+            instant(TID_LINK, "i2c done" if arg else "i2c fail", ts, {"ok": arg})
+        elif kind == TRACE_UART_DONE:
+            track(TID_LINK, "I2C1 / USART2")
+            instant(TID_LINK, "uart dma done", ts, {"queued": arg})
+            events.append({"ph": "C", "pid": pid, "name": "uart queue", "ts": ts, "args": {"frames": arg}})
+        elif kind == TRACE_UART_QUEUE:
+            events.append({"ph": "C", "pid": pid, "name": "uart queue", "ts": ts, "args": {"frames": arg & 0xFF}})
+        elif kind == TRACE_FIFO_OVF:
+            track(1, TASKS[0])
+            instant(1, "fifo overflow", ts, {"sensor": arg >> 8, "lost": arg & 0xFF})
+        elif kind == TRACE_HANDOFF:
+            track(1, TASKS[0])
+            instant(1, "handoff", ts, {"sensor": arg})
+        elif kind == TRACE_DEADLINE_MISS:
+            task, stage = arg >> 8, arg & 0xFF
+            track(1 + task, TASKS.get(task, "task %d" % task))
+            instant(1 + task, "deadline miss", ts, {"stage": stage_name(task, stage, pipe_names)})
+    # close what was still running at the freeze
+    ts_end = to_us(t_freeze)
+    for tid, stack in open_spans.items():
+        for name, _ in reversed(list(stack)):
+            end(tid, name, ts_end)
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="binary capture file or serial port")
+    parser.add_argument("--baud", type=int, default=460800)
+    parser.add_argument("-o", "--out", help="trace JSON (default stdout)")
+    parser.add_argument("--arm", action="store_true",
+                        help="live port: dump at the next FIFO overflow or deadline miss instead of now")
+    parser.add_argument("--timeout", type=float, default=30.0,
+                        help="live port: seconds to wait for the dump (--arm: for the fault)")
+    parser.add_argument("--save", metavar="PATH", help="live port: also store the received bytes")
+    args = parser.parse_args()
+
+    read, write = open_source(args.source, args.baud)
+    live = write is not None
+    if live:
+        write(build_frame(CMD_TRACE, 0, bytes([1 if args.arm else 0]), 0))
+    save = open(args.save, "wb") if args.save and live else None
+    frames = FrameParser()
+    dumps, pipe_names = [], {}
+    deadline = systime.monotonic() + args.timeout
+    try:
+        while True:
+            chunk = read()
+            if save and chunk:
+                save.write(chunk)
+            if not chunk and not live:
+                break
+            if collect(frames.feed(chunk), dumps, pipe_names) and live:
+                break
+            if live and systime.monotonic() > deadline:
+                print("# timeout: no complete dump", file=sys.stderr)
+                break
+    except KeyboardInterrupt:
+        pass
+    if save:
+        save.close()
+
+    events, stats = [], {}
+    for pid, dump in enumerate(d for d in dumps if d.records):
+        events.extend(timeline(dump, pid + 1, pipe_names, stats))
+        print("# dump %d: state %d, %d records (%d missing, %d torn), %s" %
+              (pid + 1, dump.state, len(dump.records), dump.missing(), dump.torn,
+               "complete" if dump.complete else "truncated"), file=sys.stderr)
+    out = open(args.out, "w") if args.out else sys.stdout
+    json.dump({"traceEvents": events, "displayTimeUnit": "ns"}, out)
+    if args.out:
+        out.close()
+    print("span,count,total_us,max_us", file=sys.stderr)
+    for name, (count, total, longest) in sorted(stats.items(), key=lambda kv: -kv[1][1]):
+        print("%s,%d,%.1f,%.1f" % (name, count, total, longest), file=sys.stderr)
+    print("# crc_errors=%d resyncs=%d" % (frames.crc_errors, frames.resyncs), file=sys.stderr)
+    return 0 if any(d.records for d in dumps) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
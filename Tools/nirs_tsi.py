@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""Host check of the multi-distance tissue saturation index of the MiB-NIRS firmware.
+
+Builds Project/NIRS.c with the host C compiler and calls NIRS_TsiReset/Add/Solve()
+through ctypes, so the code under test is the float32 code of STAGE_TSI. Synthetic
+tissue with a known saturation is "measured" at the configured source-detector
+distances:
+
+    tissue      hemoglobin only: µa(λ) = ln10 · (ε_HbO2(λ)·HbO2 + ε_HHb(λ)·HHb),
+                µs'(λ) = MUS800 · (1 − h·λ) / (1 − h·800), ε and h from NIRS.h
+    detectors   diffuse reflectance R(ρ) of a semi-infinite medium, either the
+                asymptotic form ∝ exp(−µeff·ρ)/ρ² that the SRS formula assumes, or
+                Farrell's dipole model (n = 1.4, extrapolated boundary)
+    currents    I = scale · R(ρ) with the nearest detector at --top-na, white current
+                noise averaged over one interval (--noise-na / √samples) and the
+                15.625 pA ADC step
+
+and for each true TSI the table gives the firmware estimate and its error. "ref" is the
+same SRS formula in double precision on the same currents; the firmware must agree
+with it to float rounding (exit status 1 otherwise). The asymptotic rows therefore
+measure the implementation, the Farrell rows the bias of the SRS approximation at the
+chosen distances.
+
+Usage:
+    nirs_tsi.py                                 # 20/25/30/35 mm, TSI 40–90 %
+    nirs_tsi.py --distances 15 20 25 30 35 40 45 50 --noise-na 1.0
+    nirs_tsi.py --thb 80 --mus 0.8 --interval-samples 100
+"""
+
+import argparse
+import ctypes
+import math
+import os
+import random
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from nirs_host import LSB_NA, ROOT, WAVELENGTHS, Current, load  # noqa: E402
+
+REF_TOL_PCT = 0.05          # float32 firmware vs double reference (TSI %)
+REFRACTIVE_INDEX = 1.4
+
+
+class Fit(ctypes.Structure):
+    _fields_ = [("n", ctypes.c_uint8), ("x0", ctypes.c_float), ("y0", ctypes.c_float * WAVELENGTHS),
+                ("sx", ctypes.c_float), ("sxx", ctypes.c_float),
+                ("sy", ctypes.c_float * WAVELENGTHS), ("sxy", ctypes.c_float * WAVELENGTHS)]
+
+
+class Result(ctypes.Structure):
+    _fields_ = [("tsi", ctypes.c_float), ("slope", ctypes.c_float * WAVELENGTHS),
+                ("distance_mm", ctypes.c_float)]
+
+
+class Nirs:
+    """NIRS_TsiReset/Add/Solve() of the host build."""
+
+    def __init__(self, cc, root):
+        self.dll = load(cc, root, ["NIRS.c"])
+        self.dll.NIRS_TsiAdd.argtypes = [ctypes.POINTER(Fit), ctypes.c_float, ctypes.POINTER(Current)]
+        self.dll.NIRS_TsiAdd.restype = ctypes.c_uint8
+        self.dll.NIRS_TsiSolve.restype = ctypes.c_uint8
+
+    def tsi(self, distances, currents):
+        fit, result, cur = Fit(), Result(), Current()
+        self.dll.NIRS_TsiReset(ctypes.byref(fit))
+        for rho, (red, ir) in zip(distances, currents):
+            cur.red, cur.ir = red, ir
+            self.dll.NIRS_TsiAdd(ctypes.byref(fit), rho, ctypes.byref(cur))
+        ok = self.dll.NIRS_TsiSolve(ctypes.byref(fit), ctypes.byref(result))
+        return result.tsi if ok else None
+
+
+def constants(root):
+    text = open(os.path.join(root, "NIRS.h"), encoding="utf-8", errors="replace").read()
+    value = lambda name: float(re.search(r"#define\s+%s\s+([-\d.eE]+)f?" % name, text).group(1))
+    eps = [[value("NIRS_EPS_HBO2_RED"), value("NIRS_EPS_HHB_RED")],
+           [value("NIRS_EPS_HBO2_IR"), value("NIRS_EPS_HHB_IR")]]
+    return eps, [value("NIRS_RED_NM"), value("NIRS_IR_NM")], value("NIRS_SRS_SCATTER_SLOPE")
+
+
+def reflectance(rho, mua, musp, model):
+    """Diffuse reflectance at distance rho (mm); mua, musp in mm⁻¹ (arbitrary scale)."""
+    mueff = math.sqrt(3.0 * mua * (mua + musp))
+    if model == "asymptotic":
+        return math.exp(-mueff * rho) / (rho * rho)
+    n = REFRACTIVE_INDEX
+    rd = -1.440 / n ** 2 + 0.710 / n + 0.668 + 0.0636 * n
+    a = (1.0 + rd) / (1.0 - rd)
+    z0 = 1.0 / (mua + musp)
+    zb = 2.0 * a / (3.0 * (mua + musp))
+    r1 = math.hypot(z0, rho)
+    r2 = math.hypot(z0 + 2.0 * zb, rho)
+    return (z0 * (mueff + 1.0 / r1) * math.exp(-mueff * r1) / r1 ** 2
+            + (z0 + 2.0 * zb) * (mueff + 1.0 / r2) * math.exp(-mueff * r2) / r2 ** 2) / (4.0 * math.pi)
+
+
+def measure(distances, tsi, thb_um, mus800, eps, nm, h, model, top_na, noise_na, samples, rng):
+    """Mean currents (nA) per detector over one interval."""
+    hbo2, hhb = thb_um * 1e-6 * tsi / 100.0, thb_um * 1e-6 * (1.0 - tsi / 100.0)
+    curves = []
+    for l in range(WAVELENGTHS):
+        mua = math.log(10) * (eps[l][0] * hbo2 + eps[l][1] * hhb) / 10.0   # cm⁻¹ → mm⁻¹
+        musp = mus800 * (1.0 - h * nm[l]) / (1.0 - h * 800.0)
+        curves.append([reflectance(rho, mua, musp, model) for rho in distances])
+    out = []
+    for k in range(len(distances)):
+        sample = []
+        for l in range(WAVELENGTHS):
+            i_na = top_na * curves[l][k] / max(curves[l])
+            i_na += rng.gauss(0.0, noise_na / math.sqrt(samples))
+            sample.append(round(i_na / LSB_NA) * LSB_NA)
+        out.append(tuple(sample))
+    return out
+
+
+def reference(distances, currents, eps, nm, h):
+    """The SRS formula of NIRS_TsiSolve() in double precision."""
+    n = len(distances)
+    xm = sum(distances) / n
+    sxx = sum((x - xm) ** 2 for x in distances)
+    mua = []
+    for l in range(WAVELENGTHS):
+        ys = [-math.log10(c[l]) for c in currents]
+        ym = sum(ys) / n
+        slope = sum((x - xm) * (y - ym) for x, y in zip(distances, ys)) / sxx
+        root = math.log(10) * slope - 2.0 / xm
+        if root <= 0:
+            return None
+        mua.append(root * root / (3.0 * (1.0 - h * nm[l])))
+    det = eps[0][0] * eps[1][1] - eps[0][1] * eps[1][0]
+    hbo2 = (eps[1][1] * mua[0] - eps[0][1] * mua[1]) / det
+    hhb = (eps[0][0] * mua[1] - eps[1][0] * mua[0]) / det
+    if hbo2 < 0 or hhb < 0:
+        return None
+    return 100.0 * hbo2 / (hbo2 + hhb)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--distances", type=float, nargs="+", default=[20.0, 25.0, 30.0, 35.0],
+                        help="source-detector distances (mm), as TSI_DISTANCES_MM")
+    parser.add_argument("--tsi", type=float, nargs="+", default=[40.0, 50.0, 60.0, 70.0, 80.0, 90.0],
+                        help="true saturations to test (%%)")
+    parser.add_argument("--thb", type=float, default=100.0, help="total hemoglobin (µM)")
+    parser.add_argument("--mus", type=float, default=0.8, help="µs' at 800 nm (mm⁻¹)")
+    parser.add_argument("--top-na", type=float, default=3000.0, help="current of the nearest detector (nA)")
+    parser.add_argument("--noise-na", type=float, default=0.5, help="white current noise per sample (nA rms)")
+    parser.add_argument("--interval-samples", type=int, default=50, help="samples averaged per interval")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"), help="host C compiler")
+    parser.add_argument("--root", default=ROOT, help="firmware source directory")
+    args = parser.parse_args()
+
+    eps, nm, h = constants(args.root)
+    nirs = Nirs(args.cc, args.root)
+    rng = random.Random(args.seed)
+    out = sys.stdout
+    out.write("# distances %s mm, THb %g µM, µs'(800) %g/mm, %g nA nearest, %g nA noise / %d samples\n"
+              % ("/".join("%g" % d for d in args.distances), args.thb, args.mus, args.top_na,
+                 args.noise_na, args.interval_samples))
+    out.write("model,tsi_true,tsi_firmware,error,ref_diff\n")
+    failures = 0
+    for model in ("asymptotic", "farrell"):
+        for tsi in args.tsi:
+            currents = measure(args.distances, tsi, args.thb, args.mus, eps, nm, h, model,
+                               args.top_na, args.noise_na, args.interval_samples, rng)
+            firmware = nirs.tsi(args.distances, currents)
+            ref = reference(args.distances, currents, eps, nm, h)
+            if firmware is None or ref is None:
+                ok = firmware is None and ref is None
+                out.write("%s,%g,%s,,%s\n" % (model, tsi, "invalid" if firmware is None else "%.2f" % firmware,
+                                              "" if ok else "FAIL"))
+            else:
+                diff = abs(firmware - ref)
+                ok = diff <= REF_TOL_PCT
+                out.write("%s,%g,%.2f,%+.2f,%.1e%s\n" % (model, tsi, firmware, firmware - tsi, diff,
+                                                         "" if ok else ",FAIL"))
+            failures += not ok
+    print("PASS" if failures == 0 else "FAIL (%d)" % failures)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())